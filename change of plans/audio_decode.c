@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "audio_input.h"
+#include "cw_audio.h"
+
+// Decodes CW from receiver audio: a WAV file, raw 16-bit PCM with -rate, or
+// either from a pipe or stdin ("-"). The tone is found by itself unless
+// -tone gives it, and the sender's speed is followed from -wpm on unless
+// -fixed holds it there. Stereo is mixed down to mono. Finished lines are
+// printed with their time in the recording, and appended to -o. Speed
+// and counts go to stderr at the end.
+//
+//   arecord -f S16_LE -r 8000 -t raw | audio_decode -rate 8000 -
+//   audio_decode -o nightly.txt archive/2024-03-01.wav
+//
+// Usage: audio_decode [-tone Hz] [-wpm N [-fixed]] [-rate Hz] [-debounce spec] [-o transcript] file.wav|-
+//
+// gcc -O2 -o audio_decode audio_decode.c audio_input.c cw_audio.c debounce.c edge_sampler.c rt_profile.c
+//     morse_decoder.c -lm -lpthread
+
+typedef struct {
+    FILE *transcript;
+} DecodeOutput;
+
+static void print_line(int event, char c, const char *text, uint64_t t_us, void *ctx) {
+    DecodeOutput *out = (DecodeOutput *)ctx;
+    (void)c;
+    if (event != MORSE_EVENT_LINE) {
+        return;
+    }
+    printf("[%10.3f] %s\n", t_us / 1e6, text);
+    fflush(stdout);
+    if (out->transcript != NULL) {
+        fprintf(out->transcript, "%s\n", text);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL;
+    const char *transcript_path = NULL;
+    uint32_t raw_rate = 0;
+    CwConfig config;
+
+    cw_config_default(&config);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-fixed") == 0) {
+            config.fixed_wpm = 1;
+        } else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+            path = argv[i];
+        } else if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return -1;
+        } else if (strcmp(argv[i], "-tone") == 0) {
+            config.tone_hz = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "-wpm") == 0) {
+            config.wpm = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-rate") == 0) {
+            raw_rate = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-debounce") == 0) {
+            if (debounce_parse(argv[++i], &config.debounce) != 0) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "-o") == 0) {
+            transcript_path = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (path == NULL || config.wpm < CW_MIN_WPM || config.wpm > CW_MAX_WPM) {
+        fprintf(stderr, "Usage: %s [-tone Hz] [-wpm %d-%d [-fixed]] [-rate Hz] [-debounce spec] [-o transcript] "
+                        "file.wav|-\n", argv[0], CW_MIN_WPM, CW_MAX_WPM);
+        return -1;
+    }
+
+    static AudioSource src;  // Holds a read block
+    if (audio_open(&src, path, raw_rate) != 0) {
+        return -1;
+    }
+    DecodeOutput out = {NULL};
+    if (transcript_path != NULL && (out.transcript = fopen(transcript_path, "a")) == NULL) {
+        perror("Failed to open transcript");
+        audio_close(&src);
+        return -1;
+    }
+    static CwAudio cw;
+    if (cw_audio_init(&cw, src.rate_hz, &config, print_line, &out) != 0) {
+        audio_close(&src);
+        return -1;
+    }
+
+    static float frames[AUDIO_READ_FRAMES * AUDIO_CHANNELS_MAX];
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    size_t n;
+    while ((n = audio_read(&src, frames, AUDIO_READ_FRAMES)) > 0) {
+        if (src.channels > 1) {
+            for (size_t i = 0; i < n; i++) {
+                float sum = 0.0f;
+                for (int c = 0; c < src.channels; c++) {
+                    sum += frames[i * (size_t)src.channels + (size_t)c];
+                }
+                frames[i] = sum / (float)src.channels;
+            }
+        }
+        cw_audio_process(&cw, frames, n);
+    }
+    cw_audio_finish(&cw);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double audio_s = (double)src.frames / src.rate_hz;
+    double cpu_s = (double)(end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+    fprintf(stderr, "%.1f s of audio at %u Hz in %.3f s (%.0fx real time)\n", audio_s, src.rate_hz, cpu_s,
+            cpu_s > 0 ? audio_s / cpu_s : 0.0);
+    cw_audio_report(&cw, stderr);
+
+    int rc = 0;
+    if (out.transcript != NULL && fclose(out.transcript) != 0) {
+        perror("Failed to write transcript");
+        rc = -1;
+    }
+    cw_audio_free(&cw);
+    audio_close(&src);
+    return rc;
+}
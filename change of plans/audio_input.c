@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <string.h>
+#include "audio_input.h"
+
+static uint32_t le16(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8;
+}
+
+static uint32_t le32(const unsigned char *p) {
+    return le16(p) | le16(p + 2) << 16;
+}
+
+// Function to read past bytes a pipe can't seek over
+static int skip_bytes(FILE *file, uint32_t count) {
+    unsigned char scratch[256];
+    while (count > 0) {
+        size_t n = count < sizeof(scratch) ? count : sizeof(scratch);
+        if (fread(scratch, 1, n, file) != n) {
+            return -1;
+        }
+        count -= (uint32_t)n;
+    }
+    return 0;
+}
+
+// Function to read the RIFF header and chunks up to the start of the samples
+static int read_wav_header(AudioSource *src, const char *path) {
+    unsigned char buf[40];
+    if (fread(buf, 1, 12, src->file) != 12 || memcmp(buf, "RIFF", 4) != 0 || memcmp(buf + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "%s: not a WAV file (give -rate for raw PCM)\n", path);
+        return -1;
+    }
+
+    int have_format = 0;
+    while (fread(buf, 1, 8, src->file) == 8) {
+        uint32_t size = le32(buf + 4);
+        if (memcmp(buf, "fmt ", 4) == 0) {
+            uint32_t take = size < sizeof(buf) ? size : sizeof(buf);
+            if (size < 16 || fread(buf, 1, take, src->file) != take || skip_bytes(src->file, size - take + (size & 1))) {
+                break;
+            }
+            src->format = (int)le16(buf);
+            src->channels = (int)le16(buf + 2);
+            src->rate_hz = le32(buf + 4);
+            src->bytes_per_sample = (int)le16(buf + 14) / 8;
+            if (src->format == AUDIO_FORMAT_EXTENSIBLE && take >= 26) {
+                src->format = (int)le16(buf + 24);  // First two bytes of the subformat GUID
+            }
+            have_format = 1;
+        } else if (memcmp(buf, "data", 4) == 0) {
+            if (!have_format) {
+                break;
+            }
+            src->remaining = size == 0 || size == 0xffffffffU ? UINT64_MAX : size;
+            return 0;
+        } else if (skip_bytes(src->file, size + (size & 1)) != 0) {
+            break;
+        }
+    }
+    fprintf(stderr, "%s: no format or data chunk\n", path);
+    return -1;
+}
+
+// Function to open a WAV file, or raw 16-bit PCM at raw_rate_hz when that
+// is nonzero. path "-" reads stdin.
+int audio_open(AudioSource *src, const char *path, uint32_t raw_rate_hz) {
+    memset(src, 0, sizeof(*src));
+    if (strcmp(path, "-") == 0) {
+        src->file = stdin;
+    } else {
+        src->file = fopen(path, "rb");
+        if (src->file == NULL) {
+            perror("Failed to open audio input");
+            return -1;
+        }
+        src->close_file = 1;
+    }
+
+    if (raw_rate_hz > 0) {
+        src->rate_hz = raw_rate_hz;
+        src->channels = 1;
+        src->format = AUDIO_FORMAT_PCM;
+        src->bytes_per_sample = 2;
+        src->remaining = UINT64_MAX;
+    } else if (read_wav_header(src, path) != 0) {
+        audio_close(src);
+        return -1;
+    }
+
+    int pcm = src->format == AUDIO_FORMAT_PCM && src->bytes_per_sample >= 1 && src->bytes_per_sample <= 4;
+    int flt = src->format == AUDIO_FORMAT_FLOAT && src->bytes_per_sample == 4;
+    if ((!pcm && !flt) || src->channels < 1 || src->channels > AUDIO_CHANNELS_MAX || src->rate_hz == 0) {
+        fprintf(stderr, "%s: unsupported audio (format %d, %d channels, %d-bit, %u Hz)\n", path, src->format,
+                src->channels, src->bytes_per_sample * 8, src->rate_hz);
+        audio_close(src);
+        return -1;
+    }
+    return 0;
+}
+
+// Function to read up to max_frames (at most AUDIO_READ_FRAMES) frames as
+// interleaved floats in -1..1. Returns the frames read, 0 at the end.
+size_t audio_read(AudioSource *src, float *out, size_t max_frames) {
+    size_t frame_bytes = (size_t)src->channels * (size_t)src->bytes_per_sample;
+    if (max_frames > AUDIO_READ_FRAMES) {
+        max_frames = AUDIO_READ_FRAMES;
+    }
+    size_t want = max_frames * frame_bytes;
+    if (src->remaining < want) {
+        want = (size_t)src->remaining - (size_t)src->remaining % frame_bytes;
+    }
+    size_t got = fread(src->raw, 1, want, src->file);
+    size_t frames = got / frame_bytes;
+    size_t samples = frames * (size_t)src->channels;
+    if (src->remaining != UINT64_MAX) {
+        src->remaining -= got;
+    }
+
+    const unsigned char *p = src->raw;
+    switch (src->format == AUDIO_FORMAT_FLOAT ? 0 : src->bytes_per_sample) {
+    case 0:
+        memcpy(out, p, samples * sizeof(float));  // Little-endian IEEE, as on the Pi and x86
+        break;
+    case 1:
+        for (size_t i = 0; i < samples; i++) {
+            out[i] = ((int)p[i] - 128) / 128.0f;  // 8-bit WAV is unsigned
+        }
+        break;
+    case 2:
+        for (size_t i = 0; i < samples; i++, p += 2) {
+            out[i] = (int16_t)le16(p) / 32768.0f;
+        }
+        break;
+    case 3:
+        for (size_t i = 0; i < samples; i++, p += 3) {
+            out[i] = (int32_t)(le16(p) << 8 | (uint32_t)p[2] << 24) / 2147483648.0f;
+        }
+        break;
+    default:
+        for (size_t i = 0; i < samples; i++, p += 4) {
+            out[i] = (int32_t)le32(p) / 2147483648.0f;
+        }
+        break;
+    }
+    src->frames += frames;
+    return frames;
+}
+
+void audio_close(AudioSource *src) {
+    if (src->close_file && src->file != NULL) {
+        fclose(src->file);
+    }
+    src->file = NULL;
+}
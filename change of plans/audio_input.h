@@ -0,0 +1,39 @@
+#ifndef AUDIO_INPUT_H
+#define AUDIO_INPUT_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// PCM reader for the audio front ends. A source is a WAV file (8, 16, 24
+// or 32-bit integer PCM, or 32-bit float) or headerless 16-bit
+// little-endian PCM at a rate given by the caller. Either can come from a
+// file, a pipe or stdin ("-"). Input is read in blocks and never seeked,
+// so a pipe from a receiver or `arecord -t raw` works the same as a file,
+// and memory stays at one block however long the recording is. A WAV
+// streamed with an unknown length (data size 0 or 0xffffffff) is read to
+// the end of the input.
+
+#define AUDIO_READ_FRAMES 4096
+#define AUDIO_CHANNELS_MAX 8
+
+#define AUDIO_FORMAT_PCM 1      // WAV format tags
+#define AUDIO_FORMAT_FLOAT 3
+#define AUDIO_FORMAT_EXTENSIBLE 0xfffe
+
+typedef struct {
+    FILE *file;
+    int close_file;             // 0 for stdin
+    uint32_t rate_hz;
+    int channels;
+    int format;                 // AUDIO_FORMAT_PCM or _FLOAT
+    int bytes_per_sample;
+    uint64_t remaining;         // Data bytes left, UINT64_MAX when unknown
+    uint64_t frames;            // Frames read so far
+    unsigned char raw[AUDIO_READ_FRAMES * AUDIO_CHANNELS_MAX * 4];
+} AudioSource;
+
+int audio_open(AudioSource *src, const char *path, uint32_t raw_rate_hz);
+size_t audio_read(AudioSource *src, float *out, size_t max_frames);
+void audio_close(AudioSource *src);
+
+#endif
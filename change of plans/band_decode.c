@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "audio_input.h"
+#include "cw_channelizer.h"
+
+// Decodes every CW signal in a wideband recording: a receiver's audio
+// passband (a WAV file, raw 16-bit PCM with -rate, or either from a pipe
+// or stdin "-"), or with -iq a two-channel I/Q WAV, where frequencies are
+// offsets from the centre. Each finished line is printed with its time,
+// frequency, signal number and speed, and appended to -o with its time and
+// frequency. -lo/-hi narrow the band searched. The work is spread over -j
+// threads (default: every core).
+//
+//   arecord -f S16_LE -r 12000 -t raw | band_decode -rate 12000 -
+//   band_decode -iq -j 8 -o 40m.txt 40m_96k_iq.wav
+//
+// Usage: band_decode [-iq] [-lo Hz] [-hi Hz] [-wpm N [-fixed]] [-rate Hz] [-debounce spec] [-j threads]
+//                    [-o transcript] file.wav|-
+//
+// gcc -O2 -o band_decode band_decode.c audio_input.c cw_channelizer.c cw_audio.c work_pool.c debounce.c
+//     edge_sampler.c rt_profile.c morse_decoder.c -lm -lpthread
+
+typedef struct {
+    FILE *transcript;
+    pthread_mutex_t lock;       // Signals are decoded on several threads
+} BandOutput;
+
+static void print_line(const CwSignal *sig, int event, char c, const char *text, uint64_t t_us, void *ctx) {
+    BandOutput *out = (BandOutput *)ctx;
+    (void)c;
+    if (event != MORSE_EVENT_LINE) {
+        return;
+    }
+    pthread_mutex_lock(&out->lock);
+    printf("[%10.3f] %8.1f Hz #%-4d %2d WPM  %s\n", t_us / 1e6, sig->hz, sig->id, cw_channel_wpm(&sig->channel),
+           text);
+    fflush(stdout);
+    if (out->transcript != NULL) {
+        fprintf(out->transcript, "%.3f %.1f %s\n", t_us / 1e6, sig->hz, text);
+    }
+    pthread_mutex_unlock(&out->lock);
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL;
+    const char *transcript_path = NULL;
+    uint32_t raw_rate = 0;
+    int iq = 0;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    float lo_hz = 0.0f, hi_hz = 0.0f;
+    int have_lo = 0, have_hi = 0;
+    CwConfig config;
+
+    cw_config_default(&config);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-fixed") == 0) {
+            config.fixed_wpm = 1;
+        } else if (strcmp(argv[i], "-iq") == 0) {
+            iq = 1;
+        } else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+            path = argv[i];
+        } else if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return -1;
+        } else if (strcmp(argv[i], "-lo") == 0) {
+            lo_hz = (float)atof(argv[++i]);
+            have_lo = 1;
+        } else if (strcmp(argv[i], "-hi") == 0) {
+            hi_hz = (float)atof(argv[++i]);
+            have_hi = 1;
+        } else if (strcmp(argv[i], "-wpm") == 0) {
+            config.wpm = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-rate") == 0) {
+            raw_rate = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-debounce") == 0) {
+            if (debounce_parse(argv[++i], &config.debounce) != 0) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "-j") == 0) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0) {
+            transcript_path = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (path == NULL || config.wpm < CW_MIN_WPM || config.wpm > CW_MAX_WPM) {
+        fprintf(stderr, "Usage: %s [-iq] [-lo Hz] [-hi Hz] [-wpm %d-%d [-fixed]] [-rate Hz] [-debounce spec] "
+                        "[-j threads]\n       [-o transcript] file.wav|-\n", argv[0], CW_MIN_WPM, CW_MAX_WPM);
+        return -1;
+    }
+
+    static AudioSource src;  // Holds a read block
+    if (audio_open(&src, path, raw_rate) != 0) {
+        return -1;
+    }
+    if (iq && src.channels != 2) {
+        fprintf(stderr, "%s: -iq needs two channels, I and Q (has %d)\n", path, src.channels);
+        audio_close(&src);
+        return -1;
+    }
+    if (!have_lo) {
+        lo_hz = iq ? -CW_SEARCH_EDGE * (float)src.rate_hz : CW_SEARCH_LO_HZ;
+    }
+    if (!have_hi) {
+        hi_hz = CW_SEARCH_EDGE * (float)src.rate_hz;
+    }
+
+    BandOutput out = {NULL, PTHREAD_MUTEX_INITIALIZER};
+    if (transcript_path != NULL && (out.transcript = fopen(transcript_path, "a")) == NULL) {
+        perror("Failed to open transcript");
+        audio_close(&src);
+        return -1;
+    }
+    static CwChannelizer band;
+    if (cw_channelizer_init(&band, src.rate_hz, iq, lo_hz, hi_hz, &config, threads, print_line, &out) != 0) {
+        audio_close(&src);
+        return -1;
+    }
+
+    static float frames[AUDIO_READ_FRAMES * AUDIO_CHANNELS_MAX];
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    size_t n;
+    while ((n = audio_read(&src, frames, AUDIO_READ_FRAMES)) > 0) {
+        if (!iq && src.channels > 1) {
+            for (size_t i = 0; i < n; i++) {
+                float sum = 0.0f;
+                for (int c = 0; c < src.channels; c++) {
+                    sum += frames[i * (size_t)src.channels + (size_t)c];
+                }
+                frames[i] = sum / (float)src.channels;
+            }
+        }
+        cw_channelizer_process(&band, frames, n);
+    }
+    cw_channelizer_finish(&band);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double audio_s = (double)src.frames / src.rate_hz;
+    double cpu_s = (double)(end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+    fprintf(stderr, "%.1f s of %s at %u Hz in %.3f s (%.0fx real time)\n", audio_s, iq ? "I/Q" : "audio",
+            src.rate_hz, cpu_s, cpu_s > 0 ? audio_s / cpu_s : 0.0);
+    cw_channelizer_report(&band, stderr);
+
+    int rc = 0;
+    if (out.transcript != NULL && fclose(out.transcript) != 0) {
+        perror("Failed to write transcript");
+        rc = -1;
+    }
+    cw_channelizer_free(&band);
+    audio_close(&src);
+    return rc;
+}
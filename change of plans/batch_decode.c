@@ -0,0 +1,697 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "audio_input.h"
+#include "cw_audio.h"
+#include "cw_channelizer.h"
+#include "multi_key.h"
+#include "pin_config.h"
+#include "work_pool.h"
+
+// Decodes an archive of recordings in one run: every .wav (receiver audio)
+// and .rle (edge_capture key trace) under a directory, or the files listed
+// in a manifest (one path per line, relative to the manifest's directory;
+// blank and '#' lines are skipped). Each file is one task on the
+// work-stealing pool. Tasks are submitted smallest first, so every worker
+// starts on its largest files and the stragglers at the end are short ones.
+//
+// A file is streamed through its front end, so memory is one read block
+// and one decoder per worker however long the recordings are:
+//   .wav - cw_audio (tone search, AGC, speed tracking), or with -band the
+//          channelizer, which decodes every signal in the passband.
+//          Lines are "seconds text", or "seconds Hz text" with -band.
+//   .rle - every recorded pin through the multi-key decoder, with the pin
+//          map's polarity, debounce and profiles as in morse_multi.
+//          Lines are "seconds pin text".
+// The transcript of <dir>/a/b.wav is written to <out>/a/b.wav.txt (a
+// manifest's absolute paths lose their leading '/'). It is written as
+// .txt.part and renamed when the file is done. Then a line is appended to
+// <out>/batch_index.txt:
+//
+//   # morse batch index v1
+//   ok audio 1920044 1712345678 60.000 412 9 a/b.wav
+//   ^status kind bytes mtime seconds chars lines name
+//
+// name is the file's path within the archive, as its transcript is named,
+// so the same archive given as "arch" or "/srv/arch" shares one index.
+//
+// Resuming: files with an "ok" line of the same kind, size and mtime, and
+// their transcript in place, are skipped, so an interrupted run (or a
+// nightly run over a growing archive) only decodes what's new or changed.
+// Ctrl-C stops the running files without indexing them. -redo decodes
+// everything again.
+//
+//   batch_decode -o transcripts -j 4 /srv/archive
+//   batch_decode -band -o band_transcripts nightly.manifest
+//
+// Usage: batch_decode -o dir [-band] [-redo] [-j threads] [-wpm N [-fixed]] [-debounce spec]
+//                     [-tick ms] [-dash ticks] [-gap ticks] dir|manifest
+//
+// gcc -O2 -o batch_decode batch_decode.c audio_input.c cw_audio.c cw_channelizer.c multi_key.c work_pool.c
+//     pin_config.c debounce.c edge_sampler.c rt_profile.c morse_decoder.c morse_timing.c -lm -lpthread
+
+#define PATH_SIZE 1024
+#define BATCH_INDEX_FILE "batch_index.txt"
+#define BATCH_INDEX_HEADER "# morse batch index v1"
+
+#define KIND_AUDIO 0
+#define KIND_BAND 1
+#define KIND_CAPTURE 2
+
+static const char *kind_names[] = {"audio", "band", "capture"};
+
+typedef struct Batch Batch;
+
+typedef struct {
+    Batch *batch;
+    char *path;                 // As found or as listed
+    char *name;                 // Transcript under the output directory, less ".txt"
+    int kind;
+    uint64_t bytes;             // Size and mtime tell a changed file from a decoded one
+    int64_t mtime;
+    int done;                   // In the index already
+    double seconds;             // Recording length
+    uint64_t chars;
+    uint64_t lines;
+    FILE *transcript;
+} BatchFile;
+
+struct Batch {
+    BatchFile *files;
+    size_t count;
+    size_t capacity;
+    const char *out_dir;
+    int band;                   // Decode audio with the channelizer
+    CwConfig config;
+    MorseTiming timing;         // Key captures
+    DebounceConfig debounce;
+    PinConfig pins;
+    FILE *index;
+    pthread_mutex_t lock;       // Index and progress
+    size_t todo;
+    size_t finished;
+    size_t failed;
+    double seconds;
+};
+
+volatile sig_atomic_t stop = 0;
+
+static void handle_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+// Function to tell the front end from the extension, -1 for files that aren't recordings
+static int file_kind(const char *path, int band) {
+    const char *dot = strrchr(path, '.');
+    if (dot == NULL) {
+        return -1;
+    }
+    if (strcasecmp(dot, ".wav") == 0) {
+        return band ? KIND_BAND : KIND_AUDIO;
+    }
+    if (strcasecmp(dot, ".rle") == 0) {
+        return KIND_CAPTURE;
+    }
+    return -1;
+}
+
+// Function to add a recording to the list; other files are skipped
+static int add_file(Batch *batch, const char *path, const char *name) {
+    int kind = file_kind(path, batch->band);
+    if (kind < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        perror(path);
+        return 0;
+    }
+    if (strlen(batch->out_dir) + strlen(name) + 16 > PATH_SIZE) {
+        fprintf(stderr, "%s: path too long, skipped\n", path);
+        return 0;
+    }
+    if (batch->count == batch->capacity) {
+        size_t capacity = batch->capacity ? batch->capacity * 2 : 256;
+        BatchFile *files = realloc(batch->files, capacity * sizeof(BatchFile));
+        if (files == NULL) {
+            perror("Failed to allocate file list");
+            return -1;
+        }
+        batch->files = files;
+        batch->capacity = capacity;
+    }
+    BatchFile *file = &batch->files[batch->count];
+    memset(file, 0, sizeof(*file));
+    file->batch = batch;
+    file->path = strdup(path);
+    file->name = strdup(name);
+    if (file->path == NULL || file->name == NULL) {
+        perror("Failed to allocate file list");
+        free(file->path);
+        free(file->name);
+        return -1;
+    }
+    file->kind = kind;
+    file->bytes = (uint64_t)st.st_size;
+    file->mtime = (int64_t)st.st_mtime;
+    batch->count++;
+    return 0;
+}
+
+// Function to add every recording under dir; name is its path below the top directory
+static int scan_dir(Batch *batch, const char *dir, const char *name) {
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        perror(dir);
+        return -1;
+    }
+    int rc = 0;
+    struct dirent *entry;
+    while (rc == 0 && (entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;  // ".", ".." and hidden files
+        }
+        char path[PATH_SIZE], sub[PATH_SIZE];
+        int len = snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        int sub_len = snprintf(sub, sizeof(sub), "%s%s%s", name, name[0] ? "/" : "", entry->d_name);
+        if (len >= (int)sizeof(path) || sub_len >= (int)sizeof(sub)) {
+            fprintf(stderr, "%s/%s: path too long, skipped\n", dir, entry->d_name);
+            continue;
+        }
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            perror(path);
+        } else if (S_ISDIR(st.st_mode)) {
+            rc = scan_dir(batch, path, sub);
+        } else if (S_ISREG(st.st_mode)) {
+            rc = add_file(batch, path, sub);
+        }
+    }
+    closedir(d);
+    return rc;
+}
+
+// Function to add the recordings a manifest lists
+static int load_manifest(Batch *batch, const char *manifest) {
+    FILE *in = fopen(manifest, "r");
+    if (in == NULL) {
+        perror("Failed to open manifest");
+        return -1;
+    }
+    char base[PATH_SIZE];
+    const char *slash = strrchr(manifest, '/');
+    snprintf(base, sizeof(base), "%.*s", slash != NULL ? (int)(slash - manifest) : 1, slash != NULL ? manifest : ".");
+
+    char line[PATH_SIZE];
+    int line_number = 0;
+    int rc = 0;
+    while (rc == 0 && fgets(line, sizeof(line), in) != NULL) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        const char *name = line;
+        while (*name == '/') {
+            name++;
+        }
+        while (strncmp(name, "./", 2) == 0) {
+            name += 2;
+        }
+        if (strcmp(name, "..") == 0 || strncmp(name, "../", 3) == 0 || strstr(name, "/../") != NULL) {
+            fprintf(stderr, "%s:%d: '..' would write outside the output directory, skipped\n", manifest,
+                    line_number);
+            continue;
+        }
+        char path[PATH_SIZE * 2];
+        if (line[0] == '/' || slash == NULL) {
+            snprintf(path, sizeof(path), "%s", line);
+        } else {
+            snprintf(path, sizeof(path), "%s/%s", base, line);
+        }
+        if (file_kind(path, batch->band) < 0) {
+            fprintf(stderr, "%s:%d: not a .wav or .rle file, skipped\n", manifest, line_number);
+            continue;
+        }
+        rc = add_file(batch, path, name);
+    }
+    fclose(in);
+    return rc;
+}
+
+static int compare_name(const void *a, const void *b) {
+    return strcmp(((const BatchFile *)a)->name, ((const BatchFile *)b)->name);
+}
+
+static int compare_size(const void *a, const void *b) {
+    const BatchFile *fa = *(BatchFile *const *)a;
+    const BatchFile *fb = *(BatchFile *const *)b;
+    return fa->bytes < fb->bytes ? -1 : fa->bytes > fb->bytes;
+}
+
+// Function to mark the files an earlier run finished (files sorted by name).
+// The last line for a name wins, so a changed and redone file counts once.
+static void load_index(Batch *batch, const char *index_path) {
+    FILE *in = fopen(index_path, "r");
+    if (in == NULL) {
+        return;
+    }
+    char line[PATH_SIZE * 2];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char status[16], kind[16];
+        unsigned long long bytes, chars, lines;
+        long long mtime;
+        double seconds;
+        int name_at = 0;
+        if (line[0] == '#' || sscanf(line, "%15s %15s %llu %lld %lf %llu %llu %n", status, kind, &bytes, &mtime,
+                                     &seconds, &chars, &lines, &name_at) != 7 || name_at == 0) {
+            continue;
+        }
+        BatchFile key;
+        key.name = &line[name_at];
+        BatchFile *file = bsearch(&key, batch->files, batch->count, sizeof(BatchFile), compare_name);
+        if (file == NULL) {
+            continue;
+        }
+        file->done = strcmp(status, "ok") == 0 && strcmp(kind, kind_names[file->kind]) == 0 &&
+                     bytes == file->bytes && mtime == file->mtime;
+    }
+    fclose(in);
+
+    for (size_t i = 0; i < batch->count; i++) {
+        BatchFile *file = &batch->files[i];
+        char transcript[PATH_SIZE];
+        struct stat st;
+        snprintf(transcript, sizeof(transcript), "%s/%s.txt", batch->out_dir, file->name);
+        if (file->done && stat(transcript, &st) != 0) {
+            file->done = 0;  // Indexed but since deleted
+        }
+    }
+}
+
+// Function to create the directories above path
+static int make_parents(const char *path) {
+    char dir[PATH_SIZE];
+    snprintf(dir, sizeof(dir), "%s", path);
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/') {
+            continue;
+        }
+        *p = '\0';
+        if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+            perror(dir);
+            return -1;
+        }
+        *p = '/';
+    }
+    return 0;
+}
+
+static void audio_line(int event, char c, const char *text, uint64_t t_us, void *ctx) {
+    BatchFile *file = (BatchFile *)ctx;
+    (void)c;
+    if (event == MORSE_EVENT_LINE) {
+        fprintf(file->transcript, "%.3f %s\n", t_us / 1e6, text);
+    }
+}
+
+static void band_line(const CwSignal *sig, int event, char c, const char *text, uint64_t t_us, void *ctx) {
+    BatchFile *file = (BatchFile *)ctx;
+    (void)c;
+    if (event == MORSE_EVENT_LINE) {
+        fprintf(file->transcript, "%.3f %.1f %s\n", t_us / 1e6, sig->hz, text);
+    }
+}
+
+static void capture_line(int pin, int event, char c, const char *text, uint64_t t_us, void *ctx) {
+    BatchFile *file = (BatchFile *)ctx;
+    (void)c;
+    if (event == MORSE_EVENT_LINE) {
+        fprintf(file->transcript, "%.3f %d %s\n", t_us / 1e6, pin, text);
+    }
+}
+
+// Function to stream a WAV file through cw_audio or the channelizer;
+// returns 1 if stopped part way
+static int decode_audio(BatchFile *file) {
+    Batch *batch = file->batch;
+    AudioSource *src = malloc(sizeof(AudioSource));
+    float *frames = malloc(AUDIO_READ_FRAMES * AUDIO_CHANNELS_MAX * sizeof(float));
+    CwAudio *cw = calloc(1, sizeof(CwAudio));
+    CwChannelizer *band = calloc(1, sizeof(CwChannelizer));
+    if (src == NULL || frames == NULL || cw == NULL || band == NULL) {
+        perror("Failed to allocate decoder");
+        free(src);
+        free(frames);
+        free(cw);
+        free(band);
+        return -1;
+    }
+
+    int rc = audio_open(src, file->path, 0);
+    if (rc == 0) {
+        if (file->kind == KIND_BAND) {
+            rc = cw_channelizer_init(band, src->rate_hz, 0, CW_SEARCH_LO_HZ, CW_SEARCH_EDGE * (float)src->rate_hz,
+                                     &batch->config, 1, band_line, file);
+        } else {
+            rc = cw_audio_init(cw, src->rate_hz, &batch->config, audio_line, file);
+        }
+        if (rc != 0) {
+            audio_close(src);
+        }
+    }
+    if (rc == 0) {
+        size_t n;
+        while (!stop && (n = audio_read(src, frames, AUDIO_READ_FRAMES)) > 0) {
+            if (src->channels > 1) {
+                for (size_t i = 0; i < n; i++) {
+                    float sum = 0.0f;
+                    for (int c = 0; c < src->channels; c++) {
+                        sum += frames[i * (size_t)src->channels + (size_t)c];
+                    }
+                    frames[i] = sum / (float)src->channels;
+                }
+            }
+            if (file->kind == KIND_BAND) {
+                cw_channelizer_process(band, frames, n);
+            } else {
+                cw_audio_process(cw, frames, n);
+            }
+        }
+        const CwStats *stats;
+        if (file->kind == KIND_BAND) {
+            cw_channelizer_finish(band);
+            stats = &band->retired;
+        } else {
+            cw_audio_finish(cw);
+            stats = &cw->channel.stats;
+        }
+        file->seconds = (double)src->frames / src->rate_hz;
+        file->chars = stats->chars;
+        file->lines = stats->lines;
+        rc = stop ? 1 : 0;
+        if (file->kind == KIND_BAND) {
+            cw_channelizer_free(band);
+        } else {
+            cw_audio_free(cw);
+        }
+        audio_close(src);
+    }
+    free(src);
+    free(frames);
+    free(cw);
+    free(band);
+    return rc;
+}
+
+// Function to replay every pin of an edge capture through the multi-key
+// decoder; returns 1 if stopped part way
+static int decode_capture(BatchFile *file) {
+    Batch *batch = file->batch;
+    const PinConfig *pins = &batch->pins;
+    FILE *in = fopen(file->path, "rb");
+    if (in == NULL) {
+        perror(file->path);
+        return -1;
+    }
+    EdgeCaptureHeader header;
+    if (edge_capture_read_header(in, &header) != 0) {
+        fclose(in);
+        return -1;
+    }
+    MultiKey *mk = malloc(sizeof(MultiKey));
+    if (mk == NULL) {
+        perror("Failed to allocate decoder");
+        fclose(in);
+        return -1;
+    }
+
+    GpioRun run;
+    uint64_t last_us = 0;
+    int started = 0;
+    while (!stop && edge_capture_read(in, &run)) {
+        uint32_t levels = run.levels ^ pins->invert_mask;
+        last_us = run.t_ns / 1000;
+        if (!started) {
+            // As morse_multi: every recorded pin, with the map's own debounce and profile where it has them
+            multi_key_init(mk, header.pin_mask, levels, &batch->timing, &batch->debounce, capture_line, file);
+            for (int i = 0; i < pins->count; i++) {
+                const PinChannel *ch = &pins->channels[i];
+                if (ch->kind == PIN_KIND_KEY && (header.pin_mask & (1U << ch->pin)) &&
+                    (ch->profile >= 0 || ch->has_debounce)) {
+                    multi_key_configure(mk, ch->pin, ch->profile >= 0 ? &ch->timing : &batch->timing,
+                                        ch->has_debounce ? &ch->debounce : &batch->debounce);
+                }
+            }
+            started = 1;
+            continue;
+        }
+        multi_key_poll(mk, last_us);
+        multi_key_sample(mk, last_us, levels);
+    }
+    fclose(in);
+    if (!started) {
+        free(mk);
+        if (stop) {
+            return 1;
+        }
+        fprintf(stderr, "%s: empty capture\n", file->path);
+        return -1;
+    }
+    multi_key_flush(mk, last_us);
+
+    // A key left idle ends no line (that takes ten dots), so the last text is written as one.
+    // The gap after a line's ten dots decodes as a lone '?', which isn't.
+    for (int pin = 0; pin < MULTI_KEY_CHANNELS; pin++) {
+        MultiKeyChannel *ch = &mk->channels[pin];
+        if (!(header.pin_mask & (1U << pin))) {
+            continue;
+        }
+        ch->decoder.text_buffer[ch->decoder.text_index] = '\0';
+        if (strspn(ch->decoder.text_buffer, "?") < (size_t)ch->decoder.text_index) {
+            capture_line(pin, MORSE_EVENT_LINE, 0, ch->decoder.text_buffer, last_us, file);
+            ch->stats.lines++;
+        }
+        file->chars += ch->stats.chars;
+        file->lines += ch->stats.lines;
+    }
+    file->seconds = last_us / 1e6;
+    free(mk);
+    return stop ? 1 : 0;
+}
+
+// Function to index a finished file and print progress
+static void record_file(BatchFile *file, int ok) {
+    Batch *batch = file->batch;
+    pthread_mutex_lock(&batch->lock);
+    fprintf(batch->index, "%s %s %llu %lld %.3f %llu %llu %s\n", ok ? "ok" : "failed", kind_names[file->kind],
+            (unsigned long long)file->bytes, (long long)file->mtime, file->seconds,
+            (unsigned long long)file->chars, (unsigned long long)file->lines, file->name);
+    fflush(batch->index);
+    if (ok) {
+        batch->finished++;
+        batch->seconds += file->seconds;
+    } else {
+        batch->failed++;
+    }
+    fprintf(stderr, "[%zu/%zu] %s: %s, %.1f s, %llu chars, %llu lines\n", batch->finished + batch->failed,
+            batch->todo, file->path, ok ? "ok" : "failed", file->seconds, (unsigned long long)file->chars,
+            (unsigned long long)file->lines);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static void decode_task(void *arg) {
+    BatchFile *file = (BatchFile *)arg;
+    Batch *batch = file->batch;
+    if (stop) {
+        return;
+    }
+
+    char final[PATH_SIZE], part[PATH_SIZE + 8];
+    snprintf(final, sizeof(final), "%s/%s.txt", batch->out_dir, file->name);
+    snprintf(part, sizeof(part), "%s.part", final);
+    int rc = make_parents(final);
+    if (rc == 0 && (file->transcript = fopen(part, "w")) == NULL) {
+        perror(part);
+        rc = -1;
+    }
+    if (rc == 0) {
+        rc = file->kind == KIND_CAPTURE ? decode_capture(file) : decode_audio(file);
+        if (fclose(file->transcript) != 0 && rc == 0) {
+            perror(part);
+            rc = -1;
+        }
+        file->transcript = NULL;
+    }
+    if (rc == 0 && rename(part, final) != 0) {
+        perror(final);
+        rc = -1;
+    }
+    if (rc != 0) {
+        remove(part);
+    }
+    if (rc != 1) {  // Stopped files are left for the next run
+        record_file(file, rc == 0);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *input = NULL;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int redo = 0;
+    int have_debounce = 0;
+    static Batch batch;
+
+    if (pin_config_init(&batch.pins) != 0) {
+        return -1;
+    }
+    cw_config_default(&batch.config);
+    morse_timing_default(&batch.timing);
+    morse_timing_load(MORSE_TIMING_FILE, 0, &batch.timing);
+    debounce_parse(DEBOUNCE_DEFAULT, &batch.debounce);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-band") == 0) {
+            batch.band = 1;
+        } else if (strcmp(argv[i], "-redo") == 0) {
+            redo = 1;
+        } else if (strcmp(argv[i], "-fixed") == 0) {
+            batch.config.fixed_wpm = 1;
+        } else if (argv[i][0] != '-') {
+            input = argv[i];
+        } else if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return -1;
+        } else if (strcmp(argv[i], "-o") == 0) {
+            batch.out_dir = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-wpm") == 0) {
+            batch.config.wpm = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-debounce") == 0) {
+            if (debounce_parse(argv[++i], &batch.debounce) != 0) {
+                return -1;
+            }
+            have_debounce = 1;
+        } else if (strcmp(argv[i], "-tick") == 0) {
+            batch.timing.tick_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-dash") == 0) {
+            batch.timing.dash_ticks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-gap") == 0) {
+            batch.timing.gap_ticks = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (input == NULL || batch.out_dir == NULL || batch.config.wpm < CW_MIN_WPM || batch.config.wpm > CW_MAX_WPM) {
+        fprintf(stderr, "Usage: %s -o dir [-band] [-redo] [-j threads] [-wpm %d-%d [-fixed]] [-debounce spec]\n"
+                        "       [-tick ms] [-dash ticks] [-gap ticks] dir|manifest\n", argv[0], CW_MIN_WPM,
+                CW_MAX_WPM);
+        return -1;
+    }
+    if (have_debounce) {
+        batch.config.debounce = batch.debounce;  // Audio keeps its own default otherwise
+    }
+
+    struct stat st;
+    if (stat(input, &st) != 0) {
+        perror(input);
+        return -1;
+    }
+    int rc;
+    if (S_ISDIR(st.st_mode)) {
+        rc = scan_dir(&batch, input, "");
+    } else if (file_kind(input, batch.band) >= 0) {
+        const char *slash = strrchr(input, '/');
+        rc = add_file(&batch, input, slash != NULL ? slash + 1 : input);  // One recording
+    } else {
+        rc = load_manifest(&batch, input);
+    }
+    if (rc != 0) {
+        return -1;
+    }
+    if (mkdir(batch.out_dir, 0755) != 0 && errno != EEXIST) {
+        perror(batch.out_dir);
+        return -1;
+    }
+
+    char index_path[PATH_SIZE];
+    snprintf(index_path, sizeof(index_path), "%s/%s", batch.out_dir, BATCH_INDEX_FILE);
+    qsort(batch.files, batch.count, sizeof(BatchFile), compare_name);
+    if (!redo) {
+        load_index(&batch, index_path);
+    }
+    batch.index = fopen(index_path, "a");
+    if (batch.index == NULL) {
+        perror("Failed to open index");
+        return -1;
+    }
+    if (ftell(batch.index) == 0) {
+        fprintf(batch.index, "%s\n", BATCH_INDEX_HEADER);
+    }
+    pthread_mutex_init(&batch.lock, NULL);
+
+    BatchFile **todo = malloc((batch.count + 1) * sizeof(BatchFile *));
+    if (todo == NULL) {
+        perror("Failed to allocate file list");
+        return -1;
+    }
+    for (size_t i = 0; i < batch.count; i++) {
+        if (!batch.files[i].done) {
+            todo[batch.todo++] = &batch.files[i];
+        }
+    }
+    qsort(todo, batch.todo, sizeof(BatchFile *), compare_size);
+    fprintf(stderr, "%zu recordings, %zu already decoded, %zu to do on %d threads\n", batch.count,
+            batch.count - batch.todo, batch.todo, threads > 0 ? threads : 1);
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    WorkPool *pool = threads > 1 ? work_pool_create(threads) : NULL;
+    size_t steals = 0;
+    for (size_t i = 0; i < batch.todo; i++) {
+        if (pool == NULL || work_pool_submit(pool, decode_task, todo[i]) != 0) {
+            decode_task(todo[i]);  // One thread, or the pool couldn't take it
+        }
+    }
+    if (pool != NULL) {
+        work_pool_wait(pool);
+        steals = work_pool_steals(pool);
+        work_pool_destroy(pool);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double wall_s = (double)(end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+    size_t left = batch.todo - batch.finished - batch.failed;
+    fprintf(stderr, "%zu decoded, %zu failed%s: %.1f h of recordings in %.1f s (%.0fx real time), %zu steals\n",
+            batch.finished, batch.failed, stop ? ", stopped" : "", batch.seconds / 3600.0, wall_s,
+            wall_s > 0 ? batch.seconds / wall_s : 0.0, steals);
+    if (left > 0) {
+        fprintf(stderr, "%zu left for the next run\n", left);
+    }
+
+    rc = batch.failed > 0 || left > 0 ? -1 : 0;
+    if (fclose(batch.index) != 0) {
+        perror("Failed to write index");
+        rc = -1;
+    }
+    for (size_t i = 0; i < batch.count; i++) {
+        free(batch.files[i].path);
+        free(batch.files[i].name);
+    }
+    free(batch.files);
+    free(todo);
+    return rc;
+}
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include "morse_log.h"
+
+// Hot-path cost of one log call: printf+fflush (what the interpreter used
+// to do per dot/dash/gap) against LOG_INFO into the async ring.
+// Log output goes to /dev/null, results to stderr.
+//
+// gcc -O2 -o bench_log bench_log.c morse_log.c -lpthread && ./bench_log
+
+#define BATCH 512       // Calls per batch, below the ring size so nothing is dropped
+#define SYNC_BATCHES 100
+#define ASYNC_BATCHES 100
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void pause_for_writer(void) {
+    struct timespec ts = {0, (MORSE_LOG_FLUSH_MS + 5) * 1000000L};
+    nanosleep(&ts, NULL);  // Let the writer empty the ring between batches
+}
+
+int main() {
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull < 0) {
+        perror("Failed to open /dev/null");
+        return -1;
+    }
+    dup2(devnull, STDOUT_FILENO);
+
+    uint64_t total = 0;
+    for (int b = 0; b < SYNC_BATCHES; b++) {
+        uint64_t start = now_ns();
+        for (int i = 0; i < BATCH; i++) {
+            printf("Dot (.) received. %d\n", i);
+            fflush(stdout);
+        }
+        total += now_ns() - start;
+    }
+    fprintf(stderr, "printf+fflush      %8.1f ns/call\n", (double)total / (SYNC_BATCHES * BATCH));
+
+    morse_log_start(0);
+
+    total = 0;
+    for (int b = 0; b < ASYNC_BATCHES; b++) {
+        uint64_t start = now_ns();
+        for (int i = 0; i < BATCH; i++) {
+            LOG_INFO("Dot (.) received. %ld", (long)i);
+        }
+        total += now_ns() - start;
+        pause_for_writer();
+    }
+    fprintf(stderr, "LOG_INFO (async)   %8.1f ns/call\n", (double)total / (ASYNC_BATCHES * BATCH));
+
+    morse_log_level = MORSE_LOG_ERROR;  // Runtime-disabled level
+    uint64_t start = now_ns();
+    for (int i = 0; i < BATCH * 100; i++) {
+        LOG_INFO("Dot (.) received. %ld", (long)i);
+    }
+    fprintf(stderr, "LOG_INFO (off)     %8.1f ns/call\n", (double)(now_ns() - start) / (BATCH * 100.0));
+
+    morse_log_stop();
+    fprintf(stderr, "dropped records    %8llu\n", (unsigned long long)morse_log_dropped());
+    return 0;
+}
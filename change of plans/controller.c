@@ -1,61 +1,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
-#include <fcntl.h>
 #include <stdint.h>
-#include <sys/mman.h>
-#include <linux/i2c-dev.h>
-#include <sys/ioctl.h>
+#include "process_supervisor.h"
+#include "lcd_i2c.h"
+#include "morse_metrics.h"
+#include "pin_config.h"
 
-#define GPIO_BASE 0x3F200000  // Base address for GPIO (Raspberry Pi 3/4)
-#define BLOCK_SIZE (4 * 1024)
-#define GPIO_PIN 24  // GPIO pin for the button
-#define I2C_ADDR 0x27  // I2C address for the LCD
+#define STOP_DEADLINE_MS 2000  // Time allowed for a graceful exit before SIGKILL
+
+// Programs managed by the controller, spawned directly without a shell
+char *interpreter_argv[] = {"./gpio_morse_interpreter", NULL};
+char *reader_argv[] = {"./lcd_file_reader", NULL};
+SupervisedProcess programs[2];
+
+// Pin map (morse_pins.conf); the button is its power channel, GPIO 24 by default
+PinConfig pins;
+const PinChannel *power_channel;
 
 // Function to check if the button is pressed
 int is_button_pressed(volatile unsigned int *gpio) {
     unsigned int level = *(gpio + 13);  // GPLEV0 register (offset 0x34 / 4 bytes)
-    return (level & (1 << GPIO_PIN)) == 0;  // Reversed logic: pressed if LOW (0)
-}
-
-// Function to send a command to the LCD
-void lcd_send_command(int fd, uint8_t command, uint8_t backlight) {
-    uint8_t data[4];
-    data[0] = (command & 0xF0) | backlight | 0x04; // Upper nibble with EN=1
-    data[1] = (command & 0xF0) | backlight;       // Upper nibble with EN=0
-    data[2] = ((command << 4) & 0xF0) | backlight | 0x04; // Lower nibble with EN=1
-    data[3] = ((command << 4) & 0xF0) | backlight;       // Lower nibble with EN=0
-    write(fd, data, 4);
-    usleep(2000);  // Command processing delay
-}
-
-// Function to send a character to the LCD
-void lcd_send_char(int fd, char c, uint8_t backlight) {
-    uint8_t data[4];
-    data[0] = (c & 0xF0) | backlight | 0x05; // Upper nibble with RS=1, EN=1
-    data[1] = (c & 0xF0) | backlight | 0x01; // Upper nibble with RS=1, EN=0
-    data[2] = ((c << 4) & 0xF0) | backlight | 0x05; // Lower nibble with RS=1, EN=1
-    data[3] = ((c << 4) & 0xF0) | backlight | 0x01; // Lower nibble with RS=1, EN=0
-    write(fd, data, 4);
-    usleep(43);  // Character processing delay
-}
-
-// Function to send a string to the LCD
-void lcd_send_text(int fd, const char *text, uint8_t backlight) {
-    while (*text) {
-        lcd_send_char(fd, *text++, backlight);
-    }
-}
-
-// Function to initialize the LCD
-void lcd_init(int fd, uint8_t backlight) {
-    lcd_send_command(fd, 0x33, backlight);  // Initialize to 8-bit mode
-    lcd_send_command(fd, 0x32, backlight);  // Switch to 4-bit mode
-    lcd_send_command(fd, 0x28, backlight);  // Function Set: 4-bit, 2-line, 5x8 dots
-    lcd_send_command(fd, 0x0C, backlight);  // Display ON, Cursor OFF
-    lcd_send_command(fd, 0x06, backlight);  // Entry Mode: Increment, No Shift
-    lcd_send_command(fd, 0x01, backlight);  // Clear Display
-    usleep(2000);  // Wait for display to clear
+    return pin_active(level, power_channel);  // Active low unless the map says otherwise
 }
 
 // Function to display "Sevarino Morse Machine"
@@ -77,63 +43,57 @@ void display_shutdown_message(int fd) {
 // Function to start the other programs
 void start_programs() {
     printf("Starting programs...\n");
-    system("sudo ./gpio_morse_interpreter &");  // Start Morse code interpreter
-    system("sudo ./lcd_file_reader &");         // Start LCD file reader
+    supervisor_start(&programs[0]);  // Start Morse code interpreter
+    supervisor_start(&programs[1]);  // Start LCD file reader
 }
 
-// Function to stop the other programs
+// Function to stop the other programs (by PID, not by name)
 void stop_programs() {
     printf("Stopping programs...\n");
-    system("sudo pkill -f gpio_morse_interpreter");
-    system("sudo pkill -f lcd_file_reader");
+    supervisor_stop(&programs[0], STOP_DEADLINE_MS);
+    supervisor_stop(&programs[1], STOP_DEADLINE_MS);
 }
 
 int main() {
-    int mem_fd;
     volatile unsigned int *gpio;
 
-    // Open /dev/gpiomem for GPIO access
-    mem_fd = open("/dev/gpiomem", O_RDWR | O_SYNC);
-    if (mem_fd < 0) {
-        perror("Failed to open /dev/gpiomem");
+    // Load the pin map shared with the interpreter
+    if (pin_config_init(&pins) != 0) {
+        return -1;
+    }
+    power_channel = pin_config_find(&pins, PIN_KIND_POWER, 0);
+    if (power_channel == NULL) {
+        fprintf(stderr, "The pin map has no power channel\n");
         return -1;
     }
 
-    // Map GPIO memory
-    gpio = mmap(NULL, BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, GPIO_BASE);
-    if (gpio == MAP_FAILED) {
-        perror("Failed to map GPIO memory");
-        close(mem_fd);
+    // Map GPIO memory (device and offset from the pin map)
+    gpio = pin_config_map(&pins);
+    if (gpio == NULL) {
         return -1;
     }
 
-    // Set GPIO 24 as input
-    *(gpio + (GPIO_PIN / 10)) &= ~(7 << ((GPIO_PIN % 10) * 3));  // Clear FSEL bits for GPIO 24
+    // Set the mapped pins as inputs, with their pulls
+    pin_config_setup(&pins, gpio);
+
+    metrics_open(1);  // LCD write counters; optional
 
     // Open I2C device for LCD
-    int lcd_fd = open("/dev/i2c-1", O_RDWR);
+    int lcd_fd = lcd_open("/dev/i2c-1", I2C_ADDR);
     if (lcd_fd < 0) {
-        perror("Failed to open I2C device");
-        munmap((void *)gpio, BLOCK_SIZE);
-        close(mem_fd);
+        pin_config_unmap(gpio);
         return -1;
     }
 
-    // Set I2C slave address
-    if (ioctl(lcd_fd, I2C_SLAVE, I2C_ADDR) < 0) {
-        perror("Failed to set I2C address");
-        close(lcd_fd);
-        munmap((void *)gpio, BLOCK_SIZE);
-        close(mem_fd);
-        return -1;
-    }
+    supervisor_init(&programs[0], "gpio_morse_interpreter", interpreter_argv);
+    supervisor_init(&programs[1], "lcd_file_reader", reader_argv);
 
     int running = 0;  // State flag: 0 = programs off, 1 = programs running
     int prev_state = 1;  // Previous button state (1 = not pressed, 0 = pressed)
 
-    printf("Monitoring GPIO 24. Press the button to toggle programs.\n");
+    printf("Monitoring GPIO %d. Press the button to toggle programs.\n", power_channel->pin);
 
-    // Monitor GPIO 24
+    // Monitor the button
     while (1) {
         int curr_state = is_button_pressed(gpio);
 
@@ -143,9 +103,8 @@ int main() {
                 stop_programs();
                 running = 0;  // Update state
             } else {
+                start_programs();  // Spawn first; the programs initialize while the LCD is drawn
                 display_startup_message(lcd_fd);
-                sleep(4);  // Wait for 4 seconds
-                start_programs();
                 running = 1;  // Update state
             }
 
@@ -154,12 +113,11 @@ int main() {
         }
 
         prev_state = curr_state;  // Update previous state
-        usleep(100000);  // Polling delay
+        supervisor_poll(programs, 2, 100);  // Polling delay; reaps, restarts and tracks readiness
     }
 
     // Cleanup
     close(lcd_fd);
-    munmap((void *)gpio, BLOCK_SIZE);
-    close(mem_fd);
+    pin_config_unmap(gpio);
     return 0;
 }
@@ -1,84 +1,85 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
-#include <fcntl.h>
 #include <stdint.h>
-#include <sys/mman.h>
-#include <linux/i2c-dev.h>
-#include <sys/ioctl.h>
-
-#define GPIO_BASE 0x3F200000  // Base address for GPIO (Raspberry Pi 3/4)
-#define BLOCK_SIZE (4 * 1024)
-#define GPIO_PIN 24  // GPIO pin for the button
-#define I2C_ADDR 0x27  // I2C address for the LCD
+#include <time.h>
+#include "process_supervisor.h"
+#include "lcd_i2c.h"
+#include "morse_metrics.h"
+#include "pin_config.h"
+
+#define STOP_DEADLINE_MS 2000  // Time allowed for a graceful exit before SIGKILL
+#define READY_TIMEOUT_MS 15000  // Show the splash anyway if the programs never report ready
+#define ANIMATION_FRAME_MS 200  // Loading animation frame period
+#define DEBOUNCE_MS 500  // Toggles ignored after a press
+
+// Programs managed by the controller, spawned directly without a shell
+char *interpreter_argv[] = {"./gpio_morse_interpreter", NULL};
+char *reader_argv[] = {"./lcd_file_reader", NULL};
+SupervisedProcess programs[2];
+
+// Pin map (morse_pins.conf); the button is its power channel, GPIO 24 by default
+PinConfig pins;
+const PinChannel *power_channel;
 
 // Function to check if the button is pressed
 int is_button_pressed(volatile unsigned int *gpio) {
     unsigned int level = *(gpio + 13);  // GPLEV0 register (offset 0x34 / 4 bytes)
-    return (level & (1 << GPIO_PIN)) == 0;  // Reversed logic: pressed if LOW (0)
-}
-
-// Function to send a command to the LCD
-void lcd_send_command(int fd, uint8_t command, uint8_t backlight) {
-    uint8_t data[4];
-    data[0] = (command & 0xF0) | backlight | 0x04; // Upper nibble with EN=1
-    data[1] = (command & 0xF0) | backlight;       // Upper nibble with EN=0
-    data[2] = ((command << 4) & 0xF0) | backlight | 0x04; // Lower nibble with EN=1
-    data[3] = ((command << 4) & 0xF0) | backlight;       // Lower nibble with EN=0
-    write(fd, data, 4);
-    usleep(2000);  // Command processing delay
+    return pin_active(level, power_channel);  // Active low unless the map says otherwise
 }
 
-// Function to send a character to the LCD
-void lcd_send_char(int fd, char c, uint8_t backlight) {
-    uint8_t data[4];
-    data[0] = (c & 0xF0) | backlight | 0x05; // Upper nibble with RS=1, EN=1
-    data[1] = (c & 0xF0) | backlight | 0x01; // Upper nibble with RS=1, EN=0
-    data[2] = ((c << 4) & 0xF0) | backlight | 0x05; // Lower nibble with RS=1, EN=1
-    data[3] = ((c << 4) & 0xF0) | backlight | 0x01; // Lower nibble with RS=1, EN=0
-    write(fd, data, 4);
-    usleep(43);  // Character processing delay
+// Loading animation state, advanced from the main loop while the programs start
+typedef struct {
+    int active;
+    int step;                   // Position of the moving dot on the second line
+    struct timespec next_frame;
+} LoadingAnimation;
+
+long ms_until(const struct timespec *when) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (when->tv_sec - now.tv_sec) * 1000L + (when->tv_nsec - now.tv_nsec) / 1000000L;
 }
 
-// Function to send a string to the LCD
-void lcd_send_text(int fd, const char *text, uint8_t backlight) {
-    while (*text) {
-        lcd_send_char(fd, *text++, backlight);
+void add_ms(struct timespec *ts, long ms) {
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
     }
 }
 
-// Function to initialize the LCD
-void lcd_init(int fd, uint8_t backlight) {
-    lcd_send_command(fd, 0x33, backlight);  // Initialize to 8-bit mode
-    lcd_send_command(fd, 0x32, backlight);  // Switch to 4-bit mode
-    lcd_send_command(fd, 0x28, backlight);  // Function Set: 4-bit, 2-line, 5x8 dots
-    lcd_send_command(fd, 0x0C, backlight);  // Display ON, Cursor OFF
-    lcd_send_command(fd, 0x06, backlight);  // Entry Mode: Increment, No Shift
-    lcd_send_command(fd, 0x01, backlight);  // Clear Display
-    usleep(2000);  // Wait for display to clear
+// Function to show the static part of the loading animation
+void animation_start(LoadingAnimation *anim, int fd, const char *message, uint8_t backlight) {
+    lcd_init(fd, backlight);                // Initialize and clear the display
+    lcd_send_text(fd, message, backlight);  // Display the static message
+    anim->active = 1;
+    anim->step = 0;
+    clock_gettime(CLOCK_MONOTONIC, &anim->next_frame);
 }
 
-// Function to display a loading animation
-void display_loading_animation(int fd, const char *message, uint8_t backlight) {
-    lcd_send_command(fd, 0x01, backlight);  // Clear the display
-    lcd_send_text(fd, message, backlight); // Display the static message
-    lcd_send_command(fd, 0xC0, backlight); // Move to the second line
-
-    for (int i = 0; i < 16; i++) {
-        lcd_send_command(fd, 0xC0, backlight); // Move to start of second line
-        for (int j = 0; j < i; j++) {
-            lcd_send_char(fd, ' ', backlight); // Fill spaces before the dot
-        }
-        lcd_send_char(fd, '.', backlight);  // Display the moving dot
-        usleep(200000);  // Wait 200ms
+// Function to draw the next frame if it is due, returns ms until the following one
+int animation_tick(LoadingAnimation *anim, int fd, uint8_t backlight) {
+    long wait = ms_until(&anim->next_frame);
+    if (wait > 0) {
+        return (int)wait;
     }
 
-    usleep(500000);  // Small delay before clearing the display
+    // Only the old and new dot positions change, so redraw just those
+    int prev = (anim->step + LCD_COLUMNS - 1) % LCD_COLUMNS;
+    lcd_send_command(fd, 0xC0 + prev, backlight);
+    lcd_send_char(fd, ' ', backlight);
+    lcd_send_command(fd, 0xC0 + anim->step, backlight);
+    lcd_send_char(fd, '.', backlight);  // Display the moving dot
+
+    anim->step = (anim->step + 1) % LCD_COLUMNS;
+    add_ms(&anim->next_frame, ANIMATION_FRAME_MS);
+    return ANIMATION_FRAME_MS;
 }
 
 // Function to display "Sevarino Morse Machine"
 void display_startup_message(int fd) {
-    display_loading_animation(fd, "Initializing...", 0x08);  // Loading animation
     lcd_send_command(fd, 0x01, 0x08);  // Clear the display
     lcd_send_text(fd, "Sevarino Morse", 0x08);  // First line
     lcd_send_command(fd, 0xC0, 0x08);           // Move to second line
@@ -89,96 +90,122 @@ void display_startup_message(int fd) {
 void display_shutdown_message(int fd) {
     lcd_send_command(fd, 0x01, 0x08);  // Clear display
     lcd_send_text(fd, "Powering Down", 0x08);
-    display_loading_animation(fd, "Shutting Down...", 0x08);  // Loading animation
+    usleep(1000000);  // Leave the message up for a second
     lcd_send_command(fd, 0x08, 0x00);  // Turn off display and backlight
 }
 
 // Function to start the other programs
 void start_programs() {
     printf("Starting programs...\n");
-    system("sudo ./gpio_morse_interpreter &");  // Start Morse code interpreter
-    system("sudo ./lcd_file_reader &");         // Start LCD file reader
+    supervisor_start(&programs[0]);  // Start Morse code interpreter
+    supervisor_start(&programs[1]);  // Start LCD file reader
 }
 
-// Function to stop the other programs
+// Function to stop the other programs (by PID, not by name)
 void stop_programs() {
     printf("Stopping programs...\n");
-    system("sudo pkill -f gpio_morse_interpreter");
-    system("sudo pkill -f lcd_file_reader");
+    supervisor_stop(&programs[0], STOP_DEADLINE_MS);
+    supervisor_stop(&programs[1], STOP_DEADLINE_MS);
 }
 
 int main() {
-    int mem_fd;
     volatile unsigned int *gpio;
 
-    // Open /dev/gpiomem for GPIO access
-    mem_fd = open("/dev/gpiomem", O_RDWR | O_SYNC);
-    if (mem_fd < 0) {
-        perror("Failed to open /dev/gpiomem");
+    // Load the pin map shared with the interpreter
+    if (pin_config_init(&pins) != 0) {
+        return -1;
+    }
+    power_channel = pin_config_find(&pins, PIN_KIND_POWER, 0);
+    if (power_channel == NULL) {
+        fprintf(stderr, "The pin map has no power channel\n");
         return -1;
     }
 
-    // Map GPIO memory
-    gpio = mmap(NULL, BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, GPIO_BASE);
-    if (gpio == MAP_FAILED) {
-        perror("Failed to map GPIO memory");
-        close(mem_fd);
+    // Map GPIO memory (device and offset from the pin map)
+    gpio = pin_config_map(&pins);
+    if (gpio == NULL) {
         return -1;
     }
 
-    // Set GPIO 24 as input
-    *(gpio + (GPIO_PIN / 10)) &= ~(7 << ((GPIO_PIN % 10) * 3));  // Clear FSEL bits for GPIO 24
+    // Set the mapped pins as inputs, with their pulls
+    pin_config_setup(&pins, gpio);
+
+    metrics_open(1);  // LCD write counters; optional
 
     // Open I2C device for LCD
-    int lcd_fd = open("/dev/i2c-1", O_RDWR);
+    int lcd_fd = lcd_open("/dev/i2c-1", I2C_ADDR);
     if (lcd_fd < 0) {
-        perror("Failed to open I2C device");
-        munmap((void *)gpio, BLOCK_SIZE);
-        close(mem_fd);
+        pin_config_unmap(gpio);
         return -1;
     }
 
-    // Set I2C slave address
-    if (ioctl(lcd_fd, I2C_SLAVE, I2C_ADDR) < 0) {
-        perror("Failed to set I2C address");
-        close(lcd_fd);
-        munmap((void *)gpio, BLOCK_SIZE);
-        close(mem_fd);
-        return -1;
-    }
+    supervisor_init(&programs[0], "gpio_morse_interpreter", interpreter_argv);
+    supervisor_init(&programs[1], "lcd_file_reader", reader_argv);
 
     int running = 0;  // State flag: 0 = programs off, 1 = programs running
+    int starting = 0;  // 1 while waiting for the programs to report ready
     int prev_state = 1;  // Previous button state (1 = not pressed, 0 = pressed)
+    LoadingAnimation anim = {0};
+    struct timespec toggle_time;
+    struct timespec debounce_until;
+    clock_gettime(CLOCK_MONOTONIC, &debounce_until);
 
-    printf("Monitoring GPIO 24. Press the button to toggle programs.\n");
+    printf("Monitoring GPIO %d. Press the button to toggle programs.\n", power_channel->pin);
 
-    // Monitor GPIO 24
+    // Monitor the button
     while (1) {
         int curr_state = is_button_pressed(gpio);
 
-        if (!curr_state && prev_state) {  // Button transition: HIGH -> LOW
+        if (!curr_state && prev_state && ms_until(&debounce_until) <= 0) {  // Button transition: HIGH -> LOW
             if (running) {
+                starting = 0;
+                anim.active = 0;
+                stop_programs();  // Stop first so nothing else is writing to the LCD
                 display_shutdown_message(lcd_fd);
-                stop_programs();
                 running = 0;  // Update state
             } else {
-                display_startup_message(lcd_fd);
-                sleep(4);  // Wait for 4 seconds
-                start_programs();
+                clock_gettime(CLOCK_MONOTONIC, &toggle_time);
+                start_programs();  // Spawn immediately, animate while they initialize
+                animation_start(&anim, lcd_fd, "Initializing...", 0x08);
+                starting = 1;
                 running = 1;  // Update state
             }
 
-            // Debounce delay
-            usleep(500000);
+            // Debounce without blocking the animation
+            clock_gettime(CLOCK_MONOTONIC, &debounce_until);
+            add_ms(&debounce_until, DEBOUNCE_MS);
         }
 
         prev_state = curr_state;  // Update previous state
-        usleep(100000);  // Polling delay
+
+        int timeout = 100;  // Polling delay
+        if (anim.active) {
+            int next_frame = animation_tick(&anim, lcd_fd, 0x08);
+            if (next_frame < timeout) {
+                timeout = next_frame;
+            }
+        }
+        supervisor_poll(programs, 2, timeout);  // Reaps, restarts and tracks readiness
+
+        if (starting) {
+            long elapsed = -ms_until(&toggle_time);
+            int ready = supervisor_all_ready(programs, 2);
+            if (ready || elapsed >= READY_TIMEOUT_MS) {
+                anim.active = 0;
+                display_startup_message(lcd_fd);  // Splash ends the animation on readiness
+                if (ready) {
+                    printf("Toggle to ready: %ld ms\n", elapsed);
+                } else {
+                    printf("Programs not ready after %d ms, continuing anyway\n", READY_TIMEOUT_MS);
+                }
+                fflush(stdout);
+                starting = 0;
+            }
+        }
     }
 
     // Cleanup
     close(lcd_fd);
-    munmap((void *)gpio, BLOCK_SIZE);
-    close(mem_fd);
+    pin_config_unmap(gpio);
     return 0;
 }
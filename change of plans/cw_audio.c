@@ -0,0 +1,473 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cw_audio.h"
+
+#define CW_FLUSH_US 60000000ULL   // Past every debounce window and gap
+#define CW_FLOOR_US 250000.0f     // Noise floor smoothing, between marks
+#define CW_PEAK_US 50000.0f       // Mark level smoothing, during marks
+#define CW_PEAK_DECAY_US 2000000.0f  // Mark level fade between marks
+#define CW_KEY_ON 0.6f            // Thresholds between floor (0) and peak (1), with hysteresis
+#define CW_KEY_OFF 0.4f
+
+void cw_config_default(CwConfig *config) {
+    config->tone_hz = 0.0f;
+    config->wpm = CW_DEFAULT_WPM;
+    config->fixed_wpm = 0;
+    debounce_parse(CW_DEBOUNCE_DEFAULT, &config->debounce);
+}
+
+static uint64_t wpm_dot_us(int wpm) {
+    return 1200000ULL / (uint64_t)wpm;  // PARIS timing
+}
+
+int cw_channel_wpm(const CwChannel *ch) {
+    return (int)((1200000ULL + ch->dot_us / 2) / ch->dot_us);
+}
+
+// Function to set the classifier's thresholds from the dot length: a mark
+// over two dots is a dash, and two dots of silence end the character
+static void set_speed(CwChannel *ch, uint64_t dot_us) {
+    uint64_t shortest = wpm_dot_us(CW_MAX_WPM), longest = wpm_dot_us(CW_MIN_WPM);
+    ch->dot_us = dot_us < shortest ? shortest : dot_us > longest ? longest : dot_us;
+    ch->classifier.dash_us = 2 * ch->dot_us;
+    ch->classifier.gap_us = 2 * ch->dot_us;
+}
+
+// Function to estimate the dot from the recent marks. Two lengths a
+// ratio of two or more apart are split into dots and dashes (2-means);
+// one length alone is taken as dots or as dashes, whichever the current
+// estimate is nearer to.
+static void track_speed(CwChannel *ch, uint64_t mark_us) {
+    ch->marks_us[ch->stats.marks % CW_SPEED_MARKS] = (float)mark_us;
+    int n = ch->mark_count < CW_SPEED_MARKS ? ++ch->mark_count : CW_SPEED_MARKS;
+
+    float lo = ch->marks_us[0], hi = ch->marks_us[0];
+    for (int i = 1; i < n; i++) {
+        lo = fminf(lo, ch->marks_us[i]);
+        hi = fmaxf(hi, ch->marks_us[i]);
+    }
+    float dot;
+    if (hi < 2.0f * lo) {
+        float mean = 0.0f;
+        for (int i = 0; i < n; i++) {
+            mean += ch->marks_us[i];
+        }
+        mean /= (float)n;
+        dot = mean < 1.73f * (float)ch->dot_us ? mean : mean / 3.0f;  // sqrt(3): halfway in ratio
+    } else {
+        float split = (lo + hi) / 2.0f, short_mean = lo, long_mean = hi;
+        for (int pass = 0; pass < 3; pass++) {
+            float sums[2] = {0.0f, 0.0f};
+            int counts[2] = {0, 0};
+            for (int i = 0; i < n; i++) {
+                int is_long = ch->marks_us[i] >= split;
+                sums[is_long] += ch->marks_us[i];
+                counts[is_long]++;
+            }
+            short_mean = sums[0] / (float)counts[0];  // lo and hi keep both sides non-empty
+            long_mean = sums[1] / (float)counts[1];
+            split = (short_mean + long_mean) / 2.0f;
+        }
+        dot = (short_mean + long_mean / 3.0f) / 2.0f;
+    }
+    set_speed(ch, (ch->dot_us + (uint64_t)dot) / 2);
+}
+
+static void channel_signal(int signal, uint64_t t_us, void *ctx) {
+    CwChannel *ch = (CwChannel *)ctx;
+    char c = 0;
+
+    if (signal == MORSE_SIGNAL_DOT) {
+        ch->stats.dots++;
+    } else if (signal == MORSE_SIGNAL_DASH) {
+        ch->stats.dashes++;
+    }
+    int event = morse_decoder_signal(&ch->decoder, signal, &c);
+    if (event == MORSE_EVENT_CHAR) {
+        ch->stats.chars++;
+        if (c == '?') {
+            ch->stats.unknown++;
+        }
+        ch->output(event, c, NULL, t_us, ch->ctx);
+    } else if (event == MORSE_EVENT_LINE) {
+        ch->stats.lines++;
+        ch->output(event, 0, ch->decoder.text_buffer, t_us, ch->ctx);
+    }
+}
+
+// Debounced edges: a finished mark updates the speed before it is classified
+static void channel_edge(int pin, uint64_t t_us, int level, void *ctx) {
+    CwChannel *ch = (CwChannel *)ctx;
+    (void)pin;
+    if (level) {
+        ch->press_start_us = t_us;
+        ch->word_spaced = 0;
+    } else {
+        if (!ch->config.fixed_wpm) {
+            track_speed(ch, t_us - ch->press_start_us);
+        }
+        ch->stats.marks++;
+    }
+    edge_classifier_edge(&ch->classifier, t_us, level);
+}
+
+void cw_channel_init(CwChannel *ch, const CwConfig *config, CwOutput output, void *ctx) {
+    MorseTiming timing = {1, 1, 1};  // Replaced by set_speed
+    memset(ch, 0, sizeof(*ch));
+    ch->config = *config;
+    ch->output = output;
+    ch->ctx = ctx;
+    morse_decoder_init(&ch->decoder);
+    edge_classifier_init(&ch->classifier, &timing, channel_signal, ch);
+    set_speed(ch, wpm_dot_us(config->wpm > 0 ? config->wpm : CW_DEFAULT_WPM));
+    debounce_init(&ch->filter, &ch->config.debounce, 0, 0, channel_edge, ch);
+}
+
+// Function to end the line: the decoder only does that on ten dots, which
+// radio traffic doesn't send, so a long silence (or a full buffer) does it
+static void end_line(CwChannel *ch, uint64_t t_us) {
+    MorseDecoder *d = &ch->decoder;
+    while (d->text_index > 0 && d->text_buffer[d->text_index - 1] == ' ') {
+        d->text_index--;
+    }
+    d->text_buffer[d->text_index] = '\0';
+    if (d->text_index > 0) {
+        ch->stats.lines++;
+        ch->output(MORSE_EVENT_LINE, 0, d->text_buffer, t_us, ch->ctx);
+    }
+    morse_decoder_init(d);
+}
+
+// Function to add word spaces and line ends while the key is up
+static void check_silence(CwChannel *ch, uint64_t now_us) {
+    MorseDecoder *d = &ch->decoder;
+    if (ch->classifier.level || ch->classifier.gap_due || d->text_index == 0) {
+        return;
+    }
+    uint64_t idle_us = now_us - ch->classifier.since_us;
+    if (idle_us >= CW_LINE_US) {
+        end_line(ch, ch->classifier.since_us + CW_LINE_US);
+    } else if (!ch->word_spaced && idle_us >= CW_WORD_DOTS * ch->dot_us) {
+        ch->word_spaced = 1;
+        if (d->text_index >= MORSE_TEXT_BUFFER_SIZE - MORSE_BUFFER_SIZE) {
+            end_line(ch, now_us);  // Long line: break it between words
+        } else if (d->text_index < MORSE_TEXT_BUFFER_SIZE - 1) {
+            d->text_buffer[d->text_index++] = ' ';
+            d->text_buffer[d->text_index] = '\0';
+            ch->output(MORSE_EVENT_CHAR, ' ', NULL, now_us, ch->ctx);
+        }
+    }
+}
+
+// Function to feed one envelope value (any linear amplitude scale) taken
+// at t_us. The thresholds sit between a noise floor that follows the
+// envelope between marks and a mark level that follows it during marks,
+// so the decision is independent of the signal's strength (AGC), and the
+// squelch keeps noise alone from keying.
+void cw_channel_level(CwChannel *ch, uint64_t t_us, float level) {
+    if (ch->levels++ == 0) {
+        ch->peak = ch->floor = level;
+        ch->last_us = t_us;
+    }
+    float dt = (float)(t_us - ch->last_us);
+    ch->last_us = t_us;
+
+    if (level > ch->peak && !ch->hold) {
+        ch->peak += (level - ch->peak) * 0.5f;
+    } else if (ch->keyed) {
+        ch->peak += (level - ch->peak) * fminf(1.0f, dt / CW_PEAK_US);
+    } else {
+        ch->peak += (ch->floor - ch->peak) * fminf(1.0f, dt / CW_PEAK_DECAY_US);
+    }
+    if (!ch->keyed) {
+        // Running mean of the first values, so the floor starts out settled
+        float weight = fmaxf(1.0f / (float)ch->levels, dt / CW_FLOOR_US);
+        ch->floor += (level - ch->floor) * fminf(1.0f, weight);
+    }
+
+    int keyed = 0;
+    if (!ch->hold && ch->peak > ch->floor * CW_SQUELCH) {
+        float norm = (level - ch->floor) / (ch->peak - ch->floor);
+        keyed = norm > (ch->keyed ? CW_KEY_OFF : CW_KEY_ON);
+    }
+    if (keyed != ch->keyed) {
+        ch->keyed = keyed;
+        debounce_edge(&ch->filter, t_us, keyed);
+    }
+    debounce_poll(&ch->filter, t_us);
+    edge_classifier_poll(&ch->classifier, t_us);
+    check_silence(ch, t_us);
+}
+
+// Function to finish the last mark, character and line after the input ends
+void cw_channel_flush(CwChannel *ch, uint64_t t_us) {
+    if (ch->keyed) {
+        ch->keyed = 0;
+        debounce_edge(&ch->filter, t_us, 0);
+    }
+    debounce_poll(&ch->filter, t_us + CW_FLUSH_US);
+    edge_classifier_poll(&ch->classifier, t_us + CW_FLUSH_US);
+    end_line(ch, t_us);
+}
+
+void goertzel_bank_init(GoertzelBank *bank, uint32_t rate_hz, float lo_hz, float step_hz, int count, uint32_t block) {
+    memset(bank, 0, sizeof(*bank));
+    count = count < CW_BANK_MAX ? count : CW_BANK_MAX;
+    bank->count = (count + CW_LANES - 1) / CW_LANES * CW_LANES;
+    bank->block = block;
+    bank->lo_hz = lo_hz;
+    bank->step_hz = step_hz;
+    for (int k = 0; k < bank->count; k++) {
+        float f = lo_hz + step_hz * (float)k;
+        bank->coeff[k / CW_LANES][k % CW_LANES] = 2.0f * cosf(2.0f * (float)M_PI * f / (float)rate_hz);
+    }
+}
+
+// Function to run every filter over n samples, four filters per vector
+// operation. At each block end the block's power is added to power[].
+void goertzel_bank_run(GoertzelBank *bank, const float *x, size_t n) {
+    int vectors = bank->count / CW_LANES;
+    for (size_t i = 0; i < n; i++) {
+        CwVec xv = {x[i], x[i], x[i], x[i]};
+        for (int v = 0; v < vectors; v++) {
+            CwVec s0 = xv + bank->coeff[v] * bank->s1[v] - bank->s2[v];
+            bank->s2[v] = bank->s1[v];
+            bank->s1[v] = s0;
+        }
+        if (++bank->filled == bank->block) {
+            for (int v = 0; v < vectors; v++) {
+                CwVec p = bank->s1[v] * bank->s1[v] + bank->s2[v] * bank->s2[v] -
+                          bank->coeff[v] * bank->s1[v] * bank->s2[v];
+                for (int l = 0; l < CW_LANES; l++) {
+                    bank->power[v * CW_LANES + l] += p[l];
+                }
+                bank->s1[v] = bank->s2[v] = (CwVec){0.0f, 0.0f, 0.0f, 0.0f};
+            }
+            bank->filled = 0;
+        }
+    }
+}
+
+static int compare_float(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Function to find the strongest bin that stands min_snr over the median
+// bin, refined between bins by a parabola through the log powers. Returns
+// its frequency, or 0 if no bin stands out.
+float goertzel_bank_peak(const GoertzelBank *bank, float min_snr) {
+    float sorted[CW_BANK_MAX];
+    int best = 0;
+    for (int k = 0; k < bank->count; k++) {
+        sorted[k] = bank->power[k];
+        if (bank->power[k] > bank->power[best]) {
+            best = k;
+        }
+    }
+    qsort(sorted, (size_t)bank->count, sizeof(float), compare_float);
+    float median = sorted[bank->count / 2];
+    if (bank->power[best] <= 0.0f || bank->power[best] < min_snr * median) {
+        return 0.0f;
+    }
+
+    float offset = 0.0f;
+    if (best > 0 && best < bank->count - 1 && bank->power[best - 1] > 0.0f && bank->power[best + 1] > 0.0f) {
+        float l = logf(bank->power[best - 1]), c = logf(bank->power[best]), r = logf(bank->power[best + 1]);
+        float curve = l - 2.0f * c + r;
+        offset = curve < 0.0f ? 0.5f * (l - r) / curve : 0.0f;
+    }
+    return bank->lo_hz + bank->step_hz * ((float)best + offset);
+}
+
+// Function to set the mixer up at the tone: one hop of cos/sin (zero past
+// the hop, so whole vectors can be used) and the phase step per hop
+static void tune(CwAudio *a, float tone_hz) {
+    float w = 2.0f * (float)M_PI * tone_hz / (float)a->rate_hz;
+    a->tone_hz = tone_hz;
+    memset(&a->cos_table, 0, sizeof(a->cos_table));
+    memset(&a->sin_table, 0, sizeof(a->sin_table));
+    for (uint32_t i = 0; i < a->hop; i++) {
+        a->cos_table.f[i] = cosf(w * (float)i);
+        a->sin_table.f[i] = sinf(w * (float)i);
+    }
+    a->phase_re = 1.0f;
+    a->phase_im = 0.0f;
+    a->step_re = cosf(w * (float)a->hop);
+    a->step_im = -sinf(w * (float)a->hop);
+}
+
+// Function to mix one full hop down to DC and pass the windowed envelope on
+static void filter_hop(CwAudio *a) {
+    CwVec re = {0.0f, 0.0f, 0.0f, 0.0f}, im = re;
+    int vectors = (int)((a->hop + CW_LANES - 1) / CW_LANES);
+    for (int v = 0; v < vectors; v++) {
+        re += a->buffer.v[v] * a->cos_table.v[v];
+        im += a->buffer.v[v] * a->sin_table.v[v];
+    }
+    float dot_re = re[0] + re[1] + re[2] + re[3];
+    float dot_im = -(im[0] + im[1] + im[2] + im[3]);
+
+    // Rotate by the phase at the hop start, so hops add up coherently
+    int s = a->sub_next;
+    a->sub_re[s] = dot_re * a->phase_re - dot_im * a->phase_im;
+    a->sub_im[s] = dot_re * a->phase_im + dot_im * a->phase_re;
+    a->sub_next = (s + 1) % CW_WINDOW_MAX;
+    float re_next = a->phase_re * a->step_re - a->phase_im * a->step_im;
+    float im_next = a->phase_re * a->step_im + a->phase_im * a->step_re;
+    float norm = 1.0f / sqrtf(re_next * re_next + im_next * im_next);  // No drift over hours
+    a->phase_re = re_next * norm;
+    a->phase_im = im_next * norm;
+
+    // Window: a dot of hops, newest first
+    int window = (int)(a->channel.dot_us / CW_HOP_US);
+    window = window < CW_WINDOW_MIN ? CW_WINDOW_MIN : window > CW_WINDOW_MAX ? CW_WINDOW_MAX : window;
+    if (++a->hops < CW_WINDOW_MAX) {
+        return;  // Not a full window yet
+    }
+    float sum_re = 0.0f, sum_im = 0.0f;
+    for (int i = 0; i < window; i++) {
+        s = (s + CW_WINDOW_MAX - (i > 0)) % CW_WINDOW_MAX;
+        sum_re += a->sub_re[s];
+        sum_im += a->sub_im[s];
+    }
+    float level = 2.0f * sqrtf(sum_re * sum_re + sum_im * sum_im) / (float)(a->hop * (uint32_t)window);
+
+    // The window is centred half its length back
+    uint64_t half = (uint64_t)a->hop * (uint64_t)window / 2;
+    uint64_t centre = a->samples > half ? a->samples - half : 0;
+    cw_channel_level(&a->channel, centre * 1000000ULL / a->rate_hz, level);
+}
+
+static void filter_samples(CwAudio *a, const float *x, size_t n) {
+    while (n > 0) {
+        size_t take = a->hop - a->filled;
+        take = take < n ? take : n;
+        memcpy(&a->buffer.f[a->filled], x, take * sizeof(float));
+        a->filled += (uint32_t)take;
+        a->samples += take;
+        x += take;
+        n -= take;
+        if (a->filled == a->hop) {
+            filter_hop(a);
+            a->filled = 0;
+        }
+    }
+}
+
+// Function to set up a decoder for mono audio at rate_hz; with no tone in
+// the config the tone is searched for first
+int cw_audio_init(CwAudio *a, uint32_t rate_hz, const CwConfig *config, CwOutput output, void *ctx) {
+    memset(a, 0, sizeof(*a));
+    a->rate_hz = rate_hz;
+    a->hop = (uint32_t)((uint64_t)rate_hz * CW_HOP_US / 1000000);
+    if (a->hop == 0 || a->hop > CW_HOP_MAX || (config->tone_hz > 0.0f && config->tone_hz >= rate_hz / 2.0f)) {
+        fprintf(stderr, "Audio rate %u Hz (tone %.0f Hz) not supported\n", rate_hz, config->tone_hz);
+        return -1;
+    }
+    cw_channel_init(&a->channel, config, output, ctx);
+
+    if (config->tone_hz > 0.0f) {
+        tune(a, config->tone_hz);
+        return 0;
+    }
+    int bins = (int)((CW_DETECT_HI_HZ - CW_DETECT_LO_HZ) / CW_DETECT_STEP_HZ) + 1;
+    goertzel_bank_init(&a->bank, rate_hz, CW_DETECT_LO_HZ, CW_DETECT_STEP_HZ, bins,
+                       (uint32_t)((uint64_t)rate_hz * CW_DETECT_BLOCK_US / 1000000));
+    a->held_max = (size_t)rate_hz * CW_DETECT_MS / 1000;
+    a->held = malloc(a->held_max * sizeof(float));
+    if (a->held == NULL) {
+        perror("Failed to allocate tone search buffer");
+        return -1;
+    }
+    return 0;
+}
+
+static void discard_output(int event, char c, const char *text, uint64_t t_us, void *ctx) {
+    (void)event;
+    (void)c;
+    (void)text;
+    (void)t_us;
+    (void)ctx;
+}
+
+// Function to run the held audio through the tone filter from the start
+static void replay_held(CwAudio *a, float tone) {
+    tune(a, tone);
+    a->hops = 0;
+    a->filled = 0;
+    a->sub_next = 0;
+    a->samples -= a->held_count;  // Held audio is timed from where it started
+    filter_samples(a, a->held, a->held_count);
+}
+
+// Function to end a search: decode the held audio at the tone found, or
+// drop it and search the next stretch. Unless the speed is fixed, the held
+// audio is run twice: once to measure the speed, then decoded starting at
+// that speed, so the first characters aren't timed at CW_DEFAULT_WPM.
+static void end_search(CwAudio *a) {
+    float tone = goertzel_bank_peak(&a->bank, CW_DETECT_SNR);
+    if (tone > 0.0f) {
+        CwChannel *ch = &a->channel;
+        if (!ch->config.fixed_wpm) {
+            CwOutput output = ch->output;
+            void *ctx = ch->ctx;
+            CwConfig config = ch->config;
+            cw_channel_init(ch, &config, discard_output, NULL);
+            replay_held(a, tone);
+            config.wpm = cw_channel_wpm(ch);
+            cw_channel_init(ch, &config, output, ctx);
+        }
+        replay_held(a, tone);
+    } else {
+        memset(a->bank.power, 0, sizeof(a->bank.power));
+    }
+    a->held_count = 0;
+}
+
+// Function to feed mono samples in -1..1
+void cw_audio_process(CwAudio *a, const float *x, size_t n) {
+    while (a->tone_hz == 0.0f && n > 0) {
+        size_t take = a->held_max - a->held_count;
+        take = take < n ? take : n;
+        goertzel_bank_run(&a->bank, x, take);
+        memcpy(&a->held[a->held_count], x, take * sizeof(float));
+        a->held_count += take;
+        a->samples += take;
+        x += take;
+        n -= take;
+        if (a->held_count == a->held_max) {
+            end_search(a);
+        }
+    }
+    filter_samples(a, x, n);
+}
+
+// Function to decode what is left after the last samples
+void cw_audio_finish(CwAudio *a) {
+    if (a->tone_hz == 0.0f && a->held_count > 0) {
+        end_search(a);
+    }
+    cw_channel_flush(&a->channel, a->samples * 1000000ULL / a->rate_hz);
+}
+
+void cw_audio_free(CwAudio *a) {
+    free(a->held);
+    a->held = NULL;
+}
+
+void cw_audio_report(const CwAudio *a, FILE *out) {
+    const CwChannel *ch = &a->channel;
+    const CwStats *s = &ch->stats;
+    if (a->tone_hz > 0.0f) {
+        fprintf(out, "Tone %.0f Hz, %d WPM at the end\n", a->tone_hz, cw_channel_wpm(ch));
+    } else {
+        fprintf(out, "No tone found (%.0f-%.0f Hz)\n", CW_DETECT_LO_HZ, CW_DETECT_HI_HZ);
+    }
+    fprintf(out, "%llu marks (%llu glitches rejected), %llu dots, %llu dashes, %llu chars (%llu unknown), %llu lines\n",
+            (unsigned long long)s->marks, (unsigned long long)ch->filter.glitches, (unsigned long long)s->dots,
+            (unsigned long long)s->dashes, (unsigned long long)s->chars, (unsigned long long)s->unknown,
+            (unsigned long long)s->lines);
+}
@@ -0,0 +1,163 @@
+#ifndef CW_AUDIO_H
+#define CW_AUDIO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "debounce.h"
+#include "edge_sampler.h"
+#include "morse_decoder.h"
+
+// CW decoding from receiver audio. Three stages:
+//   tone search - a bank of Goertzel filters, CW_DETECT_LO_HZ to
+//                 CW_DETECT_HI_HZ in CW_DETECT_STEP_HZ bins, is run over
+//                 the first CW_DETECT_MS of audio and the strongest clear
+//                 peak is taken (interpolated between bins). The audio is
+//                 kept and decoded once the tone is known. If no peak
+//                 stands out, the next stretch is searched.
+//   tone filter - the signal is mixed down at the tone and summed over
+//                 the last few hops of CW_HOP_US. This is a sliding
+//                 Goertzel about 1 / (hop * window) wide that yields an
+//                 envelope every hop. The window is one tracked dot
+//                 (CW_WINDOW_MIN to CW_WINDOW_MAX hops), matched to the
+//                 shortest element, so slower senders get a narrower
+//                 filter and more noise rejection. Mixing
+//                 is two dot products per hop against a cos/sin table.
+//   channel     - AGC and an adaptive threshold turn the envelope into
+//                 key up/down edges. The edges then go through the same
+//                 debounce filter, edge classifier and text decoder as a
+//                 GPIO key. Dot length is tracked from the last
+//                 CW_SPEED_MARKS marks and sets the dash and gap
+//                 thresholds, so a change of sender speed is followed
+//                 within a word.
+//
+// The filter bank and the mixer work on four floats at a time with GCC
+// vector extensions. That gives NEON on the Pi (-mfpu=neon on 32-bit
+// builds) and SSE on x86 without intrinsics.
+//
+// A channel can also be fed envelope values directly (cw_channel_level),
+// which is how a channelizer runs one per signal.
+
+#define CW_LANES 4
+#define CW_BANK_MAX 64
+#define CW_DETECT_LO_HZ 300.0f
+#define CW_DETECT_HI_HZ 1500.0f
+#define CW_DETECT_STEP_HZ 20.0f
+#define CW_DETECT_BLOCK_US 50000    // Goertzel block in the search, 1 / CW_DETECT_STEP_HZ
+#define CW_DETECT_MS 1500
+#define CW_DETECT_SNR 4.0f          // Peak bin power over the median bin (30 blocks averaged)
+
+#define CW_HOP_US 2000              // Envelope step
+#define CW_WINDOW_MIN 4             // Tone filter length in hops: 8 ms, about 125 Hz wide...
+#define CW_WINDOW_MAX 16            // ...to 32 ms, about 30 Hz
+#define CW_HOP_MAX 512              // Samples per hop (rates up to 256 kHz)
+
+#define CW_DEFAULT_WPM 20           // Starting speed until marks have been measured
+#define CW_MIN_WPM 5
+#define CW_MAX_WPM 60
+#define CW_SPEED_MARKS 16
+#define CW_WORD_DOTS 5              // Silence that ends a word (letter space 3, word space 7)
+#define CW_LINE_US 3000000          // Silence that ends a line
+#define CW_SQUELCH 2.5f             // Mark envelope over the noise floor needed to key
+#define CW_DEBOUNCE_DEFAULT "integrator:6000"  // Drops noise spikes, delays both edges alike
+
+typedef float CwVec __attribute__((vector_size(CW_LANES * sizeof(float))));
+
+typedef union {
+    CwVec v[CW_HOP_MAX / CW_LANES];
+    float f[CW_HOP_MAX];
+} CwHopBuffer;
+
+typedef struct {
+    float tone_hz;              // 0 = search for it
+    int wpm;                    // Starting speed
+    int fixed_wpm;              // Keep the starting speed instead of tracking
+    DebounceConfig debounce;
+} CwConfig;
+
+typedef struct {
+    uint64_t marks;             // Debounced key-downs
+    uint64_t dots;
+    uint64_t dashes;
+    uint64_t chars;
+    uint64_t unknown;           // Characters decoded as '?'
+    uint64_t lines;
+} CwStats;
+
+// Called for every decoded character (c, ' ' between words) and line end (text holds the line)
+typedef void (*CwOutput)(int event, char c, const char *text, uint64_t t_us, void *ctx);
+
+typedef struct {
+    CwConfig config;
+    float peak;                 // Mark envelope
+    float floor;                // Noise envelope
+    int keyed;                  // Thresholded level, before debounce
+    int hold;                   // Set to only track the floor, never key
+    uint64_t levels;            // Envelope values fed
+    uint64_t last_us;           // Last envelope value
+    uint64_t dot_us;            // Current dot length
+    uint64_t press_start_us;
+    float marks_us[CW_SPEED_MARKS];
+    int mark_count;
+    int word_spaced;            // A space has been added since the last mark
+    Debouncer filter;
+    EdgeClassifier classifier;
+    MorseDecoder decoder;
+    CwStats stats;
+    CwOutput output;
+    void *ctx;
+} CwChannel;
+
+// Goertzel filters, four per vector; power[] sums block powers since the last reset
+typedef struct {
+    int count;
+    uint32_t block;
+    uint32_t filled;
+    float lo_hz;
+    float step_hz;
+    CwVec coeff[CW_BANK_MAX / CW_LANES];
+    CwVec s1[CW_BANK_MAX / CW_LANES];
+    CwVec s2[CW_BANK_MAX / CW_LANES];
+    float power[CW_BANK_MAX];
+} GoertzelBank;
+
+typedef struct {
+    uint32_t rate_hz;
+    float tone_hz;              // 0 while searching
+    GoertzelBank bank;
+    float *held;                // Audio kept during the search
+    size_t held_count;
+    size_t held_max;
+    uint64_t samples;           // Samples so far, searched or filtered
+    uint32_t hop;
+    uint32_t filled;            // Samples in the current hop
+    CwHopBuffer cos_table;
+    CwHopBuffer sin_table;
+    CwHopBuffer buffer;
+    float phase_re;             // Mixer phase at the start of the hop
+    float phase_im;
+    float step_re;              // Mixer phase advance per hop
+    float step_im;
+    float sub_re[CW_WINDOW_MAX];  // Mixed-down hops, a ring
+    float sub_im[CW_WINDOW_MAX];
+    int sub_next;
+    uint64_t hops;
+    CwChannel channel;
+} CwAudio;
+
+void cw_config_default(CwConfig *config);
+void cw_channel_init(CwChannel *ch, const CwConfig *config, CwOutput output, void *ctx);
+void cw_channel_level(CwChannel *ch, uint64_t t_us, float level);
+void cw_channel_flush(CwChannel *ch, uint64_t t_us);
+int cw_channel_wpm(const CwChannel *ch);
+
+void goertzel_bank_init(GoertzelBank *bank, uint32_t rate_hz, float lo_hz, float step_hz, int count, uint32_t block);
+void goertzel_bank_run(GoertzelBank *bank, const float *x, size_t n);
+float goertzel_bank_peak(const GoertzelBank *bank, float min_snr);
+
+int cw_audio_init(CwAudio *a, uint32_t rate_hz, const CwConfig *config, CwOutput output, void *ctx);
+void cw_audio_process(CwAudio *a, const float *x, size_t n);
+void cw_audio_finish(CwAudio *a);
+void cw_audio_free(CwAudio *a);
+void cw_audio_report(const CwAudio *a, FILE *out);
+
+#endif
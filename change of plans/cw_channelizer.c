@@ -0,0 +1,512 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cw_channelizer.h"
+
+static uint64_t frame_us(const CwChannelizer *c, uint64_t frame) {
+    return (frame * (uint64_t)c->hop + (uint64_t)c->size / 2) * 1000000ULL / c->rate_hz;  // Window centre
+}
+
+static float bin_hz(const CwChannelizer *c, float bin) {
+    float index = (float)c->base + bin - (c->iq ? (float)(c->size / 2) : 0.0f);
+    return index * (float)c->rate_hz / (float)c->size;
+}
+
+static float *spectrum(const CwChannelizer *c, uint64_t frame) {
+    return &c->spectra[(size_t)(frame % (uint64_t)c->ring_frames) * (size_t)c->width];
+}
+
+// Function to transform one frame of the block: window into bit-reversed
+// order, radix-2 butterflies in place, then keep the band's bin powers
+static void transform_frame(CwChannelizer *c, uint64_t frame, float *re, float *im) {
+    int n = c->size;
+    const float *x_re = &c->in_re[(size_t)(frame - c->next_frame) * (size_t)c->hop];
+    const float *x_im = &c->in_im[(size_t)(frame - c->next_frame) * (size_t)c->hop];
+    for (int i = 0; i < n; i++) {
+        re[c->reverse[i]] = x_re[i] * c->window[i];
+        im[c->reverse[i]] = x_im[i] * c->window[i];
+    }
+    for (int half = 1, stride = n / 2; half < n; half *= 2, stride /= 2) {
+        for (int start = 0; start < n; start += 2 * half) {
+            for (int j = 0; j < half; j++) {
+                float wr = c->twiddle_re[j * stride], wi = c->twiddle_im[j * stride];
+                int a = start + j, b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+
+    float *row = spectrum(c, frame);
+    for (int j = 0; j < c->width; j++) {
+        int k = c->iq ? (c->base + j + n / 2) % n : c->base + j;  // I/Q bins are stored DC-centred
+        row[j] = re[k] * re[k] + im[k] * im[k];
+    }
+}
+
+static void fft_task(void *arg) {
+    CwFftTask *task = (CwFftTask *)arg;
+    for (int i = 0; i < task->count; i++) {
+        transform_frame(task->owner, task->first + (uint64_t)i, task->re, task->im);
+    }
+}
+
+static void signal_output(int event, char ch, const char *text, uint64_t t_us, void *ctx) {
+    CwSignal *sig = (CwSignal *)ctx;
+    sig->owner->output(sig, event, ch, text, t_us, sig->owner->ctx);
+}
+
+static void discard_output(int event, char ch, const char *text, uint64_t t_us, void *ctx) {
+    (void)event;
+    (void)ch;
+    (void)text;
+    (void)t_us;
+    (void)ctx;
+}
+
+static void feed_levels(const CwChannelizer *c, const CwSignal *sig, CwChannel *ch) {
+    for (int i = 0; i < sig->level_count; i++) {
+        ch->hold = signbit(sig->levels[i]) != 0;
+        cw_channel_level(ch, frame_us(c, sig->first_frame + (uint64_t)i), fabsf(sig->levels[i]));
+    }
+}
+
+// Function to feed a signal's levels for the block, and flush it if it is
+// being retired. A new signal's replay is run twice: once to measure the
+// speed, then decoded starting at that speed.
+static void decode_task(void *arg) {
+    CwSignal *sig = (CwSignal *)arg;
+    const CwChannelizer *c = sig->owner;
+    if (sig->fresh && !c->config.fixed_wpm) {
+        CwChannel scratch;
+        CwConfig config = c->config;
+        cw_channel_init(&scratch, &config, discard_output, NULL);
+        feed_levels(c, sig, &scratch);
+        config.wpm = cw_channel_wpm(&scratch);
+        cw_channel_init(&sig->channel, &config, signal_output, sig);
+    }
+    sig->fresh = 0;
+    feed_levels(c, sig, &sig->channel);
+
+    if (sig->retiring) {
+        cw_channel_flush(&sig->channel, frame_us(c, sig->first_frame + (uint64_t)sig->level_count));
+    }
+}
+
+static void run_task(CwChannelizer *c, WorkFn fn, void *arg) {
+    if (c->pool == NULL || work_pool_submit(c->pool, fn, arg) != 0) {
+        fn(arg);  // One thread, or the pool is out of memory
+    }
+}
+
+static void wait_tasks(CwChannelizer *c) {
+    if (c->pool != NULL) {
+        work_pool_wait(c->pool);
+    }
+}
+
+// Function to check for a live signal other than self within the guard of bin
+static int near_signal(const CwChannelizer *c, int bin, const CwSignal *self) {
+    int lo = bin > CW_GUARD_BINS ? bin - CW_GUARD_BINS : 0;
+    int hi = bin + CW_GUARD_BINS < c->width ? bin + CW_GUARD_BINS : c->width - 1;
+    for (int j = lo; j <= hi; j++) {
+        int owner = c->bin_signal[j];
+        if (owner != 0 && &c->signals[owner - 1] != self) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void move_signal(CwChannelizer *c, CwSignal *sig, int bin) {
+    if (sig->bin >= 0) {
+        c->bin_signal[sig->bin] = 0;
+    }
+    if (bin >= 0) {
+        c->bin_signal[bin] = (int)(sig - c->signals) + 1;
+    }
+    sig->bin = bin;
+}
+
+static int is_hit(const CwChannelizer *c, int j) {
+    return c->smooth[j] > CW_SPAWN_SNR * c->noise[j];
+}
+
+// Function to start decoding at bin from this frame, with the history replayed
+static void start_signal(CwChannelizer *c, int bin, uint64_t frame) {
+    CwSignal *sig = NULL;
+    for (int i = 0; i < CW_SIGNALS_MAX && sig == NULL; i++) {
+        if (c->signals[i].bin < 0) {
+            sig = &c->signals[i];
+        }
+    }
+    if (sig == NULL) {
+        return;  // Full: it gets a slot once another signal is retired
+    }
+
+    // Tone between bins: parabola through the log powers
+    float offset = 0.0f;
+    float l = c->average[bin - 1], m = c->average[bin], r = c->average[bin + 1];
+    if (l > 0.0f && r > 0.0f) {
+        float curve = logf(l) - 2.0f * logf(m) + logf(r);
+        offset = curve < 0.0f ? 0.5f * (logf(l) - logf(r)) / curve : 0.0f;
+        offset = fmaxf(-0.5f, fminf(0.5f, offset));
+    }
+    sig->id = ++c->next_id;
+    move_signal(c, sig, bin);
+    sig->hz = bin_hz(c, (float)bin + offset);
+    sig->retiring = 0;
+    sig->fresh = 1;
+    sig->last_active = frame;
+    cw_channel_init(&sig->channel, &c->config, signal_output, sig);
+
+    uint64_t history = (uint64_t)c->history_frames;
+    sig->first_frame = frame + 1 > history ? frame + 1 - history : 0;
+    sig->level_count = 0;
+    // Held up to the first mark: a hit with at least half the strongest amplitude
+    float strongest = 0.0f;
+    for (uint64_t f = sig->first_frame; f <= frame; f++) {
+        strongest = fmaxf(strongest, spectrum(c, f)[bin]);
+    }
+    float mark = fmaxf(CW_SPAWN_SNR * c->noise[bin], 0.25f * strongest);
+    int held = 1;
+    for (uint64_t f = sig->first_frame; f <= frame; f++) {
+        float power = spectrum(c, f)[bin];
+        held = held && power < mark;
+        sig->levels[sig->level_count++] = (held ? -1.0f : 1.0f) * sqrtf(power) * c->scale;
+    }
+    if (++c->active > c->active_max) {
+        c->active_max = c->active;
+    }
+}
+
+// Function to update a live signal: move it a bin if a neighbour has
+// become the stronger, record its level (held while it is quiet), and
+// retire it once it has been quiet long enough
+static void follow_signal(CwChannelizer *c, CwSignal *sig, uint64_t frame, const float *row) {
+    int b = sig->bin;
+    int step = c->average[b + 1] > c->average[b] * CW_DRIFT_RATIO   ? 1
+               : c->average[b - 1] > c->average[b] * CW_DRIFT_RATIO ? -1
+                                                                    : 0;
+    if (step != 0 && b + step > 0 && b + step < c->width - 1 && !near_signal(c, b + step, sig)) {
+        move_signal(c, sig, b + step);
+        b = sig->bin;
+        sig->hz = bin_hz(c, (float)b);
+    }
+
+    float score = fmaxf(c->score[b], fmaxf(c->score[b - 1], c->score[b + 1]));
+    if (score >= CW_QUIET_SCORE) {
+        if (frame - sig->last_active > 1) {
+            // Waking up: let go of the marks that raised the rate
+            for (int i = sig->level_count - 1; i >= 0 && signbit(sig->levels[i]); i--) {
+                if (frame - (sig->first_frame + (uint64_t)i) > c->wake_frames) {
+                    break;
+                }
+                sig->levels[i] = -sig->levels[i];
+            }
+        }
+        sig->last_active = frame;
+    }
+    sig->levels[sig->level_count++] = (sig->last_active == frame ? 1.0f : -1.0f) * sqrtf(row[b]) * c->scale;
+    if (frame - sig->last_active > c->retire_frames) {
+        sig->retiring = 1;
+    }
+}
+
+static int compare_float(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Function to set each bin's floor to the quantile of its first frames,
+// still in the ring, so tracking starts from a settled value
+static void first_noise(CwChannelizer *c) {
+    float *values = malloc((size_t)c->noise_frames * sizeof(float));
+    if (values == NULL) {
+        perror("Failed to allocate noise estimate");
+        return;  // Tracking still gets there from 0
+    }
+    for (int j = 0; j < c->width; j++) {
+        for (uint64_t f = 0; f < c->noise_frames; f++) {
+            values[f] = spectrum(c, f)[j];
+        }
+        qsort(values, (size_t)c->noise_frames, sizeof(float), compare_float);
+        c->noise[j] = values[(size_t)((float)c->noise_frames * CW_NOISE_QUANTILE)];
+    }
+    free(values);
+}
+
+// Function to run detection over one frame's spectrum
+static void detect_frame(CwChannelizer *c, uint64_t frame) {
+    const float *row = spectrum(c, frame);
+    for (int j = 0; j < c->width; j++) {
+        c->smooth[j] += (row[j] - c->smooth[j]) * c->smooth_weight;
+    }
+    if (frame + 1 < c->noise_frames) {
+        return;
+    } else if (frame + 1 == c->noise_frames) {
+        first_noise(c);
+    }
+    for (int j = 0; j < c->width; j++) {
+        // Quantile tracking: up or down a log step, weighted so both balance at the quantile
+        if (c->noise[j] <= 0.0f) {
+            c->noise[j] = row[j];  // After digital silence
+        } else if (row[j] > c->noise[j]) {
+            c->noise[j] *= c->noise_up;
+        } else {
+            c->noise[j] *= c->noise_down;
+        }
+        c->score[j] += ((float)is_hit(c, j) - c->score[j]) * c->score_weight;
+        c->average[j] += (row[j] - c->average[j]) * c->score_weight;
+    }
+
+    for (int i = 0; i < CW_SIGNALS_MAX; i++) {
+        CwSignal *sig = &c->signals[i];
+        if (sig->bin >= 0 && !sig->retiring) {
+            follow_signal(c, sig, frame, row);
+        }
+    }
+    for (int j = 1; j < c->width - 1; j++) {
+        if (c->score[j] >= CW_SPAWN_SCORE && c->average[j] > c->average[j - 1] &&
+            c->average[j] >= c->average[j + 1] && !near_signal(c, j, NULL)) {
+            start_signal(c, j, frame);
+        }
+    }
+}
+
+// Function to run frames from next_frame on: spectra in parallel, then
+// detection, then every live signal's decoding in parallel
+static void run_block(CwChannelizer *c, int frames) {
+    int per_task = (frames + c->tasks - 1) / c->tasks;
+    for (int t = 0; t < c->tasks; t++) {
+        CwFftTask *task = &c->fft_tasks[t];
+        int first = t * per_task;
+        task->first = c->next_frame + (uint64_t)first;
+        task->count = first >= frames ? 0 : frames - first < per_task ? frames - first : per_task;
+        if (task->count > 0) {
+            run_task(c, fft_task, task);
+        }
+    }
+    wait_tasks(c);
+
+    for (int i = 0; i < CW_SIGNALS_MAX; i++) {
+        c->signals[i].first_frame = c->next_frame;
+        c->signals[i].level_count = 0;
+    }
+    for (int f = 0; f < frames; f++) {
+        detect_frame(c, c->next_frame + (uint64_t)f);
+    }
+
+    for (int i = 0; i < CW_SIGNALS_MAX; i++) {
+        if (c->signals[i].bin >= 0) {
+            run_task(c, decode_task, &c->signals[i]);
+        }
+    }
+    wait_tasks(c);
+
+    for (int i = 0; i < CW_SIGNALS_MAX; i++) {
+        CwSignal *sig = &c->signals[i];
+        if (sig->bin >= 0 && sig->retiring) {
+            const CwStats *s = &sig->channel.stats;
+            c->retired.marks += s->marks;
+            c->retired.dots += s->dots;
+            c->retired.dashes += s->dashes;
+            c->retired.chars += s->chars;
+            c->retired.unknown += s->unknown;
+            c->retired.lines += s->lines;
+            move_signal(c, sig, -1);
+            c->active--;
+        }
+    }
+
+    // Keep the samples the next block's frames start in
+    int used = frames * c->hop;
+    int keep = c->in_count > used ? c->in_count - used : 0;
+    memmove(c->in_re, c->in_re + used, (size_t)keep * sizeof(float));
+    memmove(c->in_im, c->in_im + used, (size_t)keep * sizeof(float));
+    c->in_count = keep;
+    c->next_frame += (uint64_t)frames;
+}
+
+// Function to set up for audio at rate_hz, decoding lo_hz to hi_hz (offsets
+// from the centre, either side of 0, for I/Q) on threads threads
+int cw_channelizer_init(CwChannelizer *c, uint32_t rate_hz, int iq, float lo_hz, float hi_hz,
+                        const CwConfig *config, int threads, CwSignalOutput output, void *ctx) {
+    memset(c, 0, sizeof(*c));
+    c->rate_hz = rate_hz;
+    c->iq = iq;
+    c->config = *config;
+    c->output = output;
+    c->ctx = ctx;
+
+    // Nearest power of two to CW_FFT_WINDOW_US
+    float target = (float)rate_hz * CW_FFT_WINDOW_US / 1e6f;
+    int n = CW_FFT_MIN, bits = 0;
+    while (n < CW_FFT_MAX && (float)n * (float)M_SQRT2 < target) {
+        n *= 2;
+    }
+    while ((1 << bits) < n) {
+        bits++;
+    }
+    c->size = n;
+    c->hop = n / CW_FFT_OVERLAP;
+
+    int dc = iq ? n / 2 : 0, top = iq ? n - 1 : n / 2;
+    int lo = (int)ceilf(lo_hz * (float)n / (float)rate_hz) + dc;
+    int hi = (int)floorf(hi_hz * (float)n / (float)rate_hz) + dc;
+    lo = lo < 1 ? 1 : lo;
+    hi = hi > top - 1 ? top - 1 : hi;
+    if (rate_hz == 0 || hi - lo < 2) {
+        fprintf(stderr, "Band %.0f-%.0f Hz is too narrow at %u Hz\n", lo_hz, hi_hz, rate_hz);
+        return -1;
+    }
+    c->base = lo - 1;
+    c->width = hi - lo + 3;
+
+    float step_us = (float)c->hop * 1e6f / (float)rate_hz;
+    c->history_frames = (int)ceilf(CW_HISTORY_US / step_us);
+    c->ring_frames = c->history_frames + CW_BLOCK_FRAMES;
+    c->in_max = (CW_BLOCK_FRAMES - 1) * c->hop + n;
+    c->smooth_weight = fminf(1.0f, step_us / CW_SMOOTH_US);
+    c->noise_frames = (uint64_t)ceilf(CW_NOISE_US / step_us);
+    c->noise_up = expf(step_us / CW_NOISE_US * CW_NOISE_QUANTILE);
+    c->noise_down = expf(-step_us / CW_NOISE_US * (1.0f - CW_NOISE_QUANTILE));
+    c->score_weight = step_us / CW_SCORE_US;
+    c->wake_frames = (uint64_t)(CW_WAKE_US / step_us);
+    c->retire_frames = (uint64_t)(CW_RETIRE_US / step_us);
+
+    threads = threads < 1 ? 1 : threads > CW_THREADS_MAX ? CW_THREADS_MAX : threads;
+    c->tasks = threads;
+    int levels = c->history_frames + CW_BLOCK_FRAMES;
+    c->window = malloc((size_t)n * sizeof(float));
+    c->twiddle_re = malloc((size_t)n / 2 * sizeof(float));
+    c->twiddle_im = malloc((size_t)n / 2 * sizeof(float));
+    c->reverse = malloc((size_t)n * sizeof(int));
+    c->in_re = calloc((size_t)c->in_max, sizeof(float));
+    c->in_im = calloc((size_t)c->in_max, sizeof(float));
+    c->spectra = malloc((size_t)c->ring_frames * (size_t)c->width * sizeof(float));
+    c->smooth = calloc((size_t)c->width, sizeof(float));
+    c->noise = calloc((size_t)c->width, sizeof(float));
+    c->score = calloc((size_t)c->width, sizeof(float));
+    c->average = calloc((size_t)c->width, sizeof(float));
+    c->bin_signal = calloc((size_t)c->width, sizeof(int));
+    c->level_store = malloc((size_t)CW_SIGNALS_MAX * (size_t)levels * sizeof(float));
+    int ok = c->window && c->twiddle_re && c->twiddle_im && c->reverse && c->in_re && c->in_im && c->spectra &&
+             c->smooth && c->noise && c->score && c->average && c->bin_signal &&
+             c->level_store;
+    for (int t = 0; t < c->tasks && ok; t++) {
+        c->fft_tasks[t].owner = c;
+        c->fft_tasks[t].re = malloc((size_t)n * sizeof(float));
+        c->fft_tasks[t].im = malloc((size_t)n * sizeof(float));
+        ok = c->fft_tasks[t].re && c->fft_tasks[t].im;
+    }
+    if (!ok) {
+        perror("Failed to allocate channelizer buffers");
+        cw_channelizer_free(c);
+        return -1;
+    }
+    if (threads > 1 && (c->pool = work_pool_create(threads)) == NULL) {
+        fprintf(stderr, "Failed to start worker threads, running on one\n");
+    }
+
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) {
+        c->window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * (float)i / (float)n);  // Hann
+        sum += c->window[i];
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        c->reverse[i] = r;
+    }
+    for (int i = 0; i < n / 2; i++) {
+        c->twiddle_re[i] = cosf(2.0f * (float)M_PI * (float)i / (float)n);
+        c->twiddle_im[i] = -sinf(2.0f * (float)M_PI * (float)i / (float)n);
+    }
+    c->scale = (iq ? 1.0f : 2.0f) / sum;  // A sine's bin magnitude is sum / 2 times its amplitude
+
+    for (int i = 0; i < CW_SIGNALS_MAX; i++) {
+        c->signals[i].bin = -1;
+        c->signals[i].owner = c;
+        c->signals[i].levels = &c->level_store[(size_t)i * (size_t)levels];
+    }
+    return 0;
+}
+
+// Function to feed n samples in -1..1: mono, or I/Q pairs
+void cw_channelizer_process(CwChannelizer *c, const float *x, size_t n) {
+    while (n > 0) {
+        size_t take = (size_t)(c->in_max - c->in_count);
+        take = take < n ? take : n;
+        for (size_t i = 0; i < take; i++) {
+            c->in_re[c->in_count + (int)i] = c->iq ? x[2 * i] : x[i];
+            c->in_im[c->in_count + (int)i] = c->iq ? x[2 * i + 1] : 0.0f;
+        }
+        c->in_count += (int)take;
+        c->samples += take;
+        x += c->iq ? 2 * take : take;
+        n -= take;
+        if (c->in_count == c->in_max) {
+            run_block(c, CW_BLOCK_FRAMES);
+        }
+    }
+}
+
+// Function to run the frames that start in the last samples, zero-padded,
+// then retire every signal so its last line is output
+void cw_channelizer_finish(CwChannelizer *c) {
+    while (c->in_count > 0) {
+        int frames = (c->in_count + c->hop - 1) / c->hop;
+        frames = frames < CW_BLOCK_FRAMES ? frames : CW_BLOCK_FRAMES;
+        memset(c->in_re + c->in_count, 0, (size_t)(c->in_max - c->in_count) * sizeof(float));
+        memset(c->in_im + c->in_count, 0, (size_t)(c->in_max - c->in_count) * sizeof(float));
+        run_block(c, frames);
+    }
+    for (int i = 0; i < CW_SIGNALS_MAX; i++) {
+        c->signals[i].retiring = 1;
+    }
+    run_block(c, 0);
+}
+
+void cw_channelizer_free(CwChannelizer *c) {
+    if (c->pool != NULL) {
+        work_pool_destroy(c->pool);
+        c->pool = NULL;
+    }
+    for (int t = 0; t < c->tasks; t++) {
+        free(c->fft_tasks[t].re);
+        free(c->fft_tasks[t].im);
+        c->fft_tasks[t].re = c->fft_tasks[t].im = NULL;
+    }
+    free(c->window);
+    free(c->twiddle_re);
+    free(c->twiddle_im);
+    free(c->reverse);
+    free(c->in_re);
+    free(c->in_im);
+    free(c->spectra);
+    free(c->smooth);
+    free(c->noise);
+    free(c->score);
+    free(c->average);
+    free(c->bin_signal);
+    free(c->level_store);
+    c->window = c->twiddle_re = c->twiddle_im = c->in_re = c->in_im = NULL;
+    c->spectra = c->smooth = c->noise = c->score = c->average = c->level_store = NULL;
+    c->reverse = c->bin_signal = NULL;
+}
+
+void cw_channelizer_report(const CwChannelizer *c, FILE *out) {
+    const CwStats *s = &c->retired;
+    fprintf(out, "%d-point FFT every %d samples (%.1f Hz bins, %.1f ms), %.0f to %.0f Hz, %d threads\n", c->size,
+            c->hop, (float)c->rate_hz / (float)c->size, (float)c->hop * 1e3f / (float)c->rate_hz, bin_hz(c, 1.0f),
+            bin_hz(c, (float)(c->width - 2)), c->tasks);
+    fprintf(out, "%d signals (%d at once), %llu marks, %llu chars (%llu unknown), %llu lines\n", c->next_id,
+            c->active_max, (unsigned long long)s->marks, (unsigned long long)s->chars,
+            (unsigned long long)s->unknown, (unsigned long long)s->lines);
+}
@@ -0,0 +1,154 @@
+#ifndef CW_CHANNELIZER_H
+#define CW_CHANNELIZER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "cw_audio.h"
+#include "work_pool.h"
+
+// Decodes every CW signal in a wideband recording at once: a receiver's
+// SSB passband as real audio, or complex I/Q from an SDR. Input is cut
+// into overlapping Hann-windowed FFT frames, CW_FFT_OVERLAP per FFT
+// length, and handled in blocks of CW_BLOCK_FRAMES:
+//   spectra   - the block's FFTs are split across the worker threads.
+//   detection - every bin has a smoothed power and a noise floor: the
+//               CW_NOISE_QUANTILE quantile of its power, taken over the
+//               first CW_NOISE_US and then tracked with that time
+//               constant. That is the noise between the marks of a keyed
+//               carrier, even one there from the start, and it follows
+//               the passband's shape. A bin over CW_SPAWN_SNR times its
+//               floor is a hit. A hit rate over CW_SPAWN_SCORE in the
+//               last CW_SCORE_US starts a signal on the bin with the most
+//               mean power over that time, unless one is already within
+//               CW_GUARD_BINS. A signal moves to a neighbour with
+//               CW_DRIFT_RATIO more mean power, so it follows a drifting
+//               tone. While its hit rate is under CW_QUIET_SCORE its
+//               decoder is held: the floor follows the noise but can't
+//               key, so noise can't key it while its AGC winds down.
+//               After CW_RETIRE_US of that it is retired.
+//   decoding  - each signal is a CwChannel fed its bin's amplitude every
+//               frame, so it has its own AGC, debounce filter, speed
+//               tracking and decoder. The last CW_HISTORY_US of its bin
+//               is replayed when it starts, held up to its first mark,
+//               so the characters that got it noticed are decoded too. A
+//               first pass over the replay measures the speed, so those
+//               characters aren't lost while it is tracked from -wpm.
+//               Signals are decoded in parallel, one task per signal per
+//               block.
+// Detection runs on one thread between the two parallel stages; it is a
+// few operations per bin per frame.
+//
+// The output callback is called from the worker threads, for different
+// signals at the same time, but never for one signal from two threads.
+
+#define CW_FFT_WINDOW_US 24000      // FFT length aimed at; the nearest power of two is used
+#define CW_FFT_MIN 64
+#define CW_FFT_MAX 8192             // Rates up to about 340 kHz
+#define CW_FFT_OVERLAP 8            // Frames per FFT length
+#define CW_BLOCK_FRAMES 128         // Frames per block of parallel work
+#define CW_SIGNALS_MAX 128
+#define CW_THREADS_MAX 64
+#define CW_SEARCH_LO_HZ 200.0f      // Default band for real audio, up to CW_SEARCH_EDGE of the rate
+#define CW_SEARCH_EDGE 0.45f        // Default band edge, as a fraction of the rate (either side for I/Q)
+
+#define CW_SMOOTH_US 8000           // Bin power smoothing for detection
+#define CW_NOISE_US 500000          // Noise floor time constant, and first estimate
+#define CW_NOISE_QUANTILE 0.3f      // Below most keying duty cycles' gaps
+#define CW_SPAWN_SNR 12.0f          // Smoothed power over the floor for a hit, about 6 times the mean noise
+#define CW_SCORE_US 1000000         // Hit rate averaging
+#define CW_SPAWN_SCORE 0.15f        // Hit rate that starts a signal
+#define CW_GUARD_BINS 2             // Closest two signals can be
+#define CW_DRIFT_RATIO 1.25f        // About 1 dB, so a tone between two bins doesn't flip
+#define CW_QUIET_SCORE 0.1f         // Hit rate that keeps a signal decoding, held over word spaces
+#define CW_WAKE_US 100000           // Decoded back this far when the rate comes back up
+#define CW_HISTORY_US 1000000       // Replayed into a new signal's decoder, at least CW_NOISE_US
+#define CW_RETIRE_US 6000000        // Past CW_LINE_US, so the last line ends first
+
+typedef struct CwChannelizer CwChannelizer;
+typedef struct CwSignal CwSignal;
+
+// As CwOutput, with the signal it came from
+typedef void (*CwSignalOutput)(const CwSignal *sig, int event, char c, const char *text, uint64_t t_us,
+                               void *ctx);
+
+struct CwSignal {
+    int id;                     // Counts from 1 over the run
+    int bin;                    // Stored bin followed, -1 when the slot is free
+    float hz;                   // Tone, or offset from the centre for I/Q
+    int retiring;               // Flushed and freed at the end of the block
+    int fresh;                  // Started this block: speed not measured yet
+    uint64_t last_active;       // Last frame the hit rate was over CW_QUIET_SCORE
+    uint64_t first_frame;       // Frame of levels[0]
+    int level_count;
+    float *levels;              // Amplitudes to decode this block, negative while held
+    CwChannel channel;
+    CwChannelizer *owner;
+};
+
+typedef struct {
+    CwChannelizer *owner;
+    uint64_t first;             // Frames this task transforms
+    int count;
+    float *re;                  // FFT scratch
+    float *im;
+} CwFftTask;
+
+struct CwChannelizer {
+    uint32_t rate_hz;
+    int iq;                     // Input is I/Q pairs
+    int size;                   // FFT points
+    int hop;                    // Samples between frames
+    int base;                   // Spectrum index of stored bin 0, DC at size / 2 for I/Q
+    int width;                  // Stored bins: the band and one either side
+    float scale;                // Bin magnitude to sine amplitude
+    float *window;
+    float *twiddle_re;
+    float *twiddle_im;
+    int *reverse;               // Bit-reversed index
+
+    float *in_re;               // Samples of the next block, from frame next_frame on
+    float *in_im;
+    int in_count;
+    int in_max;
+    uint64_t samples;           // Samples fed so far
+    uint64_t next_frame;
+
+    int ring_frames;            // Power spectra kept: history and one block
+    int history_frames;
+    float *spectra;
+    float *smooth;              // Per stored bin: detection state
+    float *noise;
+    float *score;
+    float *average;             // Mean power over CW_SCORE_US
+    int *bin_signal;            // Index + 1 of the signal on each stored bin, 0 for none
+    uint64_t noise_frames;      // Frames in the first noise estimate
+    float smooth_weight;        // Per-frame smoothing weights
+    float noise_up;             // Floor steps
+    float noise_down;
+    float score_weight;
+    uint64_t wake_frames;
+    uint64_t retire_frames;
+
+    CwConfig config;
+    CwSignal signals[CW_SIGNALS_MAX];
+    float *level_store;         // Every signal's levels
+    int active;
+    int active_max;
+    int next_id;
+    CwStats retired;            // Totals of the retired signals
+
+    WorkPool *pool;             // NULL on one thread
+    int tasks;
+    CwFftTask fft_tasks[CW_THREADS_MAX];
+    CwSignalOutput output;
+    void *ctx;
+};
+
+int cw_channelizer_init(CwChannelizer *c, uint32_t rate_hz, int iq, float lo_hz, float hi_hz,
+                        const CwConfig *config, int threads, CwSignalOutput output, void *ctx);
+void cw_channelizer_process(CwChannelizer *c, const float *x, size_t n);
+void cw_channelizer_finish(CwChannelizer *c);
+void cw_channelizer_free(CwChannelizer *c);
+void cw_channelizer_report(const CwChannelizer *c, FILE *out);
+
+#endif
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "debounce.h"
+
+// Function to read a spec string such as "lockout:20000". Returns 0 on success.
+int debounce_parse(const char *spec, DebounceConfig *config) {
+    char name[16];
+    unsigned int window = 0;
+    int samples = DEBOUNCE_SHIFT_SAMPLES;
+    int fields = sscanf(spec, "%15[a-z]:%u:%d", name, &window, &samples);
+
+    memset(config, 0, sizeof(*config));
+    config->samples = samples;
+    config->window_us = window;
+    if (fields >= 1 && strcmp(name, "none") == 0) {
+        config->mode = DEBOUNCE_NONE;
+        return 0;
+    }
+    if (fields < 2 || window == 0) {
+        fprintf(stderr, "Bad debounce spec '%s' (none, integrator:us, shift:us[:samples], lockout:us)\n", spec);
+        return -1;
+    }
+    if (strcmp(name, "integrator") == 0) {
+        config->mode = DEBOUNCE_INTEGRATOR;
+    } else if (strcmp(name, "shift") == 0 && samples >= 1) {
+        config->mode = DEBOUNCE_SHIFT;
+    } else if (strcmp(name, "lockout") == 0) {
+        config->mode = DEBOUNCE_LOCKOUT;
+    } else {
+        fprintf(stderr, "Bad debounce spec '%s' (none, integrator:us, shift:us[:samples], lockout:us)\n", spec);
+        return -1;
+    }
+    return 0;
+}
+
+const char *debounce_mode_name(int mode) {
+    static const char *names[] = {"none", "integrator", "shift", "lockout"};
+    return mode >= 0 && mode <= DEBOUNCE_LOCKOUT ? names[mode] : "?";
+}
+
+// Function to start a pin at a known level (no output edge for it)
+void debounce_init(Debouncer *d, const DebounceConfig *config, int pin, int level, DebounceOutput output, void *ctx) {
+    memset(d, 0, sizeof(*d));
+    d->config = *config;
+    d->pin = pin;
+    d->raw = level != 0;
+    d->out = d->raw;
+    d->integ_us = d->raw ? config->window_us : 0;
+    d->output = output;
+    d->ctx = ctx;
+}
+
+static void emit(Debouncer *d, uint64_t t_us, int level) {
+    d->out = level;
+    d->accepted++;
+    d->output(d->pin, t_us, level, d->ctx);
+}
+
+// Function to run the filter forward to t_us with the input unchanged,
+// emitting an output edge (at the time the filter accepts it) if one is due
+static void advance(Debouncer *d, uint64_t t_us) {
+    uint32_t window = d->config.window_us;
+
+    switch (d->config.mode) {
+    case DEBOUNCE_INTEGRATOR: {
+        uint64_t dt = t_us - d->integ_t_us;
+        if (d->raw) {
+            if (!d->out && d->integ_us + dt >= window) {
+                emit(d, d->integ_t_us + (window - d->integ_us), 1);
+            }
+            d->integ_us = d->integ_us + dt >= window ? window : d->integ_us + dt;
+        } else {
+            if (d->out && dt >= d->integ_us) {
+                emit(d, d->integ_t_us + d->integ_us, 0);
+            }
+            d->integ_us = dt >= d->integ_us ? 0 : d->integ_us - dt;
+        }
+        d->integ_t_us = t_us;
+        break;
+    }
+    case DEBOUNCE_SHIFT:
+        if (d->raw != d->out) {
+            // First sample on the grid at or after the change, then samples - 1 more
+            uint64_t first = (d->raw_since_us + window - 1) / window * window;
+            uint64_t at = first + (uint64_t)(d->config.samples - 1) * window;
+            if (at <= t_us) {
+                emit(d, at, d->raw);
+            }
+        }
+        break;
+    case DEBOUNCE_LOCKOUT:
+        if (d->raw != d->out && t_us >= d->lock_until_us) {
+            // The input settled on the other level during the lockout
+            uint64_t at = d->lock_until_us > d->raw_since_us ? d->lock_until_us : d->raw_since_us;
+            emit(d, at, d->raw);
+            d->lock_until_us = at + window;
+        }
+        break;
+    }
+}
+
+// Function to feed a raw level change; edges must arrive in time order
+void debounce_edge(Debouncer *d, uint64_t t_us, int level) {
+    level = level != 0;
+    advance(d, t_us);
+    if (level == d->raw) {
+        return;
+    }
+    if (d->raw != d->out && level == d->out) {
+        d->glitches++;  // Back to the output level before the excursion was accepted
+    }
+    d->raw = level;
+    d->raw_since_us = t_us;
+
+    if (d->config.mode == DEBOUNCE_NONE) {
+        emit(d, t_us, level);
+    } else if (d->config.mode == DEBOUNCE_LOCKOUT && level != d->out && t_us >= d->lock_until_us) {
+        emit(d, t_us, level);  // No delay on a clean edge
+        d->lock_until_us = t_us + d->config.window_us;
+    }
+}
+
+// Function to let pending output edges through when no new edge arrives
+void debounce_poll(Debouncer *d, uint64_t now_us) {
+    advance(d, now_us);
+}
@@ -0,0 +1,58 @@
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+
+// Contact debounce on timestamped edges, one Debouncer per pin. Filters
+// run on edge times rather than on a sampling loop, so a clean key costs a
+// few comparisons per edge and no dead time:
+//   integrator - a counter runs up while the input is high and down while
+//                low (1 per us, clamped to 0..window_us); the output flips
+//                when it reaches either end
+//   shift      - the input is sampled every window_us; the output flips
+//                after `samples` consecutive samples agree
+//   lockout    - the first edge is passed through at once, then the input
+//                is ignored for window_us (the minimum pulse width)
+// A glitch is an excursion away from the output level that ends before the
+// filter accepts it.
+//
+// Spec strings: "none", "integrator:5000", "shift:1000:8", "lockout:20000"
+
+#define DEBOUNCE_NONE 0
+#define DEBOUNCE_INTEGRATOR 1
+#define DEBOUNCE_SHIFT 2
+#define DEBOUNCE_LOCKOUT 3
+
+#define DEBOUNCE_SHIFT_SAMPLES 8  // Default agreeing samples for the shift register
+#define DEBOUNCE_DEFAULT "lockout:10000"  // Well under a dot at 20 WPM (60 ms), well over bounce
+
+typedef struct {
+    int mode;
+    uint32_t window_us;
+    int samples;            // Shift register only
+} DebounceConfig;
+
+typedef void (*DebounceOutput)(int pin, uint64_t t_us, int level, void *ctx);
+
+typedef struct {
+    DebounceConfig config;
+    int pin;
+    int raw;                // Input level
+    uint64_t raw_since_us;
+    int out;                // Filtered level
+    uint64_t integ_us;      // Integrator value at integ_t_us
+    uint64_t integ_t_us;
+    uint64_t lock_until_us; // Lockout end
+    uint64_t glitches;
+    uint64_t accepted;      // Output edges
+    DebounceOutput output;
+    void *ctx;
+} Debouncer;
+
+int debounce_parse(const char *spec, DebounceConfig *config);
+const char *debounce_mode_name(int mode);
+void debounce_init(Debouncer *d, const DebounceConfig *config, int pin, int level, DebounceOutput output, void *ctx);
+void debounce_edge(Debouncer *d, uint64_t t_us, int level);
+void debounce_poll(Debouncer *d, uint64_t now_us);
+
+#endif
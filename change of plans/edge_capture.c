@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include "edge_sampler.h"
+#include "debounce.h"
+#include "morse_decoder.h"
+#include "morse_timing.h"
+#include "pin_config.h"
+
+// Records GPIO bank 0 with the high-rate edge sampler into a run-length
+// encoded capture file, or replays a capture: decodes one pin through the
+// debounce filter and edge classifier and prints its raw pulse widths for
+// bounce analysis. The GPIO block, the default pins (every key channel when
+// recording, the first key when replaying) and each pin's polarity come
+// from the pin map (morse_pins.conf).
+//
+// Usage: edge_capture -o capture.rle [-rate Hz] [-pins mask] [-seconds N]
+//        edge_capture -replay capture.rle [-pin N] [-debounce spec]
+//                     [-tick ms] [-dash ticks] [-gap ticks]
+//
+// Set MORSE_RT to pin the sampling thread (see rt_profile.h).
+//
+// gcc -O2 -o edge_capture edge_capture.c edge_sampler.c debounce.c rt_profile.c morse_decoder.c
+//     morse_timing.c pin_config.c -lpthread
+
+#define GPLEV0 0x34
+#define PULSE_BUCKETS 24    // Powers of two from 1 us to ~8 s
+#define REPLAY_FLUSH_US 60000000ULL
+
+volatile sig_atomic_t stop = 0;
+
+static void handle_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static int record(const PinConfig *pins, const char *path, uint32_t rate_hz, uint32_t pin_mask, int seconds) {
+    volatile unsigned int *gpio = pin_config_map(pins);
+    if (gpio == NULL) {
+        return -1;
+    }
+    pin_config_setup(pins, gpio);
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        perror("Failed to open capture file");
+        pin_config_unmap(gpio);
+        return -1;
+    }
+
+    RtProfile rt;
+    rt_profile_from_env(&rt);
+    rt_prepare_process(&rt);
+    EdgeSampler sampler;
+    if (edge_capture_begin(file, rate_hz, pin_mask) != 0 ||
+        edge_sampler_start(&sampler, &gpio[GPLEV0 / 4], pin_mask, rate_hz, EDGE_RING_DEFAULT, &rt) != 0) {
+        fclose(file);
+        pin_config_unmap(gpio);
+        return -1;
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    fprintf(stderr, "Recording pins 0x%08x at %u Hz to %s, Ctrl-C to stop\n", pin_mask, rate_hz, path);
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t start_ns = 0;
+    uint64_t edges = 0;
+    GpioRun run;
+    while (!stop) {
+        while (edge_ring_pop(&sampler.ring, &run)) {
+            if (start_ns == 0) {
+                start_ns = run.t_ns;  // The sampler's first record holds the initial levels
+            }
+            edge_capture_write(file, &run, start_ns);
+            edges++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (seconds > 0 && now.tv_sec - start.tv_sec >= seconds) {
+            break;
+        }
+        usleep(10000);  // Drain 100 times a second; the ring holds minutes of keying
+    }
+    edge_sampler_stop(&sampler);
+    while (edge_ring_pop(&sampler.ring, &run)) {
+        edge_capture_write(file, &run, start_ns);
+        edges++;
+    }
+
+    fprintf(stderr, "%llu samples, %llu late, %llu records, %llu dropped\n",
+            (unsigned long long)atomic_load(&sampler.samples), (unsigned long long)atomic_load(&sampler.late_samples),
+            (unsigned long long)edges, (unsigned long long)atomic_load(&sampler.ring.dropped));
+    edge_ring_free(&sampler.ring);
+    int rc = fclose(file) == 0 ? 0 : -1;
+    pin_config_unmap(gpio);
+    return rc;
+}
+
+static void print_signal(int signal, uint64_t t_us, void *ctx) {
+    MorseDecoder *decoder = (MorseDecoder *)ctx;
+    char c;
+    (void)t_us;
+    int event = morse_decoder_signal(decoder, signal, &c);
+    if (event == MORSE_EVENT_CHAR) {
+        putchar(c);
+    } else if (event == MORSE_EVENT_LINE) {
+        putchar('\n');
+    }
+}
+
+// Debounced edges go on to the classifier
+static void classify_edge(int pin, uint64_t t_us, int level, void *ctx) {
+    (void)pin;
+    edge_classifier_edge((EdgeClassifier *)ctx, t_us, level);
+}
+
+static void print_pulses(const char *name, const uint64_t *buckets) {
+    printf("%s pulse widths:\n", name);
+    for (int i = 0; i < PULSE_BUCKETS; i++) {
+        if (buckets[i] > 0) {
+            printf("  < %8llu us  %llu\n", 1ULL << (i + 1), (unsigned long long)buckets[i]);
+        }
+    }
+}
+
+static int replay(const PinConfig *pins, const char *path, int pin, const MorseTiming *timing,
+                  const DebounceConfig *debounce) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror("Failed to open capture file");
+        return -1;
+    }
+    EdgeCaptureHeader header;
+    if (edge_capture_read_header(file, &header) != 0) {
+        fclose(file);
+        return -1;
+    }
+    if (!(header.pin_mask & (1U << pin))) {
+        fprintf(stderr, "Pin %d was not recorded (mask 0x%08x)\n", pin, header.pin_mask);
+        fclose(file);
+        return -1;
+    }
+
+    MorseDecoder decoder;
+    EdgeClassifier classifier;
+    Debouncer filter;
+    morse_decoder_init(&decoder);
+    edge_classifier_init(&classifier, timing, print_signal, &decoder);
+
+    uint64_t high[PULSE_BUCKETS] = {0};  // Pressed
+    uint64_t low[PULSE_BUCKETS] = {0};   // Released
+    uint64_t records = 0, edges = 0;
+    uint64_t last_us = 0;
+    int level = -1;
+    GpioRun run;
+    while (edge_capture_read(file, &run)) {
+        uint64_t t_us = run.t_ns / 1000;
+        int now = ((run.levels ^ pins->invert_mask) >> pin) & 1;  // 1 = pressed, whatever the polarity
+        records++;
+        if (now == level) {
+            continue;  // Another recorded pin changed
+        }
+        if (level >= 0) {
+            uint64_t width = t_us - last_us;
+            int bucket = width > 0 ? 63 - __builtin_clzll(width) : 0;
+            (level ? high : low)[bucket < PULSE_BUCKETS ? bucket : PULSE_BUCKETS - 1]++;
+            edges++;
+            debounce_edge(&filter, t_us, now);
+        } else {
+            debounce_init(&filter, debounce, pin, now, classify_edge, &classifier);  // First record: initial levels
+            classifier.level = now;
+        }
+        level = now;
+        last_us = t_us;
+    }
+    // Flush the last edge and character: run time on well past every window
+    debounce_poll(&filter, last_us + REPLAY_FLUSH_US);
+    edge_classifier_poll(&classifier, last_us + REPLAY_FLUSH_US + classifier.gap_us);
+    fclose(file);
+
+    printf("\n%llu records, %llu edges on GPIO %d, sampled at %u Hz (%.1f us resolution)\n",
+           (unsigned long long)records, (unsigned long long)edges, pin, header.rate_hz, 1e6 / header.rate_hz);
+    printf("Debounce %s %u us: %llu edges passed, %llu glitches rejected\n", debounce_mode_name(filter.config.mode),
+           filter.config.window_us, (unsigned long long)filter.accepted, (unsigned long long)filter.glitches);
+    print_pulses("Pressed", high);
+    print_pulses("Released", low);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *output_path = NULL;
+    const char *replay_path = NULL;
+    uint32_t rate_hz = EDGE_RATE_DEFAULT;
+    uint32_t pin_mask = 0;
+    int seconds = 0;
+    int pin = -1;
+    MorseTiming timing;
+    DebounceConfig debounce;
+    PinConfig pins;
+
+    if (pin_config_init(&pins) != 0) {
+        return -1;
+    }
+    const PinChannel *key_channel = pin_config_find(&pins, PIN_KIND_KEY, 0);
+    if (key_channel != NULL) {
+        pin = key_channel->pin;
+    }
+    pin_mask = pins.key_mask;
+    morse_timing_default(&timing);
+    morse_timing_load(MORSE_TIMING_FILE, 0, &timing);
+    debounce_parse(DEBOUNCE_DEFAULT, &debounce);
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return -1;
+        }
+        if (strcmp(argv[i], "-o") == 0) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "-replay") == 0) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "-rate") == 0) {
+            rate_hz = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-pins") == 0) {
+            pin_mask = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-seconds") == 0) {
+            seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-pin") == 0) {
+            pin = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-debounce") == 0) {
+            if (debounce_parse(argv[++i], &debounce) != 0) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "-tick") == 0) {
+            timing.tick_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-dash") == 0) {
+            timing.dash_ticks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-gap") == 0) {
+            timing.gap_ticks = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if (replay_path != NULL) {
+        if (pin < 0 || pin > 31) {
+            fprintf(stderr, "Pin must be 0-31 (the pin map has no key channel)\n");
+            return -1;
+        }
+        return replay(&pins, replay_path, pin, &timing, &debounce);
+    }
+    if (output_path == NULL) {
+        fprintf(stderr, "Usage: edge_capture -o capture.rle [-rate Hz] [-pins mask] [-seconds N]\n"
+                        "       edge_capture -replay capture.rle [-pin N] [-debounce spec]\n"
+                        "                    [-tick ms] [-dash ticks] [-gap ticks]\n");
+        return -1;
+    }
+    if (pin_mask == 0) {
+        fprintf(stderr, "No pins to record: the pin map has no key channel, use -pins\n");
+        return -1;
+    }
+    return record(&pins, output_path, rate_hz, pin_mask, seconds);
+}
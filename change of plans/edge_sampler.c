@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "edge_sampler.h"
+#include "morse_decoder.h"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Function to allocate a ring of at least capacity records (rounded up to a power of two)
+int edge_ring_init(EdgeRing *ring, size_t capacity) {
+    size_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->slots = calloc(slots, sizeof(GpioRun));
+    if (ring->slots == NULL) {
+        perror("Failed to allocate edge ring");
+        return -1;
+    }
+    ring->mask = (uint32_t)(slots - 1);
+    return 0;
+}
+
+void edge_ring_free(EdgeRing *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+// Function for the single producer (the sampler thread or another edge
+// source); a full ring drops the record
+void edge_ring_push(EdgeRing *ring, const GpioRun *run) {
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail > ring->mask) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    ring->slots[head & ring->mask] = *run;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Function for the single consumer. Returns 1 if a record was taken.
+int edge_ring_pop(EdgeRing *ring, GpioRun *run) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail == head) {
+        return 0;
+    }
+    *run = ring->slots[tail & ring->mask];
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+static void *sampler_thread(void *arg) {
+    EdgeSampler *s = (EdgeSampler *)arg;
+    if (s->rt.enabled) {
+        int applied = rt_enter_sampling(&s->rt, 0, RT_LOOP_SPINS);  // Busy-waits between slots
+        fprintf(stderr, "Edge sampler: %u Hz on CPU %d, applied %s\n", s->rate_hz, s->rt.cpu, rt_describe(applied));
+    }
+
+    uint64_t period = 1000000000ULL / s->rate_hz;
+    uint64_t next = now_ns();
+    uint32_t prev = *s->gplev;
+    uint32_t run = 0;
+    uint64_t samples = 0;
+    uint64_t late = 0;
+
+    GpioRun first = {next, prev, 0};  // Initial levels, so consumers know where they start
+    edge_ring_push(&s->ring, &first);
+
+    while (atomic_load_explicit(&s->running, memory_order_relaxed)) {
+        uint64_t now = now_ns();
+        if (now < next) {
+            continue;  // Busy wait: no sleep call can hit a 10-100 us slot
+        }
+        next += period;
+        if (now >= next) {
+            // Preempted past whole slots; resynchronize instead of bursting
+            late += (now - next) / period + 1;
+            next = now + period;
+        }
+
+        uint32_t levels = *s->gplev;  // One load samples every pin in the bank
+        samples++;
+        if ((levels ^ prev) & s->pin_mask) {
+            GpioRun edge = {now, levels, run};
+            edge_ring_push(&s->ring, &edge);
+            prev = levels;
+            run = 0;
+        }
+        run++;
+
+        if ((samples & 1023) == 0) {
+            atomic_store_explicit(&s->samples, samples, memory_order_relaxed);
+            atomic_store_explicit(&s->late_samples, late, memory_order_relaxed);
+        }
+    }
+    atomic_store(&s->samples, samples);
+    atomic_store(&s->late_samples, late);
+    return NULL;
+}
+
+// Function to start sampling gplev (the mapped GPLEV0 register) on its own
+// thread. ring_capacity is rounded up to a power of two.
+int edge_sampler_start(EdgeSampler *s, volatile unsigned int *gplev, uint32_t pin_mask, uint32_t rate_hz,
+                       size_t ring_capacity, const RtProfile *rt) {
+    memset(s, 0, sizeof(*s));
+    if (rate_hz == 0 || rate_hz > EDGE_RATE_MAX) {
+        fprintf(stderr, "Edge sampler rate must be 1-%d Hz\n", EDGE_RATE_MAX);
+        return -1;
+    }
+    if (edge_ring_init(&s->ring, ring_capacity) != 0) {
+        return -1;
+    }
+    s->gplev = gplev;
+    s->pin_mask = pin_mask;
+    s->rate_hz = rate_hz;
+    if (rt != NULL) {
+        s->rt = *rt;
+    }
+
+    atomic_store(&s->running, 1);
+    if (pthread_create(&s->tid, NULL, sampler_thread, s) != 0) {
+        perror("Failed to start edge sampler");
+        edge_ring_free(&s->ring);
+        return -1;
+    }
+    return 0;
+}
+
+// Function to stop the sampling thread. The ring stays readable so the
+// last records can be drained; free it with edge_ring_free afterwards.
+void edge_sampler_stop(EdgeSampler *s) {
+    if (!atomic_load(&s->running)) {
+        return;
+    }
+    atomic_store(&s->running, 0);
+    pthread_join(s->tid, NULL);
+}
+
+// Function to write the capture file header
+int edge_capture_begin(FILE *file, uint32_t rate_hz, uint32_t pin_mask) {
+    EdgeCaptureHeader header = {EDGE_CAPTURE_MAGIC, EDGE_CAPTURE_VERSION, rate_hz, pin_mask};
+    return fwrite(&header, sizeof(header), 1, file) == 1 ? 0 : -1;
+}
+
+// Function to append a record, timed relative to start_ns
+int edge_capture_write(FILE *file, const GpioRun *run, uint64_t start_ns) {
+    GpioRun rel = *run;
+    rel.t_ns = run->t_ns - start_ns;
+    return fwrite(&rel, sizeof(rel), 1, file) == 1 ? 0 : -1;
+}
+
+int edge_capture_read_header(FILE *file, EdgeCaptureHeader *header) {
+    if (fread(header, sizeof(*header), 1, file) != 1 || header->magic != EDGE_CAPTURE_MAGIC ||
+        header->version != EDGE_CAPTURE_VERSION) {
+        fprintf(stderr, "Not an edge capture file\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to read the next record. Returns 1, or 0 at the end of the file.
+int edge_capture_read(FILE *file, GpioRun *run) {
+    return fread(run, sizeof(*run), 1, file) == 1;
+}
+
+void edge_classifier_init(EdgeClassifier *c, const MorseTiming *timing, EdgeSignalCallback callback, void *ctx) {
+    memset(c, 0, sizeof(*c));
+    c->dash_us = (uint64_t)timing->dash_ticks * (uint64_t)timing->tick_ms * 1000;
+    c->gap_us = (uint64_t)timing->gap_ticks * (uint64_t)timing->tick_ms * 1000;
+    c->callback = callback;
+    c->ctx = ctx;
+}
+
+// Function to signal the gap once the key has been idle long enough; call
+// periodically (and it is called before every edge)
+void edge_classifier_poll(EdgeClassifier *c, uint64_t now_us) {
+    if (c->level == 0 && c->gap_due && now_us - c->since_us >= c->gap_us) {
+        c->gap_due = 0;
+        c->callback(MORSE_SIGNAL_GAP, c->since_us + c->gap_us, c->ctx);
+    }
+}
+
+// Function to feed one level change of the key pin
+void edge_classifier_edge(EdgeClassifier *c, uint64_t t_us, int level) {
+    level = level != 0;
+    if (level == c->level) {
+        return;
+    }
+    edge_classifier_poll(c, t_us);
+    if (level == 0) {
+        int signal = t_us - c->since_us >= c->dash_us ? MORSE_SIGNAL_DASH : MORSE_SIGNAL_DOT;
+        c->callback(signal, t_us, c->ctx);
+        c->gap_due = 1;
+    }
+    c->level = level;
+    c->since_us = t_us;
+}
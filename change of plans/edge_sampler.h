@@ -0,0 +1,95 @@
+#ifndef EDGE_SAMPLER_H
+#define EDGE_SAMPLER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "morse_timing.h"
+#include "rt_profile.h"
+
+// High-rate sampler for the whole GPIO bank. A dedicated thread (ideally
+// on an isolated core, see rt_profile.h) reads GPLEV0 in a paced busy loop
+// at 10-100 kHz. All 32 bank-0 pins are sampled in one load. Only changes
+// are kept: each change becomes one run record in a lock-free
+// single-producer ring, so a key sending at 20 WPM costs a few records a
+// second however fast it is sampled.
+//
+// Capture file (native endian): an EdgeCaptureHeader, then GpioRun records
+// with t_ns relative to the start of the capture.
+
+#define EDGE_RATE_DEFAULT 20000      // Samples per second
+#define EDGE_RATE_MAX 100000
+#define EDGE_RING_DEFAULT 65536      // Records, power of two (1 MB)
+#define EDGE_CAPTURE_MAGIC 0x454C524DU  // "MRLE"
+#define EDGE_CAPTURE_VERSION 1
+
+// One run-length-encoded edge: the bank changed to `levels` at t_ns after
+// holding its previous value for `samples` samples
+typedef struct {
+    uint64_t t_ns;
+    uint32_t levels;
+    uint32_t samples;
+} GpioRun;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t rate_hz;
+    uint32_t pin_mask;
+} EdgeCaptureHeader;
+
+typedef struct {
+    GpioRun *slots;
+    uint32_t mask;               // capacity - 1
+    _Atomic uint64_t head;       // Next slot the sampler writes
+    _Atomic uint64_t tail;       // Next slot the consumer reads
+    _Atomic uint64_t dropped;    // Records lost to a full ring
+} EdgeRing;
+
+typedef struct {
+    volatile unsigned int *gplev;  // Mapped GPLEV0
+    uint32_t pin_mask;             // Pins whose changes are recorded
+    uint32_t rate_hz;
+    RtProfile rt;                  // Applied to the sampling thread if enabled
+    EdgeRing ring;
+    atomic_int running;
+    pthread_t tid;
+    _Atomic uint64_t samples;      // GPLEV0 reads
+    _Atomic uint64_t late_samples; // Sample slots skipped because the thread was preempted
+} EdgeSampler;
+
+// Streaming dot/dash/gap classifier for one pin's edges, the edge-timed
+// counterpart of the assembly loop: presses of at least dash_us are dashes,
+// and idle for gap_us decides the character. The gap is signalled as soon
+// as it is decided rather than at the next press.
+typedef void (*EdgeSignalCallback)(int signal, uint64_t t_us, void *ctx);
+
+typedef struct {
+    uint64_t dash_us;
+    uint64_t gap_us;
+    int level;                   // Current key level
+    uint64_t since_us;           // Time of the last level change
+    int gap_due;                 // Elements sent since the last gap
+    EdgeSignalCallback callback;
+    void *ctx;
+} EdgeClassifier;
+
+int edge_sampler_start(EdgeSampler *s, volatile unsigned int *gplev, uint32_t pin_mask, uint32_t rate_hz,
+                       size_t ring_capacity, const RtProfile *rt);
+void edge_sampler_stop(EdgeSampler *s);
+int edge_ring_init(EdgeRing *ring, size_t capacity);
+void edge_ring_free(EdgeRing *ring);
+void edge_ring_push(EdgeRing *ring, const GpioRun *run);
+int edge_ring_pop(EdgeRing *ring, GpioRun *run);
+
+int edge_capture_begin(FILE *file, uint32_t rate_hz, uint32_t pin_mask);
+int edge_capture_write(FILE *file, const GpioRun *run, uint64_t start_ns);
+int edge_capture_read_header(FILE *file, EdgeCaptureHeader *header);
+int edge_capture_read(FILE *file, GpioRun *run);
+
+void edge_classifier_init(EdgeClassifier *c, const MorseTiming *timing, EdgeSignalCallback callback, void *ctx);
+void edge_classifier_edge(EdgeClassifier *c, uint64_t t_us, int level);
+void edge_classifier_poll(EdgeClassifier *c, uint64_t now_us);
+
+#endif
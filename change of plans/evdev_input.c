@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/input.h>
+#include "evdev_input.h"
+
+static int64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Function to find the pin a key code acts as, -1 if it isn't mapped
+static int code_pin(const EvdevInput *in, int code) {
+    for (int i = 0; i < in->count; i++) {
+        if (in->codes[i] == code) {
+            return in->pins[i];
+        }
+    }
+    return in->any_code_pin;
+}
+
+// Function to set a pin's bit for a key state, honouring the pin's polarity
+static uint32_t level_word(uint32_t levels, int pin, int pressed, uint32_t invert_mask) {
+    uint32_t bit = 1U << pin;
+    int level = pressed ^ ((invert_mask & bit) != 0);
+    return level ? levels | bit : levels & ~bit;
+}
+
+// Function to open an input device and map its keys to pins. With grab,
+// the keys stop reaching other programs (a keyboard used as a key doesn't
+// type into the console). The first record in the ring holds the levels
+// the keys are in now.
+int evdev_open(EvdevInput *in, const char *path, const PinConfig *pins, int grab) {
+    memset(in, 0, sizeof(*in));
+    in->epfd = -1;
+    in->wake_fd = -1;
+    in->any_code_pin = -1;
+
+    in->fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (in->fd < 0) {
+        perror("Failed to open input device");
+        return -1;
+    }
+
+    // Event stamps on the clock the rest of the pipeline uses; older kernels
+    // only give CLOCK_REALTIME, shifted by the offset measured here
+    int clock = CLOCK_MONOTONIC;
+    in->clock_monotonic = ioctl(in->fd, EVIOCSCLOCKID, &clock) == 0;
+    in->realtime_offset_ns = clock_ns(CLOCK_MONOTONIC) - clock_ns(CLOCK_REALTIME);
+    if (grab && ioctl(in->fd, EVIOCGRAB, 1) != 0) {
+        perror("Input device not grabbed, other programs still see its keys");
+    }
+
+    in->count = pins->evdev_count;
+    memcpy(in->codes, pins->evdev_codes, sizeof(in->codes));
+    memcpy(in->pins, pins->evdev_pins, sizeof(in->pins));
+    for (int i = 0; i < in->count; i++) {
+        in->pin_mask |= 1U << in->pins[i];
+    }
+    if (in->count == 0) {
+        const PinChannel *key = pin_config_find(pins, PIN_KIND_KEY, 0);
+        if (key == NULL) {
+            fprintf(stderr, "No evdev lines and no key channel in the pin map\n");
+            evdev_close(in);
+            return -1;
+        }
+        in->any_code_pin = key->pin;
+        in->pin_mask = 1U << key->pin;
+    }
+
+    // Start from the keys' current state (released if the device won't say)
+    unsigned char keys[KEY_MAX / 8 + 1];
+    memset(keys, 0, sizeof(keys));
+    ioctl(in->fd, EVIOCGKEY(sizeof(keys)), keys);
+    in->levels = pins->invert_mask & in->pin_mask;
+    for (int i = 0; i < in->count; i++) {
+        int pressed = (keys[in->codes[i] / 8] >> (in->codes[i] % 8)) & 1;
+        in->levels = level_word(in->levels, in->pins[i], pressed, pins->invert_mask);
+    }
+    in->invert_mask = pins->invert_mask;
+
+    in->epfd = epoll_create1(EPOLL_CLOEXEC);
+    in->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev = {.events = EPOLLIN, .data.fd = in->fd};
+    struct epoll_event wake = {.events = EPOLLIN, .data.fd = in->wake_fd};
+    if (in->epfd < 0 || in->wake_fd < 0 || epoll_ctl(in->epfd, EPOLL_CTL_ADD, in->fd, &ev) != 0 ||
+        epoll_ctl(in->epfd, EPOLL_CTL_ADD, in->wake_fd, &wake) != 0) {
+        perror("Failed to set up epoll for the input device");
+        evdev_close(in);
+        return -1;
+    }
+
+    if (edge_ring_init(&in->ring, EDGE_RING_DEFAULT) != 0) {
+        evdev_close(in);
+        return -1;
+    }
+    GpioRun first = {(uint64_t)clock_ns(CLOCK_MONOTONIC), in->levels, 0};
+    edge_ring_push(&in->ring, &first);
+    return 0;
+}
+
+// Function to wait up to timeout_ms (-1 = forever) for key events and move
+// them into the ring. Returns the records added, or -1 when the device is
+// gone or evdev_stop woke the wait.
+int evdev_poll(EvdevInput *in, int timeout_ms) {
+    struct epoll_event ready[2];
+    int n = epoll_wait(in->epfd, ready, 2, timeout_ms);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int added = 0;
+    for (int i = 0; i < n; i++) {
+        if (ready[i].data.fd == in->wake_fd) {
+            return -1;
+        }
+        if (ready[i].events & (EPOLLHUP | EPOLLERR)) {
+            fprintf(stderr, "Input device disconnected\n");
+            return -1;
+        }
+
+        struct input_event events[EVDEV_BATCH];
+        ssize_t len;
+        while ((len = read(in->fd, events, sizeof(events))) > 0) {
+            for (size_t e = 0; e < (size_t)len / sizeof(struct input_event); e++) {
+                const struct input_event *event = &events[e];
+                if (event->type != EV_KEY || event->value == 2) {
+                    continue;  // Not a key, or autorepeat
+                }
+                int pin = code_pin(in, event->code);
+                if (pin < 0) {
+                    continue;
+                }
+                uint32_t levels = level_word(in->levels, pin, event->value != 0, in->invert_mask);
+                if (levels == in->levels) {
+                    continue;
+                }
+                in->levels = levels;
+
+                int64_t t_ns = (int64_t)event->input_event_sec * 1000000000LL + (int64_t)event->input_event_usec * 1000;
+                if (!in->clock_monotonic) {
+                    t_ns += in->realtime_offset_ns;
+                }
+                GpioRun run = {(uint64_t)t_ns, levels, 0};
+                edge_ring_push(&in->ring, &run);
+                atomic_fetch_add_explicit(&in->events, 1, memory_order_relaxed);
+                added++;
+            }
+        }
+        if (len < 0 && errno == ENODEV) {
+            fprintf(stderr, "Input device disconnected\n");
+            return -1;
+        }
+    }
+    return added;
+}
+
+static void *evdev_thread(void *arg) {
+    EvdevInput *in = (EvdevInput *)arg;
+    while (atomic_load(&in->running)) {
+        if (evdev_poll(in, -1) < 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Function to move events into the ring on a thread of their own
+int evdev_start(EvdevInput *in) {
+    atomic_store(&in->running, 1);
+    if (pthread_create(&in->tid, NULL, evdev_thread, in) != 0) {
+        perror("Failed to start input device thread");
+        atomic_store(&in->running, 0);
+        return -1;
+    }
+    return 0;
+}
+
+void evdev_stop(EvdevInput *in) {
+    if (!atomic_load(&in->running)) {
+        return;
+    }
+    atomic_store(&in->running, 0);
+    uint64_t one = 1;
+    if (write(in->wake_fd, &one, sizeof(one)) != sizeof(one)) {
+        perror("Failed to wake the input device thread");
+    }
+    pthread_join(in->tid, NULL);
+}
+
+void evdev_close(EvdevInput *in) {
+    evdev_stop(in);
+    if (in->fd >= 0) {
+        close(in->fd);
+    }
+    if (in->epfd >= 0) {
+        close(in->epfd);
+    }
+    if (in->wake_fd >= 0) {
+        close(in->wake_fd);
+    }
+    edge_ring_free(&in->ring);
+    in->fd = in->epfd = in->wake_fd = -1;
+}
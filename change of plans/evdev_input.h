@@ -0,0 +1,50 @@
+#ifndef EVDEV_INPUT_H
+#define EVDEV_INPUT_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "edge_sampler.h"
+#include "pin_config.h"
+
+// Key input from a Linux input device (/dev/input/eventN): a USB foot
+// switch, a keyboard or a keying interface. Each mapped key code stands in
+// for a bank-0 pin, so every press or release becomes a GpioRun record
+// holding the level word that pin would have shown, and the debounce
+// filter, edge classifier and multi-key decoder take it unchanged. Times
+// are the kernel's event timestamps on CLOCK_MONOTONIC (taken in the
+// interrupt, not when this thread woke). A thread waits in epoll, so an
+// edge reaches the ring in well under a millisecond with no polling.
+//
+// The map comes from the pin map's evdev lines ("evdev 57 17": KEY_SPACE
+// acts as GPIO 17, polarity from that pin's channel). Without any, every
+// key drives the first key channel.
+
+#define EVDEV_BATCH 64  // Events per read()
+
+typedef struct {
+    int fd;
+    int epfd;
+    int wake_fd;                   // eventfd that ends the thread's epoll_wait
+    int clock_monotonic;           // EVIOCSCLOCKID worked; else realtime stamps are shifted
+    int64_t realtime_offset_ns;    // CLOCK_MONOTONIC - CLOCK_REALTIME at open
+    uint16_t codes[PIN_EVDEV_MAX];
+    uint8_t pins[PIN_EVDEV_MAX];
+    int count;
+    int any_code_pin;              // Pin for every key when nothing is mapped, else -1
+    uint32_t levels;               // Current level word
+    uint32_t pin_mask;             // Pins the map can change
+    uint32_t invert_mask;          // Active-low pins, from the pin map
+    EdgeRing ring;
+    atomic_int running;
+    pthread_t tid;
+    _Atomic uint64_t events;       // Key events mapped into the ring
+} EvdevInput;
+
+int evdev_open(EvdevInput *in, const char *path, const PinConfig *pins, int grab);
+int evdev_poll(EvdevInput *in, int timeout_ms);
+int evdev_start(EvdevInput *in);
+void evdev_stop(EvdevInput *in);
+void evdev_close(EvdevInput *in);
+
+#endif
@@ -1,47 +1,44 @@
 #include <stdio.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <sys/mman.h>
 #include <stdint.h>
+#include "pin_config.h"
 
-#define GPIO_BASE 0x3F200000  // Base address for GPIO (Raspberry Pi 3/4)
-#define BLOCK_SIZE (4 * 1024)
-#define GPIO_PIN 24  // GPIO pin to monitor
+// gcc -o gpio24_status gpio24_status.c pin_config.c debounce.c morse_timing.c
 
 int main() {
-    int mem_fd;
     volatile unsigned int *gpio;
+    PinConfig pins;
 
-    // Open /dev/gpiomem for GPIO access
-    mem_fd = open("/dev/gpiomem", O_RDWR | O_SYNC);
-    if (mem_fd < 0) {
-        perror("Failed to open /dev/gpiomem");
+    // The power button from the pin map (GPIO 24 by default)
+    if (pin_config_init(&pins) != 0) {
+        return -1;
+    }
+    const PinChannel *button = pin_config_find(&pins, PIN_KIND_POWER, 0);
+    if (button == NULL) {
+        fprintf(stderr, "The pin map has no power channel\n");
         return -1;
     }
 
     // Map GPIO memory
-    gpio = mmap(NULL, BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, GPIO_BASE);
-    if (gpio == MAP_FAILED) {
-        perror("Failed to map GPIO memory");
-        close(mem_fd);
+    gpio = pin_config_map(&pins);
+    if (gpio == NULL) {
         return -1;
     }
 
-    // Set GPIO 24 as input
-    *(gpio + (GPIO_PIN / 10)) &= ~(7 << ((GPIO_PIN % 10) * 3));  // Clear FSEL bits for GPIO 24
+    // Set the mapped pins as inputs
+    pin_config_setup(&pins, gpio);
 
-    printf("Monitoring GPIO 24 status. Press the button to see changes.\n");
+    printf("Monitoring GPIO %d status. Press the button to see changes.\n", button->pin);
 
-    // Monitor GPIO 24 status
+    // Monitor the button status
     while (1) {
         unsigned int level = *(gpio + 13);  // GPLEV0 register (offset 0x34 / 4 bytes)
-        int status = (level & (1 << GPIO_PIN)) != 0;  // Check if GPIO 24 is high
-        printf("GPIO 24 status: %s\n", status ? "PRESSED" : "NOT PRESSED");
+        int status = (level >> button->pin) & 1;  // Check if the pin is high
+        printf("GPIO %d status: %s\n", button->pin, status ? "PRESSED" : "NOT PRESSED");
         usleep(100000);  // Polling delay
     }
 
     // Cleanup
-    munmap((void *)gpio, BLOCK_SIZE);
-    close(mem_fd);
+    pin_config_unmap(gpio);
     return 0;
 }
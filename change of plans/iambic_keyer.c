@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <string.h>
+#include "iambic_keyer.h"
+
+void iambic_config_default(IambicConfig *config) {
+    config->wpm = IAMBIC_DEFAULT_WPM;
+    config->mode = IAMBIC_MODE_B;
+    config->weight = IAMBIC_DEFAULT_WEIGHT;
+    config->ratio = IAMBIC_DEFAULT_RATIO;
+}
+
+// Function to set up a keyer; returns -1 for settings out of range
+int iambic_init(IambicKeyer *k, const IambicConfig *config, IambicSignalCallback callback, void *ctx) {
+    if (config->wpm < IAMBIC_MIN_WPM || config->wpm > IAMBIC_MAX_WPM || config->weight < 25 ||
+        config->weight > 75 || config->ratio < 20 || config->ratio > 45) {
+        fprintf(stderr, "Keyer settings out of range (%d-%d WPM, weight 25-75, ratio 20-45)\n",
+                IAMBIC_MIN_WPM, IAMBIC_MAX_WPM);
+        return -1;
+    }
+    memset(k, 0, sizeof(*k));
+    k->config = *config;
+
+    // PARIS timing: a dot is 1.2 s / WPM
+    uint64_t unit_us = 1200000 / (uint64_t)config->wpm;
+    int64_t weighting = (int64_t)unit_us * (config->weight - 50) / 50;
+    k->dot_us = (uint64_t)((int64_t)unit_us + weighting);
+    k->dash_us = (uint64_t)((int64_t)(unit_us * (uint64_t)config->ratio / 10) + weighting);
+    k->space_us = (uint64_t)((int64_t)unit_us - weighting);
+    k->gap_us = IAMBIC_GAP_UNITS * unit_us;
+    k->callback = callback;
+    k->ctx = ctx;
+    return 0;
+}
+
+static void start_element(IambicKeyer *k, int element, uint64_t t_us) {
+    k->element = element;
+    k->state = IAMBIC_MARK;
+    k->until_us = t_us + (element == MORSE_SIGNAL_DOT ? k->dot_us : k->dash_us);
+    k->keyed = 1;
+    k->squeezed = 0;
+    if (element == MORSE_SIGNAL_DOT) {
+        k->dot_memory = 0;
+    } else {
+        k->dash_memory = 0;
+    }
+    k->gap_due = 1;
+    k->elements++;
+    k->callback(element, t_us, k->ctx);
+}
+
+// Function to pick the element after a space: the opposite one if it was
+// remembered or is held, else the same one while its paddle is held
+static int next_element(IambicKeyer *k, int dot, int dash) {
+    int dot_wanted = k->dot_memory || dot;
+    int dash_wanted = k->dash_memory || dash;
+
+    if (k->config.mode == IAMBIC_MODE_A && k->squeezed && !dot && !dash) {
+        k->dot_memory = 0;  // Squeeze released: Mode A stops here
+        k->dash_memory = 0;
+        return 0;
+    }
+    if (k->element == MORSE_SIGNAL_DOT) {
+        return dash_wanted ? MORSE_SIGNAL_DASH : dot ? MORSE_SIGNAL_DOT : 0;
+    }
+    return dot_wanted ? MORSE_SIGNAL_DOT : dash ? MORSE_SIGNAL_DASH : 0;
+}
+
+// Function to advance the keyer to now_us with the paddles as given (1 = down)
+void iambic_update(IambicKeyer *k, uint64_t now_us, int dot, int dash) {
+    while (1) {
+        if (k->state == IAMBIC_IDLE) {
+            if (k->gap_due && now_us >= k->mark_end_us + k->gap_us) {
+                k->gap_due = 0;
+                k->callback(MORSE_SIGNAL_GAP, k->mark_end_us + k->gap_us, k->ctx);
+            }
+            if (dot || dash) {
+                start_element(k, dot ? MORSE_SIGNAL_DOT : MORSE_SIGNAL_DASH, now_us);
+                continue;
+            }
+            return;
+        }
+
+        // The opposite paddle during a mark or its space is remembered
+        if (k->element == MORSE_SIGNAL_DOT && dash) {
+            k->dash_memory = 1;
+            k->squeezed |= dot;
+        } else if (k->element == MORSE_SIGNAL_DASH && dot) {
+            k->dot_memory = 1;
+            k->squeezed |= dash;
+        }
+        if (now_us < k->until_us) {
+            return;
+        }
+
+        if (k->state == IAMBIC_MARK) {
+            k->state = IAMBIC_SPACE;
+            k->keyed = 0;
+            k->mark_end_us = k->until_us;
+            k->until_us += k->space_us;
+            continue;
+        }
+        int element = next_element(k, dot, dash);
+        if (element) {
+            start_element(k, element, k->until_us);  // Back to back, on the exact grid
+        } else {
+            k->state = IAMBIC_IDLE;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef IAMBIC_KEYER_H
+#define IAMBIC_KEYER_H
+
+#include <stdint.h>
+#include "morse_decoder.h"
+
+// Iambic keyer for a dual-lever paddle. The keyer times every element
+// itself at the configured speed, so its output goes to the decoder as
+// finished dots, dashes and gaps with nothing left to classify. Call
+// iambic_update on every tick of a periodic sampler with the two paddle
+// levels; element and space ends are chained from their exact deadlines,
+// so a late tick delays an element but never stretches the code.
+//
+//   memories - tapping the opposite paddle during an element (or the
+//              space after it) queues that element next
+//   squeeze  - holding both paddles alternates dots and dashes
+//   Mode A   - releasing a squeeze ends after the current element
+//   Mode B   - releasing a squeeze sends one more opposite element
+//   weight   - 50 = standard; above lengthens every element (and shortens
+//              the space after it) by (weight - 50)/50 of a dot, so at 60
+//              a dot is keyed for 1.2 dots and followed by 0.8
+//   ratio    - dash length in dots, in tenths (30 = 3:1)
+//
+// After an element, silence of IAMBIC_GAP_UNITS dots ends the character.
+
+#define IAMBIC_MODE_A 0
+#define IAMBIC_MODE_B 1
+
+#define IAMBIC_DEFAULT_WPM 25
+#define IAMBIC_MIN_WPM 5
+#define IAMBIC_MAX_WPM 80
+#define IAMBIC_DEFAULT_WEIGHT 50
+#define IAMBIC_DEFAULT_RATIO 30
+#define IAMBIC_GAP_UNITS 2      // Halfway between an element space (1) and a letter space (3)
+#define IAMBIC_TICK_US 250      // Update period: 1% of a dot at 48 WPM
+
+#define IAMBIC_IDLE 0
+#define IAMBIC_MARK 1           // Element keyed
+#define IAMBIC_SPACE 2          // Space after an element
+
+typedef void (*IambicSignalCallback)(int signal, uint64_t t_us, void *ctx);
+
+typedef struct {
+    int wpm;
+    int mode;
+    int weight;                 // 25-75
+    int ratio;                  // Tenths, 20-45
+} IambicConfig;
+
+typedef struct {
+    IambicConfig config;
+    uint64_t dot_us;            // Element on-times after weighting
+    uint64_t dash_us;
+    uint64_t space_us;          // Space after an element
+    uint64_t gap_us;            // Silence after an element that ends the character
+    int state;
+    int element;                // MORSE_SIGNAL_DOT or _DASH being (or last) sent
+    uint64_t until_us;          // End of the current mark or space
+    uint64_t mark_end_us;
+    int dot_memory;
+    int dash_memory;
+    int squeezed;               // Both paddles seen down during this element
+    int gap_due;                // Elements sent since the last gap
+    int keyed;                  // Keyer output, for a sidetone or transmitter line
+    uint64_t elements;
+    IambicSignalCallback callback;
+    void *ctx;
+} IambicKeyer;
+
+void iambic_config_default(IambicConfig *config);
+int iambic_init(IambicKeyer *k, const IambicConfig *config, IambicSignalCallback callback, void *ctx);
+void iambic_update(IambicKeyer *k, uint64_t now_us, int dot, int dash);
+
+#endif
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "iambic_keyer.h"
+
+// Checks the keyer's element timing: drives iambic_update on its own tick
+// with scripted paddles and measures how long the output stays keyed.
+// Exits non-zero on the first failed check.
+//
+// gcc -o iambic_keyer_test iambic_keyer_test.c iambic_keyer.c
+
+static int failures = 0;
+
+static void ignore_signal(int signal, uint64_t t_us, void *ctx) {
+    (void)signal;
+    (void)t_us;
+    (void)ctx;
+}
+
+// Function to run a keyer with one paddle held for hold_us and record the
+// times the output went up and down, returns the number of edges seen
+static int run_keyer(const IambicConfig *config, int dash, uint64_t hold_us, uint64_t *edges, int max_edges) {
+    IambicKeyer k;
+    int count = 0;
+    int keyed = 0;
+
+    if (iambic_init(&k, config, ignore_signal, NULL) != 0) {
+        return -1;
+    }
+    for (uint64_t t = 0; t < 1000000; t += IAMBIC_TICK_US) {
+        int down = t < hold_us;
+        iambic_update(&k, t, down && !dash, down && dash);
+        if (k.keyed != keyed && count < max_edges) {
+            edges[count++] = t;
+            keyed = k.keyed;
+        }
+    }
+    return count;
+}
+
+static void expect(const char *what, uint64_t got_us, uint64_t want_us) {
+    if (got_us != want_us) {
+        fprintf(stderr, "FAIL: %s %llu us, expected %llu us\n", what, (unsigned long long)got_us,
+                (unsigned long long)want_us);
+        failures++;
+    } else {
+        printf("ok: %s %llu us\n", what, (unsigned long long)got_us);
+    }
+}
+
+int main(void) {
+    IambicConfig config;
+    uint64_t edges[8];
+
+    // 20 WPM: a dot is 60 ms. Weight 60 adds a fifth of a dot to every mark
+    // and takes it from the space after it.
+    iambic_config_default(&config);
+    config.wpm = 20;
+    config.weight = 60;
+
+    // Dot paddle held into the second dot: up, down, up again
+    if (run_keyer(&config, 0, 130000, edges, 8) < 3) {
+        fprintf(stderr, "FAIL: dots not keyed\n");
+        return 1;
+    }
+    expect("weight 60 dot", edges[1] - edges[0], 72000);
+    expect("weight 60 space", edges[2] - edges[1], 48000);
+
+    if (run_keyer(&config, 1, 1000, edges, 8) < 2) {
+        fprintf(stderr, "FAIL: dash not keyed\n");
+        return 1;
+    }
+    expect("weight 60 dash", edges[1] - edges[0], 192000);
+
+    config.weight = 50;
+    if (run_keyer(&config, 0, 1000, edges, 8) < 2) {
+        fprintf(stderr, "FAIL: dot not keyed\n");
+        return 1;
+    }
+    expect("weight 50 dot", edges[1] - edges[0], 60000);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+#include "key_trace.h"
+
+// Keys text in Morse on a virtual input device, so the evdev backend can be
+// tried without a foot switch. It creates a uinput keyboard with one key
+// (-code, KEY_SPACE by default), prints its event node, waits -wait seconds
+// for a reader to open it, then presses and releases the key on the edges
+// of a synthetic trace (see key_trace.h), ending with the ten-dot end of
+// line. -jitter and -bounce roughen the keying as they do for key_recorder.
+//
+//   key_inject -text "CQ DE W1AW" &
+//   morse_multi -evdev /dev/input/eventN
+//
+// Usage: key_inject -text TEXT [-code N] [-wpm N] [-wait s] [-jitter F] [-bounce F] [-seed N]
+//
+// Needs write access to /dev/uinput.
+//
+// gcc -o key_inject key_inject.c key_trace.c morse_decoder.c morse_timing.c
+
+#define UINPUT_PATH "/dev/uinput"
+#define DEFAULT_CODE KEY_SPACE
+#define DEFAULT_WAIT_S 1
+#define TEXT_SIZE 256
+
+static int emit(int fd, int type, int code, int value) {
+    struct input_event event;
+    memset(&event, 0, sizeof(event));
+    event.type = (unsigned short)type;
+    event.code = (unsigned short)code;
+    event.value = value;
+    return write(fd, &event, sizeof(event)) == sizeof(event) ? 0 : -1;
+}
+
+// Function to find the eventN node of a uinput device from its sysfs name
+static int find_event_node(const char *sysname, char *node, size_t len) {
+    char dir_path[128];
+    snprintf(dir_path, sizeof(dir_path), "/sys/devices/virtual/input/%s", sysname);
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL) {
+        return -1;
+    }
+    int rc = -1;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "event", 5) == 0) {
+            snprintf(node, len, "/dev/input/%s", entry->d_name);
+            rc = 0;
+            break;
+        }
+    }
+    closedir(dir);
+    return rc;
+}
+
+// Function to create a virtual keyboard with a single key
+static int open_device(int code) {
+    int fd = open(UINPUT_PATH, O_WRONLY | O_NONBLOCK);
+    if (fd < 0) {
+        perror("Failed to open " UINPUT_PATH);
+        return -1;
+    }
+
+    struct uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0x1209;
+    setup.id.product = 0x4d43;
+    snprintf(setup.name, sizeof(setup.name), "Morse key injector");
+    if (ioctl(fd, UI_SET_EVBIT, EV_KEY) != 0 || ioctl(fd, UI_SET_KEYBIT, code) != 0 ||
+        ioctl(fd, UI_DEV_SETUP, &setup) != 0 || ioctl(fd, UI_DEV_CREATE) != 0) {
+        perror("Failed to create uinput device");
+        close(fd);
+        return -1;
+    }
+
+    char sysname[64];
+    char node[300];
+    if (ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) >= 0 && find_event_node(sysname, node, sizeof(node)) == 0) {
+        printf("Created %s, key code %d\n", node, code);
+    } else {
+        printf("Created a uinput device, key code %d\n", code);
+    }
+    fflush(stdout);
+    return fd;
+}
+
+// Function to press and release the key on each edge of the trace, on an
+// absolute schedule so write time doesn't add up over the message
+static int play_trace(int fd, int code, const KeyTrace *trace) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < trace->count; i++) {
+        uint64_t t_ns = (uint64_t)start.tv_nsec + trace->edges[i].t_us * 1000ULL;
+        struct timespec at = {start.tv_sec + (time_t)(t_ns / 1000000000ULL), (long)(t_ns % 1000000000ULL)};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL);
+        if (emit(fd, EV_KEY, code, trace->edges[i].level) != 0 || emit(fd, EV_SYN, SYN_REPORT, 0) != 0) {
+            perror("Failed to write key event");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *text = NULL;
+    int code = DEFAULT_CODE;
+    int wait_s = DEFAULT_WAIT_S;
+    SynthParams params;
+
+    synth_params_default(&params);
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return -1;
+        }
+        if (strcmp(argv[i], "-text") == 0) {
+            text = argv[++i];
+        } else if (strcmp(argv[i], "-code") == 0) {
+            code = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-wpm") == 0) {
+            params.wpm = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-wait") == 0) {
+            wait_s = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-jitter") == 0) {
+            params.jitter = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-bounce") == 0) {
+            params.bounce = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-seed") == 0) {
+            params.seed = strtoull(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (text == NULL || code <= 0 || code > KEY_MAX || params.wpm <= 0) {
+        fprintf(stderr, "Usage: %s -text TEXT [-code N] [-wpm N] [-wait s] [-jitter F] [-bounce F] [-seed N]\n",
+                argv[0]);
+        return -1;
+    }
+
+    KeyTrace trace;
+    char keyed[TEXT_SIZE];
+    key_trace_init(&trace);
+    snprintf(keyed, sizeof(keyed), "%s\n", text);  // End of line releases the last character
+    if (key_trace_synthesize(&trace, keyed, &params) != 0) {
+        key_trace_free(&trace);
+        return -1;
+    }
+
+    int fd = open_device(code);
+    if (fd < 0) {
+        key_trace_free(&trace);
+        return -1;
+    }
+    sleep((unsigned int)wait_s);  // udev creates the node, the reader opens it
+
+    int status = play_trace(fd, code, &trace);
+    if (status == 0) {
+        fprintf(stderr, "Keyed %zu edges in %.1f s\n", trace.count, (double)trace.end_us / 1e6);
+    }
+    usleep(100000);  // Let the reader drain the last release before the device goes away
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+    key_trace_free(&trace);
+    return status;
+}
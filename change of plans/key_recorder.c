@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include "key_trace.h"
+#include "trace_corpus.h"
+#include "pin_config.h"
+
+// Adds one labelled trace to a corpus file. By default it records the key
+// channel of the pin map (GPIO 17 unless morse_pins.conf moves it) at 1 kHz while the operator keys the given text. Recording stops after
+// -idle seconds without a press, or on Ctrl+C. Key the ten-dot end of line
+// last, so the final character is complete. With -synth the trace is
+// generated from the text instead, which is useful for building baseline
+// corpora.
+//
+// Usage: key_recorder -o corpus.txt -id ID -operator NAME -text "CQ DE W1AW"
+//                     [-idle s] [-synth [-wpm N] [-gap ms] [-jitter F] [-bounce F] [-seed N]]
+//
+// gcc -o key_recorder key_recorder.c key_trace.c trace_corpus.c morse_decoder.c pin_config.c debounce.c
+//     morse_timing.c
+
+#define GPLEV0 0x34
+#define SAMPLE_US 1000       // 1 kHz, far finer than the 50 ms sampling loop
+#define DEFAULT_IDLE_S 5
+
+volatile sig_atomic_t stop = 0;
+
+static void handle_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+// Function to record key edges from the key pin until the operator goes idle
+static int record_trace(KeyTrace *trace, int idle_s) {
+    PinConfig pins;
+    if (pin_config_init(&pins) != 0) {
+        return -1;
+    }
+    const PinChannel *key = pin_config_find(&pins, PIN_KIND_KEY, 0);
+    if (key == NULL) {
+        fprintf(stderr, "The pin map has no key channel\n");
+        return -1;
+    }
+    volatile unsigned int *gpio = pin_config_map(&pins);
+    if (gpio == NULL) {
+        return -1;
+    }
+    pin_config_setup(&pins, gpio);
+
+    signal(SIGINT, handle_signal);
+    fprintf(stderr, "Recording GPIO %d, key the text then stay idle for %d s (or Ctrl+C)\n", key->pin, idle_s);
+
+    uint64_t start = now_us();
+    uint64_t last_change = 0;
+    int level = 0;
+    int pressed_once = 0;
+    struct timespec period = {0, SAMPLE_US * 1000L};
+
+    while (!stop) {
+        int sample = pin_active(gpio[GPLEV0 / 4], key);
+        uint64_t t = now_us() - start;
+        if (sample != level) {
+            level = sample;
+            last_change = t;
+            pressed_once = 1;
+            if (key_trace_add(trace, t, level) != 0) {
+                break;
+            }
+        }
+        if (pressed_once && !level && t - last_change > (uint64_t)idle_s * 1000000ULL) {
+            break;
+        }
+        nanosleep(&period, NULL);
+    }
+    trace->end_us = now_us() - start;
+    pin_config_unmap(gpio);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *corpus_path = NULL;
+    const char *id = NULL;
+    const char *operator_name = "unknown";
+    const char *text = NULL;
+    int idle_s = DEFAULT_IDLE_S;
+    int synth = 0;
+    SynthParams params;
+
+    synth_params_default(&params);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-synth") == 0) {
+            synth = 1;
+        } else if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return -1;
+        } else if (strcmp(argv[i], "-o") == 0) {
+            corpus_path = argv[++i];
+        } else if (strcmp(argv[i], "-id") == 0) {
+            id = argv[++i];
+        } else if (strcmp(argv[i], "-operator") == 0) {
+            operator_name = argv[++i];
+        } else if (strcmp(argv[i], "-text") == 0) {
+            text = argv[++i];
+        } else if (strcmp(argv[i], "-idle") == 0) {
+            idle_s = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-wpm") == 0) {
+            params.wpm = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-gap") == 0) {
+            params.char_gap_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-jitter") == 0) {
+            params.jitter = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-bounce") == 0) {
+            params.bounce = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-seed") == 0) {
+            params.seed = strtoull(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (corpus_path == NULL || id == NULL || text == NULL) {
+        fprintf(stderr, "Usage: %s -o corpus.txt -id ID -operator NAME -text TEXT [-idle s] [-synth ...]\n", argv[0]);
+        return -1;
+    }
+
+    TraceCorpus corpus;
+    corpus_init(&corpus);
+    LabelledTrace *entry = corpus_add(&corpus, id, operator_name, text);
+    if (entry == NULL) {
+        return -1;
+    }
+
+    int status;
+    if (synth) {
+        char keyed[CORPUS_TEXT_MAX + 2];
+        snprintf(keyed, sizeof(keyed), "%s\n", text);  // End of line releases the last character
+        status = key_trace_synthesize(&entry->trace, keyed, &params);
+    } else {
+        status = record_trace(&entry->trace, idle_s);
+    }
+    if (status != 0) {
+        corpus_free(&corpus);
+        return -1;
+    }
+
+    // Append, writing the header if the corpus is new
+    FILE *out = fopen(corpus_path, "a");
+    if (out == NULL) {
+        perror("Failed to open corpus");
+        corpus_free(&corpus);
+        return -1;
+    }
+    fseek(out, 0, SEEK_END);
+    if (ftell(out) == 0) {
+        fprintf(out, "%s\n", CORPUS_HEADER);
+    }
+    status = corpus_write_entry(out, entry);
+    if (fclose(out) != 0 || status != 0) {
+        perror("Failed to write corpus");
+        status = -1;
+    }
+    fprintf(stderr, "Added %s: %zu edges, %.1f s\n", id, entry->trace.count, (double)entry->trace.end_us / 1e6);
+    corpus_free(&corpus);
+    return status;
+}
@@ -0,0 +1,205 @@
+#include <stdlib.h>
+#include <ctype.h>
+#include "key_trace.h"
+#include "morse_decoder.h"
+
+// Defaults keyed for the stock thresholds: 250 ms dots, 750 ms dashes, 2.5 s between characters
+void synth_params_default(SynthParams *params) {
+    params->wpm = 4.8;
+    params->char_gap_ms = 2500;
+    params->jitter = 0.0;
+    params->bounce = 0.0;
+    params->bounce_max = 3;
+    params->bounce_us = 2000;
+    params->seed = 1;
+}
+
+void key_trace_init(KeyTrace *trace) {
+    trace->edges = NULL;
+    trace->count = 0;
+    trace->capacity = 0;
+    trace->end_us = 0;
+}
+
+void key_trace_free(KeyTrace *trace) {
+    free(trace->edges);
+    key_trace_init(trace);
+}
+
+// Function to append a level change; edges must arrive in time order
+int key_trace_add(KeyTrace *trace, uint64_t t_us, int level) {
+    if (trace->count == trace->capacity) {
+        size_t capacity = trace->capacity ? trace->capacity * 2 : 256;
+        KeyEdge *edges = realloc(trace->edges, capacity * sizeof(KeyEdge));
+        if (edges == NULL) {
+            return -1;
+        }
+        trace->edges = edges;
+        trace->capacity = capacity;
+    }
+    trace->edges[trace->count].t_us = t_us;
+    trace->edges[trace->count].level = (uint8_t)(level != 0);
+    trace->count++;
+    if (t_us > trace->end_us) {
+        trace->end_us = t_us;
+    }
+    return 0;
+}
+
+// xorshift64*: deterministic across platforms, unlike rand()
+static uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+// Uniform in [-1, 1)
+static double random_signed(uint64_t *state) {
+    return (double)(next_random(state) >> 11) / (double)(1ULL << 52) - 1.0;
+}
+
+static uint64_t jittered(double ms, const SynthParams *params, uint64_t *state) {
+    double scale = 1.0 + params->jitter * random_signed(state);
+    double us = ms * 1000.0 * (scale > 0.05 ? scale : 0.05);
+    return (uint64_t)us;
+}
+
+// Function to add an edge, sometimes preceded by contact bounce
+static int add_edge(KeyTrace *trace, uint64_t t_us, int level, const SynthParams *params, uint64_t *state) {
+    if (params->bounce > 0.0 && (double)(next_random(state) >> 11) / (double)(1ULL << 53) < params->bounce) {
+        int pulses = 1 + (int)(next_random(state) % (uint64_t)(params->bounce_max > 0 ? params->bounce_max : 1));
+        uint64_t step = (uint64_t)params->bounce_us / (2 * pulses + 1);
+        for (int i = 0; i < pulses; i++) {
+            if (key_trace_add(trace, t_us, level) != 0 ||
+                key_trace_add(trace, t_us + step, !level) != 0) {
+                return -1;
+            }
+            t_us += 2 * step;
+        }
+    }
+    return key_trace_add(trace, t_us, level);
+}
+
+// Function to key text as a trace. Letters are keyed with the PARIS ratios
+// (dash = 3 dots, 1 dot between elements), spaces add one more character
+// gap, '\n' keys the ten-dot end of line, and other characters are skipped.
+int key_trace_synthesize(KeyTrace *trace, const char *text, const SynthParams *params) {
+    uint64_t state = params->seed ? params->seed : 1;
+    double dot_ms = 1200.0 / params->wpm;
+    double char_gap_ms = params->char_gap_ms > 0 ? params->char_gap_ms : 3.0 * dot_ms;
+    uint64_t t = trace->end_us;
+    char endline[MORSE_ENDLINE_DOTS + 1];
+
+    for (int i = 0; i < MORSE_ENDLINE_DOTS; i++) {
+        endline[i] = '.';
+    }
+    endline[MORSE_ENDLINE_DOTS] = '\0';
+
+    for (; *text; text++) {
+        const char *code;
+        if (*text == '\n') {
+            code = endline;
+        } else if (*text == ' ') {
+            t += jittered(char_gap_ms, params, &state);
+            continue;
+        } else {
+            code = translate_english_to_morse((char)toupper((unsigned char)*text));
+            if (code == NULL) {
+                continue;
+            }
+        }
+
+        for (const char *e = code; *e; e++) {
+            if (add_edge(trace, t, 1, params, &state) != 0) {
+                return -1;
+            }
+            t = trace->end_us + jittered(*e == '-' ? 3.0 * dot_ms : dot_ms, params, &state);
+            if (add_edge(trace, t, 0, params, &state) != 0) {
+                return -1;
+            }
+            t = trace->end_us + jittered(e[1] ? dot_ms : char_gap_ms, params, &state);
+        }
+    }
+    trace->end_us = t;
+    return 0;
+}
+
+typedef struct {
+    const KeyTrace *trace;
+    size_t next;      // Next edge not yet applied
+    int level;
+} KeyCursor;
+
+// Function to return the key level at time t (t never goes backwards)
+static int sample_at(KeyCursor *cursor, uint64_t t) {
+    const KeyTrace *trace = cursor->trace;
+    while (cursor->next < trace->count && trace->edges[cursor->next].t_us <= t) {
+        cursor->level = trace->edges[cursor->next].level;
+        cursor->next++;
+    }
+    return cursor->level;
+}
+
+// Function to replay a trace through a C model of morse_code_main. Register
+// names follow the assembly: R5 press ticks, R6 idle ticks, R7 gap pending,
+// R8 dash pending. Like the assembly, a character's gap is only sent when
+// the next press starts. Returns the number of signals sent (not counting
+// REPLAY_GAP_DECIDED).
+size_t key_trace_replay(const KeyTrace *trace, const MorseTiming *timing, ReplayCallback callback, void *ctx) {
+    KeyCursor cursor = {trace, 0, 0};
+    uint64_t tick_us = (uint64_t)timing->tick_ms * 1000;
+    uint64_t t = 0;
+    size_t signals = 0;
+    int idle_ticks = 0;    // R6
+    int gap_pending = 0;   // R7
+
+    while (t <= trace->end_us || cursor.next < trace->count) {
+        if (!sample_at(&cursor, t)) {
+            // check_gap
+            if (idle_ticks < timing->gap_ticks) {
+                idle_ticks++;
+                t += tick_us;
+            } else {
+                if (!gap_pending) {
+                    callback(REPLAY_GAP_DECIDED, t, ctx);
+                }
+                gap_pending = 1;
+                idle_ticks = 0;
+            }
+            continue;
+        }
+
+        // button_pressed
+        if (gap_pending) {
+            callback(MORSE_SIGNAL_GAP, t, ctx);
+            signals++;
+            gap_pending = 0;
+        }
+        idle_ticks = 0;
+        int press_ticks = 0;   // R5
+        int dash_pending = 0;  // R8
+
+        // track_press
+        while (sample_at(&cursor, t)) {
+            if (press_ticks < timing->dash_ticks) {
+                press_ticks++;
+                t += tick_us;
+            } else {
+                // Dash decided: the assembly keeps sleeping a tick per check
+                dash_pending = 1;
+                if (cursor.next >= trace->count && t > trace->end_us) {
+                    return signals;  // Key never released
+                }
+                t += tick_us;
+            }
+        }
+
+        // button_released
+        callback(dash_pending ? MORSE_SIGNAL_DASH : MORSE_SIGNAL_DOT, t, ctx);
+        signals++;
+    }
+    return signals;
+}
@@ -0,0 +1,52 @@
+#ifndef KEY_TRACE_H
+#define KEY_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "morse_timing.h"
+
+// Recorded or synthetic key traces, and an off-device replay of the
+// sampling loop in morse_code_logic_active_state.s. A trace is the list of
+// key level changes; the replay samples it on the same tick grid as the
+// assembly and emits the same dot/dash/gap signals, so decoder changes can
+// be measured without a Pi or a key.
+
+typedef struct {
+    uint64_t t_us;    // Time of the level change since the start of the trace
+    uint8_t level;    // Key level after the change (1 = pressed)
+} KeyEdge;
+
+typedef struct {
+    KeyEdge *edges;
+    size_t count;
+    size_t capacity;
+    uint64_t end_us;  // Trace length; the key is idle after the last edge
+} KeyTrace;
+
+typedef struct {
+    double wpm;            // Sets the dot length, 1200 / wpm ms (PARIS timing)
+    int char_gap_ms;       // Idle time between characters, 0 = 3 dots
+    double jitter;         // Each duration is scaled by 1 +/- up to this fraction
+    double bounce;         // Probability that an edge bounces
+    int bounce_max;        // Extra level changes per bounce, 1..bounce_max
+    int bounce_us;         // Spread of the bounce pulses after the edge
+    uint64_t seed;         // Same seed and text give the same trace
+} SynthParams;
+
+// Replay-only signal, never sent by the assembly: the key has been idle for
+// gap_ticks, so the character is decided (the assembly sends the gap itself
+// when the next press starts)
+#define REPLAY_GAP_DECIDED 0
+
+// Called once per signal; t_us is the simulated time the assembly would send it
+typedef void (*ReplayCallback)(int signal, uint64_t t_us, void *ctx);
+
+void synth_params_default(SynthParams *params);
+
+void key_trace_init(KeyTrace *trace);
+void key_trace_free(KeyTrace *trace);
+int key_trace_add(KeyTrace *trace, uint64_t t_us, int level);
+int key_trace_synthesize(KeyTrace *trace, const char *text, const SynthParams *params);
+size_t key_trace_replay(const KeyTrace *trace, const MorseTiming *timing, ReplayCallback callback, void *ctx);
+
+#endif
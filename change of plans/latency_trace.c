@@ -0,0 +1,131 @@
+#include "latency_trace.h"
+
+#ifdef MORSE_TRACE
+
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define HIST_END_TO_END TRACE_STAGES  // Extra histogram after the per-stage ones
+#define HIST_COUNT (TRACE_STAGES + 1)
+
+static const char *stage_names[HIST_COUNT] = {
+    "edge",                     // Unused: no stage before the edge
+    "edge->classified",
+    "classified->gap",
+    "gap->translated",
+    "translated->queued",
+    "queued->displayed",
+    "end to end",
+};
+
+static _Atomic uint32_t histograms[HIST_COUNT][TRACE_BUCKETS];
+
+// Function to map a value to its log-linear bucket (exact below 16)
+static int bucket_index(uint64_t v) {
+    if (v < 16) {
+        return (int)v;
+    }
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - 4;
+    return (shift + 1) * 16 + (int)((v >> shift) & 15);
+}
+
+// Function to return the midpoint of a bucket's value range
+static uint64_t bucket_value(int index) {
+    if (index < 16) {
+        return (uint64_t)index;
+    }
+    int shift = index / 16 - 1;
+    uint64_t low = (uint64_t)(16 + index % 16) << shift;
+    return low + ((1ULL << shift) >> 1);
+}
+
+// Function to add one finished character to the histograms (~100 ns)
+void trace_record(const TraceStamps *stamps) {
+    uint64_t first = 0;
+    uint64_t prev = 0;
+
+    for (int stage = 0; stage < TRACE_STAGES; stage++) {
+        uint64_t t = stamps->t[stage];
+        if (t == 0) {
+            continue;  // Stage not traced in this build (e.g. no LCD in the interpreter)
+        }
+        if (prev != 0 && t >= prev) {
+            atomic_fetch_add_explicit(&histograms[stage][bucket_index(t - prev)], 1, memory_order_relaxed);
+        }
+        if (first == 0) {
+            first = t;
+        }
+        prev = t;
+    }
+    if (first != 0 && prev > first) {
+        atomic_fetch_add_explicit(&histograms[HIST_END_TO_END][bucket_index(prev - first)], 1, memory_order_relaxed);
+    }
+}
+
+// Function to print count and percentiles (in ms) for every stage
+void trace_dump(FILE *out) {
+    static const double quantiles[] = {0.50, 0.90, 0.99, 0.999, 1.0};
+
+    fprintf(out, "%-20s %8s %10s %10s %10s %10s %10s\n", "stage (ms)", "count", "p50", "p90", "p99", "p999", "max");
+    for (int h = 1; h < HIST_COUNT; h++) {
+        uint32_t counts[TRACE_BUCKETS];
+        uint64_t total = 0;
+        for (int i = 0; i < TRACE_BUCKETS; i++) {
+            counts[i] = atomic_load_explicit(&histograms[h][i], memory_order_relaxed);
+            total += counts[i];
+        }
+
+        fprintf(out, "%-20s %8llu", stage_names[h], (unsigned long long)total);
+        for (int q = 0; q < 5; q++) {
+            if (total == 0) {
+                fprintf(out, " %10s", "-");
+                continue;
+            }
+            uint64_t target = (uint64_t)(quantiles[q] * (double)total + 0.5);
+            if (target == 0) {
+                target = 1;
+            }
+            uint64_t seen = 0;
+            int i = 0;
+            for (; i < TRACE_BUCKETS - 1; i++) {
+                seen += counts[i];
+                if (seen >= target) {
+                    break;
+                }
+            }
+            fprintf(out, " %10.3f", (double)bucket_value(i) / 1e6);
+        }
+        fprintf(out, "\n");
+    }
+    fflush(out);
+}
+
+static void *dump_thread(void *arg) {
+    sigset_t *set = (sigset_t *)arg;
+    int sig;
+    while (sigwait(set, &sig) == 0) {
+        trace_dump(stderr);
+    }
+    return NULL;
+}
+
+// Function to dump the histograms on SIGUSR2. Call before creating other
+// threads so they all inherit SIGUSR2 blocked and only the dump thread sees it.
+int trace_init(void) {
+    static sigset_t set;
+    pthread_t tid;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    if (pthread_create(&tid, NULL, dump_thread, &set) != 0) {
+        perror("Failed to start trace dump thread");
+        return -1;
+    }
+    pthread_detach(tid);
+    return 0;
+}
+
+#endif
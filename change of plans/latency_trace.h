@@ -0,0 +1,63 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Per-character latency tracing from key edge to LCD. Each character
+// carries a TraceStamps through the pipeline; when it reaches the end the
+// time spent between consecutive stages (and end to end) goes into a
+// log-linear (HDR-style) histogram. Histograms are printed to stderr on
+// SIGUSR2 or with trace_dump().
+//
+// Build with -DMORSE_TRACE to enable; otherwise every macro compiles away.
+
+#define TRACE_EDGE 0         // Key release that ended the last element
+#define TRACE_CLASSIFIED 1   // Element classified as dot or dash
+#define TRACE_GAP 2          // Character gap reported by the sampling loop
+#define TRACE_TRANSLATED 3   // Morse looked up as a character
+#define TRACE_QUEUED 4       // Handed to the display (queue or transcript)
+#define TRACE_DISPLAYED 5    // I2C transfer to the LCD complete
+#define TRACE_STAGES 6
+
+#define TRACE_BUCKETS 1024   // 16 sub-buckets per power of two, ~6% resolution
+
+#ifdef MORSE_TRACE
+
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    uint64_t t[TRACE_STAGES];  // CLOCK_MONOTONIC ns, 0 = stage not reached
+} TraceStamps;
+
+static inline uint64_t trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#define TRACE_STAMP(stamps, stage) ((stamps)->t[(stage)] = trace_now())
+#define TRACE_CLEAR(stamps) memset((stamps), 0, sizeof(TraceStamps))
+
+int trace_init(void);
+void trace_record(const TraceStamps *stamps);
+void trace_dump(FILE *out);
+
+#else
+
+typedef struct {
+    char unused;
+} TraceStamps;
+
+#define TRACE_STAMP(stamps, stage) ((void)(stamps))
+#define TRACE_CLEAR(stamps) ((void)(stamps))
+static inline int trace_init(void) {
+    return 0;
+}
+#define trace_record(stamps) ((void)(stamps))
+#define trace_dump(out) ((void)(out))
+
+#endif
+
+#endif
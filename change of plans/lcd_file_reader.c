@@ -3,108 +3,117 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
-#include <stdint.h>  // For uint8_t
-#include <linux/i2c-dev.h>
-#include <sys/ioctl.h>
-
-#define I2C_ADDR 0x27  // I2C address for the LCD
-#define BACKLIGHT 0x08 // Control bit for backlight
-
-// Function declarations
-void lcd_send_command(int fd, uint8_t command);
-void lcd_send_char(int fd, char c);
-void lcd_send_text(int fd, const char *text);
-void lcd_init(int fd);
-
-// Function to send a command to the LCD
-void lcd_send_command(int fd, uint8_t command) {
-    uint8_t data[4];
-    data[0] = (command & 0xF0) | BACKLIGHT | 0x04; // Upper nibble with EN=1
-    data[1] = (command & 0xF0) | BACKLIGHT;       // Upper nibble with EN=0
-    data[2] = ((command << 4) & 0xF0) | BACKLIGHT | 0x04; // Lower nibble with EN=1
-    data[3] = ((command << 4) & 0xF0) | BACKLIGHT;       // Lower nibble with EN=0
-    if (write(fd, data, 4) != 4) {
-        perror("Failed to send command to LCD");
+#include <sys/stat.h>
+#include "transcript_log.h"
+#include "process_supervisor.h"
+#include "lcd_i2c.h"
+#include "morse_metrics.h"
+#include "perf_counters.h"
+#include "morse_log.h"
+
+// State for following the active transcript across rotations
+int follow_fd = -1;          // Descriptor of the segment being followed
+ino_t follow_inode = 0;      // Inode of that segment, changes when the writer rotates
+char pending[512];           // Partial line waiting for its newline
+size_t pending_len = 0;
+int lcd_ready = 0;           // The LCD is initialized on the first line, not at start-up
+
+// Function to show one transcript line on the LCD
+void display_line(int lcd_fd, const char *line) {
+    const char *text = transcript_strip_timestamp(line, NULL);  // Drop the "<unix seconds> " prefix
+    if (!lcd_ready) {
+        // Until now the controller's animation and splash own the display
+        lcd_init(lcd_fd, LCD_BACKLIGHT);
+        lcd_ready = 1;
     }
-    usleep(2000); // Delay to allow command processing
+    lcd_send_command(lcd_fd, 0x01, LCD_BACKLIGHT);  // Clear the LCD before displaying
+    lcd_send_text(lcd_fd, text, LCD_BACKLIGHT);     // Display the line on the LCD
+    usleep(2000000);                 // Wait 2 seconds before the next line
 }
 
-// Function to send a single character to the LCD
-void lcd_send_char(int fd, char c) {
-    uint8_t data[4];
-    data[0] = (c & 0xF0) | BACKLIGHT | 0x05; // Upper nibble with RS=1, EN=1
-    data[1] = (c & 0xF0) | BACKLIGHT | 0x01; // Upper nibble with RS=1, EN=0
-    data[2] = ((c << 4) & 0xF0) | BACKLIGHT | 0x05; // Lower nibble with RS=1, EN=1
-    data[3] = ((c << 4) & 0xF0) | BACKLIGHT | 0x01; // Lower nibble with RS=1, EN=0
-    if (write(fd, data, 4) != 4) {
-        perror("Failed to send character to LCD");
+// Function to display every complete line appended since the last read
+void drain_transcript(int lcd_fd) {
+    char chunk[256];
+    ssize_t n;
+
+    while ((n = read(follow_fd, chunk, sizeof(chunk))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (chunk[i] == '\n') {
+                pending[pending_len] = '\0';
+                display_line(lcd_fd, pending);
+                pending_len = 0;
+            } else if (pending_len < sizeof(pending) - 1) {
+                pending[pending_len++] = chunk[i];
+            }
+        }
     }
-    usleep(43); // Delay to allow character processing
 }
 
-// Function to send a string to the LCD
-void lcd_send_text(int fd, const char *text) {
-    while (*text) {
-        lcd_send_char(fd, *text++);
-    }
-}
+// Function to open the active transcript, either at its start or its end
+int open_transcript(const char *filename, int from_end) {
+    struct stat st;
 
-// Function to initialize the LCD
-void lcd_init(int fd) {
-    // Initialization sequence as per the provided instruction set
-    lcd_send_command(fd, 0x33);  // Initialize to 8-bit mode
-    lcd_send_command(fd, 0x32);  // Switch to 4-bit mode
-    lcd_send_command(fd, 0x28);  // Function Set: 4-bit, 2-line, 5x8 dots
-    lcd_send_command(fd, 0x0C);  // Display ON, Cursor OFF
-    lcd_send_command(fd, 0x06);  // Entry Mode: Increment, No Shift
-    lcd_send_command(fd, 0x01);  // Clear Display
-    usleep(2000);                // Wait for display to clear
+    follow_fd = open(filename, O_RDONLY);
+    if (follow_fd < 0) {
+        return -1;  // Writer has not created it yet
+    }
+    if (fstat(follow_fd, &st) == 0) {
+        follow_inode = st.st_ino;
+    }
+    if (from_end) {
+        lseek(follow_fd, 0, SEEK_END);  // Only show text written after we start
+    }
+    pending_len = 0;
+    return 0;
 }
 
-// Function to read and display file content on the LCD
+// Function to read and display new file content on the LCD, following rotations
 void read_and_display_file(const char *filename, int lcd_fd) {
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
-        perror("Failed to open file");
-        return;
+    static int opened_once = 0;
+    struct stat st;
+
+    if (follow_fd < 0) {
+        if (open_transcript(filename, !opened_once) == 0) {
+            opened_once = 1;
+        }
+        if (follow_fd < 0) {
+            return;
+        }
     }
 
-    lcd_send_command(lcd_fd, 0x01);  // Clear the LCD before displaying
+    // Check for rotation before draining so the tail of the old segment is not lost
+    int rotated = stat(filename, &st) != 0 || st.st_ino != follow_inode;
 
-    char line[256];
-    while (fgets(line, sizeof(line), file)) {
-        lcd_send_text(lcd_fd, line);  // Display the line on the LCD
-        usleep(2000000);              // Wait 2 seconds before clearing
-    }
+    drain_transcript(lcd_fd);
 
-    fclose(file);
-
-    // Optionally, clear the file after reading
-    file = fopen(filename, "w");
-    if (file) fclose(file);
+    if (rotated) {
+        close(follow_fd);
+        follow_fd = -1;
+        if (open_transcript(filename, 0) == 0) {  // New segment: read it from the start
+            drain_transcript(lcd_fd);
+        }
+    }
 }
 
 int main() {
     const char *filename = "morse_output.txt";
 
+    // SIGINT/SIGTERM (the controller's stop) exit cleanly through the log
+    // writer, so the counters below are printed; block them before any thread
+    morse_log_start(MORSE_LOG_EXIT_ON_SIGNAL);
+    metrics_open(1);  // LCD write counters; optional
+    perf_counters_init();  // lcd_send_text counters on SIGUSR1 and exit (-DMORSE_PERF only)
+
     // Open I2C device
-    int lcd_fd = open("/dev/i2c-1", O_RDWR);
+    int lcd_fd = lcd_open("/dev/i2c-1", I2C_ADDR);
     if (lcd_fd < 0) {
-        perror("Failed to open I2C device");
-        return -1;
-    }
-
-    // Set I2C slave address
-    if (ioctl(lcd_fd, I2C_SLAVE, I2C_ADDR) < 0) {
-        perror("Failed to set I2C address");
-        close(lcd_fd);
         return -1;
     }
 
-    // Initialize the LCD
-    lcd_init(lcd_fd);
+    // The LCD is left alone until there is a line to show (see display_line)
+    supervisor_notify_ready();
 
-    // Continuously check and display file content
+    // Continuously follow the transcript and display new lines
     while (1) {
         read_and_display_file(filename, lcd_fd);
         usleep(500000);  // Check the file every 0.5 seconds
@@ -1,192 +1,246 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <fcntl.h>
-#include <sys/mman.h>
 #include <unistd.h>
 #include <time.h>
 #include <linux/i2c-dev.h>
 #include <sys/ioctl.h>
+#include "transcript_log.h"
+#include "process_supervisor.h"
+#include "morse_decoder.h"
+#include "morse_log.h"
+#include "latency_trace.h"
+#include "morse_metrics.h"
+#include "morse_timing.h"
+#include "perf_counters.h"
+#include "morse_probes.h"
+#include "tick_watchdog.h"
+#include "rt_profile.h"
+#include "periodic_sampler.h"
+#include "pin_config.h"
 
-#define GPIO_BASE 0x200000  // GPIO base address for /dev/gpiomem
-#define BLOCK_SIZE (4 * 1024)  // Block size for GPIO
 #define I2C_ADDR 0x27  // I2C address for the LCD
 
 // GPIO Register Offsets
-#define GPFSEL0 0x00
-#define GPFSEL1 0x04
 #define GPLEV0 0x34
 
 volatile unsigned int *gpio;
 
-// Morse code translation table
-typedef struct {
-    char *morse;
-    char letter;
-} MorseCode;
-
-MorseCode morse_table[] = {
-    {".-", 'A'},   {"-...", 'B'}, {"-.-.", 'C'}, {"-..", 'D'}, 
-    {".", 'E'},    {"..-.", 'F'}, {"--.", 'G'},  {"....", 'H'},
-    {"..", 'I'},   {".---", 'J'}, {"-.-", 'K'},  {".-..", 'L'},
-    {"--", 'M'},   {"-.", 'N'},   {"---", 'O'},  {".--.", 'P'},
-    {"--.-", 'Q'}, {".-.", 'R'},  {"...", 'S'},  {"-", 'T'},
-    {"..-", 'U'},  {"...-", 'V'}, {".--", 'W'},  {"-..-", 'X'},
-    {"-.--", 'Y'}, {"--..", 'Z'}, {NULL, '\0'}
-};
-
-// Morse code buffer
-#define BUFFER_SIZE 64
-char morse_buffer[BUFFER_SIZE];
-int buffer_index = 0;
-
-// English text buffer
-#define TEXT_BUFFER_SIZE 256
-char text_buffer[TEXT_BUFFER_SIZE];
-int text_index = 0;
-
-// Endline counter
-int endline_counter = 0;
+// Pin map (morse_pins.conf) and the key channel read by the sampling loop
+PinConfig pins;
+const PinChannel *key_channel;
+
+// Decoder state (Morse buffer, text buffer and endline counter)
+MorseDecoder decoder;
+
+// Latency stamps for the character being keyed
+TraceStamps char_trace;
+
+// Counter sample taken when the current sampling loop iteration started
+PerfSample poll_sample;
+
+// Tick period and jitter of the sampling loop (sampling thread only)
+TickWatchdog tick_watchdog;
+
+// Absolute tick grid for delay_ms (sampling thread only)
+PeriodicSampler tick_sampler;
 
 // File path for exporting text
 const char *export_file_path = "morse_output.txt";
 
-// Function to export the text buffer to a file
+// Function to export the text buffer to the rotating transcript
 void export_text_to_file(const char *text) {
-    FILE *file = fopen(export_file_path, "a");  // Open file in append mode
-    if (file == NULL) {
-        perror("Failed to open file for writing");
+    PerfSample sample;
+    PERF_BEGIN(&sample);
+    int rc = transcript_append(text);
+    PERF_END(PERF_REGION_EXPORT, &sample);
+    MORSE_PROBE2(export, strlen(text) + 1, rc == 0);
+    if (rc != 0) {
+        perror("Failed to write transcript");
         return;
     }
-    fprintf(file, "%s\n", text);  // Write the text buffer to the file
-    fclose(file);
-    printf("Exported text to file: %s\n", export_file_path);
+    METRIC_ADD(export_bytes_total, strlen(text) + 1);
+    LOG_INFO("Exported text to file: %s", export_file_path);
 }
 
-// Delay function in milliseconds
+// Delay function in milliseconds, called by the assembly every tick. Waits
+// for the next tick on a fixed grid rather than sleeping a relative time, so
+// the work done between calls doesn't stretch the tick.
 void delay_ms(int milliseconds) {
-    struct timespec ts;
-    ts.tv_sec = milliseconds / 1000;
-    ts.tv_nsec = (milliseconds % 1000) * 1000000;
-    nanosleep(&ts, NULL);
-}
-
-// Function to translate Morse code to English
-char translate_morse_to_english(const char *morse) {
-    for (int i = 0; morse_table[i].morse != NULL; i++) {
-        if (strcmp(morse, morse_table[i].morse) == 0) {
-            return morse_table[i].letter;
-        }
+    PERF_END(PERF_REGION_POLL, &poll_sample);  // The loop iteration ends where its sleep starts
+    metrics_note_tick((uint64_t)milliseconds * 1000);  // Called once per sampling tick
+    int jitter = watchdog_tick(&tick_watchdog, (uint64_t)milliseconds * 1000);
+    if (jitter == WATCHDOG_ALERT) {
+        LOG_WARN("Tick jitter p99 %ld us is over a quarter of the %ld us Morse unit, timings unreliable",
+                 (long)tick_watchdog.p99_us, (long)tick_watchdog.unit_us);
+    } else if (jitter == WATCHDOG_CLEAR) {
+        LOG_INFO("Tick jitter back to p99 %ld us", (long)tick_watchdog.p99_us);
     }
-    return '?';  // Return '?' if Morse code is invalid
+    if (tick_sampler.period_ns != (uint64_t)milliseconds * 1000000) {
+        sampler_start(&tick_sampler, (uint64_t)milliseconds * 1000);  // First tick, or a new profile
+    }
+    uint64_t elapsed = sampler_wait(&tick_sampler);
+    if (elapsed > 1) {
+        METRIC_ADD(timer_overruns_total, elapsed - 1);
+    }
+    PERF_BEGIN(&poll_sample);
 }
 
 // Function to process Morse signals
 void send_morse_signal(int signal) {
-    if (signal == 1) {  // Dot
-        printf("Dot (.) received.\n");
-        morse_buffer[buffer_index++] = '.';
-        endline_counter++;
-        
-        if (endline_counter >= 10) {  // Check for endline condition
-            printf("Endline detected! Printing translated characters: %s\n", text_buffer);
-            text_buffer[text_index] = '\0';  // Null-terminate the text buffer
-            printf("%s\n", text_buffer);    // Print the translated text
-            export_text_to_file(text_buffer);  // Export the text to a file
-            text_index = 0;                 // Reset text buffer
-            endline_counter = 0;            // Reset endline counter
-        }
-    } else if (signal == 2) {  // Dash
-        printf("Dash (-) received.\n");
-        morse_buffer[buffer_index++] = '-';
-        endline_counter = 0;  // Reset endline counter on non-dot
-    } else if (signal == 3) {  // Gap
-        printf("Gap detected (translating to English).\n");
-        morse_buffer[buffer_index] = '\0';  // Null-terminate the Morse code
-        char translated = translate_morse_to_english(morse_buffer);
-        printf("Translated: %c\n", translated);
-
-        // Add translated character to text buffer
-        if (text_index < TEXT_BUFFER_SIZE - 1) {
-            text_buffer[text_index++] = translated;
-        }
+    char translated;
+
+    if (signal != MORSE_SIGNAL_GAP && watchdog_element(&tick_watchdog)) {
+        LOG_WARN_RATELIMITED(1, "Low confidence %s: the sampling loop stalled during the press",
+                 signal == MORSE_SIGNAL_DOT ? "dot" : "dash");
+    }
+
+    if (signal == MORSE_SIGNAL_DOT) {
+        MORSE_PROBE1(element, signal);
+        TRACE_STAMP(&char_trace, TRACE_CLASSIFIED);
+        METRIC_INC(dots_total);
+        LOG_DEBUG("Dot (.) received.");
+    } else if (signal == MORSE_SIGNAL_DASH) {
+        MORSE_PROBE1(element, signal);
+        TRACE_STAMP(&char_trace, TRACE_CLASSIFIED);
+        METRIC_INC(dashes_total);
+        LOG_DEBUG("Dash (-) received.");
+    } else if (signal == MORSE_SIGNAL_GAP) {
+        MORSE_PROBE1(gap, decoder.buffer_index);
+        TRACE_STAMP(&char_trace, TRACE_GAP);
+        LOG_DEBUG("Gap detected (translating to English).");
+    }
 
-        buffer_index = 0;  // Reset Morse code buffer
-        endline_counter = 0;  // Reset endline counter on gap
+    int event = morse_decoder_signal(&decoder, signal, &translated);
+    if (event == MORSE_EVENT_CHAR) {
+        TRACE_STAMP(&char_trace, TRACE_TRANSLATED);
+        trace_record(&char_trace);  // The LCD stages happen in lcd_file_reader, not here
+        TRACE_CLEAR(&char_trace);
+        metrics_note_character(translated);
+        LOG_INFO("Translated: %c", translated);
+    } else if (event == MORSE_EVENT_LINE) {
+        METRIC_INC(lines_total);
+        // The text buffer is reused right away, so log its length rather than a pointer to it
+        LOG_INFO("Endline detected! Exporting %ld translated characters", (long)strlen(decoder.text_buffer));
+        export_text_to_file(decoder.text_buffer);  // Export the text to a file
     }
-    fflush(stdout);
 }
 
 // Function to be called by the assembly code to report successful entry
 void report_init() {
-    printf("Entered Morse code interpreter in assembly successfully.\n");
-    fflush(stdout);
+    LOG_INFO("Entered Morse code interpreter in assembly successfully.");
+    supervisor_notify_ready();  // Sampling loop is about to start
 }
 
-// Function to read the state of GPIO 17 (button press)
+// Function to read the state of the key (GPIO 17 unless remapped)
 unsigned int read_gpio_pin() {
     unsigned int gpio_value = gpio[GPLEV0 / 4];  // Read the GPIO pin level register
-    unsigned int pin_value = (gpio_value >> 17) & 0x1;  // Extract GPIO 17 value
+    unsigned int pin_value = pin_active(gpio_value, key_channel);  // Pressed, whatever the polarity
+    static unsigned int prev_pin;
+    if (pin_value != prev_pin) {
+        MORSE_PROBE1(key_edge, pin_value);
+        if (pin_value) {
+            watchdog_key_down(&tick_watchdog);
+        } else {
+            TRACE_STAMP(&char_trace, TRACE_EDGE);  // Key released, an element just ended
+        }
+        prev_pin = pin_value;
+    }
     return pin_value;  // Return 1 if pressed, 0 otherwise
 }
 
 // Function to log "Button Pressed"
 void report_button_pressed() {
-    printf("Button Pressed\n");
-    fflush(stdout);
+    LOG_INFO("Button Pressed");
 }
 
 // Function to log "Button Unpressed"
 void report_button_unpressed() {
-    printf("Button Unpressed\n");
-    fflush(stdout);
+    LOG_INFO("Button Unpressed");
 }
 
 extern void morse_code_main();  // Declaration of the assembly function
 
+// Function to print the tick watchdog summary when the interpreter exits
+static void report_tick_watchdog(void) {
+    watchdog_report(&tick_watchdog, stderr);
+}
+
 int main() {
-    int mem_fd;
-    void *gpio_map;
-
-    // Open /dev/gpiomem to access GPIO physical memory
-    printf("Opening /dev/gpiomem to access GPIO memory...\n");
-    fflush(stdout);
-    mem_fd = open("/dev/gpiomem", O_RDWR | O_SYNC);
-    if (mem_fd < 0) {
-        perror("open");
+    RtProfile rt;
+
+    // MORSE_RT: lock memory and keep every thread started below off the sampling CPU
+    rt_profile_from_env(&rt);
+    int rt_applied = rt_prepare_process(&rt);
+
+    // Start the log writer before the other helper threads; it also turns
+    // SIGINT/SIGTERM into a clean exit, and they must inherit those blocked
+    morse_log_start(MORSE_LOG_EXIT_ON_SIGNAL);
+    trace_init();  // SIGUSR2 dumps latency histograms (no-op unless built with -DMORSE_TRACE)
+    perf_counters_init();  // SIGUSR1 and exit print region counters (no-op unless built with -DMORSE_PERF)
+
+    // Counters for metrics_exporter; the interpreter runs fine without them
+    if (metrics_open(1) != 0) {
+        LOG_WARN("Metrics disabled, shared stats block unavailable");
+    }
+
+    // Pin map: morse_pins.conf (or MORSE_PINS), else key on GPIO 17
+    if (pin_config_init(&pins) != 0) {
+        return -1;
+    }
+    key_channel = pin_config_find(&pins, PIN_KIND_KEY, 0);
+    if (key_channel == NULL) {
+        LOG_ERROR("The pin map has no key channel");
         return -1;
     }
 
     // Map GPIO memory
-    printf("Mapping GPIO memory...\n");
-    fflush(stdout);
-    gpio_map = mmap(NULL, BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, GPIO_BASE);
-    if (gpio_map == MAP_FAILED) {
-        perror("mmap GPIO");
-        close(mem_fd);
+    LOG_INFO("Mapping GPIO memory from %s...", pins.device);
+    gpio = pin_config_map(&pins);
+    if (gpio == NULL) {
         return -1;
     }
 
-    // Close /dev/gpiomem file descriptor after mapping
-    printf("Closing /dev/gpiomem file descriptor after mapping...\n");
-    fflush(stdout);
-    close(mem_fd);
+    // Configure the mapped pins as inputs, with the pulls the map asks for
+    LOG_INFO("Configuring key %s on GPIO %ld as input, active %s...", key_channel->name,
+             (long)key_channel->pin, key_channel->active_low ? "low" : "high");
+    pin_config_setup(&pins, gpio);
+
+    morse_decoder_init(&decoder);
+    watchdog_init(&tick_watchdog);
+    sampler_init(&tick_sampler);
+    atexit(report_tick_watchdog);
+
+    // Sampling thresholds: the key channel's profile, else the first in morse_timing.conf
+    // (see morse_tune), else the defaults
+    MorseTiming timing = key_channel->timing;
+    if (key_channel->profile >= 0 || morse_timing_load(MORSE_TIMING_FILE, 0, &timing) == 0) {
+        morse_timing_apply(&timing);
+        LOG_INFO("Timing profile: %ld ms ticks, dash at %ld ticks, gap at %ld ticks",
+                 (long)timing.tick_ms, (long)timing.dash_ticks, (long)timing.gap_ticks);
+    }
 
-    // Assign pointers to mapped regions
-    gpio = (volatile unsigned int *)gpio_map;
+    // Open the rotating transcript (sealed segments are compressed in the background)
+    if (transcript_open(export_file_path, TRANSCRIPT_DEFAULT_MAX_BYTES, TRANSCRIPT_DEFAULT_MAX_AGE) != 0) {
+        pin_config_unmap(gpio);
+        return -1;
+    }
+    atexit(transcript_close);  // A signal exits through the log writer thread
 
-    // Configure GPIO 17 as input (GPFSEL1 controls pins 10-19, GPIO 17 corresponds to bits 21-23)
-    printf("Configuring GPIO pin 17 as input...\n");
-    fflush(stdout);
-    gpio[GPFSEL1 / 4] &= ~(0b111 << 21);  // Clear bits 21-23 to set GPIO 17 as input
+    // The sampling loop runs on this thread: SCHED_FIFO on its own CPU when MORSE_RT is set
+    if (rt.enabled) {
+        rt_applied |= rt_enter_sampling(&rt, rt_applied, RT_LOOP_SLEEPS);  // delay_ms every tick
+        LOG_INFO("Real-time profile: priority %ld on CPU %ld, applied %s", (long)rt.priority, (long)rt.cpu,
+                 rt_describe(rt_applied));
+    }
 
     // Hand control to the assembly code
-    printf("Handing control over to Morse code interpreter in assembly...\n");
-    fflush(stdout);
+    LOG_INFO("Handing control over to Morse code interpreter in assembly...");
     morse_code_main();  // Call the assembly function
 
     // Cleanup
-    munmap(gpio_map, BLOCK_SIZE);
+    transcript_close();
+    pin_config_unmap(gpio);
 
     return 0;  // Exit the program
 }
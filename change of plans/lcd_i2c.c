@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <sys/ioctl.h>
+#include "lcd_i2c.h"
+#include "morse_metrics.h"
+#include "perf_counters.h"
+#include "morse_probes.h"
+
+// Function to open the I2C bus and select the LCD, returns the fd or -1
+int lcd_open(const char *device, int address) {
+    int fd = open(device, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open I2C device");
+        return -1;
+    }
+
+    // Set I2C slave address
+    if (ioctl(fd, I2C_SLAVE, address) < 0) {
+        perror("Failed to set I2C address");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Function to send a command to the LCD
+void lcd_send_command(int fd, uint8_t command, uint8_t backlight) {
+    uint8_t data[4];
+    data[0] = (command & 0xF0) | backlight | 0x04; // Upper nibble with EN=1
+    data[1] = (command & 0xF0) | backlight;       // Upper nibble with EN=0
+    data[2] = ((command << 4) & 0xF0) | backlight | 0x04; // Lower nibble with EN=1
+    data[3] = ((command << 4) & 0xF0) | backlight;       // Lower nibble with EN=0
+    METRIC_INC(lcd_writes_total);
+    MORSE_PROBE2(lcd_issue, 0, command);
+    int ok = write(fd, data, 4) == 4;
+    if (!ok) {
+        METRIC_INC(lcd_write_errors_total);
+        perror("Failed to send command to LCD");
+    }
+    usleep(2000);  // Command processing delay
+    MORSE_PROBE3(lcd_done, 0, command, ok);
+}
+
+// Function to send a character to the LCD
+void lcd_send_char(int fd, char c, uint8_t backlight) {
+    uint8_t data[4];
+    data[0] = (c & 0xF0) | backlight | 0x05; // Upper nibble with RS=1, EN=1
+    data[1] = (c & 0xF0) | backlight | 0x01; // Upper nibble with RS=1, EN=0
+    data[2] = ((c << 4) & 0xF0) | backlight | 0x05; // Lower nibble with RS=1, EN=1
+    data[3] = ((c << 4) & 0xF0) | backlight | 0x01; // Lower nibble with RS=1, EN=0
+    METRIC_INC(lcd_writes_total);
+    MORSE_PROBE2(lcd_issue, 1, c);
+    int ok = write(fd, data, 4) == 4;
+    if (!ok) {
+        METRIC_INC(lcd_write_errors_total);
+        perror("Failed to send character to LCD");
+    }
+    usleep(43);  // Character processing delay
+    MORSE_PROBE3(lcd_done, 1, c, ok);
+}
+
+// Function to send a string to the LCD
+void lcd_send_text(int fd, const char *text, uint8_t backlight) {
+    PerfSample sample;
+    PERF_BEGIN(&sample);
+    while (*text) {
+        lcd_send_char(fd, *text++, backlight);
+    }
+    PERF_END(PERF_REGION_LCD_TEXT, &sample);
+}
+
+// Function to initialize the LCD
+void lcd_init(int fd, uint8_t backlight) {
+    lcd_send_command(fd, 0x33, backlight);  // Initialize to 8-bit mode
+    lcd_send_command(fd, 0x32, backlight);  // Switch to 4-bit mode
+    lcd_send_command(fd, 0x28, backlight);  // Function Set: 4-bit, 2-line, 5x8 dots
+    lcd_send_command(fd, 0x0C, backlight);  // Display ON, Cursor OFF
+    lcd_send_command(fd, 0x06, backlight);  // Entry Mode: Increment, No Shift
+    lcd_send_command(fd, 0x01, backlight);  // Clear Display
+    usleep(2000);  // Wait for display to clear
+}
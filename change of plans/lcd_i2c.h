@@ -0,0 +1,18 @@
+#ifndef LCD_I2C_H
+#define LCD_I2C_H
+
+#include <stdint.h>
+
+// HD44780 16x2 LCD behind a PCF8574 I2C backpack, driven in 4-bit mode.
+
+#define I2C_ADDR 0x27  // I2C address for the LCD
+#define LCD_BACKLIGHT 0x08 // Control bit for backlight
+#define LCD_COLUMNS 16
+
+int lcd_open(const char *device, int address);
+void lcd_send_command(int fd, uint8_t command, uint8_t backlight);
+void lcd_send_char(int fd, char c, uint8_t backlight);
+void lcd_send_text(int fd, const char *text, uint8_t backlight);
+void lcd_init(int fd, uint8_t backlight);
+
+#endif
@@ -0,0 +1,369 @@
+#include <stdlib.h>
+#include <string.h>
+#include "lz4_lite.h"
+
+#define LZ4_MAGIC 0x184D2204U
+#define MIN_MATCH 4
+#define LAST_LITERALS 5   // Last 5 bytes of a block are always literals
+#define MF_LIMIT 12       // Last match must start at least 12 bytes before the end
+#define HASH_LOG 12
+
+#define PRIME32_1 2654435761U
+#define PRIME32_2 2246822519U
+#define PRIME32_3 3266489917U
+#define PRIME32_4 668265263U
+#define PRIME32_5 374761393U
+
+static uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint32_t read32_le(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write32_le(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static uint32_t rotl32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+// XXH32, needed for the frame header checksum byte
+uint32_t lz4_lite_xxh32(const void *input, size_t len, uint32_t seed) {
+    const uint8_t *p = (const uint8_t *)input;
+    const uint8_t *end = p + len;
+    uint32_t h;
+
+    if (len >= 16) {
+        uint32_t v1 = seed + PRIME32_1 + PRIME32_2;
+        uint32_t v2 = seed + PRIME32_2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - PRIME32_1;
+        while (p + 16 <= end) {
+            v1 = rotl32(v1 + read32_le(p) * PRIME32_2, 13) * PRIME32_1;
+            v2 = rotl32(v2 + read32_le(p + 4) * PRIME32_2, 13) * PRIME32_1;
+            v3 = rotl32(v3 + read32_le(p + 8) * PRIME32_2, 13) * PRIME32_1;
+            v4 = rotl32(v4 + read32_le(p + 12) * PRIME32_2, 13) * PRIME32_1;
+            p += 16;
+        }
+        h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    } else {
+        h = seed + PRIME32_5;
+    }
+
+    h += (uint32_t)len;
+    while (p + 4 <= end) {
+        h += read32_le(p) * PRIME32_3;
+        h = rotl32(h, 17) * PRIME32_4;
+        p += 4;
+    }
+    while (p < end) {
+        h += (*p++) * PRIME32_5;
+        h = rotl32(h, 11) * PRIME32_1;
+    }
+
+    h ^= h >> 15;
+    h *= PRIME32_2;
+    h ^= h >> 13;
+    h *= PRIME32_3;
+    h ^= h >> 16;
+    return h;
+}
+
+static uint32_t hash4(uint32_t v) {
+    return (v * PRIME32_1) >> (32 - HASH_LOG);
+}
+
+// Function to write an LZ4 length extension (runs of 255 plus remainder)
+static uint8_t *write_length(uint8_t *op, int len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+// Function to emit one sequence (literals followed by an optional match)
+static uint8_t *emit_sequence(uint8_t *op, uint8_t *oend, const uint8_t *lit, int lit_len,
+                              int offset, int match_len) {
+    int worst = 1 + lit_len / 255 + 1 + lit_len + 2 + match_len / 255 + 1;
+    if (op + worst > oend) {
+        return NULL;  // Output buffer too small
+    }
+
+    uint8_t *token = op++;
+    *token = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15) {
+        op = write_length(op, lit_len - 15);
+    }
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+
+    if (offset > 0) {
+        *op++ = offset & 0xFF;
+        *op++ = (offset >> 8) & 0xFF;
+        int ml = match_len - MIN_MATCH;
+        *token |= (uint8_t)(ml >= 15 ? 15 : ml);
+        if (ml >= 15) {
+            op = write_length(op, ml - 15);
+        }
+    }
+    return op;
+}
+
+// Function to compress one block with a greedy single-probe hash table
+int lz4_lite_compress_block(const uint8_t *src, int src_len, uint8_t *dst, int dst_cap) {
+    uint32_t table[1 << HASH_LOG];  // Position + 1 of the last occurrence, 0 = empty
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *end = src + src_len;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + dst_cap;
+
+    memset(table, 0, sizeof(table));
+
+    if (src_len > MF_LIMIT) {
+        const uint8_t *mflimit = end - MF_LIMIT;
+        const uint8_t *matchlimit = end - LAST_LITERALS;
+
+        while (ip <= mflimit) {
+            uint32_t h = hash4(read32(ip));
+            uint32_t ref = table[h];
+            table[h] = (uint32_t)(ip - src) + 1;
+
+            if (ref == 0) {
+                ip++;
+                continue;
+            }
+            const uint8_t *match = src + ref - 1;
+            if (ip - match > 65535 || read32(match) != read32(ip)) {
+                ip++;
+                continue;
+            }
+
+            // Extend the match backwards into pending literals, then forwards
+            while (ip > anchor && match > src && ip[-1] == match[-1]) {
+                ip--;
+                match--;
+            }
+            const uint8_t *p = ip + MIN_MATCH;
+            const uint8_t *m = match + MIN_MATCH;
+            while (p < matchlimit && *p == *m) {
+                p++;
+                m++;
+            }
+
+            op = emit_sequence(op, oend, anchor, (int)(ip - anchor), (int)(ip - match), (int)(p - ip));
+            if (op == NULL) {
+                return 0;
+            }
+            anchor = ip = p;
+        }
+    }
+
+    op = emit_sequence(op, oend, anchor, (int)(end - anchor), 0, 0);
+    if (op == NULL || op - dst >= src_len) {
+        return 0;  // Incompressible, caller stores the block raw
+    }
+    return (int)(op - dst);
+}
+
+// Function to read an LZ4 length extension, returns -1 on overrun
+static int read_length(const uint8_t **ipp, const uint8_t *iend) {
+    int len = 0;
+    uint8_t b;
+    do {
+        if (*ipp >= iend) {
+            return -1;
+        }
+        b = *(*ipp)++;
+        len += b;
+    } while (b == 255);
+    return len;
+}
+
+// Function to decompress one block with full bounds checking
+int lz4_lite_decompress_block(const uint8_t *src, int src_len, uint8_t *dst, int dst_cap) {
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + src_len;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + dst_cap;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        int lit_len = token >> 4;
+        if (lit_len == 15) {
+            int ext = read_length(&ip, iend);
+            if (ext < 0) {
+                return -1;
+            }
+            lit_len += ext;
+        }
+        if (lit_len > iend - ip || lit_len > oend - op) {
+            return -1;
+        }
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        if (ip >= iend) {
+            break;  // Last sequence has literals only
+        }
+        if (iend - ip < 2) {
+            return -1;
+        }
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - dst) {
+            return -1;
+        }
+
+        int match_len = token & 0x0F;
+        if (match_len == 15) {
+            int ext = read_length(&ip, iend);
+            if (ext < 0) {
+                return -1;
+            }
+            match_len += ext;
+        }
+        match_len += MIN_MATCH;
+        if (match_len > oend - op) {
+            return -1;
+        }
+
+        const uint8_t *m = op - offset;
+        for (int i = 0; i < match_len; i++) {
+            op[i] = m[i];  // Byte copy handles overlapping matches
+        }
+        op += match_len;
+    }
+    return (int)(op - dst);
+}
+
+// Function to compress a whole stream into an LZ4 frame of independent 64 KB blocks
+int lz4_lite_compress_stream(FILE *in, FILE *out) {
+    uint8_t header[7];
+    uint8_t *src = malloc(LZ4_LITE_BLOCK_SIZE);
+    uint8_t *dst = malloc(LZ4_LITE_BOUND(LZ4_LITE_BLOCK_SIZE));
+    int status = -1;
+
+    if (src == NULL || dst == NULL) {
+        goto done;
+    }
+
+    write32_le(header, LZ4_MAGIC);
+    header[4] = 0x60;  // FLG: version 01, independent blocks, no checksums
+    header[5] = 0x40;  // BD: 64 KB max block size
+    header[6] = (lz4_lite_xxh32(header + 4, 2, 0) >> 8) & 0xFF;
+    if (fwrite(header, 1, sizeof(header), out) != sizeof(header)) {
+        goto done;
+    }
+
+    size_t n;
+    while ((n = fread(src, 1, LZ4_LITE_BLOCK_SIZE, in)) > 0) {
+        uint8_t size_le[4];
+        int csize = lz4_lite_compress_block(src, (int)n, dst, LZ4_LITE_BOUND(LZ4_LITE_BLOCK_SIZE));
+        if (csize > 0) {
+            write32_le(size_le, (uint32_t)csize);
+            if (fwrite(size_le, 1, 4, out) != 4 || fwrite(dst, 1, csize, out) != (size_t)csize) {
+                goto done;
+            }
+        } else {
+            write32_le(size_le, (uint32_t)n | 0x80000000U);  // High bit marks a stored block
+            if (fwrite(size_le, 1, 4, out) != 4 || fwrite(src, 1, n, out) != n) {
+                goto done;
+            }
+        }
+    }
+    if (ferror(in)) {
+        goto done;
+    }
+
+    uint8_t end_mark[4] = {0, 0, 0, 0};
+    if (fwrite(end_mark, 1, 4, out) != 4) {
+        goto done;
+    }
+    status = 0;
+
+done:
+    free(src);
+    free(dst);
+    return status;
+}
+
+// Function to decompress an LZ4 frame (independent blocks only) into a stream
+int lz4_lite_decompress_stream(FILE *in, FILE *out) {
+    uint8_t header[7];
+    uint8_t *src = NULL;
+    uint8_t *dst = NULL;
+    int status = -1;
+
+    if (fread(header, 1, 6, in) != 6 || read32_le(header) != LZ4_MAGIC) {
+        return -1;
+    }
+    uint8_t flg = header[4];
+    uint8_t bd = header[5];
+    if ((flg >> 6) != 1 || !(flg & 0x20)) {
+        return -1;  // Unknown version or linked blocks
+    }
+    int block_checksum = (flg >> 4) & 1;
+    int content_checksum = (flg >> 2) & 1;
+    int skip = ((flg >> 3) & 1 ? 8 : 0) + (flg & 1 ? 4 : 0) + 1;  // Content size, dict ID, HC
+    if (fseek(in, skip, SEEK_CUR) != 0) {
+        return -1;
+    }
+
+    int max_block = 1 << (8 + 2 * ((bd >> 4) & 0x07));  // 4 -> 64 KB ... 7 -> 4 MB
+    src = malloc(max_block);
+    dst = malloc(max_block);
+    if (src == NULL || dst == NULL) {
+        goto done;
+    }
+
+    while (1) {
+        uint8_t size_le[4];
+        if (fread(size_le, 1, 4, in) != 4) {
+            goto done;
+        }
+        uint32_t size = read32_le(size_le);
+        if (size == 0) {
+            break;  // End mark
+        }
+        int stored = (size & 0x80000000U) != 0;
+        size &= 0x7FFFFFFFU;
+        if (size > (uint32_t)max_block || fread(src, 1, size, in) != size) {
+            goto done;
+        }
+        if (block_checksum && fseek(in, 4, SEEK_CUR) != 0) {
+            goto done;
+        }
+
+        if (stored) {
+            if (fwrite(src, 1, size, out) != size) {
+                goto done;
+            }
+        } else {
+            int n = lz4_lite_decompress_block(src, (int)size, dst, max_block);
+            if (n < 0 || fwrite(dst, 1, n, out) != (size_t)n) {
+                goto done;
+            }
+        }
+    }
+    if (content_checksum) {
+        fseek(in, 4, SEEK_CUR);
+    }
+    status = 0;
+
+done:
+    free(src);
+    free(dst);
+    return status;
+}
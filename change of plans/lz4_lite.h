@@ -0,0 +1,27 @@
+#ifndef LZ4_LITE_H
+#define LZ4_LITE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Minimal LZ4 implementation (block + frame format) so sealed transcript
+// segments can be compressed without pulling in an external library.
+// Output is a standard .lz4 frame readable by the stock `lz4` tool.
+
+#define LZ4_LITE_BLOCK_SIZE (64 * 1024)  // Frame block size (BD = 64 KB)
+#define LZ4_LITE_BOUND(n) ((n) + ((n) / 255) + 16)  // Worst-case compressed size
+
+uint32_t lz4_lite_xxh32(const void *input, size_t len, uint32_t seed);
+
+// Compress one block, returns compressed size (0 if it did not shrink)
+int lz4_lite_compress_block(const uint8_t *src, int src_len, uint8_t *dst, int dst_cap);
+
+// Decompress one block, returns decompressed size or -1 on corrupt input
+int lz4_lite_decompress_block(const uint8_t *src, int src_len, uint8_t *dst, int dst_cap);
+
+// Stream a whole file into / out of an LZ4 frame, returns 0 on success
+int lz4_lite_compress_stream(FILE *in, FILE *out);
+int lz4_lite_decompress_stream(FILE *in, FILE *out);
+
+#endif
@@ -0,0 +1,98 @@
+#include <errno.h>
+#include <time.h>
+#include "message_queue.h"
+
+void queue_init(MessageQueue *q) {
+    q->head = 0;
+    q->count = 0;
+    q->closed = 0;
+    q->dropped = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+}
+
+static void push_locked(MessageQueue *q, const QueueMessage *msg) {
+    q->items[(q->head + q->count) % QUEUE_CAPACITY] = *msg;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+}
+
+// Function to push a message, waiting for room; returns -1 if the queue is closed
+int queue_push(MessageQueue *q, const QueueMessage *msg) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == QUEUE_CAPACITY && !q->closed) {
+        pthread_cond_wait(&q->not_full, &q->lock);
+    }
+    if (q->closed) {
+        pthread_mutex_unlock(&q->lock);
+        return -1;
+    }
+    push_locked(q, msg);
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+// Function to push without blocking; returns -1 (and counts a drop) if full
+int queue_try_push(MessageQueue *q, const QueueMessage *msg) {
+    pthread_mutex_lock(&q->lock);
+    if (q->count == QUEUE_CAPACITY || q->closed) {
+        q->dropped++;
+        pthread_mutex_unlock(&q->lock);
+        return -1;
+    }
+    push_locked(q, msg);
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+// Function to pop a message: 0 = got one, -1 = timed out, 1 = closed and empty.
+// A negative timeout waits forever.
+int queue_pop(MessageQueue *q, QueueMessage *msg, int timeout_ms) {
+    struct timespec deadline;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && !q->closed) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&q->not_empty, &q->lock);
+        } else if (pthread_cond_timedwait(&q->not_empty, &q->lock, &deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&q->lock);
+            return -1;
+        }
+    }
+    if (q->count == 0) {
+        pthread_mutex_unlock(&q->lock);
+        return 1;
+    }
+    *msg = q->items[q->head];
+    q->head = (q->head + 1) % QUEUE_CAPACITY;
+    q->count--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+// Function to wake all waiters; remaining messages can still be popped
+void queue_close(MessageQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+}
+
+int queue_depth(MessageQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    int depth = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return depth;
+}
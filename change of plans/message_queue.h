@@ -0,0 +1,39 @@
+#ifndef MESSAGE_QUEUE_H
+#define MESSAGE_QUEUE_H
+
+#include <pthread.h>
+#include "latency_trace.h"
+
+// Bounded in-memory queue of small fixed-size messages between threads of
+// morse_machine. Producers on the sampling path use queue_try_push so they
+// never block; everything else may block.
+
+#define QUEUE_CAPACITY 64
+#define QUEUE_TEXT_MAX 64
+
+typedef struct {
+    int type;                    // Message type, defined by the user of the queue
+    int value;                   // Signal code, character, ...
+    char text[QUEUE_TEXT_MAX];   // Optional text payload
+    TraceStamps trace;           // Per-character latency stamps (empty unless MORSE_TRACE)
+} QueueMessage;
+
+typedef struct {
+    QueueMessage items[QUEUE_CAPACITY];
+    int head;
+    int count;
+    int closed;
+    unsigned long dropped;       // Messages rejected by queue_try_push
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} MessageQueue;
+
+void queue_init(MessageQueue *q);
+int queue_push(MessageQueue *q, const QueueMessage *msg);
+int queue_try_push(MessageQueue *q, const QueueMessage *msg);
+int queue_pop(MessageQueue *q, QueueMessage *msg, int timeout_ms);
+void queue_close(MessageQueue *q);
+int queue_depth(MessageQueue *q);
+
+#endif
@@ -0,0 +1,150 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "morse_metrics.h"
+
+// Publishes the shared stats block in Prometheus text format. Runs as its
+// own process so scrapes never share a CPU timeslice with the sampling loop.
+//
+// Usage: metrics_exporter [-p port] [-l listen_addr] [-f textfile] [-i interval_ms]
+//   -p 9473               serve http://<addr>:9473/metrics (0 disables HTTP)
+//   -l 127.0.0.1          listen address (default all interfaces)
+//   -f /var/lib/node_exporter/textfile_collector/morse.prom
+//                         also rewrite a node_exporter textfile every interval
+//
+// gcc -o metrics_exporter metrics_exporter.c morse_metrics.c -lrt
+
+#define DEFAULT_PORT 9473
+#define DEFAULT_INTERVAL_MS 15000
+#define REQUEST_MAX 1024
+#define RESPONSE_MAX 8192
+
+// Function to open the listening socket for the HTTP endpoint
+static int open_listener(const char *addr, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("Failed to create socket");
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    if (inet_pton(AF_INET, addr, &sa.sin_addr) != 1) {
+        fprintf(stderr, "Invalid listen address %s\n", addr);
+        close(fd);
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(fd, 8) < 0) {
+        perror("Failed to listen for scrapes");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Function to answer one scrape; only GET /metrics is served
+static void serve_client(int client) {
+    char request[REQUEST_MAX];
+    char body[RESPONSE_MAX];
+    char response[RESPONSE_MAX + 256];
+    struct pollfd pfd = {client, POLLIN, 0};
+
+    // Don't let a silent client hold up the next scrape
+    if (poll(&pfd, 1, 1000) <= 0) {
+        return;
+    }
+    ssize_t n = read(client, request, sizeof(request) - 1);
+    if (n <= 0) {
+        return;
+    }
+    request[n] = '\0';
+
+    int len;
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0) {
+        size_t body_len = metrics_format(morse_stats, body, sizeof(body));
+        len = snprintf(response, sizeof(response),
+                       "HTTP/1.0 200 OK\r\n"
+                       "Content-Type: text/plain; version=0.0.4\r\n"
+                       "Content-Length: %zu\r\n"
+                       "Connection: close\r\n\r\n%s",
+                       body_len, body);
+    } else {
+        len = snprintf(response, sizeof(response),
+                       "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    }
+    if (len > (int)sizeof(response) - 1) {
+        len = sizeof(response) - 1;
+    }
+    if (write(client, response, len) < 0) {
+        perror("Failed to answer scrape");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int port = DEFAULT_PORT;
+    const char *addr = "0.0.0.0";
+    const char *textfile = NULL;
+    int interval_ms = DEFAULT_INTERVAL_MS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            addr = argv[++i];
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            textfile = argv[++i];
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            interval_ms = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-p port] [-l addr] [-f textfile] [-i interval_ms]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (port <= 0 && textfile == NULL) {
+        fprintf(stderr, "Nothing to do: HTTP disabled and no textfile given\n");
+        return -1;
+    }
+
+    // Create the block if the interpreter hasn't yet, so start order doesn't matter
+    if (metrics_open(1) < 0) {
+        return -1;
+    }
+    signal(SIGPIPE, SIG_IGN);  // Scrapers hanging up mid-response
+
+    int listener = -1;
+    if (port > 0) {
+        listener = open_listener(addr, port);
+        if (listener < 0) {
+            return -1;
+        }
+        printf("Serving metrics on http://%s:%d/metrics\n", addr, port);
+    }
+
+    while (1) {
+        if (textfile != NULL) {
+            metrics_write_textfile(morse_stats, textfile);
+        }
+
+        struct pollfd pfd = {listener, POLLIN, 0};
+        int ready = poll(&pfd, listener >= 0 ? 1 : 0, textfile != NULL ? interval_ms : -1);
+        if (ready > 0 && (pfd.revents & POLLIN)) {
+            int client = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+            if (client >= 0) {
+                serve_client(client);
+                close(client);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <dirent.h>
+#include "key_trace.h"
+#include "morse_decoder.h"
+#include "transcript_log.h"
+
+// Decoder benchmark on deterministic synthetic key traces. Each stage runs
+// in isolation, then the whole pipeline runs end to end:
+//   classify   - sampling-loop replay, key trace -> dot/dash/gap
+//   lookup     - translate_morse_to_english
+//   buffer     - morse_decoder_signal (Morse and text buffer management)
+//   export     - transcript_append into a scratch directory
+//   end_to_end - replay + decoder + export, timed per character
+// Results are printed as JSON so runs can be diffed across versions.
+//
+// Usage: morse_bench [-wpm N] [-gap ms] [-jitter F] [-bounce F] [-seed N]
+//                    [-chars N] [-iterations N] [-o results.json]
+//
+// gcc -O2 -o morse_bench morse_bench.c key_trace.c morse_timing.c morse_decoder.c transcript_log.c lz4_lite.c -lpthread
+
+#define LINE_CHARS 20         // Letters per synthetic line before the end-of-line dots
+#define DEFAULT_CHARS 2000
+#define DEFAULT_ITERATIONS 20
+
+typedef struct {
+    const char *name;
+    uint64_t ops;           // Operations in the throughput runs
+    uint64_t total_ns;      // Wall time of the throughput runs
+    uint64_t *samples;      // Per-operation latency from the timed runs
+    size_t sample_count;
+    size_t sample_capacity;
+} StageResult;
+
+typedef struct {
+    int *signals;
+    size_t count;
+    size_t capacity;
+    StageResult *timed;     // Non-NULL in the timed run
+    uint64_t last_ns;
+} SignalLog;
+
+typedef struct {
+    MorseDecoder decoder;
+    size_t chars;
+    StageResult *timed;
+    uint64_t last_ns;
+} Pipeline;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void add_sample(StageResult *stage, uint64_t ns) {
+    if (stage->sample_count == stage->sample_capacity) {
+        size_t capacity = stage->sample_capacity ? stage->sample_capacity * 2 : 4096;
+        uint64_t *samples = realloc(stage->samples, capacity * sizeof(uint64_t));
+        if (samples == NULL) {
+            return;
+        }
+        stage->samples = samples;
+        stage->sample_capacity = capacity;
+    }
+    stage->samples[stage->sample_count++] = ns;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const StageResult *stage, double q) {
+    if (stage->sample_count == 0) {
+        return 0;
+    }
+    size_t i = (size_t)(q * (double)stage->sample_count);
+    return stage->samples[i < stage->sample_count ? i : stage->sample_count - 1];
+}
+
+// Function to build a reproducible random text, one '\n' every LINE_CHARS letters
+static char *make_text(int chars, uint64_t seed, char *letters) {
+    char *text = malloc(chars + chars / LINE_CHARS + 2);
+    size_t n = 0;
+    uint64_t x = seed ? seed : 1;
+
+    for (int i = 0; i < chars; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        letters[i] = (char)('A' + x % 26);
+        text[n++] = letters[i];
+        if ((i + 1) % LINE_CHARS == 0) {
+            text[n++] = '\n';
+        }
+    }
+    letters[chars] = '\0';
+    text[n++] = '\n';  // The final gap is only sent when the next press starts
+    text[n] = '\0';
+    return text;
+}
+
+static void collect_signal(int signal, uint64_t t_us, void *ctx) {
+    SignalLog *log = (SignalLog *)ctx;
+    (void)t_us;
+    if (signal == REPLAY_GAP_DECIDED) {
+        return;
+    }
+    if (log->timed) {
+        uint64_t now = now_ns();
+        add_sample(log->timed, now - log->last_ns);
+        log->last_ns = now;
+    }
+    if (log->count == log->capacity) {
+        log->capacity = log->capacity ? log->capacity * 2 : 4096;
+        log->signals = realloc(log->signals, log->capacity * sizeof(int));
+    }
+    log->signals[log->count++] = signal;
+}
+
+static void pipeline_signal(int signal, uint64_t t_us, void *ctx) {
+    Pipeline *p = (Pipeline *)ctx;
+    char translated;
+    (void)t_us;
+
+    int event = morse_decoder_signal(&p->decoder, signal, &translated);
+    if (event == MORSE_EVENT_CHAR) {
+        p->chars++;
+        if (p->timed) {
+            uint64_t now = now_ns();
+            add_sample(p->timed, now - p->last_ns);
+            p->last_ns = now;
+        }
+    } else if (event == MORSE_EVENT_LINE) {
+        transcript_append(p->decoder.text_buffer);
+    }
+}
+
+// Function to delete the scratch transcript directory and everything in it
+static void remove_scratch(const char *dir) {
+    char path[TRANSCRIPT_PATH_MAX + 256];
+    DIR *d = opendir(dir);
+    struct dirent *entry;
+
+    if (d == NULL) {
+        return;
+    }
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+            unlink(path);
+        }
+    }
+    closedir(d);
+    rmdir(dir);
+}
+
+static void print_stage(FILE *out, const StageResult *stage, const char *unit, int last) {
+    double ns_per_op = stage->ops ? (double)stage->total_ns / (double)stage->ops : 0.0;
+    fprintf(out,
+            "    \"%s\": {\"ops\": %llu, \"%s_per_sec\": %.1f, \"ns_per_%s\": %.1f, "
+            "\"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu}%s\n",
+            stage->name, (unsigned long long)stage->ops, unit, ns_per_op > 0 ? 1e9 / ns_per_op : 0.0, unit, ns_per_op,
+            (unsigned long long)percentile(stage, 0.50), (unsigned long long)percentile(stage, 0.99),
+            (unsigned long long)percentile(stage, 0.999), (unsigned long long)percentile(stage, 1.0),
+            last ? "" : ",");
+}
+
+int main(int argc, char *argv[]) {
+    SynthParams params;
+    MorseTiming timing;
+    int chars = DEFAULT_CHARS;
+    int iterations = DEFAULT_ITERATIONS;
+    const char *output_path = NULL;
+
+    synth_params_default(&params);
+    morse_timing_default(&timing);
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return -1;
+        }
+        if (strcmp(argv[i], "-wpm") == 0) {
+            params.wpm = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-gap") == 0) {
+            params.char_gap_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-jitter") == 0) {
+            params.jitter = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-bounce") == 0) {
+            params.bounce = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-seed") == 0) {
+            params.seed = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-chars") == 0) {
+            chars = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-iterations") == 0) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0) {
+            output_path = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (params.wpm <= 0 || chars <= 0 || iterations <= 0) {
+        fprintf(stderr, "wpm, chars and iterations must be positive\n");
+        return -1;
+    }
+
+    char *letters = malloc(chars + 1);
+    char *text = make_text(chars, params.seed, letters);
+    KeyTrace trace;
+    key_trace_init(&trace);
+    if (key_trace_synthesize(&trace, text, &params) != 0) {
+        fprintf(stderr, "Failed to synthesize trace\n");
+        return -1;
+    }
+
+    // Export goes to a scratch transcript so nothing real is touched
+    char scratch[] = "/tmp/morse_bench.XXXXXX";
+    char transcript_path[TRANSCRIPT_PATH_MAX];
+    if (mkdtemp(scratch) == NULL) {
+        perror("Failed to create scratch directory");
+        return -1;
+    }
+    snprintf(transcript_path, sizeof(transcript_path), "%s/morse_output.txt", scratch);
+    if (transcript_open(transcript_path, TRANSCRIPT_DEFAULT_MAX_BYTES, TRANSCRIPT_DEFAULT_MAX_AGE) != 0) {
+        return -1;
+    }
+
+    StageResult classify = {.name = "classify"}, lookup = {.name = "lookup"}, buffer = {.name = "buffer"};
+    StageResult export = {.name = "export"}, end_to_end = {.name = "end_to_end"};
+    SignalLog log = {0};
+
+    // classify: throughput runs, then one timed run per iteration
+    for (int it = 0; it < iterations; it++) {
+        log.count = 0;
+        log.timed = NULL;
+        uint64_t start = now_ns();
+        classify.ops += key_trace_replay(&trace, &timing, collect_signal, &log);
+        classify.total_ns += now_ns() - start;
+
+        log.count = 0;
+        log.timed = &classify;
+        log.last_ns = now_ns();
+        key_trace_replay(&trace, &timing, collect_signal, &log);
+    }
+
+    // lookup: the Morse for every letter in the text
+    const char **codes = malloc(chars * sizeof(char *));
+    for (int i = 0; i < chars; i++) {
+        codes[i] = translate_english_to_morse(letters[i]);
+    }
+    volatile char sink;
+    for (int it = 0; it < iterations; it++) {
+        uint64_t start = now_ns();
+        for (int i = 0; i < chars; i++) {
+            sink = translate_morse_to_english(codes[i]);
+        }
+        lookup.total_ns += now_ns() - start;
+        lookup.ops += chars;
+        for (int i = 0; i < chars; i++) {
+            uint64_t t0 = now_ns();
+            sink = translate_morse_to_english(codes[i]);
+            add_sample(&lookup, now_ns() - t0);
+        }
+    }
+    (void)sink;
+
+    // buffer: the classified signal stream through the decoder buffers
+    for (int it = 0; it < iterations; it++) {
+        MorseDecoder decoder;
+        char translated;
+        morse_decoder_init(&decoder);
+        uint64_t start = now_ns();
+        for (size_t i = 0; i < log.count; i++) {
+            morse_decoder_signal(&decoder, log.signals[i], &translated);
+        }
+        buffer.total_ns += now_ns() - start;
+        buffer.ops += log.count;
+
+        morse_decoder_init(&decoder);
+        for (size_t i = 0; i < log.count; i++) {
+            uint64_t t0 = now_ns();
+            morse_decoder_signal(&decoder, log.signals[i], &translated);
+            add_sample(&buffer, now_ns() - t0);
+        }
+    }
+
+    // export: one transcript line per synthetic line
+    char line[LINE_CHARS + 1];
+    for (int it = 0; it < iterations; it++) {
+        for (int i = 0; i + LINE_CHARS <= chars; i += LINE_CHARS) {
+            memcpy(line, letters + i, LINE_CHARS);
+            line[LINE_CHARS] = '\0';
+            uint64_t t0 = now_ns();
+            transcript_append(line);
+            uint64_t elapsed = now_ns() - t0;
+            add_sample(&export, elapsed);
+            export.total_ns += elapsed;
+            export.ops++;
+        }
+    }
+
+    // end_to_end: trace in, transcript out
+    size_t decoded = 0;
+    for (int it = 0; it < iterations; it++) {
+        Pipeline p;
+        memset(&p, 0, sizeof(p));
+        morse_decoder_init(&p.decoder);
+        uint64_t start = now_ns();
+        key_trace_replay(&trace, &timing, pipeline_signal, &p);
+        end_to_end.total_ns += now_ns() - start;
+        end_to_end.ops += p.chars;
+        decoded = p.chars;
+
+        memset(&p, 0, sizeof(p));
+        morse_decoder_init(&p.decoder);
+        p.timed = &end_to_end;
+        p.last_ns = now_ns();
+        key_trace_replay(&trace, &timing, pipeline_signal, &p);
+    }
+
+    transcript_close();
+    remove_scratch(scratch);
+
+    StageResult *stages[] = {&classify, &lookup, &buffer, &export, &end_to_end};
+    for (int i = 0; i < 5; i++) {
+        qsort(stages[i]->samples, stages[i]->sample_count, sizeof(uint64_t), compare_u64);
+    }
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < 1000; i++) {
+        now_ns();
+    }
+    double timer_ns = (double)(now_ns() - t0) / 1000.0;
+
+    FILE *out = stdout;
+    if (output_path != NULL && (out = fopen(output_path, "w")) == NULL) {
+        perror("Failed to open output file");
+        return -1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"workload\": {\"chars\": %d, \"wpm\": %.2f, \"char_gap_ms\": %d, \"jitter\": %.3f, "
+                 "\"bounce\": %.3f, \"seed\": %llu, \"iterations\": %d, \"edges\": %zu, \"trace_seconds\": %.1f},\n",
+            chars, params.wpm, params.char_gap_ms, params.jitter, params.bounce,
+            (unsigned long long)params.seed, iterations, trace.count, (double)trace.end_us / 1e6);
+    fprintf(out, "  \"timing\": {\"tick_ms\": %d, \"dash_ticks\": %d, \"gap_ticks\": %d},\n",
+            timing.tick_ms, timing.dash_ticks, timing.gap_ticks);
+    fprintf(out, "  \"timer_overhead_ns\": %.1f,\n", timer_ns);
+    fprintf(out, "  \"stages\": {\n");
+    print_stage(out, &classify, "symbol", 0);
+    print_stage(out, &lookup, "char", 0);
+    print_stage(out, &buffer, "symbol", 0);
+    print_stage(out, &export, "line", 0);
+    print_stage(out, &end_to_end, "char", 1);
+    fprintf(out, "  },\n");
+    // Keyed letters plus the '?' the decoder emits for the empty gap after each end of line
+    fprintf(out, "  \"decoded_chars\": %zu\n", decoded);
+    fprintf(out, "}\n");
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    for (int i = 0; i < 5; i++) {
+        free(stages[i]->samples);
+    }
+    free(log.signals);
+    free(codes);
+    free(text);
+    free(letters);
+    key_trace_free(&trace);
+    return 0;
+}
@@ -3,6 +3,9 @@
 .extern read_gpio_pin
 .extern send_morse_signal
 .extern delay_ms
+.extern morse_tick_ms        @ Timing globals from morse_timing.c (loadable profile)
+.extern morse_dash_ticks
+.extern morse_gap_ticks
 
 .section .text
 morse_code_main:
@@ -54,15 +57,21 @@ track_press:
     CMP R0, #0               @ Check if button is released
     BEQ button_released      @ If released, determine press type
 
-    CMP R5, #10              @ Check if duration exceeds 0.5s (10 ticks at 50ms)
-    BLT increment_press      @ If duration < 0.5s, continue incrementing
+    LDR R1, =morse_dash_ticks
+    LDR R1, [R1]             @ Dash threshold in ticks (default 10, 0.5s at 50ms)
+    CMP R5, R1               @ Check if duration exceeds the dash threshold
+    BLT increment_press      @ If shorter, continue incrementing
 
-    MOV R8, #1               @ Set dash pending flag (duration >= 0.5s)
+    MOV R8, #1               @ Set dash pending flag (duration >= threshold)
+    LDR R0, =morse_tick_ms
+    LDR R0, [R0]             @ Keep sleeping a tick per check, R5 stays at the threshold
+    BL delay_ms
     B track_press            @ Continue tracking press
 
 increment_press:
     ADD R5, R5, #1           @ Increment press duration counter
-    MOV R0, #50              @ Add 50ms delay between checks (reduced from 100ms)
+    LDR R0, =morse_tick_ms
+    LDR R0, [R0]             @ Tick length in ms (default 50, reduced from 100ms)
     BL delay_ms
     B track_press
 
@@ -89,8 +98,10 @@ reset_idle:
     B main_loop
 
 check_gap:
-    CMP R6, #40              @ Compare gap duration to 40 ticks (2s at 50ms)
-    BLT increment_gap        @ If unpressed < 2s, increment gap counter
+    LDR R1, =morse_gap_ticks
+    LDR R1, [R1]             @ Gap threshold in ticks (default 40, 2s at 50ms)
+    CMP R6, R1               @ Compare gap duration to the gap threshold
+    BLT increment_gap        @ If shorter, increment gap counter
 
     MOV R7, #1               @ Set gap pending flag
     MOV R6, #0               @ Reset gap duration counter
@@ -98,6 +109,9 @@ check_gap:
 
 increment_gap:
     ADD R6, R6, #1           @ Increment gap duration counter
-    MOV R0, #50              @ Add 50ms delay between checks (reduced from 100ms)
+    LDR R0, =morse_tick_ms
+    LDR R0, [R0]             @ Tick length in ms
     BL delay_ms
     B main_loop
+
+.ltorg                       @ Literal pool for the timing global addresses
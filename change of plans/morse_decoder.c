@@ -0,0 +1,92 @@
+#include <stddef.h>
+#include <string.h>
+#include "morse_decoder.h"
+#include "perf_counters.h"
+#include "morse_probes.h"
+
+// Morse code translation table
+typedef struct {
+    char *morse;
+    char letter;
+} MorseCode;
+
+MorseCode morse_table[] = {
+    {".-", 'A'},   {"-...", 'B'}, {"-.-.", 'C'}, {"-..", 'D'},
+    {".", 'E'},    {"..-.", 'F'}, {"--.", 'G'},  {"....", 'H'},
+    {"..", 'I'},   {".---", 'J'}, {"-.-", 'K'},  {".-..", 'L'},
+    {"--", 'M'},   {"-.", 'N'},   {"---", 'O'},  {".--.", 'P'},
+    {"--.-", 'Q'}, {".-.", 'R'},  {"...", 'S'},  {"-", 'T'},
+    {"..-", 'U'},  {"...-", 'V'}, {".--", 'W'},  {"-..-", 'X'},
+    {"-.--", 'Y'}, {"--..", 'Z'},
+    {"-----", '0'}, {".----", '1'}, {"..---", '2'}, {"...--", '3'},
+    {"....-", '4'}, {".....", '5'}, {"-....", '6'}, {"--...", '7'},
+    {"---..", '8'}, {"----.", '9'}, {NULL, '\0'}
+};
+
+void morse_decoder_init(MorseDecoder *decoder) {
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+// Function to translate Morse code to English
+char translate_morse_to_english(const char *morse) {
+    for (int i = 0; morse_table[i].morse != NULL; i++) {
+        if (strcmp(morse, morse_table[i].morse) == 0) {
+            return morse_table[i].letter;
+        }
+    }
+    return '?';  // Return '?' if Morse code is invalid
+}
+
+// Function to look up the Morse code for a letter, NULL if it has none
+const char *translate_english_to_morse(char letter) {
+    for (int i = 0; morse_table[i].morse != NULL; i++) {
+        if (morse_table[i].letter == letter) {
+            return morse_table[i].morse;
+        }
+    }
+    return NULL;
+}
+
+// Function to process one Morse signal, returns a MORSE_EVENT_* code
+int morse_decoder_signal(MorseDecoder *decoder, int signal, char *translated) {
+    if (signal == MORSE_SIGNAL_DOT) {
+        if (decoder->buffer_index < MORSE_BUFFER_SIZE - 1) {
+            decoder->morse_buffer[decoder->buffer_index++] = '.';
+        }
+        decoder->endline_counter++;
+
+        if (decoder->endline_counter >= MORSE_ENDLINE_DOTS) {  // Check for endline condition
+            decoder->text_buffer[decoder->text_index] = '\0';  // Null-terminate the text buffer
+            decoder->text_index = 0;        // Reset text buffer (text stays readable until the next char)
+            decoder->buffer_index = 0;      // The endline dots are not a character
+            decoder->endline_counter = 0;   // Reset endline counter
+            MORSE_PROBE1(line, strlen(decoder->text_buffer));
+            return MORSE_EVENT_LINE;
+        }
+    } else if (signal == MORSE_SIGNAL_DASH) {
+        if (decoder->buffer_index < MORSE_BUFFER_SIZE - 1) {
+            decoder->morse_buffer[decoder->buffer_index++] = '-';
+        }
+        decoder->endline_counter = 0;  // Reset endline counter on non-dot
+    } else if (signal == MORSE_SIGNAL_GAP) {
+        decoder->morse_buffer[decoder->buffer_index] = '\0';  // Null-terminate the Morse code
+        PerfSample sample;
+        PERF_BEGIN(&sample);
+        char c = translate_morse_to_english(decoder->morse_buffer);
+        PERF_END(PERF_REGION_TRANSLATE, &sample);
+
+        // Add translated character to text buffer
+        if (decoder->text_index < MORSE_TEXT_BUFFER_SIZE - 1) {
+            decoder->text_buffer[decoder->text_index++] = c;
+        }
+        if (translated) {
+            *translated = c;
+        }
+        MORSE_PROBE2(char, c, decoder->text_index);
+
+        decoder->buffer_index = 0;  // Reset Morse code buffer
+        decoder->endline_counter = 0;  // Reset endline counter on gap
+        return MORSE_EVENT_CHAR;
+    }
+    return MORSE_EVENT_NONE;
+}
@@ -0,0 +1,34 @@
+#ifndef MORSE_DECODER_H
+#define MORSE_DECODER_H
+
+// Element-to-text stage shared by the interpreter programs. Signals use the
+// codes the assembly passes to send_morse_signal: 1 = dot, 2 = dash,
+// 3 = gap (end of character). Ten dots in a row end the line.
+
+#define MORSE_SIGNAL_DOT 1
+#define MORSE_SIGNAL_DASH 2
+#define MORSE_SIGNAL_GAP 3
+
+#define MORSE_BUFFER_SIZE 64
+#define MORSE_TEXT_BUFFER_SIZE 256
+#define MORSE_ENDLINE_DOTS 10
+
+// Result of feeding one signal to the decoder
+#define MORSE_EVENT_NONE 0
+#define MORSE_EVENT_CHAR 1   // A character was translated
+#define MORSE_EVENT_LINE 2   // The line was ended, text is complete
+
+typedef struct {
+    char morse_buffer[MORSE_BUFFER_SIZE];
+    int buffer_index;
+    char text_buffer[MORSE_TEXT_BUFFER_SIZE];
+    int text_index;
+    int endline_counter;
+} MorseDecoder;
+
+void morse_decoder_init(MorseDecoder *decoder);
+char translate_morse_to_english(const char *morse);
+const char *translate_english_to_morse(char letter);
+int morse_decoder_signal(MorseDecoder *decoder, int signal, char *translated);
+
+#endif
@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "morse_log.h"
+
+typedef struct {
+    uint64_t timestamp_ns;
+    const char *fmt;
+    long args[MORSE_LOG_MAX_ARGS];
+    int32_t level;
+    int32_t nargs;
+} LogRecord;
+
+// Single-producer single-consumer ring, one per logging thread
+typedef struct {
+    _Atomic uint32_t head;             // Next record to read (writer thread)
+    char pad0[60];                     // Keep producer and consumer indices on separate cache lines
+    _Atomic uint32_t tail;             // Next record to fill (owning thread)
+    char pad1[60];
+    _Atomic uint64_t dropped;          // Records lost because the ring was full
+    LogRecord records[MORSE_LOG_RING_SIZE];
+} LogRing;
+
+int morse_log_level = MORSE_LOG_MIN_LEVEL;
+
+static _Atomic(LogRing *) rings[MORSE_LOG_MAX_THREADS];
+static atomic_int ring_count;
+static _Thread_local LogRing *thread_ring;
+static _Atomic uint64_t dropped_other;  // No ring available, or rate limited
+
+static pthread_t writer;
+static atomic_int running;
+static int exit_on_signal;
+static sigset_t exit_signals;
+static uint64_t start_ns;
+
+static const char *level_names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Function to give the calling thread its own ring on first use
+static LogRing *register_thread(void) {
+    int i = atomic_fetch_add(&ring_count, 1);
+    if (i >= MORSE_LOG_MAX_THREADS) {
+        atomic_fetch_sub(&ring_count, 1);
+        return NULL;
+    }
+    LogRing *ring = calloc(1, sizeof(LogRing));
+    atomic_store_explicit(&rings[i], ring, memory_order_release);
+    thread_ring = ring;
+    return ring;
+}
+
+// Hot path: copy the record into this thread's ring, never blocks
+void morse_log_emit(int level, const char *fmt, const long *args, int nargs) {
+    LogRing *ring = thread_ring ? thread_ring : register_thread();
+    if (ring == NULL) {
+        atomic_fetch_add_explicit(&dropped_other, 1, memory_order_relaxed);
+        return;
+    }
+
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head >= MORSE_LOG_RING_SIZE) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    LogRecord *rec = &ring->records[tail & (MORSE_LOG_RING_SIZE - 1)];
+    rec->timestamp_ns = now_ns();
+    rec->fmt = fmt;
+    rec->level = level;
+    rec->nargs = nargs > MORSE_LOG_MAX_ARGS ? MORSE_LOG_MAX_ARGS : nargs;
+    for (int i = 0; i < rec->nargs; i++) {
+        rec->args[i] = args[i];
+    }
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+// Function for LOG_*_RATELIMITED: at most per_second records per call site per second
+int morse_log_allow(MorseLogLimit *limit, uint32_t per_second) {
+    uint64_t now = now_ns();
+    if (now - limit->window_start_ns >= 1000000000ULL) {
+        limit->window_start_ns = now;
+        limit->count = 0;
+    }
+    if (limit->count < per_second) {
+        limit->count++;
+        return 1;
+    }
+    atomic_fetch_add_explicit(&dropped_other, 1, memory_order_relaxed);
+    return 0;
+}
+
+uint64_t morse_log_dropped(void) {
+    uint64_t total = atomic_load(&dropped_other);
+    int count = atomic_load(&ring_count);
+    for (int i = 0; i < count; i++) {
+        LogRing *ring = atomic_load_explicit(&rings[i], memory_order_acquire);
+        if (ring != NULL) {
+            total += atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+static void write_all(const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, buf, len);
+        if (n <= 0) {
+            return;  // Nowhere to log to
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+}
+
+// Function to format every pending record; one write() per batch
+static void drain(void) {
+    static char out[64 * 1024];
+    static uint64_t reported_drops;
+    size_t used = 0;
+
+    int count = atomic_load(&ring_count);
+    for (int i = 0; i < count; i++) {
+        LogRing *ring = atomic_load_explicit(&rings[i], memory_order_acquire);
+        if (ring == NULL) {
+            continue;
+        }
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+        while (head != tail) {
+            LogRecord *rec = &ring->records[head & (MORSE_LOG_RING_SIZE - 1)];
+            if (sizeof(out) - used < 512) {
+                write_all(out, used);
+                used = 0;
+            }
+            double secs = (double)(rec->timestamp_ns - start_ns) / 1e9;
+            used += snprintf(out + used, sizeof(out) - used, "[%11.6f] %-5s ", secs, level_names[rec->level & 3]);
+            int n = snprintf(out + used, sizeof(out) - used - 1, rec->fmt,
+                             rec->args[0], rec->args[1], rec->args[2], rec->args[3]);
+            if (n > 0) {
+                used += (size_t)n < sizeof(out) - used - 1 ? (size_t)n : sizeof(out) - used - 2;
+            }
+            out[used++] = '\n';
+            head++;
+        }
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+    }
+
+    uint64_t drops = morse_log_dropped();
+    if (drops != reported_drops) {
+        if (sizeof(out) - used < 128) {
+            write_all(out, used);
+            used = 0;
+        }
+        used += snprintf(out + used, sizeof(out) - used, "[log] %llu records dropped or rate limited\n",
+                         (unsigned long long)(drops - reported_drops));
+        reported_drops = drops;
+    }
+    if (used > 0) {
+        write_all(out, used);
+    }
+}
+
+static void *writer_thread(void *arg) {
+    (void)arg;
+    struct timespec period = {0, MORSE_LOG_FLUSH_MS * 1000000L};
+
+    while (atomic_load(&running)) {
+        drain();
+        if (exit_on_signal) {
+            // The writer doubles as the process's signal handler thread
+            siginfo_t info;
+            int sig = sigtimedwait(&exit_signals, &info, &period);
+            if (sig > 0) {
+                drain();
+                exit(0);  // Runs atexit handlers (e.g. transcript close)
+            }
+        } else {
+            nanosleep(&period, NULL);
+        }
+    }
+    drain();
+    return NULL;
+}
+
+// Function to start the writer thread. With MORSE_LOG_EXIT_ON_SIGNAL, call this
+// before creating other threads so they inherit SIGINT/SIGTERM blocked. The
+// rings are drained at exit as well, however the process ends.
+int morse_log_start(int flags) {
+    start_ns = now_ns();
+    exit_on_signal = (flags & MORSE_LOG_EXIT_ON_SIGNAL) != 0;
+    if (exit_on_signal) {
+        sigemptyset(&exit_signals);
+        sigaddset(&exit_signals, SIGINT);
+        sigaddset(&exit_signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &exit_signals, NULL);
+    }
+
+    atomic_store(&running, 1);
+    if (pthread_create(&writer, NULL, writer_thread, NULL) != 0) {
+        perror("Failed to start log writer");
+        atomic_store(&running, 0);
+        return -1;
+    }
+    atexit(morse_log_stop);
+    return 0;
+}
+
+// Function to stop the writer after a final drain
+void morse_log_stop(void) {
+    if (atomic_exchange(&running, 0)) {
+        if (pthread_equal(pthread_self(), writer)) {
+            return;  // exit() on a signal, from the writer itself: it has drained already
+        }
+        pthread_join(writer, NULL);
+    }
+}
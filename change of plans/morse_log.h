@@ -0,0 +1,119 @@
+#ifndef MORSE_LOG_H
+#define MORSE_LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Asynchronous logger for the sampling path. A log call copies the format
+// pointer and up to four arguments into the calling thread's lock-free ring;
+// a background thread formats and writes the records. No syscall happens on
+// the calling thread.
+//
+// Formats must be string literals. Arguments are stored as long, so use
+// %ld/%lu/%lx with a (long) argument, %c with a char, or %s with a string
+// that outlives the record (a literal or static buffer). The macros convert
+// each argument themselves and have the compiler check the format against
+// the arguments as written.
+//
+// Build with -DMORSE_LOG_MIN_LEVEL=MORSE_LOG_WARN (etc.) to compile lower
+// levels out entirely.
+
+#define MORSE_LOG_DEBUG 0
+#define MORSE_LOG_INFO 1
+#define MORSE_LOG_WARN 2
+#define MORSE_LOG_ERROR 3
+#define MORSE_LOG_OFF 4
+
+#ifndef MORSE_LOG_MIN_LEVEL
+#define MORSE_LOG_MIN_LEVEL MORSE_LOG_DEBUG
+#endif
+
+#define MORSE_LOG_MAX_ARGS 4
+#define MORSE_LOG_RING_SIZE 1024     // Records per thread, power of two
+#define MORSE_LOG_MAX_THREADS 16
+#define MORSE_LOG_FLUSH_MS 20        // Writer wake-up period
+
+#define MORSE_LOG_EXIT_ON_SIGNAL 1   // morse_log_start flag: drain and exit on SIGINT/SIGTERM
+
+extern int morse_log_level;  // Runtime threshold, at or above MORSE_LOG_MIN_LEVEL
+
+// Per call site rate limit state for LOG_*_RATELIMITED
+typedef struct {
+    uint64_t window_start_ns;
+    uint32_t count;
+} MorseLogLimit;
+
+int morse_log_start(int flags);
+void morse_log_stop(void);
+void morse_log_emit(int level, const char *fmt, const long *args, int nargs);
+int morse_log_allow(MorseLogLimit *limit, uint32_t per_second);
+uint64_t morse_log_dropped(void);
+
+// Never called: gives the log macros printf format checking
+static inline void morse_log_check(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static inline void morse_log_check(const char *fmt, ...) {
+    (void)fmt;
+}
+
+// Convert up to MORSE_LOG_MAX_ARGS arguments to long, one by one
+#define MORSE_LOG_LONG0()
+#define MORSE_LOG_LONG1(a) (long)(a)
+#define MORSE_LOG_LONG2(a, b) (long)(a), (long)(b)
+#define MORSE_LOG_LONG3(a, b, c) (long)(a), (long)(b), (long)(c)
+#define MORSE_LOG_LONG4(a, b, c, d) (long)(a), (long)(b), (long)(c), (long)(d)
+#define MORSE_LOG_PICK(_0, _1, _2, _3, _4, name, ...) name
+#define MORSE_LOG_LONGS(...) \
+    MORSE_LOG_PICK(_0, ##__VA_ARGS__, MORSE_LOG_LONG4, MORSE_LOG_LONG3, MORSE_LOG_LONG2, MORSE_LOG_LONG1, \
+                   MORSE_LOG_LONG0)(__VA_ARGS__)
+
+#define MORSE_LOG_NARGS(...) (int)(sizeof((long[]){0, MORSE_LOG_LONGS(__VA_ARGS__)}) / sizeof(long) - 1)
+
+#define MORSE_LOG_AT(level, fmt, ...)                                                   \
+    do {                                                                                \
+        if ((level) >= MORSE_LOG_MIN_LEVEL && (level) >= morse_log_level) {             \
+            long morse_log_args_[] = {0, MORSE_LOG_LONGS(__VA_ARGS__)};                 \
+            morse_log_emit((level), (fmt), morse_log_args_ + 1, MORSE_LOG_NARGS(__VA_ARGS__)); \
+        }                                                                               \
+        if (0) morse_log_check((fmt), ##__VA_ARGS__);                                   \
+    } while (0)
+
+#define MORSE_LOG_LIMITED(level, per_second, fmt, ...)                                  \
+    do {                                                                                \
+        static MorseLogLimit morse_log_limit_;                                          \
+        if ((level) >= MORSE_LOG_MIN_LEVEL && (level) >= morse_log_level &&             \
+            morse_log_allow(&morse_log_limit_, (per_second))) {                         \
+            long morse_log_args_[] = {0, MORSE_LOG_LONGS(__VA_ARGS__)};                 \
+            morse_log_emit((level), (fmt), morse_log_args_ + 1, MORSE_LOG_NARGS(__VA_ARGS__)); \
+        }                                                                               \
+        if (0) morse_log_check((fmt), ##__VA_ARGS__);                                   \
+    } while (0)
+
+#if MORSE_LOG_MIN_LEVEL <= MORSE_LOG_DEBUG
+#define LOG_DEBUG(fmt, ...) MORSE_LOG_AT(MORSE_LOG_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) ((void)0)
+#endif
+
+#if MORSE_LOG_MIN_LEVEL <= MORSE_LOG_INFO
+#define LOG_INFO(fmt, ...) MORSE_LOG_AT(MORSE_LOG_INFO, fmt, ##__VA_ARGS__)
+#define LOG_INFO_RATELIMITED(per_second, fmt, ...) MORSE_LOG_LIMITED(MORSE_LOG_INFO, per_second, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) ((void)0)
+#define LOG_INFO_RATELIMITED(per_second, fmt, ...) ((void)0)
+#endif
+
+#if MORSE_LOG_MIN_LEVEL <= MORSE_LOG_WARN
+#define LOG_WARN(fmt, ...) MORSE_LOG_AT(MORSE_LOG_WARN, fmt, ##__VA_ARGS__)
+#define LOG_WARN_RATELIMITED(per_second, fmt, ...) MORSE_LOG_LIMITED(MORSE_LOG_WARN, per_second, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) ((void)0)
+#define LOG_WARN_RATELIMITED(per_second, fmt, ...) ((void)0)
+#endif
+
+#if MORSE_LOG_MIN_LEVEL <= MORSE_LOG_ERROR
+#define LOG_ERROR(fmt, ...) MORSE_LOG_AT(MORSE_LOG_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) ((void)0)
+#endif
+
+#endif
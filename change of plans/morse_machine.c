@@ -0,0 +1,631 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "lcd_i2c.h"
+#include "morse_decoder.h"
+#include "message_queue.h"
+#include "transcript_log.h"
+#include "latency_trace.h"
+#include "morse_metrics.h"
+#include "morse_timing.h"
+#include "perf_counters.h"
+#include "morse_probes.h"
+#include "tick_watchdog.h"
+#include "rt_profile.h"
+#include "periodic_sampler.h"
+#include "edge_sampler.h"
+#include "debounce.h"
+#include "pin_config.h"
+#include "iambic_keyer.h"
+#include "evdev_input.h"
+
+// Single-process build of the controller, interpreter and LCD reader.
+// Threads:
+//   input   - the assembly sampling loop (morse_code_main) on the key pin, or with
+//             -edges Hz the edge sampler thread, a debounce filter and an
+//             edge classifier, or with -iambic WPM a paddle keyer on the
+//             dit and dah pins, or with -evdev the same edge path fed
+//             by a Linux input device (evdev_input.h)
+//   decoder - turns dots/dashes/gaps into text and writes the transcript
+//   display - the only thread that touches /dev/i2c-1
+//   main    - watches the power toggle
+// Pins come from morse_pins.conf (see pin_config.h): by default the key is
+// GPIO 17 and the power toggle GPIO 24.
+// They talk through in-memory queues instead of morse_output.txt.
+//
+// gcc -o morse_machine morse_machine.c morse_code_logic_active_state.s lcd_i2c.c morse_decoder.c
+//     message_queue.c transcript_log.c lz4_lite.c morse_metrics.c morse_timing.c tick_watchdog.c rt_profile.c
+//     periodic_sampler.c edge_sampler.c debounce.c pin_config.c iambic_keyer.c evdev_input.c -lpthread -lrt
+//
+// Usage: morse_machine [-on] [-edges Hz [-debounce spec]] [-evdev /dev/input/eventN [-debounce spec]]
+//                      [-iambic WPM [-mode a|b] [-weight 25-75] [-ratio tenths]]
+// Add -DMORSE_TRACE latency_trace.c for per-stage latency histograms (kill -USR2 to print).
+// Add -DMORSE_PERF perf_counters.c for per-region hardware counters (kill -USR1 to print).
+
+// GPIO Register Offsets
+#define GPLEV0 0x34
+
+// Message types
+#define MSG_SIGNAL 1      // input -> decoder, value = MORSE_SIGNAL_*
+#define MSG_RESET 2       // main -> decoder, drop partial input
+#define MSG_CHAR 3        // decoder -> display, value = character
+#define MSG_LINE 4        // decoder -> display, line ended
+#define MSG_POWER_ON 5    // main -> display
+#define MSG_POWER_OFF 6   // main -> display
+
+volatile unsigned int *gpio;
+PinConfig pins;
+const PinChannel *key_channel;    // Morse key
+const PinChannel *power_channel;  // Power toggle button
+const PinChannel *dit_channel;    // Paddle levers (-iambic only)
+const PinChannel *dah_channel;
+
+MessageQueue decoder_queue;
+MessageQueue display_queue;
+
+// Input runs only while powered; delay_ms parks the sampling thread otherwise
+atomic_int powered = 0;
+pthread_mutex_t power_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t power_cond = PTHREAD_COND_INITIALIZER;
+struct timespec toggle_time;  // When the last power-on toggle was seen
+
+volatile sig_atomic_t quit = 0;
+
+TraceStamps input_trace;  // Stamps for the character being keyed (input thread only)
+PerfSample poll_sample;   // Counters at the start of the sampling loop iteration (input thread only)
+int input_elements;       // Elements since the last gap, for the gap probe (input thread only)
+TickWatchdog tick_watchdog;  // Tick period and jitter (input thread only)
+RtProfile rt;             // MORSE_RT settings for the input thread
+int rt_applied;           // RT_APPLIED_* steps that succeeded
+PeriodicSampler tick_sampler;  // Absolute tick grid for delay_ms (input thread only)
+DebounceConfig key_debounce;   // Filter between the edge sampler and the classifier
+Debouncer key_filter;          // Edge input thread only (read by main after it exits)
+IambicConfig keyer_config;     // -iambic speed, mode, weight and ratio
+
+const char *export_file_path = "morse_output.txt";
+
+static long ms_since(const struct timespec *from) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - from->tv_sec) * 1000L + (now.tv_nsec - from->tv_nsec) / 1000000L;
+}
+
+static void set_powered(int on) {
+    pthread_mutex_lock(&power_lock);
+    atomic_store(&powered, on);
+    pthread_cond_broadcast(&power_cond);
+    pthread_mutex_unlock(&power_lock);
+}
+
+// Delay function in milliseconds, called by the assembly every tick. Ticks
+// sit on a fixed grid, so the loop's own work doesn't stretch them.
+void delay_ms(int milliseconds) {
+    PERF_END(PERF_REGION_POLL, &poll_sample);
+    metrics_note_tick((uint64_t)milliseconds * 1000);
+    int jitter = watchdog_tick(&tick_watchdog, (uint64_t)milliseconds * 1000);
+    if (jitter == WATCHDOG_ALERT) {
+        fprintf(stderr, "Tick jitter p99 %u us is over a quarter of the %u us Morse unit\n",
+                tick_watchdog.p99_us, tick_watchdog.unit_us);
+    } else if (jitter == WATCHDOG_CLEAR) {
+        fprintf(stderr, "Tick jitter back to p99 %u us\n", tick_watchdog.p99_us);
+    }
+    if (milliseconds > 0) {
+        if (tick_sampler.period_ns != (uint64_t)milliseconds * 1000000) {
+            sampler_start(&tick_sampler, (uint64_t)milliseconds * 1000);
+        }
+        uint64_t elapsed = sampler_wait(&tick_sampler);
+        if (elapsed > 1) {
+            METRIC_ADD(timer_overruns_total, elapsed - 1);
+        }
+    }
+
+    if (!atomic_load(&powered)) {
+        sampler_stop(&tick_sampler);  // A fresh grid after the pause, not a burst of overruns
+        pthread_mutex_lock(&power_lock);
+        while (!atomic_load(&powered)) {
+            pthread_cond_wait(&power_cond, &power_lock);
+        }
+        pthread_mutex_unlock(&power_lock);
+        metrics_tick_resume();  // Time spent parked is not a missed tick
+        watchdog_resume(&tick_watchdog);
+    }
+    PERF_BEGIN(&poll_sample);
+}
+
+// Function to read the state of the key (button press)
+unsigned int read_gpio_pin() {
+    unsigned int gpio_value = gpio[GPLEV0 / 4];  // Read the GPIO pin level register
+    unsigned int pin_value = pin_active(gpio_value, key_channel);
+    static unsigned int prev_pin;
+    if (pin_value != prev_pin) {
+        MORSE_PROBE1(key_edge, pin_value);
+        if (pin_value) {
+            watchdog_key_down(&tick_watchdog);
+        } else {
+            TRACE_STAMP(&input_trace, TRACE_EDGE);  // Key released, an element just ended
+        }
+        prev_pin = pin_value;
+    }
+    return pin_value;  // Return 1 if pressed, 0 otherwise
+}
+
+// Function to hand a signal from the sampling loop to the decoder thread
+void send_morse_signal(int signal) {
+    QueueMessage msg = {.type = MSG_SIGNAL, .value = signal};
+    if (signal == MORSE_SIGNAL_GAP) {
+        MORSE_PROBE1(gap, input_elements);
+        input_elements = 0;
+        TRACE_STAMP(&input_trace, TRACE_GAP);
+        msg.trace = input_trace;  // The character travels with its stamps
+        TRACE_CLEAR(&input_trace);
+    } else {
+        MORSE_PROBE1(element, signal);
+        input_elements++;
+        if (watchdog_element(&tick_watchdog)) {
+            fprintf(stderr, "Low confidence %s: the sampling loop stalled during the press\n",
+                    signal == MORSE_SIGNAL_DOT ? "dot" : "dash");
+        }
+        TRACE_STAMP(&input_trace, TRACE_CLASSIFIED);
+        if (signal == MORSE_SIGNAL_DOT) {
+            METRIC_INC(dots_total);
+        } else {
+            METRIC_INC(dashes_total);
+        }
+    }
+    if (queue_try_push(&decoder_queue, &msg) != 0) {
+        METRIC_INC(dropped_signals_total);
+        fprintf(stderr, "Decoder queue full, dropped signal %d\n", signal);
+    }
+}
+
+// Function to be called by the assembly code to report successful entry
+void report_init() {
+    printf("Entered Morse code interpreter in assembly successfully.\n");
+    fflush(stdout);
+}
+
+extern void morse_code_main();  // Declaration of the assembly function
+
+// Function to put the calling input thread on the MORSE_RT profile (both
+// input loops sleep every tick)
+static void enter_realtime(void) {
+    if (rt.enabled) {
+        rt_applied |= rt_enter_sampling(&rt, rt_applied, RT_LOOP_SLEEPS);
+        printf("Real-time input thread: priority %d on CPU %d, applied %s\n", rt.priority, rt.cpu,
+               rt_describe(rt_applied));
+    }
+}
+
+static void *input_thread(void *arg) {
+    (void)arg;
+    enter_realtime();
+    delay_ms(0);  // Park until the first power-on
+    morse_code_main();
+    return NULL;
+}
+
+static void edge_signal(int signal, uint64_t t_us, void *ctx) {
+    (void)t_us;
+    (void)ctx;
+    send_morse_signal(signal);
+}
+
+// Debounced key edges go on to the classifier
+static void filtered_edge(int pin, uint64_t t_us, int level, void *ctx) {
+    (void)pin;
+    MORSE_PROBE1(key_edge, level);
+    edge_classifier_edge((EdgeClassifier *)ctx, t_us, level);
+}
+
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+// Input from the edge sampler or an input device: key edges timed to the
+// sample (or kernel event), debounced, then classified by press and idle
+// length instead of counted ticks
+static void *edge_input_thread(void *arg) {
+    EdgeRing *ring = (EdgeRing *)arg;
+    EdgeClassifier classifier;
+    MorseTiming timing = {morse_tick_ms, morse_dash_ticks, morse_gap_ticks};
+    int was_powered = 0;
+    int level = 0;  // Raw key level from the last record
+    uint64_t glitches = 0;
+    GpioRun run;
+
+    debounce_init(&key_filter, &key_debounce, key_channel->pin, 0, filtered_edge, &classifier);
+    while (!quit) {
+        int on = atomic_load(&powered);
+        if (on && !was_powered) {
+            // Fresh start after power-on, from the key's current level
+            glitches += key_filter.glitches;
+            edge_classifier_init(&classifier, &timing, edge_signal, NULL);
+            classifier.level = level;
+            debounce_init(&key_filter, &key_debounce, key_channel->pin, level, filtered_edge, &classifier);
+        }
+        was_powered = on;
+        while (edge_ring_pop(ring, &run)) {
+            level = pin_active(run.levels, key_channel);
+            if (on) {
+                debounce_edge(&key_filter, run.t_ns / 1000, level);
+            }
+        }
+        if (on) {
+            uint64_t now = monotonic_us();
+            debounce_poll(&key_filter, now);
+            edge_classifier_poll(&classifier, now);
+        }
+        // Edges carry the sampler's timestamps, so this poll only adds latency, not timing error
+        usleep(1000);
+    }
+    key_filter.glitches += glitches;  // Total over every power cycle, for the exit report
+    return NULL;
+}
+
+// Function run every IAMBIC_TICK_US: both levers from one GPLEV0 read.
+// Returns nonzero to leave sampler_run on power-off or shutdown.
+static int keyer_tick(uint64_t tick, uint64_t missed, void *ctx) {
+    IambicKeyer *keyer = (IambicKeyer *)ctx;
+    (void)tick;
+    if (missed > 0) {
+        METRIC_ADD(timer_overruns_total, missed);
+    }
+    if (quit || !atomic_load(&powered)) {
+        return 1;
+    }
+    unsigned int levels = gpio[GPLEV0 / 4];
+    iambic_update(keyer, monotonic_us(), pin_active(levels, dit_channel), pin_active(levels, dah_channel));
+    return 0;
+}
+
+// Input from an iambic paddle: the keyer times each element itself, so its
+// dots, dashes and gaps go to the decoder as they are sent
+static void *iambic_input_thread(void *arg) {
+    PeriodicSampler sampler;
+    IambicKeyer keyer;
+    (void)arg;
+
+    enter_realtime();
+    sampler_init(&sampler);
+    while (!quit) {
+        pthread_mutex_lock(&power_lock);
+        while (!atomic_load(&powered) && !quit) {
+            pthread_cond_wait(&power_cond, &power_lock);
+        }
+        pthread_mutex_unlock(&power_lock);
+        if (quit) {
+            break;
+        }
+        iambic_init(&keyer, &keyer_config, edge_signal, NULL);  // Fresh memories after power-on
+        sampler_run(&sampler, IAMBIC_TICK_US, keyer_tick, &keyer);
+    }
+    sampler_close(&sampler);
+    return NULL;
+}
+
+static void *decoder_thread(void *arg) {
+    MorseDecoder decoder;
+    QueueMessage msg;
+    (void)arg;
+
+    morse_decoder_init(&decoder);
+    while (queue_pop(&decoder_queue, &msg, -1) == 0) {
+        METRIC_SET(decoder_queue_depth, queue_depth(&decoder_queue));
+        if (msg.type == MSG_RESET) {
+            morse_decoder_init(&decoder);
+            continue;
+        }
+
+        char translated;
+        int event = morse_decoder_signal(&decoder, msg.value, &translated);
+        if (event == MORSE_EVENT_CHAR) {
+            QueueMessage out = {.type = MSG_CHAR, .value = translated};
+            out.trace = msg.trace;
+            TRACE_STAMP(&out.trace, TRACE_TRANSLATED);
+            TRACE_STAMP(&out.trace, TRACE_QUEUED);
+            metrics_note_character(translated);
+            queue_push(&display_queue, &out);
+        } else if (event == MORSE_EVENT_LINE) {
+            METRIC_INC(lines_total);
+            PerfSample sample;
+            PERF_BEGIN(&sample);
+            int rc = transcript_append(decoder.text_buffer);
+            PERF_END(PERF_REGION_EXPORT, &sample);
+            MORSE_PROBE2(export, strlen(decoder.text_buffer) + 1, rc == 0);
+            if (rc != 0) {
+                perror("Failed to write transcript");
+            } else {
+                METRIC_ADD(export_bytes_total, strlen(decoder.text_buffer) + 1);
+            }
+            QueueMessage out = {.type = MSG_LINE, .value = 0};
+            snprintf(out.text, sizeof(out.text), "%.*s", QUEUE_TEXT_MAX - 1, decoder.text_buffer);
+            queue_push(&display_queue, &out);
+            printf("Line: %s\n", decoder.text_buffer);
+            fflush(stdout);
+        }
+    }
+    return NULL;
+}
+
+static void *display_thread(void *arg) {
+    int lcd_fd = *(int *)arg;
+    int column = 0;          // Characters shown since the last clear (2 lines of 16)
+    int clear_pending = 1;   // Clear before the next character
+    QueueMessage msg;
+
+    while (queue_pop(&display_queue, &msg, -1) == 0) {
+        METRIC_SET(display_queue_depth, queue_depth(&display_queue));
+        switch (msg.type) {
+        case MSG_POWER_ON:
+            lcd_init(lcd_fd, LCD_BACKLIGHT);
+            lcd_send_text(lcd_fd, "Sevarino Morse", LCD_BACKLIGHT);  // First line
+            lcd_send_command(lcd_fd, 0xC0, LCD_BACKLIGHT);           // Move to second line
+            lcd_send_text(lcd_fd, "Machine", LCD_BACKLIGHT);         // Second line
+            clear_pending = 1;
+            set_powered(1);
+            printf("Ready %ld ms after toggle\n", ms_since(&toggle_time));
+            fflush(stdout);
+            break;
+
+        case MSG_POWER_OFF:
+            lcd_send_command(lcd_fd, 0x01, LCD_BACKLIGHT);  // Clear display
+            lcd_send_text(lcd_fd, "Powering Down", LCD_BACKLIGHT);
+            usleep(2000000);  // Leave the message up for 2 seconds
+            lcd_send_command(lcd_fd, 0x08, 0x00);  // Turn off display and backlight
+            break;
+
+        case MSG_CHAR:
+            if (clear_pending || column >= 2 * LCD_COLUMNS) {
+                lcd_send_command(lcd_fd, 0x01, LCD_BACKLIGHT);  // Clear display
+                column = 0;
+                clear_pending = 0;
+            }
+            if (column == LCD_COLUMNS) {
+                lcd_send_command(lcd_fd, 0xC0, LCD_BACKLIGHT);  // Wrap to second line
+            }
+            lcd_send_char(lcd_fd, (char)msg.value, LCD_BACKLIGHT);
+            TRACE_STAMP(&msg.trace, TRACE_DISPLAYED);
+            trace_record(&msg.trace);
+            column++;
+            break;
+
+        case MSG_LINE:
+            clear_pending = 1;  // Keep the finished line visible until the next character
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void handle_signal(int sig) {
+    (void)sig;
+    quit = 1;
+}
+
+int main(int argc, char *argv[]) {
+    int start_on = 0;
+    uint32_t edge_rate = 0;  // 0 = the assembly sampling loop
+    const char *debounce_spec = NULL;  // -debounce, else the key channel's, else DEBOUNCE_DEFAULT
+    int iambic = 0;
+    const char *evdev_path = NULL;  // -evdev, key input from an input device
+    iambic_config_default(&keyer_config);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-on") == 0) {
+            start_on = 1;
+        } else if (strcmp(argv[i], "-edges") == 0 && i + 1 < argc) {
+            edge_rate = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-debounce") == 0 && i + 1 < argc) {
+            debounce_spec = argv[++i];
+        } else if (strcmp(argv[i], "-evdev") == 0 && i + 1 < argc) {
+            evdev_path = argv[++i];
+        } else if (strcmp(argv[i], "-iambic") == 0 && i + 1 < argc) {
+            iambic = 1;
+            keyer_config.wpm = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-mode") == 0 && i + 1 < argc) {
+            keyer_config.mode = argv[++i][0] == 'a' || argv[i][0] == 'A' ? IAMBIC_MODE_A : IAMBIC_MODE_B;
+        } else if (strcmp(argv[i], "-weight") == 0 && i + 1 < argc) {
+            keyer_config.weight = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-ratio") == 0 && i + 1 < argc) {
+            keyer_config.ratio = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-on] [-edges Hz [-debounce spec]] [-evdev /dev/input/eventN [-debounce spec]]\n"
+                            "       [-iambic WPM [-mode a|b] [-weight 25-75] [-ratio tenths]]\n", argv[0]);
+            return -1;
+        }
+    }
+    if ((iambic != 0) + (edge_rate > 0) + (evdev_path != NULL) > 1) {
+        fprintf(stderr, "-edges, -evdev and -iambic are different inputs, pick one\n");
+        return -1;
+    }
+
+    // Pin map: morse_pins.conf (or MORSE_PINS), else key on GPIO 17 and power on GPIO 24
+    if (pin_config_init(&pins) != 0) {
+        return -1;
+    }
+    key_channel = pin_config_find(&pins, PIN_KIND_KEY, 0);
+    power_channel = pin_config_find(&pins, PIN_KIND_POWER, 0);
+    if (key_channel == NULL || power_channel == NULL) {
+        fprintf(stderr, "The pin map needs a key and a power channel\n");
+        return -1;
+    }
+    if (iambic) {
+        IambicKeyer check;
+        dit_channel = pin_config_find(&pins, PIN_KIND_DIT, 0);
+        dah_channel = pin_config_find(&pins, PIN_KIND_DAH, 0);
+        if (dit_channel == NULL || dah_channel == NULL) {
+            fprintf(stderr, "-iambic needs dit and dah channels in the pin map\n");
+            return -1;
+        }
+        if (iambic_init(&check, &keyer_config, edge_signal, NULL) != 0) {
+            return -1;
+        }
+        printf("Iambic keyer: %d WPM, mode %c, weight %d, ratio %d.%d, dit GPIO %d, dah GPIO %d\n",
+               keyer_config.wpm, keyer_config.mode == IAMBIC_MODE_A ? 'A' : 'B', keyer_config.weight,
+               keyer_config.ratio / 10, keyer_config.ratio % 10, dit_channel->pin, dah_channel->pin);
+    }
+    if (debounce_spec == NULL && key_channel->has_debounce) {
+        key_debounce = key_channel->debounce;
+    } else if (debounce_parse(debounce_spec != NULL ? debounce_spec : DEBOUNCE_DEFAULT, &key_debounce) != 0) {
+        return -1;
+    }
+
+    // MORSE_RT: lock memory and keep every thread but input off the sampling CPU
+    rt_profile_from_env(&rt);
+    rt_applied = rt_prepare_process(&rt);
+
+    trace_init();  // Before any thread is created (SIGUSR2 dumps the latency histograms)
+    perf_counters_init();  // Likewise for SIGUSR1 (region counters, -DMORSE_PERF only)
+
+    // Counters for metrics_exporter; the machine runs fine without them
+    metrics_open(1);
+
+    // Sampling thresholds: the key channel's profile, else the first in morse_timing.conf
+    // (see morse_tune), else the defaults
+    MorseTiming timing = key_channel->timing;
+    if (key_channel->profile >= 0 || morse_timing_load(MORSE_TIMING_FILE, 0, &timing) == 0) {
+        morse_timing_apply(&timing);
+        printf("Timing profile: %d ms ticks, dash at %d ticks, gap at %d ticks\n",
+               timing.tick_ms, timing.dash_ticks, timing.gap_ticks);
+    }
+
+    // Map GPIO memory; every mapped pin becomes an input with its configured pull
+    gpio = pin_config_map(&pins);
+    if (gpio == NULL) {
+        return -1;
+    }
+    pin_config_setup(&pins, gpio);
+
+    // The display thread is the only owner of the I2C bus
+    int lcd_fd = lcd_open("/dev/i2c-1", I2C_ADDR);
+    if (lcd_fd < 0) {
+        pin_config_unmap(gpio);
+        return -1;
+    }
+
+    if (transcript_open(export_file_path, TRANSCRIPT_DEFAULT_MAX_BYTES, TRANSCRIPT_DEFAULT_MAX_AGE) != 0) {
+        close(lcd_fd);
+        pin_config_unmap(gpio);
+        return -1;
+    }
+
+    queue_init(&decoder_queue);
+    queue_init(&display_queue);
+    watchdog_init(&tick_watchdog);
+    sampler_init(&tick_sampler);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    // Start the edge source before the pipeline threads, so a failure has
+    // nothing to stop
+    EdgeSampler edge_sampler;
+    EvdevInput evdev;
+    int source_ok = 0;
+    if (edge_rate > 0) {
+        source_ok = edge_sampler_start(&edge_sampler, &gpio[GPLEV0 / 4], 1U << key_channel->pin, edge_rate,
+                                       EDGE_RING_DEFAULT, &rt) == 0;
+    } else if (evdev_path != NULL) {
+        // Grabbed, so a keyboard used as the key doesn't also type into the console
+        if (evdev_open(&evdev, evdev_path, &pins, 1) == 0) {
+            source_ok = evdev_start(&evdev) == 0;
+            if (!source_ok) {
+                evdev_close(&evdev);
+            }
+        }
+    } else {
+        source_ok = 1;
+    }
+    if (!source_ok) {
+        transcript_close();
+        close(lcd_fd);
+        pin_config_unmap(gpio);
+        return -1;
+    }
+
+    pthread_t input_tid, decoder_tid, display_tid;
+    pthread_create(&display_tid, NULL, display_thread, &lcd_fd);
+    pthread_create(&decoder_tid, NULL, decoder_thread, NULL);
+    if (edge_rate > 0) {
+        pthread_create(&input_tid, NULL, edge_input_thread, &edge_sampler.ring);
+    } else if (evdev_path != NULL) {
+        printf("Key input from %s\n", evdev_path);
+        pthread_create(&input_tid, NULL, edge_input_thread, &evdev.ring);
+    } else if (iambic) {
+        pthread_create(&input_tid, NULL, iambic_input_thread, NULL);
+    } else {
+        pthread_create(&input_tid, NULL, input_thread, NULL);
+        pthread_detach(input_tid);  // The assembly loop never returns
+    }
+
+    int running = 0;
+    int prev_state = 1;  // Previous button state (1 = not pressed, 0 = pressed)
+
+    printf("Monitoring GPIO %d. Press the button to toggle the interpreter.\n", power_channel->pin);
+    fflush(stdout);
+
+    // Power toggle loop
+    while (!quit) {
+        int curr_state = !pin_active(gpio[GPLEV0 / 4], power_channel);
+
+        if ((!curr_state && prev_state) || start_on) {  // Button transition: HIGH -> LOW (or -on)
+            start_on = 0;
+            if (running) {
+                set_powered(0);  // Park the sampling loop
+                QueueMessage msg = {.type = MSG_POWER_OFF, .value = 0};
+                queue_push(&display_queue, &msg);
+                running = 0;
+            } else {
+                clock_gettime(CLOCK_MONOTONIC, &toggle_time);
+                QueueMessage reset = {.type = MSG_RESET, .value = 0};
+                queue_push(&decoder_queue, &reset);
+                QueueMessage msg = {.type = MSG_POWER_ON, .value = 0};
+                queue_push(&display_queue, &msg);  // Display thread un-parks input once the splash is up
+                running = 1;
+            }
+            usleep(500000);  // Debounce delay
+        }
+
+        prev_state = curr_state;
+        usleep(100000);  // Polling delay
+    }
+
+    // Shut down: stop input, let decoder and display drain their queues
+    set_powered(0);
+    if (edge_rate > 0) {
+        pthread_join(input_tid, NULL);
+        edge_sampler_stop(&edge_sampler);
+        fprintf(stderr, "Debounce %s %u us: %llu glitches rejected, %llu sampler records dropped\n",
+                debounce_mode_name(key_debounce.mode), key_debounce.window_us,
+                (unsigned long long)key_filter.glitches, (unsigned long long)atomic_load(&edge_sampler.ring.dropped));
+        edge_ring_free(&edge_sampler.ring);
+    } else if (evdev_path != NULL) {
+        pthread_join(input_tid, NULL);
+        fprintf(stderr, "Debounce %s %u us: %llu key events, %llu glitches rejected\n",
+                debounce_mode_name(key_debounce.mode), key_debounce.window_us,
+                (unsigned long long)atomic_load(&evdev.events), (unsigned long long)key_filter.glitches);
+        evdev_close(&evdev);
+    } else if (iambic) {
+        pthread_join(input_tid, NULL);
+    }
+    queue_close(&decoder_queue);
+    pthread_join(decoder_tid, NULL);
+    queue_close(&display_queue);
+    pthread_join(display_tid, NULL);
+
+    transcript_close();
+    lcd_send_command(lcd_fd, 0x08, 0x00);  // Turn off display and backlight
+    close(lcd_fd);
+    pin_config_unmap(gpio);
+    watchdog_report(&tick_watchdog, stderr);  // Input is parked, its counters are stable
+    return 0;
+}
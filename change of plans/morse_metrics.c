@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "morse_metrics.h"
+
+#define WPM_SMOOTHING 8  // Moving average over roughly the last 8 characters
+#define WPM_IDLE_MS 5000 // Longer pauses between characters don't count toward WPM
+
+MorseStats *morse_stats = NULL;
+
+// Function to map the shared stats block; create it if asked (writers), or
+// attach read-only (the exporter)
+int metrics_open(int create) {
+    int fd = shm_open(METRICS_SHM_NAME, create ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+    if (fd < 0) {
+        perror("Failed to open metrics shared memory");
+        return -1;
+    }
+    if (create) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size < (off_t)sizeof(MorseStats) &&
+            ftruncate(fd, sizeof(MorseStats)) < 0) {
+            perror("Failed to size metrics shared memory");
+            close(fd);
+            return -1;
+        }
+    }
+
+    void *map = mmap(NULL, sizeof(MorseStats), create ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Failed to map metrics shared memory");
+        return -1;
+    }
+
+    MorseStats *stats = (MorseStats *)map;
+    if (create && stats->magic == METRICS_MAGIC && stats->version < METRICS_VERSION) {
+        // Left behind by an older build: start over with the current layout
+        memset(stats, 0, sizeof(MorseStats));
+    }
+    if (create && stats->magic != METRICS_MAGIC) {
+        // Fresh zero-filled block; counters already start at 0
+        stats->version = METRICS_VERSION;
+        stats->magic = METRICS_MAGIC;
+    }
+    if (stats->magic != METRICS_MAGIC || stats->version != METRICS_VERSION) {
+        fprintf(stderr, "Metrics shared memory has an unknown layout\n");
+        munmap(map, sizeof(MorseStats));
+        return -1;
+    }
+    morse_stats = stats;
+    return 0;
+}
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+// Function to count a decoded character and update the WPM estimate.
+// One word is five characters, so WPM = 12000 / (ms per character).
+// Called from a single decoder thread per process.
+void metrics_note_character(char c) {
+    static uint64_t last_ms;
+    static uint64_t avg_ms;
+
+    if (morse_stats == NULL) {
+        return;
+    }
+    METRIC_INC(characters_total);
+    if (c == '?') {
+        METRIC_INC(unknown_characters_total);
+    }
+
+    uint64_t now = now_ms();
+    if (last_ms != 0 && now - last_ms < WPM_IDLE_MS) {
+        uint64_t interval = now - last_ms;
+        avg_ms = avg_ms == 0 ? interval : avg_ms + ((int64_t)interval - (int64_t)avg_ms) / WPM_SMOOTHING;
+        if (avg_ms > 0) {
+            METRIC_SET(wpm_x100, 1200000ULL / avg_ms);
+        }
+    }
+    last_ms = now;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static uint64_t last_tick_us;  // Sampling thread only
+
+// Function to record one sampling tick, called at the top of delay_ms. The
+// period is measured from the previous call: one vDSO clock read and a few
+// relaxed atomics, no syscalls.
+void metrics_note_tick(uint64_t intended_us) {
+    if (morse_stats == NULL) {
+        return;
+    }
+    uint64_t now = now_us();
+    uint64_t period_us = now - last_tick_us;
+    int first = last_tick_us == 0;
+    last_tick_us = now;
+    if (first) {
+        return;
+    }
+
+    METRIC_INC(loop_iterations_total);
+    METRIC_SET(loop_period_us, period_us);
+    if (period_us > atomic_load_explicit(&morse_stats->loop_period_max_us, memory_order_relaxed)) {
+        METRIC_SET(loop_period_max_us, period_us);
+    }
+    // A wake-up more than half a tick late means at least one sample was skipped
+    if (intended_us > 0 && period_us >= intended_us + intended_us / 2) {
+        METRIC_ADD(missed_ticks_total, (period_us + intended_us / 2) / intended_us - 1);
+    }
+}
+
+// Function to restart tick timing after the sampling loop was deliberately parked
+void metrics_tick_resume(void) {
+    last_tick_us = 0;
+}
+
+#define LOAD(field) ((unsigned long long)atomic_load_explicit(&stats->field, memory_order_relaxed))
+
+// Function to render the stats block in Prometheus text exposition format
+size_t metrics_format(const MorseStats *stats, char *buf, size_t len) {
+    int n = snprintf(buf, len,
+        "# HELP morse_elements_total Morse elements classified by the sampling loop.\n"
+        "# TYPE morse_elements_total counter\n"
+        "morse_elements_total{type=\"dot\"} %llu\n"
+        "morse_elements_total{type=\"dash\"} %llu\n"
+        "# HELP morse_characters_total Characters decoded.\n"
+        "# TYPE morse_characters_total counter\n"
+        "morse_characters_total %llu\n"
+        "# HELP morse_unknown_characters_total Characters that decoded as '?'.\n"
+        "# TYPE morse_unknown_characters_total counter\n"
+        "morse_unknown_characters_total %llu\n"
+        "# HELP morse_lines_total Lines ended with the end-of-line signal.\n"
+        "# TYPE morse_lines_total counter\n"
+        "morse_lines_total %llu\n"
+        "# HELP morse_wpm Estimated sending speed in words per minute.\n"
+        "# TYPE morse_wpm gauge\n"
+        "morse_wpm %.2f\n"
+        "# HELP morse_loop_iterations_total Sampling loop ticks.\n"
+        "# TYPE morse_loop_iterations_total counter\n"
+        "morse_loop_iterations_total %llu\n"
+        "# HELP morse_loop_period_seconds Duration of the last sampling tick.\n"
+        "# TYPE morse_loop_period_seconds gauge\n"
+        "morse_loop_period_seconds %.6f\n"
+        "# HELP morse_loop_period_max_seconds Longest sampling tick since start.\n"
+        "# TYPE morse_loop_period_max_seconds gauge\n"
+        "morse_loop_period_max_seconds %.6f\n"
+        "# HELP morse_missed_ticks_total Sampling ticks skipped by late wake-ups.\n"
+        "# TYPE morse_missed_ticks_total counter\n"
+        "morse_missed_ticks_total %llu\n"
+        "# HELP morse_timer_overruns_total Tick timer expirations that passed while the loop was busy.\n"
+        "# TYPE morse_timer_overruns_total counter\n"
+        "morse_timer_overruns_total %llu\n"
+        "# HELP morse_tick_jitter_p99_seconds p99 deviation of the tick period over the last 256 ticks.\n"
+        "# TYPE morse_tick_jitter_p99_seconds gauge\n"
+        "morse_tick_jitter_p99_seconds %.6f\n"
+        "# HELP morse_jitter_alert 1 while tick jitter exceeds a quarter of the Morse unit.\n"
+        "# TYPE morse_jitter_alert gauge\n"
+        "morse_jitter_alert %llu\n"
+        "# HELP morse_jitter_alerts_total Times the tick jitter alert was raised.\n"
+        "# TYPE morse_jitter_alerts_total counter\n"
+        "morse_jitter_alerts_total %llu\n"
+        "# HELP morse_low_confidence_elements_total Elements whose press was timed across a sampling loop stall.\n"
+        "# TYPE morse_low_confidence_elements_total counter\n"
+        "morse_low_confidence_elements_total %llu\n"
+        "# HELP morse_lcd_writes_total I2C writes to the LCD.\n"
+        "# TYPE morse_lcd_writes_total counter\n"
+        "morse_lcd_writes_total %llu\n"
+        "# HELP morse_lcd_write_errors_total Failed I2C writes to the LCD.\n"
+        "# TYPE morse_lcd_write_errors_total counter\n"
+        "morse_lcd_write_errors_total %llu\n"
+        "# HELP morse_queue_depth Messages waiting in a morse_machine queue.\n"
+        "# TYPE morse_queue_depth gauge\n"
+        "morse_queue_depth{queue=\"decoder\"} %llu\n"
+        "morse_queue_depth{queue=\"display\"} %llu\n"
+        "# HELP morse_dropped_signals_total Key signals dropped because the decoder queue was full.\n"
+        "# TYPE morse_dropped_signals_total counter\n"
+        "morse_dropped_signals_total %llu\n"
+        "# HELP morse_export_bytes_total Text bytes exported to the transcript.\n"
+        "# TYPE morse_export_bytes_total counter\n"
+        "morse_export_bytes_total %llu\n",
+        LOAD(dots_total), LOAD(dashes_total), LOAD(characters_total), LOAD(unknown_characters_total),
+        LOAD(lines_total), (double)LOAD(wpm_x100) / 100.0, LOAD(loop_iterations_total),
+        (double)LOAD(loop_period_us) / 1e6, (double)LOAD(loop_period_max_us) / 1e6,
+        LOAD(missed_ticks_total), LOAD(timer_overruns_total), (double)LOAD(tick_jitter_p99_us) / 1e6, LOAD(jitter_alert),
+        LOAD(jitter_alerts_total), LOAD(low_confidence_elements_total), LOAD(lcd_writes_total), LOAD(lcd_write_errors_total),
+        LOAD(decoder_queue_depth), LOAD(display_queue_depth), LOAD(dropped_signals_total),
+        LOAD(export_bytes_total));
+    if (n < 0) {
+        return 0;
+    }
+    return (size_t)n < len ? (size_t)n : len - 1;
+}
+
+// Function to write a textfile-collector file atomically (temp file + rename)
+int metrics_write_textfile(const MorseStats *stats, const char *path) {
+    char tmp[512];
+    char buf[4096];
+    size_t len = metrics_format(stats, buf, sizeof(buf));
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *file = fopen(tmp, "w");
+    if (file == NULL) {
+        perror("Failed to open metrics textfile");
+        return -1;
+    }
+    if (fwrite(buf, 1, len, file) != len || fclose(file) != 0) {
+        perror("Failed to write metrics textfile");
+        unlink(tmp);
+        return -1;
+    }
+    if (rename(tmp, path) < 0) {
+        perror("Failed to publish metrics textfile");
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
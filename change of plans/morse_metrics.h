@@ -0,0 +1,72 @@
+#ifndef MORSE_METRICS_H
+#define MORSE_METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Decoder and display health counters kept in a shared-memory block
+// (/dev/shm/morse_stats) so the interpreter, LCD reader and morse_machine
+// can all update it with relaxed atomics, and metrics_exporter can publish
+// it in Prometheus text format without touching the sampling loop.
+// Every METRIC_* macro is a no-op until metrics_open() succeeds.
+
+#define METRICS_SHM_NAME "/morse_stats"
+#define METRICS_MAGIC 0x4D535453U  // "MSTS"
+#define METRICS_VERSION 3
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+
+    _Atomic uint64_t dots_total;
+    _Atomic uint64_t dashes_total;
+    _Atomic uint64_t characters_total;
+    _Atomic uint64_t unknown_characters_total;  // Decoded as '?'
+    _Atomic uint64_t lines_total;
+    _Atomic uint64_t wpm_x100;                  // Gauge: estimated words per minute * 100
+
+    _Atomic uint64_t loop_iterations_total;     // Sampling ticks
+    _Atomic uint64_t loop_period_us;            // Gauge: last tick period
+    _Atomic uint64_t loop_period_max_us;        // Gauge: worst tick period since start
+    _Atomic uint64_t missed_ticks_total;        // Ticks swallowed by a late wake-up
+    _Atomic uint64_t timer_overruns_total;      // Same, as counted by the tick timer's expirations
+    _Atomic uint64_t tick_jitter_p99_us;        // Gauge: p99 |period - intended| over the watchdog window
+    _Atomic uint64_t jitter_alert;              // Gauge: 1 while jitter exceeds the alert threshold
+    _Atomic uint64_t jitter_alerts_total;
+    _Atomic uint64_t low_confidence_elements_total;  // Elements measured across a loop stall
+
+    _Atomic uint64_t lcd_writes_total;
+    _Atomic uint64_t lcd_write_errors_total;
+
+    _Atomic uint64_t decoder_queue_depth;       // Gauges, morse_machine only
+    _Atomic uint64_t display_queue_depth;
+    _Atomic uint64_t dropped_signals_total;
+
+    _Atomic uint64_t export_bytes_total;        // Text bytes exported to the transcript
+} MorseStats;
+
+extern MorseStats *morse_stats;
+
+#define METRIC_ADD(field, n)                                                            \
+    do {                                                                                \
+        if (morse_stats) {                                                              \
+            atomic_fetch_add_explicit(&morse_stats->field, (n), memory_order_relaxed);  \
+        }                                                                               \
+    } while (0)
+#define METRIC_INC(field) METRIC_ADD(field, 1)
+#define METRIC_SET(field, v)                                                            \
+    do {                                                                                \
+        if (morse_stats) {                                                              \
+            atomic_store_explicit(&morse_stats->field, (v), memory_order_relaxed);      \
+        }                                                                               \
+    } while (0)
+
+int metrics_open(int create);
+void metrics_note_character(char c);
+void metrics_note_tick(uint64_t intended_us);
+void metrics_tick_resume(void);
+size_t metrics_format(const MorseStats *stats, char *buf, size_t len);
+int metrics_write_textfile(const MorseStats *stats, const char *path);
+
+#endif
@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include "multi_key.h"
+#include "pin_config.h"
+#include "evdev_input.h"
+
+// Decodes several straight keys at once, one per bank-0 GPIO pin. The edge
+// sampler reads the whole of GPLEV0 each sample and the multi-key decoder
+// runs one channel per key in the pin map (morse_pins.conf), or per pin in
+// -pins. Polarity comes from the map, as do a channel's own debounce and
+// timing profile; -debounce and -tick/-dash/-gap set the rest. Each
+// finished line is printed as "GPIO n: text" and, with -o, appended to
+// <prefix>n.txt. -replay decodes every recorded pin of an edge_capture
+// file instead of live GPIO. -evdev takes the keys from a Linux input
+// device instead, through the map's evdev lines (see evdev_input.h).
+//
+// Usage: morse_multi [-pins mask] [-rate Hz] [-seconds N] [-o prefix]
+//                    [-debounce spec] [-tick ms] [-dash ticks] [-gap ticks]
+//        morse_multi -replay capture.rle [-pins mask] [-o prefix] ...
+//        morse_multi -evdev /dev/input/eventN [-pins mask] [-seconds N] [-o prefix] ...
+//
+// Set MORSE_RT to pin the sampling thread (see rt_profile.h).
+//
+// gcc -O2 -o morse_multi morse_multi.c multi_key.c edge_sampler.c debounce.c rt_profile.c
+//     morse_decoder.c morse_timing.c pin_config.c evdev_input.c -lpthread
+
+#define GPLEV0 0x34
+#define PATH_SIZE 256
+
+volatile sig_atomic_t stop = 0;
+
+static void handle_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+// Function to print a channel's finished line and append it to its transcript
+static void channel_output(int pin, int event, char c, const char *text, uint64_t t_us, void *ctx) {
+    const char *prefix = (const char *)ctx;
+    (void)c;
+    if (event != MORSE_EVENT_LINE) {
+        return;
+    }
+    printf("[%10.3f] GPIO %d: %s\n", t_us / 1e6, pin, text);
+    fflush(stdout);
+    if (prefix != NULL) {
+        char path[PATH_SIZE];
+        snprintf(path, sizeof(path), "%s%d.txt", prefix, pin);
+        FILE *file = fopen(path, "a");
+        if (file == NULL) {
+            perror("Failed to open channel transcript");
+            return;
+        }
+        fprintf(file, "%s\n", text);
+        fclose(file);
+    }
+}
+
+// Function to start the decoder from the first (inverted) word, then give
+// every mapped key its own debounce and profile
+static void start_channels(MultiKey *mk, const PinConfig *pins, uint32_t pin_mask, uint32_t levels,
+                           const MorseTiming *timing, const DebounceConfig *debounce, const char *prefix) {
+    multi_key_init(mk, pin_mask, levels, timing, debounce, channel_output, (void *)prefix);
+    for (int i = 0; i < pins->count; i++) {
+        const PinChannel *ch = &pins->channels[i];
+        if (ch->kind == PIN_KIND_KEY && (pin_mask & (1U << ch->pin)) && (ch->profile >= 0 || ch->has_debounce)) {
+            multi_key_configure(mk, ch->pin, ch->profile >= 0 ? &ch->timing : timing,
+                                ch->has_debounce ? &ch->debounce : debounce);
+        }
+    }
+}
+
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Function to decode from the edge sampler on GPIO, or from an input
+// device when evdev_path is set. Both fill an EdgeRing the same way.
+static int run_live(MultiKey *mk, const PinConfig *pins, const char *evdev_path, uint32_t pin_mask, uint32_t rate_hz,
+                    int seconds, const MorseTiming *timing, const DebounceConfig *debounce, const char *prefix) {
+    volatile unsigned int *gpio = NULL;
+    EdgeSampler sampler;
+    EvdevInput evdev;
+    EdgeRing *ring;
+
+    if (evdev_path != NULL) {
+        if (evdev_open(&evdev, evdev_path, pins, 1) != 0) {
+            return -1;
+        }
+        pin_mask &= evdev.pin_mask;
+        if (pin_mask == 0) {
+            fprintf(stderr, "No decoded pin has a key code (evdev pins 0x%08x)\n", evdev.pin_mask);
+            evdev_close(&evdev);
+            return -1;
+        }
+        if (evdev_start(&evdev) != 0) {
+            evdev_close(&evdev);
+            return -1;
+        }
+        ring = &evdev.ring;
+    } else {
+        gpio = pin_config_map(pins);
+        if (gpio == NULL) {
+            return -1;
+        }
+        pin_config_setup(pins, gpio);
+
+        RtProfile rt;
+        rt_profile_from_env(&rt);
+        rt_prepare_process(&rt);
+        if (edge_sampler_start(&sampler, &gpio[GPLEV0 / 4], pin_mask, rate_hz, EDGE_RING_DEFAULT, &rt) != 0) {
+            pin_config_unmap(gpio);
+            return -1;
+        }
+        ring = &sampler.ring;
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    if (evdev_path != NULL) {
+        fprintf(stderr, "Decoding pins 0x%08x from %s, Ctrl-C to stop\n", pin_mask, evdev_path);
+    } else {
+        fprintf(stderr, "Decoding pins 0x%08x at %u Hz, Ctrl-C to stop\n", pin_mask, rate_hz);
+    }
+
+    uint64_t start_us = monotonic_us();
+    uint64_t now_us = start_us;
+    int started = 0;
+    GpioRun run;
+    while (!stop) {
+        while (edge_ring_pop(ring, &run)) {
+            uint32_t levels = run.levels ^ pins->invert_mask;  // 1 = pressed on every pin
+            if (!started) {
+                // The ring's first record holds the initial levels
+                start_channels(mk, pins, pin_mask, levels, timing, debounce, prefix);
+                started = 1;
+            } else {
+                multi_key_sample(mk, run.t_ns / 1000, levels);
+            }
+        }
+        now_us = monotonic_us();
+        if (started) {
+            multi_key_poll(mk, now_us);
+        }
+        if (seconds > 0 && now_us - start_us >= (uint64_t)seconds * 1000000ULL) {
+            break;
+        }
+        usleep(1000);
+    }
+    if (evdev_path != NULL) {
+        evdev_stop(&evdev);
+    } else {
+        edge_sampler_stop(&sampler);
+    }
+    if (started) {
+        while (edge_ring_pop(ring, &run)) {
+            multi_key_sample(mk, run.t_ns / 1000, run.levels ^ pins->invert_mask);
+        }
+        multi_key_flush(mk, now_us);
+    }
+
+    if (evdev_path != NULL) {
+        fprintf(stderr, "%llu key events, %llu dropped\n", (unsigned long long)atomic_load(&evdev.events),
+                (unsigned long long)atomic_load(&evdev.ring.dropped));
+        evdev_close(&evdev);
+    } else {
+        fprintf(stderr, "%llu samples, %llu late, %llu dropped\n", (unsigned long long)atomic_load(&sampler.samples),
+                (unsigned long long)atomic_load(&sampler.late_samples),
+                (unsigned long long)atomic_load(&sampler.ring.dropped));
+        edge_ring_free(&sampler.ring);
+        pin_config_unmap(gpio);
+    }
+    return started ? 0 : -1;
+}
+
+static int run_replay(MultiKey *mk, const PinConfig *pins, const char *path, uint32_t pin_mask,
+                      const MorseTiming *timing, const DebounceConfig *debounce, const char *prefix) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror("Failed to open capture file");
+        return -1;
+    }
+    EdgeCaptureHeader header;
+    if (edge_capture_read_header(file, &header) != 0) {
+        fclose(file);
+        return -1;
+    }
+    pin_mask = pin_mask ? pin_mask & header.pin_mask : header.pin_mask;
+    if (pin_mask == 0) {
+        fprintf(stderr, "None of the pins were recorded (mask 0x%08x)\n", header.pin_mask);
+        fclose(file);
+        return -1;
+    }
+
+    GpioRun run;
+    uint64_t last_us = 0;
+    int started = 0;
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    while (edge_capture_read(file, &run)) {
+        uint32_t levels = run.levels ^ pins->invert_mask;
+        last_us = run.t_ns / 1000;
+        if (!started) {
+            start_channels(mk, pins, pin_mask, levels, timing, debounce, prefix);
+            started = 1;
+            continue;
+        }
+        multi_key_poll(mk, last_us);
+        multi_key_sample(mk, last_us, levels);
+    }
+    fclose(file);
+    if (!started) {
+        fprintf(stderr, "%s: empty capture\n", path);
+        return -1;
+    }
+    multi_key_flush(mk, last_us);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(stderr, "Replayed %.1f s of keying on %d pins in %.3f ms\n", last_us / 1e6, __builtin_popcount(pin_mask),
+            (end.tv_sec - begin.tv_sec) * 1e3 + (end.tv_nsec - begin.tv_nsec) / 1e6);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *replay_path = NULL;
+    const char *evdev_path = NULL;
+    const char *prefix = NULL;
+    uint32_t pin_mask = 0;
+    uint32_t rate_hz = EDGE_RATE_DEFAULT;
+    int seconds = 0;
+    MorseTiming timing;
+    DebounceConfig debounce;
+    PinConfig pins;
+
+    if (pin_config_init(&pins) != 0) {
+        return -1;
+    }
+    morse_timing_default(&timing);
+    morse_timing_load(MORSE_TIMING_FILE, 0, &timing);
+    debounce_parse(DEBOUNCE_DEFAULT, &debounce);
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return -1;
+        }
+        if (strcmp(argv[i], "-pins") == 0) {
+            pin_mask = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-replay") == 0) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "-evdev") == 0) {
+            evdev_path = argv[++i];
+        } else if (strcmp(argv[i], "-rate") == 0) {
+            rate_hz = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-seconds") == 0) {
+            seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0) {
+            prefix = argv[++i];
+        } else if (strcmp(argv[i], "-debounce") == 0) {
+            if (debounce_parse(argv[++i], &debounce) != 0) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "-tick") == 0) {
+            timing.tick_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-dash") == 0) {
+            timing.dash_ticks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-gap") == 0) {
+            timing.gap_ticks = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (replay_path == NULL && pin_mask == 0) {
+        pin_mask = pins.key_mask;
+    }
+    if (replay_path == NULL && pin_mask == 0) {
+        fprintf(stderr, "Usage: morse_multi [-pins mask] [-rate Hz] [-seconds N] [-o prefix]\n"
+                        "                   [-debounce spec] [-tick ms] [-dash ticks] [-gap ticks]\n"
+                        "       morse_multi -replay capture.rle [-pins mask] [-o prefix] ...\n"
+                        "       morse_multi -evdev /dev/input/eventN [-pins mask] [-seconds N] [-o prefix] ...\n");
+        return -1;
+    }
+
+    static MultiKey mk;  // 32 channels of decoder buffers
+    int rc = replay_path != NULL ? run_replay(&mk, &pins, replay_path, pin_mask, &timing, &debounce, prefix)
+                                 : run_live(&mk, &pins, evdev_path, pin_mask, rate_hz, seconds, &timing, &debounce, prefix);
+    if (rc == 0) {
+        multi_key_report(&mk, stderr);
+    }
+    return rc;
+}
@@ -0,0 +1,88 @@
+#ifndef MORSE_PROBES_H
+#define MORSE_PROBES_H
+
+// USDT (SystemTap-style) static probes, provider "morse". Each probe is a
+// single nop in the code plus a .note.stapsdt entry that tells bpftrace,
+// perf and SystemTap where the nop is and where to find its arguments, so a
+// running binary can be traced without rebuilding:
+//
+//   bpftrace -l 'usdt:./gpio_morse_interpreter:*'
+//   bpftrace -e 'usdt:./morse_machine:morse:char { printf("%c\n", arg0); }'
+//
+// Same note layout as <sys/sdt.h>, written out here so nothing needs to be
+// installed. Arguments are widened to long; pass pointers as (long). Build
+// with -DMORSE_NO_PROBES to drop the probes entirely.
+//
+// Probes:
+//   key_edge(level)              GPIO 17 changed (1 = pressed)
+//   element(signal)              Element classified (1 dot, 2 dash)
+//   gap(morse_len)               Character gap decided, morse_len elements buffered
+//   char(c, text_len)            Character emitted
+//   line(text_len)               End of line
+//   lcd_issue(kind, byte)        LCD transfer started (kind 0 command, 1 character)
+//   lcd_done(kind, byte, ok)     LCD transfer and its processing delay finished
+//   export(bytes, ok)            Line flushed to the transcript
+
+#if !defined(MORSE_NO_PROBES) && defined(__GNUC__) && defined(__ELF__)
+
+#if __SIZEOF_POINTER__ == 8
+#define MORSE_PROBE_PTR ".8byte"
+#else
+#define MORSE_PROBE_PTR ".4byte"
+#endif
+
+#if __SIZEOF_LONG__ == 8
+#define MORSE_PROBE_ARG(n) "-8@%[a" #n "]"
+#else
+#define MORSE_PROBE_ARG(n) "-4@%[a" #n "]"
+#endif
+
+// The nop, its note, and (once per object) the .stapsdt.base anchor the
+// tools use to correct for prelinking
+#define MORSE_PROBE_ASM(name, args, ...)                                      \
+    __asm__ __volatile__(                                                     \
+        "990: nop\n"                                                          \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n"                         \
+        ".balign 4\n"                                                         \
+        ".4byte 992f-991f, 994f-993f, 3\n"                                    \
+        "991: .asciz \"stapsdt\"\n"                                           \
+        "992: .balign 4\n"                                                    \
+        "993: " MORSE_PROBE_PTR " 990b\n"                                     \
+        MORSE_PROBE_PTR " _.stapsdt.base\n"                                   \
+        MORSE_PROBE_PTR " 0\n"                                                \
+        ".asciz \"morse\"\n"                                                  \
+        ".asciz \"" #name "\"\n"                                              \
+        ".asciz \"" args "\"\n"                                               \
+        "994: .balign 4\n"                                                    \
+        ".popsection\n"                                                       \
+        ".ifndef _.stapsdt.base\n"                                            \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+        ".weak _.stapsdt.base\n"                                              \
+        ".hidden _.stapsdt.base\n"                                            \
+        "_.stapsdt.base: .space 1\n"                                          \
+        ".size _.stapsdt.base, 1\n"                                           \
+        ".popsection\n"                                                       \
+        ".endif\n"                                                            \
+        :: __VA_ARGS__)
+
+// "nor": the argument stays wherever the compiler already has it
+#define MORSE_PROBE0(name) MORSE_PROBE_ASM(name, "", )
+#define MORSE_PROBE1(name, x1) \
+    MORSE_PROBE_ASM(name, MORSE_PROBE_ARG(1), [a1] "nor"((long)(x1)))
+#define MORSE_PROBE2(name, x1, x2)                                         \
+    MORSE_PROBE_ASM(name, MORSE_PROBE_ARG(1) " " MORSE_PROBE_ARG(2),      \
+                    [a1] "nor"((long)(x1)), [a2] "nor"((long)(x2)))
+#define MORSE_PROBE3(name, x1, x2, x3)                                                \
+    MORSE_PROBE_ASM(name, MORSE_PROBE_ARG(1) " " MORSE_PROBE_ARG(2) " " MORSE_PROBE_ARG(3), \
+                    [a1] "nor"((long)(x1)), [a2] "nor"((long)(x2)), [a3] "nor"((long)(x3)))
+
+#else
+
+#define MORSE_PROBE0(name) ((void)0)
+#define MORSE_PROBE1(name, x1) ((void)(x1))
+#define MORSE_PROBE2(name, x1, x2) ((void)(x1), (void)(x2))
+#define MORSE_PROBE3(name, x1, x2, x3) ((void)(x1), (void)(x2), (void)(x3))
+
+#endif
+
+#endif
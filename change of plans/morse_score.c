@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "key_trace.h"
+#include "trace_corpus.h"
+#include "trace_score.h"
+
+// Scores the decoder against a labelled corpus: character error rate, word
+// error rate, confusion matrix and per-operator breakdown. Traces are
+// decoded in parallel, and results are reported in corpus order, so two
+// runs on the same corpus and timing always print the same numbers. The
+// JSON carries the corpus checksum and timing to keep runs comparable.
+//
+// Usage: morse_score [-j threads] [-tick ms] [-dash ticks] [-gap ticks] [-o results.json] corpus.txt
+//
+// gcc -O2 -o morse_score morse_score.c trace_score.c trace_corpus.c key_trace.c morse_timing.c morse_decoder.c -lpthread
+
+#define MAX_OPERATORS 64
+#define TOP_CONFUSIONS 10
+
+typedef struct {
+    const TraceCorpus *corpus;
+    const MorseTiming *timing;
+    ScoreCounts *results;      // One per corpus entry
+    char (*decoded)[CORPUS_TEXT_MAX];
+    atomic_size_t next;
+    atomic_int failed;
+} ScoreJob;
+
+typedef struct {
+    const char *name;
+    ScoreCounts counts;
+    size_t traces;
+} OperatorScore;
+
+static void *score_worker(void *arg) {
+    ScoreJob *job = (ScoreJob *)arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->corpus->count) {
+        if (score_trace(&job->corpus->entries[i], job->timing, &job->results[i],
+                        job->decoded[i], CORPUS_TEXT_MAX) != 0) {
+            atomic_store(&job->failed, 1);
+        }
+    }
+    return NULL;
+}
+
+static void print_json_counts(FILE *out, const ScoreCounts *c) {
+    fprintf(out, "\"cer\": %.6f, \"wer\": %.6f, \"ref_chars\": %llu, \"decoded_chars\": %llu, "
+                 "\"substitutions\": %llu, \"insertions\": %llu, \"deletions\": %llu, "
+                 "\"ref_words\": %llu, \"word_errors\": %llu, \"mean_latency_ms\": %.1f, \"max_latency_ms\": %.1f",
+            score_cer(c), score_wer(c), (unsigned long long)c->ref_chars, (unsigned long long)c->hyp_chars,
+            (unsigned long long)c->substitutions, (unsigned long long)c->insertions,
+            (unsigned long long)c->deletions, (unsigned long long)c->ref_words, (unsigned long long)c->word_errors,
+            c->latency_count ? (double)c->latency_us_total / c->latency_count / 1000.0 : 0.0,
+            (double)c->latency_us_max / 1000.0);
+}
+
+// Function to print the most frequent off-diagonal confusion cells.
+// Clears each cell it prints, so pass a scratch copy.
+static void print_top_confusions(ScoreCounts *scratch) {
+    printf("Top confusions (reference -> decoded, _ = nothing):\n");
+    for (int shown = 0; shown < TOP_CONFUSIONS; shown++) {
+        uint32_t best = 0;
+        int best_r = 0, best_h = 0;
+        for (int r = 0; r < SCORE_SYMBOLS; r++) {
+            for (int h = 0; h < SCORE_SYMBOLS; h++) {
+                if (r != h && scratch->confusion[r][h] > best) {
+                    best = scratch->confusion[r][h];
+                    best_r = r;
+                    best_h = h;
+                }
+            }
+        }
+        if (best == 0) {
+            break;
+        }
+        printf("  %c -> %c  %u\n", score_symbol_char(best_r), score_symbol_char(best_h), best);
+        scratch->confusion[best_r][best_h] = 0;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    MorseTiming timing;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *corpus_path = NULL;
+    const char *output_path = NULL;
+
+    morse_timing_default(&timing);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-tick") == 0 && i + 1 < argc) {
+            timing.tick_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-dash") == 0 && i + 1 < argc) {
+            timing.dash_ticks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-gap") == 0 && i + 1 < argc) {
+            timing.gap_ticks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (argv[i][0] != '-' && corpus_path == NULL) {
+            corpus_path = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [-j threads] [-tick ms] [-dash ticks] [-gap ticks] [-o results.json] corpus.txt\n", argv[0]);
+            return -1;
+        }
+    }
+    if (corpus_path == NULL || timing.tick_ms <= 0) {
+        fprintf(stderr, "Usage: %s [-j threads] [-tick ms] [-dash ticks] [-gap ticks] [-o results.json] corpus.txt\n", argv[0]);
+        return -1;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    TraceCorpus corpus;
+    corpus_init(&corpus);
+    if (corpus_load(&corpus, corpus_path) != 0) {
+        corpus_free(&corpus);
+        return -1;
+    }
+
+    ScoreJob job;
+    job.corpus = &corpus;
+    job.timing = &timing;
+    job.results = calloc(corpus.count ? corpus.count : 1, sizeof(ScoreCounts));
+    job.decoded = calloc(corpus.count ? corpus.count : 1, CORPUS_TEXT_MAX);
+    atomic_init(&job.next, 0);
+    atomic_init(&job.failed, 0);
+    if (job.results == NULL || job.decoded == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    for (int t = 0; t < threads; t++) {
+        pthread_create(&tids[t], NULL, score_worker, &job);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    free(tids);
+    if (atomic_load(&job.failed)) {
+        fprintf(stderr, "Some traces could not be scored\n");
+    }
+
+    // Aggregate in corpus order so the output doesn't depend on scheduling
+    ScoreCounts total;
+    OperatorScore operators[MAX_OPERATORS];
+    int operator_count = 0;
+    memset(&total, 0, sizeof(total));
+    for (size_t i = 0; i < corpus.count; i++) {
+        const char *name = corpus.entries[i].operator_name;
+        int o = 0;
+        while (o < operator_count && strcmp(operators[o].name, name) != 0) {
+            o++;
+        }
+        if (o == operator_count && operator_count < MAX_OPERATORS) {
+            operators[o].name = name;
+            operators[o].traces = 0;
+            memset(&operators[o].counts, 0, sizeof(ScoreCounts));
+            operator_count++;
+        }
+        if (o < operator_count) {
+            score_add(&operators[o].counts, &job.results[i]);
+            operators[o].traces++;
+        }
+        score_add(&total, &job.results[i]);
+    }
+
+    printf("Corpus %s (%zu traces, checksum %08x), tick %d ms, dash %d ticks, gap %d ticks\n",
+           corpus_path, corpus.count, corpus.checksum, timing.tick_ms, timing.dash_ticks, timing.gap_ticks);
+    printf("%-16s %6s %8s %8s %8s %10s\n", "operator", "traces", "chars", "CER", "WER", "latency");
+    for (int o = 0; o < operator_count; o++) {
+        const ScoreCounts *c = &operators[o].counts;
+        printf("%-16s %6zu %8llu %7.2f%% %7.2f%% %8.0fms\n", operators[o].name[0] ? operators[o].name : "-",
+               operators[o].traces, (unsigned long long)c->ref_chars, 100.0 * score_cer(c), 100.0 * score_wer(c),
+               c->latency_count ? (double)c->latency_us_total / c->latency_count / 1000.0 : 0.0);
+    }
+    printf("%-16s %6zu %8llu %7.2f%% %7.2f%% %8.0fms\n", "total", corpus.count,
+           (unsigned long long)total.ref_chars, 100.0 * score_cer(&total), 100.0 * score_wer(&total),
+           total.latency_count ? (double)total.latency_us_total / total.latency_count / 1000.0 : 0.0);
+
+    if (output_path != NULL) {
+        FILE *out = fopen(output_path, "w");
+        if (out == NULL) {
+            perror("Failed to open output file");
+            return -1;
+        }
+        fprintf(out, "{\n  \"corpus\": {\"path\": \"%s\", \"traces\": %zu, \"checksum\": \"%08x\"},\n",
+                corpus_path, corpus.count, corpus.checksum);
+        fprintf(out, "  \"timing\": {\"tick_ms\": %d, \"dash_ticks\": %d, \"gap_ticks\": %d},\n",
+                timing.tick_ms, timing.dash_ticks, timing.gap_ticks);
+        fprintf(out, "  \"total\": {");
+        print_json_counts(out, &total);
+        fprintf(out, "},\n  \"operators\": {\n");
+        for (int o = 0; o < operator_count; o++) {
+            fprintf(out, "    \"%s\": {\"traces\": %zu, ", operators[o].name, operators[o].traces);
+            print_json_counts(out, &operators[o].counts);
+            fprintf(out, "}%s\n", o + 1 < operator_count ? "," : "");
+        }
+        fprintf(out, "  },\n  \"traces\": [\n");
+        for (size_t i = 0; i < corpus.count; i++) {
+            fprintf(out, "    {\"id\": \"%s\", \"operator\": \"%s\", \"decoded\": \"%s\", ",
+                    corpus.entries[i].id, corpus.entries[i].operator_name, job.decoded[i]);
+            print_json_counts(out, &job.results[i]);
+            fprintf(out, "}%s\n", i + 1 < corpus.count ? "," : "");
+        }
+        fprintf(out, "  ],\n  \"confusion\": [");
+        int first = 1;
+        for (int r = 0; r < SCORE_SYMBOLS; r++) {
+            for (int h = 0; h < SCORE_SYMBOLS; h++) {
+                if (total.confusion[r][h] != 0) {
+                    fprintf(out, "%s\n    {\"ref\": \"%c\", \"decoded\": \"%c\", \"count\": %u}", first ? "" : ",",
+                            score_symbol_char(r), score_symbol_char(h), total.confusion[r][h]);
+                    first = 0;
+                }
+            }
+        }
+        fprintf(out, "\n  ]\n}\n");
+        fclose(out);
+    }
+
+    ScoreCounts scratch = total;
+    print_top_confusions(&scratch);
+
+    free(job.results);
+    free(job.decoded);
+    corpus_free(&corpus);
+    return 0;
+}
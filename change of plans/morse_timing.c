@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <string.h>
+#include "morse_timing.h"
+
+int morse_tick_ms = MORSE_TICK_MS;
+int morse_dash_ticks = MORSE_DASH_TICKS;
+int morse_gap_ticks = MORSE_GAP_TICKS;
+
+void morse_timing_default(MorseTiming *timing) {
+    timing->tick_ms = MORSE_TICK_MS;
+    timing->dash_ticks = MORSE_DASH_TICKS;
+    timing->gap_ticks = MORSE_GAP_TICKS;
+}
+
+// Function to read profile number index (0 = first) from a profile file.
+// Returns 0 on success, -1 if the file can't be read or has no such profile.
+int morse_timing_load(const char *path, int index, MorseTiming *timing) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    char line[256];
+    int found = -1;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        MorseTiming t;
+        if (strncmp(line, "profile ", 8) != 0 ||
+            sscanf(line + 8, "%d %d %d", &t.tick_ms, &t.dash_ticks, &t.gap_ticks) != 3) {
+            continue;
+        }
+        if (t.tick_ms <= 0 || t.dash_ticks <= 0 || t.gap_ticks <= 0) {
+            fprintf(stderr, "%s: ignoring invalid profile\n", path);
+            continue;
+        }
+        if (index-- == 0) {
+            *timing = t;
+            found = 0;
+            break;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+// Function to make the sampling loop use a timing (call before morse_code_main)
+void morse_timing_apply(const MorseTiming *timing) {
+    morse_tick_ms = timing->tick_ms;
+    morse_dash_ticks = timing->dash_ticks;
+    morse_gap_ticks = timing->gap_ticks;
+}
@@ -0,0 +1,33 @@
+#ifndef MORSE_TIMING_H
+#define MORSE_TIMING_H
+
+// Timing of the assembly sampling loop. morse_code_main reads the three
+// globals below on every tick, so a profile loaded before the loop starts
+// (or produced by morse_tune) takes effect without rebuilding.
+//
+// Profile file, one profile per line, best accuracy first:
+//   # tick_ms dash_ticks gap_ticks cer mean_latency_ms
+//   profile 50 10 40 0.0000 2137.5
+
+#define MORSE_TICK_MS 50      // delay_ms(50) between samples
+#define MORSE_DASH_TICKS 10   // Presses this many ticks long are dashes
+#define MORSE_GAP_TICKS 40    // Idle this many ticks ends the character
+
+#define MORSE_TIMING_FILE "morse_timing.conf"
+
+typedef struct {
+    int tick_ms;
+    int dash_ticks;
+    int gap_ticks;
+} MorseTiming;
+
+// Read by morse_code_logic_active_state.s
+extern int morse_tick_ms;
+extern int morse_dash_ticks;
+extern int morse_gap_ticks;
+
+void morse_timing_default(MorseTiming *timing);
+int morse_timing_load(const char *path, int index, MorseTiming *timing);
+void morse_timing_apply(const MorseTiming *timing);
+
+#endif
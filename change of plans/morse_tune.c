@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "key_trace.h"
+#include "morse_timing.h"
+#include "trace_corpus.h"
+#include "trace_score.h"
+#include "work_pool.h"
+
+// Searches the sampling-loop timing (tick length, dash threshold, gap
+// threshold) for the best trade-off between character error rate and decode
+// latency on a labelled corpus. Every (timing, trace) pair is one task on a
+// work-stealing pool, and no hardware is needed. The Pareto set is written as
+// a profile file that the interpreter and morse_machine load at start.
+//
+// Usage: morse_tune [-search grid|descent] [-tick lo:hi:step] [-dash lo:hi:step]
+//                   [-gap lo:hi:step] [-operator NAME] [-j threads] [-o morse_timing.conf] corpus.txt
+//
+// gcc -O2 -o morse_tune morse_tune.c work_pool.c trace_score.c trace_corpus.c key_trace.c morse_timing.c morse_decoder.c -lpthread
+
+#define MAX_CANDIDATES 65536
+#define MAX_DESCENT_ROUNDS 10
+
+typedef struct {
+    int lo;
+    int hi;
+    int step;
+} Range;
+
+typedef struct {
+    MorseTiming timing;
+    int evaluated;
+    atomic_ullong edits;
+    atomic_ullong ref_chars;
+    atomic_ullong latency_us_total;
+    atomic_ullong latency_count;
+    double cer;
+    double latency_ms;
+} Candidate;
+
+typedef struct {
+    Candidate *candidate;
+    const LabelledTrace *entry;
+} EvalTask;
+
+Candidate *candidates;
+int candidate_count = 0;
+
+// Latency weights (CER per second of latency) for the descent runs; 0 = accuracy only
+static const double descent_weights[] = {0.0, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5};
+
+static int parse_range(const char *s, Range *r) {
+    int n = sscanf(s, "%d:%d:%d", &r->lo, &r->hi, &r->step);
+    if (n == 1) {
+        r->hi = r->lo;
+        r->step = 1;
+    } else if (n == 2) {
+        r->step = 1;
+    } else if (n != 3) {
+        return -1;
+    }
+    return r->lo > 0 && r->hi >= r->lo && r->step > 0 ? 0 : -1;
+}
+
+static int clamp_to_range(int v, const Range *r) {
+    if (v <= r->lo) {
+        return r->lo;
+    }
+    if (v >= r->hi) {
+        return r->hi;
+    }
+    return r->lo + (v - r->lo) / r->step * r->step;
+}
+
+// Function to find a timing's candidate, adding it if it's new
+static Candidate *candidate_for(const MorseTiming *t) {
+    for (int i = 0; i < candidate_count; i++) {
+        const MorseTiming *c = &candidates[i].timing;
+        if (c->tick_ms == t->tick_ms && c->dash_ticks == t->dash_ticks && c->gap_ticks == t->gap_ticks) {
+            return &candidates[i];
+        }
+    }
+    if (candidate_count == MAX_CANDIDATES) {
+        return NULL;
+    }
+    Candidate *c = &candidates[candidate_count++];
+    memset(c, 0, sizeof(*c));
+    c->timing = *t;
+    return c;
+}
+
+static void eval_task(void *arg) {
+    EvalTask *task = (EvalTask *)arg;
+    ScoreCounts counts;
+    Candidate *c = task->candidate;
+
+    if (score_trace(task->entry, &c->timing, &counts, NULL, 0) != 0) {
+        return;
+    }
+    atomic_fetch_add_explicit(&c->edits, counts.substitutions + counts.insertions + counts.deletions, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->ref_chars, counts.ref_chars, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->latency_us_total, counts.latency_us_total, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->latency_count, counts.latency_count, memory_order_relaxed);
+}
+
+// Function to score every not-yet-evaluated candidate in the list on every trace
+static void evaluate(WorkPool *pool, Candidate **list, int count, const LabelledTrace **traces, size_t trace_count) {
+    EvalTask *tasks = malloc((size_t)count * trace_count * sizeof(EvalTask));
+    size_t n = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (list[i]->evaluated) {
+            continue;
+        }
+        for (size_t j = 0; j < trace_count; j++) {
+            tasks[n].candidate = list[i];
+            tasks[n].entry = traces[j];
+            work_pool_submit(pool, eval_task, &tasks[n]);
+            n++;
+        }
+    }
+    work_pool_wait(pool);
+    free(tasks);
+
+    for (int i = 0; i < count; i++) {
+        Candidate *c = list[i];
+        if (c->evaluated) {
+            continue;
+        }
+        unsigned long long ref = atomic_load(&c->ref_chars);
+        unsigned long long lat_n = atomic_load(&c->latency_count);
+        c->cer = ref ? (double)atomic_load(&c->edits) / (double)ref : 0.0;
+        c->latency_ms = lat_n ? (double)atomic_load(&c->latency_us_total) / (double)lat_n / 1000.0 : 0.0;
+        c->evaluated = 1;
+    }
+}
+
+static double objective(const Candidate *c, double weight) {
+    return c->cer + weight * c->latency_ms / 1000.0;
+}
+
+// Function for coordinate descent: along one parameter at a time, move to the best value
+static void descend(WorkPool *pool, const Range ranges[3], const LabelledTrace **traces, size_t trace_count, double weight) {
+    MorseTiming current;
+    morse_timing_default(&current);
+    current.tick_ms = clamp_to_range(current.tick_ms, &ranges[0]);
+    current.dash_ticks = clamp_to_range(current.dash_ticks, &ranges[1]);
+    current.gap_ticks = clamp_to_range(current.gap_ticks, &ranges[2]);
+
+    for (int round = 0; round < MAX_DESCENT_ROUNDS; round++) {
+        int moved = 0;
+        for (int dim = 0; dim < 3; dim++) {
+            Candidate *line[1024];
+            int count = 0;
+            for (int v = ranges[dim].lo; v <= ranges[dim].hi && count < 1024; v += ranges[dim].step) {
+                MorseTiming t = current;
+                int *field = dim == 0 ? &t.tick_ms : dim == 1 ? &t.dash_ticks : &t.gap_ticks;
+                *field = v;
+                Candidate *c = candidate_for(&t);
+                if (c != NULL) {
+                    line[count++] = c;
+                }
+            }
+            evaluate(pool, line, count, traces, trace_count);
+
+            Candidate *best = candidate_for(&current);  // NULL once the candidate table is full
+            for (int i = 0; i < count; i++) {
+                if (best == NULL || objective(line[i], weight) < objective(best, weight)) {
+                    best = line[i];
+                }
+            }
+            if (best == NULL) {
+                fprintf(stderr, "Candidate table full, stopping the descent\n");
+                return;  // Keep what has been scored so far
+            }
+            if (memcmp(&best->timing, &current, sizeof(current)) != 0) {
+                current = best->timing;
+                moved = 1;
+            }
+        }
+        if (!moved) {
+            break;
+        }
+    }
+}
+
+static int compare_pareto(const void *a, const void *b) {
+    const Candidate *x = *(Candidate *const *)a;
+    const Candidate *y = *(Candidate *const *)b;
+    if (x->cer != y->cer) {
+        return x->cer < y->cer ? -1 : 1;
+    }
+    return (x->latency_ms > y->latency_ms) - (x->latency_ms < y->latency_ms);
+}
+
+int main(int argc, char *argv[]) {
+    Range ranges[3] = {{MORSE_TICK_MS, MORSE_TICK_MS, 1}, {4, 16, 1}, {8, 60, 2}};
+    const char *search = "descent";
+    const char *operator_name = NULL;
+    const char *corpus_path = NULL;
+    const char *output_path = MORSE_TIMING_FILE;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i++) {
+        int bad = 0;
+        if (strcmp(argv[i], "-search") == 0 && i + 1 < argc) {
+            search = argv[++i];
+        } else if (strcmp(argv[i], "-tick") == 0 && i + 1 < argc) {
+            bad = parse_range(argv[++i], &ranges[0]);
+        } else if (strcmp(argv[i], "-dash") == 0 && i + 1 < argc) {
+            bad = parse_range(argv[++i], &ranges[1]);
+        } else if (strcmp(argv[i], "-gap") == 0 && i + 1 < argc) {
+            bad = parse_range(argv[++i], &ranges[2]);
+        } else if (strcmp(argv[i], "-operator") == 0 && i + 1 < argc) {
+            operator_name = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (argv[i][0] != '-' && corpus_path == NULL) {
+            corpus_path = argv[i];
+        } else {
+            bad = 1;
+        }
+        if (bad) {
+            fprintf(stderr, "Usage: %s [-search grid|descent] [-tick lo:hi:step] [-dash lo:hi:step] [-gap lo:hi:step]\n"
+                            "       [-operator NAME] [-j threads] [-o profile.conf] corpus.txt\n", argv[0]);
+            return -1;
+        }
+    }
+    if (corpus_path == NULL || (strcmp(search, "grid") != 0 && strcmp(search, "descent") != 0)) {
+        fprintf(stderr, "Need a corpus, and -search must be grid or descent\n");
+        return -1;
+    }
+
+    TraceCorpus corpus;
+    corpus_init(&corpus);
+    if (corpus_load(&corpus, corpus_path) != 0) {
+        corpus_free(&corpus);
+        return -1;
+    }
+    const LabelledTrace **traces = malloc((corpus.count ? corpus.count : 1) * sizeof(LabelledTrace *));
+    size_t trace_count = 0;
+    for (size_t i = 0; i < corpus.count; i++) {
+        if (operator_name == NULL || strcmp(corpus.entries[i].operator_name, operator_name) == 0) {
+            traces[trace_count++] = &corpus.entries[i];
+        }
+    }
+    if (trace_count == 0) {
+        fprintf(stderr, "No traces to tune on\n");
+        return -1;
+    }
+
+    candidates = calloc(MAX_CANDIDATES, sizeof(Candidate));
+    WorkPool *pool = work_pool_create(threads);
+    if (candidates == NULL || pool == NULL) {
+        fprintf(stderr, "Failed to set up the tuner\n");
+        return -1;
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    if (strcmp(search, "grid") == 0) {
+        Candidate **all = malloc(MAX_CANDIDATES * sizeof(Candidate *));
+        int count = 0;
+        for (int tick = ranges[0].lo; tick <= ranges[0].hi; tick += ranges[0].step) {
+            for (int dash = ranges[1].lo; dash <= ranges[1].hi; dash += ranges[1].step) {
+                for (int gap = ranges[2].lo; gap <= ranges[2].hi; gap += ranges[2].step) {
+                    MorseTiming t = {tick, dash, gap};
+                    Candidate *c = candidate_for(&t);
+                    if (c != NULL) {
+                        all[count++] = c;
+                    }
+                }
+            }
+        }
+        evaluate(pool, all, count, traces, trace_count);
+        free(all);
+    } else {
+        for (size_t w = 0; w < sizeof(descent_weights) / sizeof(descent_weights[0]); w++) {
+            descend(pool, ranges, traces, trace_count, descent_weights[w]);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    size_t steals = work_pool_steals(pool);
+    work_pool_destroy(pool);
+
+    // Pareto set: sorted by CER, keep each config that is faster than everything more accurate
+    Candidate **sorted = malloc(candidate_count * sizeof(Candidate *));
+    for (int i = 0; i < candidate_count; i++) {
+        sorted[i] = &candidates[i];
+    }
+    qsort(sorted, candidate_count, sizeof(Candidate *), compare_pareto);
+
+    FILE *out = fopen(output_path, "w");
+    if (out == NULL) {
+        perror("Failed to write profile");
+        return -1;
+    }
+    fprintf(out, "# Morse timing profiles from morse_tune (%s search, %zu traces of %s%s%s)\n",
+            search, trace_count, corpus_path, operator_name ? ", operator " : "", operator_name ? operator_name : "");
+    fprintf(out, "# Pareto set of CER vs mean decode latency, most accurate first; the first profile is used\n");
+    fprintf(out, "# tick_ms dash_ticks gap_ticks cer mean_latency_ms\n");
+
+    printf("%d configurations x %zu traces in %.2f s on %d threads (%zu steals)\n",
+           candidate_count, trace_count, elapsed, threads, steals);
+    printf("%8s %10s %9s %8s %12s\n", "tick_ms", "dash_ticks", "gap_ticks", "CER", "latency_ms");
+    double best_latency = -1.0;
+    for (int i = 0; i < candidate_count; i++) {
+        const Candidate *c = sorted[i];
+        if (best_latency >= 0.0 && c->latency_ms >= best_latency) {
+            continue;  // Dominated: something at least as accurate is also faster
+        }
+        best_latency = c->latency_ms;
+        fprintf(out, "profile %d %d %d %.4f %.1f\n", c->timing.tick_ms, c->timing.dash_ticks, c->timing.gap_ticks,
+                c->cer, c->latency_ms);
+        printf("%8d %10d %9d %7.2f%% %12.1f\n", c->timing.tick_ms, c->timing.dash_ticks, c->timing.gap_ticks,
+               100.0 * c->cer, c->latency_ms);
+    }
+    fclose(out);
+    printf("Wrote %s\n", output_path);
+
+    free(sorted);
+    free(candidates);
+    free(traces);
+    corpus_free(&corpus);
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <string.h>
+#include "multi_key.h"
+
+#define MULTI_KEY_FLUSH_US 60000000ULL  // Past every debounce window and gap
+
+// Function to keep a channel's pending bit in step with its filter and classifier
+static void update_pending(MultiKey *mk, MultiKeyChannel *ch) {
+    uint32_t bit = 1U << ch->pin;
+    if (ch->filter.raw != ch->filter.out || ch->classifier.gap_due) {
+        mk->pending |= bit;
+    } else {
+        mk->pending &= ~bit;
+    }
+}
+
+static void channel_signal(int signal, uint64_t t_us, void *ctx) {
+    MultiKeyChannel *ch = (MultiKeyChannel *)ctx;
+    MultiKey *mk = ch->owner;
+    char c = 0;
+
+    if (signal == MORSE_SIGNAL_DOT) {
+        ch->stats.dots++;
+    } else if (signal == MORSE_SIGNAL_DASH) {
+        ch->stats.dashes++;
+    }
+    int event = morse_decoder_signal(&ch->decoder, signal, &c);
+    if (event == MORSE_EVENT_CHAR) {
+        ch->stats.chars++;
+        if (c == '?') {
+            ch->stats.unknown++;
+        }
+        mk->output(ch->pin, event, c, NULL, t_us, mk->ctx);
+    } else if (event == MORSE_EVENT_LINE) {
+        ch->stats.lines++;
+        mk->output(ch->pin, event, 0, ch->decoder.text_buffer, t_us, mk->ctx);
+    }
+}
+
+// Debounced edges go on to the channel's classifier
+static void channel_edge(int pin, uint64_t t_us, int level, void *ctx) {
+    MultiKeyChannel *ch = (MultiKeyChannel *)ctx;
+    (void)pin;
+    if (level) {
+        ch->press_start_us = t_us;
+    } else {
+        ch->stats.press_us += t_us - ch->press_start_us;
+    }
+    edge_classifier_edge(&ch->classifier, t_us, level);
+}
+
+// Function to start every pin in pin_mask from its bit in the first word
+void multi_key_init(MultiKey *mk, uint32_t pin_mask, uint32_t levels, const MorseTiming *timing,
+                    const DebounceConfig *debounce, MultiKeyOutput output, void *ctx) {
+    memset(mk, 0, sizeof(*mk));
+    mk->pin_mask = pin_mask;
+    mk->levels = levels & pin_mask;
+    mk->output = output;
+    mk->ctx = ctx;
+    for (int pin = 0; pin < MULTI_KEY_CHANNELS; pin++) {
+        if (pin_mask & (1U << pin)) {
+            multi_key_configure(mk, pin, timing, debounce);
+        }
+    }
+}
+
+// Function to give one channel its own timing and debounce (a fresh start
+// from the pin's current level)
+void multi_key_configure(MultiKey *mk, int pin, const MorseTiming *timing, const DebounceConfig *debounce) {
+    MultiKeyChannel *ch = &mk->channels[pin];
+    int level = (mk->levels >> pin) & 1;
+    memset(ch, 0, sizeof(*ch));
+    ch->owner = mk;
+    ch->pin = pin;
+    morse_decoder_init(&ch->decoder);
+    edge_classifier_init(&ch->classifier, timing, channel_signal, ch);
+    ch->classifier.level = level;
+    debounce_init(&ch->filter, debounce, pin, level, channel_edge, ch);
+    update_pending(mk, ch);
+}
+
+// Function to feed one GPLEV0 word. Unchanged pins cost nothing beyond the
+// XOR; changed pins are visited lowest first.
+void multi_key_sample(MultiKey *mk, uint64_t t_us, uint32_t levels) {
+    uint32_t changed = (levels ^ mk->levels) & mk->pin_mask;
+    mk->samples++;
+    if (changed == 0) {
+        return;
+    }
+    mk->levels ^= changed;
+
+    while (changed) {
+        int pin = __builtin_ctz(changed);
+        changed &= changed - 1;
+        MultiKeyChannel *ch = &mk->channels[pin];
+        ch->stats.edges++;
+        debounce_edge(&ch->filter, t_us, (levels >> pin) & 1);
+        update_pending(mk, ch);
+    }
+}
+
+// Function to let due filtered edges and gaps through on the channels that
+// owe one; call periodically (every millisecond is plenty)
+void multi_key_poll(MultiKey *mk, uint64_t now_us) {
+    uint32_t pins = mk->pending;
+    while (pins) {
+        int pin = __builtin_ctz(pins);
+        pins &= pins - 1;
+        MultiKeyChannel *ch = &mk->channels[pin];
+        debounce_poll(&ch->filter, now_us);
+        edge_classifier_poll(&ch->classifier, now_us);
+        update_pending(mk, ch);
+    }
+}
+
+// Function to finish every channel's last edge and character after the
+// final word (end of a replay or shutdown)
+void multi_key_flush(MultiKey *mk, uint64_t last_us) {
+    multi_key_poll(mk, last_us + MULTI_KEY_FLUSH_US);
+    multi_key_poll(mk, last_us + 2 * MULTI_KEY_FLUSH_US);
+}
+
+void multi_key_report(const MultiKey *mk, FILE *out) {
+    fprintf(out, "GPIO  edges  glitches  dots  dashes  chars  unknown  lines  mean press ms\n");
+    for (int pin = 0; pin < MULTI_KEY_CHANNELS; pin++) {
+        if (!(mk->pin_mask & (1U << pin))) {
+            continue;
+        }
+        const MultiKeyChannel *ch = &mk->channels[pin];
+        const MultiKeyStats *s = &ch->stats;
+        uint64_t elements = s->dots + s->dashes;
+        fprintf(out, "%4d  %5llu  %8llu  %4llu  %6llu  %5llu  %7llu  %5llu  %13.1f\n", pin,
+                (unsigned long long)s->edges, (unsigned long long)ch->filter.glitches, (unsigned long long)s->dots,
+                (unsigned long long)s->dashes, (unsigned long long)s->chars, (unsigned long long)s->unknown,
+                (unsigned long long)s->lines, elements ? (double)s->press_us / elements / 1000.0 : 0.0);
+    }
+    fprintf(out, "%llu words\n", (unsigned long long)mk->samples);
+}
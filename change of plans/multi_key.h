@@ -0,0 +1,65 @@
+#ifndef MULTI_KEY_H
+#define MULTI_KEY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "debounce.h"
+#include "edge_sampler.h"
+#include "morse_decoder.h"
+#include "morse_timing.h"
+
+// Decoder for up to 32 straight keys on GPIO bank 0, one channel per pin,
+// fed with the whole GPLEV0 word (XOR it with the pin map's invert_mask
+// first, so 1 is pressed on every pin). Each sample costs one XOR against the
+// previous word, masked to the keyed pins. Only the pins whose bits
+// changed are visited (lowest set bit first), so sixteen idle keys cost
+// the same as one. Every channel has its own debounce filter, edge
+// classifier, text decoder and stats. A `pending` mask lists the channels
+// that still owe an edge or a gap, and multi_key_poll visits only those.
+
+#define MULTI_KEY_CHANNELS 32
+
+typedef struct {
+    uint64_t edges;         // Raw level changes
+    uint64_t dots;
+    uint64_t dashes;
+    uint64_t chars;
+    uint64_t unknown;       // Characters decoded as '?'
+    uint64_t lines;
+    uint64_t press_us;      // Total debounced press time
+} MultiKeyStats;
+
+// Called for every decoded character (c) and line end (text holds the line)
+typedef void (*MultiKeyOutput)(int pin, int event, char c, const char *text, uint64_t t_us, void *ctx);
+
+struct MultiKey;
+
+typedef struct {
+    struct MultiKey *owner;
+    int pin;
+    Debouncer filter;
+    EdgeClassifier classifier;
+    MorseDecoder decoder;
+    uint64_t press_start_us;
+    MultiKeyStats stats;
+} MultiKeyChannel;
+
+typedef struct MultiKey {
+    uint32_t pin_mask;
+    uint32_t levels;        // Last raw word, keyed pins only
+    uint32_t pending;       // Channels with a filtered edge or a gap still due
+    uint64_t samples;       // Words fed
+    MultiKeyOutput output;
+    void *ctx;
+    MultiKeyChannel channels[MULTI_KEY_CHANNELS];  // Indexed by pin
+} MultiKey;
+
+void multi_key_init(MultiKey *mk, uint32_t pin_mask, uint32_t levels, const MorseTiming *timing,
+                    const DebounceConfig *debounce, MultiKeyOutput output, void *ctx);
+void multi_key_configure(MultiKey *mk, int pin, const MorseTiming *timing, const DebounceConfig *debounce);
+void multi_key_sample(MultiKey *mk, uint64_t t_us, uint32_t levels);
+void multi_key_poll(MultiKey *mk, uint64_t now_us);
+void multi_key_flush(MultiKey *mk, uint64_t last_us);
+void multi_key_report(const MultiKey *mk, FILE *out);
+
+#endif
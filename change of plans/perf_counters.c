@@ -0,0 +1,170 @@
+#include "perf_counters.h"
+
+#ifdef MORSE_PERF
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+typedef struct {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+} CounterSpec;
+
+static const CounterSpec counter_specs[PERF_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache-misses"},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "ctx-switches"},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, "page-faults"},
+};
+
+static const char *region_names[PERF_REGIONS] = {"poll", "translate", "lcd_send_text", "export"};
+
+static atomic_uint_fast64_t region_calls[PERF_REGIONS];
+static atomic_uint_fast64_t region_totals[PERF_REGIONS][PERF_COUNTERS];
+static atomic_int counter_seen[PERF_COUNTERS];  // Some thread managed to open this counter
+
+// Per-thread group: leader fd, and where each counter sits in the group read
+static _Thread_local int group_fd = -1;
+static _Thread_local int group_state;  // 0 = not tried, 1 = open, -1 = unavailable
+static _Thread_local int group_slot[PERF_COUNTERS];
+static _Thread_local int group_size;
+
+static int open_counter(const CounterSpec *spec, int leader, int exclude_kernel) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec->type;
+    attr.config = spec->config;
+    attr.disabled = leader == -1;  // The leader starts the whole group at once
+    attr.exclude_kernel = exclude_kernel;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC);
+}
+
+// Function to open this thread's counter group; counters the CPU or kernel
+// refuses are left out of the group rather than failing it
+static void open_group(void) {
+    group_state = -1;
+    for (int exclude_kernel = 0; exclude_kernel <= 1 && group_state != 1; exclude_kernel++) {
+        group_size = 0;
+        group_fd = -1;
+        for (int i = 0; i < PERF_COUNTERS; i++) {
+            group_slot[i] = -1;
+            int fd = open_counter(&counter_specs[i], group_fd, exclude_kernel);
+            if (fd < 0) {
+                continue;
+            }
+            if (group_fd == -1) {
+                group_fd = fd;
+            }
+            group_slot[i] = group_size++;
+            atomic_store(&counter_seen[i], 1);
+        }
+        if (group_fd != -1) {
+            ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            group_state = 1;
+        }
+    }
+    if (group_state != 1) {
+        perror("perf_event_open");
+    }
+}
+
+// Function to read every counter in this thread's group with one syscall
+static int read_group(uint64_t *values) {
+    uint64_t buf[1 + PERF_COUNTERS];
+    if (group_state == 0) {
+        open_group();
+    }
+    if (group_state != 1 || read(group_fd, buf, sizeof(buf)) < (ssize_t)sizeof(uint64_t)) {
+        return -1;
+    }
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        values[i] = group_slot[i] >= 0 && (uint64_t)group_slot[i] < buf[0] ? buf[1 + group_slot[i]] : 0;
+    }
+    return 0;
+}
+
+void perf_region_begin(PerfSample *sample) {
+    sample->valid = read_group(sample->v) == 0;
+}
+
+void perf_region_end(int region, const PerfSample *sample) {
+    uint64_t now[PERF_COUNTERS];
+    if (!sample->valid || read_group(now) != 0) {
+        return;
+    }
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        atomic_fetch_add_explicit(&region_totals[region][i], now[i] - sample->v[i], memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&region_calls[region], 1, memory_order_relaxed);
+}
+
+// Function to print per-region totals and per-call averages
+void perf_counters_dump(FILE *out) {
+    fprintf(out, "%-14s %10s %14s %14s %6s %12s %12s %12s\n", "region", "calls",
+            "cycles/call", "instr/call", "IPC", "misses/call", "ctx-switches", "page-faults");
+    for (int r = 0; r < PERF_REGIONS; r++) {
+        uint64_t calls = atomic_load(&region_calls[r]);
+        uint64_t t[PERF_COUNTERS];
+        for (int i = 0; i < PERF_COUNTERS; i++) {
+            t[i] = atomic_load(&region_totals[r][i]);
+        }
+        double per = calls ? (double)calls : 1.0;
+        fprintf(out, "%-14s %10llu %14.0f %14.0f %6.2f %12.1f %12llu %12llu\n", region_names[r],
+                (unsigned long long)calls, t[PERF_CYCLES] / per, t[PERF_INSTRUCTIONS] / per,
+                t[PERF_CYCLES] ? (double)t[PERF_INSTRUCTIONS] / (double)t[PERF_CYCLES] : 0.0,
+                t[PERF_CACHE_MISSES] / per, (unsigned long long)t[PERF_CONTEXT_SWITCHES],
+                (unsigned long long)t[PERF_PAGE_FAULTS]);
+    }
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (!atomic_load(&counter_seen[i])) {
+            fprintf(out, "(%s not available on this system)\n", counter_specs[i].name);
+        }
+    }
+    fflush(out);
+}
+
+static void dump_at_exit(void) {
+    perf_counters_dump(stderr);
+}
+
+static void *dump_thread(void *arg) {
+    sigset_t *set = (sigset_t *)arg;
+    int sig;
+    while (sigwait(set, &sig) == 0) {
+        perf_counters_dump(stderr);
+    }
+    return NULL;
+}
+
+// Function to dump the totals at exit and on SIGUSR1. Call before creating
+// other threads so they all inherit SIGUSR1 blocked and only the dump thread sees it.
+int perf_counters_init(void) {
+    static sigset_t set;
+    pthread_t tid;
+
+    atexit(dump_at_exit);
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    if (pthread_create(&tid, NULL, dump_thread, &set) != 0) {
+        perror("Failed to start perf dump thread");
+        return -1;
+    }
+    pthread_detach(tid);
+    return 0;
+}
+
+#endif
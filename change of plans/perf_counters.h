@@ -0,0 +1,62 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Hardware counters around named regions of the pipeline. Each thread that
+// enters a region opens one perf_event_open group (cycles, instructions,
+// cache misses, context switches, page faults) and the group is read with a
+// single read() at both ends of the region; the difference is added to the
+// region's totals. Totals are printed to stderr at exit, on SIGUSR1, or with
+// perf_counters_dump().
+//
+// Build with -DMORSE_PERF to enable; otherwise every macro compiles away.
+// Kernel-side events (context switches, page faults) need root or
+// /proc/sys/kernel/perf_event_paranoid <= 1; without that only user-space
+// counts are taken and those columns read 0.
+
+#define PERF_REGION_POLL 0        // One iteration of the morse_code_main sampling loop
+#define PERF_REGION_TRANSLATE 1   // translate_morse_to_english
+#define PERF_REGION_LCD_TEXT 2    // lcd_send_text
+#define PERF_REGION_EXPORT 3      // Appending a finished line to the transcript
+#define PERF_REGIONS 4
+
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_CACHE_MISSES 2
+#define PERF_CONTEXT_SWITCHES 3
+#define PERF_PAGE_FAULTS 4
+#define PERF_COUNTERS 5
+
+#ifdef MORSE_PERF
+
+typedef struct {
+    uint64_t v[PERF_COUNTERS];
+    int valid;  // 0 if this thread has no counters (open failed)
+} PerfSample;
+
+#define PERF_BEGIN(sample) perf_region_begin(sample)
+#define PERF_END(region, sample) perf_region_end((region), (sample))
+
+int perf_counters_init(void);
+void perf_region_begin(PerfSample *sample);
+void perf_region_end(int region, const PerfSample *sample);
+void perf_counters_dump(FILE *out);
+
+#else
+
+typedef struct {
+    char unused;
+} PerfSample;
+
+#define PERF_BEGIN(sample) ((void)(sample))
+#define PERF_END(region, sample) ((void)(sample))
+static inline int perf_counters_init(void) {
+    return 0;
+}
+#define perf_counters_dump(out) ((void)(out))
+
+#endif
+
+#endif
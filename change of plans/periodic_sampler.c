@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include "periodic_sampler.h"
+
+#define NS_PER_SEC 1000000000ULL
+
+static uint64_t ts_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * NS_PER_SEC + (uint64_t)ts->tv_nsec;
+}
+
+static struct timespec ns_ts(uint64_t ns) {
+    struct timespec ts = {(time_t)(ns / NS_PER_SEC), (long)(ns % NS_PER_SEC)};
+    return ts;
+}
+
+// Function to set up a sampler; falls back to clock_nanosleep when timerfd
+// is unavailable, so it only fails on bad input
+int sampler_init(PeriodicSampler *s) {
+    memset(s, 0, sizeof(*s));
+    s->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (s->fd < 0) {
+        perror("timerfd_create (using clock_nanosleep)");
+    }
+    return 0;
+}
+
+// Function to start (or restart with a new period) the tick grid; the first
+// tick is one period from now
+int sampler_start(PeriodicSampler *s, uint64_t period_us) {
+    if (period_us < SAMPLER_MIN_PERIOD_US) {
+        fprintf(stderr, "Sampler period %llu us is below the %d us minimum\n",
+                (unsigned long long)period_us, SAMPLER_MIN_PERIOD_US);
+        return -1;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    s->period_ns = period_us * 1000ULL;
+    s->next = ns_ts(ts_ns(&now) + s->period_ns);
+
+    if (s->fd >= 0) {
+        struct itimerspec spec;
+        spec.it_value = s->next;
+        spec.it_interval = ns_ts(s->period_ns);
+        if (timerfd_settime(s->fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+            perror("timerfd_settime (using clock_nanosleep)");
+            close(s->fd);
+            s->fd = -1;
+        }
+    }
+    return 0;
+}
+
+// Function to stop ticking (e.g. while the loop is parked); the next
+// sampler_start begins a fresh grid so the pause doesn't count as overruns
+void sampler_stop(PeriodicSampler *s) {
+    if (s->fd >= 0) {
+        struct itimerspec off;
+        memset(&off, 0, sizeof(off));
+        timerfd_settime(s->fd, 0, &off, NULL);
+    }
+    s->period_ns = 0;
+}
+
+// Function to block until the next tick. Returns the ticks that elapsed
+// since the previous wait: 1 when on time, n > 1 when n - 1 were overrun.
+// Returns 0 on error or if the sampler isn't started.
+uint64_t sampler_wait(PeriodicSampler *s) {
+    uint64_t expirations = 0;
+    if (s->period_ns == 0) {
+        return 0;
+    }
+
+    if (s->fd >= 0) {
+        ssize_t n;
+        do {
+            n = read(s->fd, &expirations, sizeof(expirations));
+        } while (n < 0 && errno == EINTR);
+        if (n != (ssize_t)sizeof(expirations)) {
+            perror("Failed to read timerfd");
+            return 0;
+        }
+    } else {
+        int rc;
+        do {
+            rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &s->next, NULL);
+        } while (rc == EINTR);
+        // Deadlines already behind us are overruns; step the grid past now
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t next = ts_ns(&s->next);
+        uint64_t late = ts_ns(&now) > next ? ts_ns(&now) - next : 0;
+        expirations = 1 + late / s->period_ns;
+        s->next = ns_ts(next + expirations * s->period_ns);
+    }
+
+    s->ticks += expirations;
+    s->overruns += expirations - 1;
+    return expirations;
+}
+
+// Function to call cb once per tick until it returns nonzero
+int sampler_run(PeriodicSampler *s, uint64_t period_us, SamplerCallback cb, void *ctx) {
+    if (sampler_start(s, period_us) != 0) {
+        return -1;
+    }
+    while (1) {
+        uint64_t elapsed = sampler_wait(s);
+        if (elapsed == 0) {
+            sampler_stop(s);
+            return -1;
+        }
+        if (cb(s->ticks, elapsed - 1, ctx) != 0) {
+            break;
+        }
+    }
+    sampler_stop(s);
+    return 0;
+}
+
+void sampler_close(PeriodicSampler *s) {
+    if (s->fd >= 0) {
+        close(s->fd);
+    }
+    s->fd = -1;
+    s->period_ns = 0;
+}
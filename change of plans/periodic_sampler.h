@@ -0,0 +1,35 @@
+#ifndef PERIODIC_SAMPLER_H
+#define PERIODIC_SAMPLER_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Drift-free periodic ticks. Deadlines sit on a fixed grid (start + n *
+// period) on CLOCK_MONOTONIC, so time spent working between waits does not
+// push later ticks back, unlike a relative nanosleep per tick. Ticks come
+// from a timerfd; its expiration count says how many ticks went by while
+// the caller was busy (overruns). Without timerfd, clock_nanosleep with
+// TIMER_ABSTIME walks the same grid.
+
+#define SAMPLER_MIN_PERIOD_US 50   // Up to 20 kHz
+
+typedef struct {
+    int fd;                 // timerfd, -1 when walking the grid with clock_nanosleep
+    uint64_t period_ns;     // 0 = not started
+    struct timespec next;   // Next deadline (clock_nanosleep mode)
+    uint64_t ticks;         // Ticks elapsed since start, overruns included
+    uint64_t overruns;      // Ticks that expired while the caller was still busy
+} PeriodicSampler;
+
+// Called once per tick by sampler_run; missed is the number of ticks
+// skipped just before this one. Return nonzero to stop.
+typedef int (*SamplerCallback)(uint64_t tick, uint64_t missed, void *ctx);
+
+int sampler_init(PeriodicSampler *s);
+int sampler_start(PeriodicSampler *s, uint64_t period_us);
+void sampler_stop(PeriodicSampler *s);
+uint64_t sampler_wait(PeriodicSampler *s);
+int sampler_run(PeriodicSampler *s, uint64_t period_us, SamplerCallback cb, void *ctx);
+void sampler_close(PeriodicSampler *s);
+
+#endif
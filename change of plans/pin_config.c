@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "pin_config.h"
+
+// GPIO register offsets
+#define GPPUD 0x94
+#define GPPUDCLK0 0x98
+#define GPIO_PUP_PDN_CNTRL_REG0 0xE4  // bcm2711: 2 bits per pin, 16 pins per register
+
+#define PUD_SETTLE_US 10  // Well over the 150 cycles the bcm2835 pull sequence needs
+
+static void add_channel(PinConfig *config, const PinChannel *channel) {
+    uint32_t bit = 1U << channel->pin;
+    config->channels[config->count++] = *channel;
+    if (channel->kind == PIN_KIND_KEY) {
+        config->key_mask |= bit;
+    }
+    if (channel->active_low) {
+        config->invert_mask |= bit;
+    }
+}
+
+// Function to fill in the map the programs used before the config file
+void pin_config_default(PinConfig *config) {
+    memset(config, 0, sizeof(*config));
+    snprintf(config->device, sizeof(config->device), "%s", PIN_DEFAULT_DEVICE);
+    config->base = PIN_DEFAULT_BASE;
+
+    PinChannel key = {.name = "key", .kind = PIN_KIND_KEY, .pin = 17, .pull = PIN_PULL_KEEP, .profile = -1};
+    PinChannel power = {.name = "power", .kind = PIN_KIND_POWER, .pin = 24, .active_low = 1,
+                        .pull = PIN_PULL_KEEP, .profile = -1};
+    add_channel(config, &key);
+    add_channel(config, &power);
+}
+
+static int parse_channel(const char *path, int line_no, char *fields[7], PinChannel *channel) {
+    memset(channel, 0, sizeof(*channel));
+    if (strcmp(fields[0], "power") == 0) {
+        channel->kind = PIN_KIND_POWER;
+    } else if (strcmp(fields[0], "dit") == 0) {
+        channel->kind = PIN_KIND_DIT;
+    } else if (strcmp(fields[0], "dah") == 0) {
+        channel->kind = PIN_KIND_DAH;
+    } else {
+        channel->kind = PIN_KIND_KEY;
+    }
+    snprintf(channel->name, sizeof(channel->name), "%s", fields[1]);
+
+    char *end;
+    long pin = strtol(fields[2], &end, 10);
+    if (*end != '\0' || pin < 0 || pin > 31) {
+        fprintf(stderr, "%s:%d: pin must be 0-31 (bank 0)\n", path, line_no);
+        return -1;
+    }
+    channel->pin = (uint8_t)pin;
+
+    if (strcmp(fields[3], "high") == 0) {
+        channel->active_low = 0;
+    } else if (strcmp(fields[3], "low") == 0) {
+        channel->active_low = 1;
+    } else {
+        fprintf(stderr, "%s:%d: active must be high or low\n", path, line_no);
+        return -1;
+    }
+
+    if (strcmp(fields[4], "up") == 0) {
+        channel->pull = PIN_PULL_UP;
+    } else if (strcmp(fields[4], "down") == 0) {
+        channel->pull = PIN_PULL_DOWN;
+    } else if (strcmp(fields[4], "off") == 0) {
+        channel->pull = PIN_PULL_OFF;
+    } else if (strcmp(fields[4], "-") == 0) {
+        channel->pull = PIN_PULL_KEEP;
+    } else {
+        fprintf(stderr, "%s:%d: pull must be up, down, off or -\n", path, line_no);
+        return -1;
+    }
+
+    if (strcmp(fields[5], "-") != 0) {
+        if (debounce_parse(fields[5], &channel->debounce) != 0) {
+            return -1;
+        }
+        channel->has_debounce = 1;
+    }
+
+    channel->profile = -1;
+    if (strcmp(fields[6], "-") != 0) {
+        int profile = atoi(fields[6]);
+        if (profile < 0 || profile > 127 || morse_timing_load(MORSE_TIMING_FILE, profile, &channel->timing) != 0) {
+            fprintf(stderr, "%s:%d: no profile %s in %s\n", path, line_no, fields[6], MORSE_TIMING_FILE);
+            return -1;
+        }
+        channel->profile = (int8_t)profile;
+    }
+    return 0;
+}
+
+// Function to read a pin map file over the defaults. The file replaces every
+// channel; gpio and pulls lines are optional. Returns 0 when loaded, 1 if
+// there is no such file (defaults kept), -1 on a bad line.
+int pin_config_load(const char *path, PinConfig *config) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return 1;
+    }
+
+    PinConfig loaded;
+    pin_config_default(&loaded);
+    loaded.count = 0;
+    loaded.key_mask = 0;
+    loaded.invert_mask = 0;
+
+    char line[256];
+    int line_no = 0;
+    int rc = 0;
+    uint32_t used = 0;
+    while (rc == 0 && fgets(line, sizeof(line), file) != NULL) {
+        char *fields[7];
+        int n = 0;
+        line_no++;
+        line[strcspn(line, "#\r\n")] = '\0';
+        for (char *tok = strtok(line, " \t"); tok != NULL && n < 7; tok = strtok(NULL, " \t")) {
+            fields[n++] = tok;
+        }
+        if (n == 0) {
+            continue;
+        }
+
+        if (strcmp(fields[0], "gpio") == 0 && n == 3) {
+            snprintf(loaded.device, sizeof(loaded.device), "%s", fields[1]);
+            loaded.base = (uint32_t)strtoul(fields[2], NULL, 0);
+        } else if (strcmp(fields[0], "pulls") == 0 && n == 2 &&
+                   (strcmp(fields[1], "bcm2835") == 0 || strcmp(fields[1], "bcm2711") == 0)) {
+            loaded.bcm2711_pulls = strcmp(fields[1], "bcm2711") == 0;
+        } else if (strcmp(fields[0], "evdev") == 0 && n == 3) {
+            long code = strtol(fields[1], NULL, 0);
+            long pin = strtol(fields[2], NULL, 10);
+            if (code <= 0 || code > 0x2ff || pin < 0 || pin > 31 || loaded.evdev_count == PIN_EVDEV_MAX) {
+                fprintf(stderr, "%s:%d: expected 'evdev code pin' (key code 1-767, pin 0-31)\n", path, line_no);
+                rc = -1;
+            } else {
+                loaded.evdev_codes[loaded.evdev_count] = (uint16_t)code;
+                loaded.evdev_pins[loaded.evdev_count++] = (uint8_t)pin;
+            }
+        } else if ((strcmp(fields[0], "key") == 0 || strcmp(fields[0], "power") == 0 ||
+                    strcmp(fields[0], "dit") == 0 || strcmp(fields[0], "dah") == 0) && n == 7) {
+            PinChannel channel;
+            if (parse_channel(path, line_no, fields, &channel) != 0) {
+                rc = -1;
+            } else if (used & (1U << channel.pin)) {
+                fprintf(stderr, "%s:%d: GPIO %d is already mapped\n", path, line_no, channel.pin);
+                rc = -1;
+            } else if (loaded.count == PIN_CHANNELS_MAX) {
+                fprintf(stderr, "%s:%d: too many channels\n", path, line_no);
+                rc = -1;
+            } else {
+                used |= 1U << channel.pin;
+                add_channel(&loaded, &channel);
+            }
+        } else {
+            fprintf(stderr, "%s:%d: expected 'gpio device base', 'pulls bcm2835|bcm2711', 'evdev code pin' or "
+                            "'key|power|dit|dah name pin active pull debounce profile'\n", path, line_no);
+            rc = -1;
+        }
+    }
+    fclose(file);
+
+    if (rc == 0) {
+        *config = loaded;
+    }
+    return rc;
+}
+
+// Function to load the pin map named by MORSE_PINS, else morse_pins.conf,
+// else the defaults. Returns -1 only for a file that exists but is invalid.
+int pin_config_init(PinConfig *config) {
+    const char *path = getenv("MORSE_PINS");
+    pin_config_default(config);
+    int rc = pin_config_load(path != NULL ? path : PIN_CONFIG_FILE, config);
+    if (rc == 1 && path != NULL) {
+        fprintf(stderr, "%s: no such pin map\n", path);
+        return -1;
+    }
+    return rc < 0 ? -1 : 0;
+}
+
+// Function to get the index-th channel of a kind (0 = first), NULL if none
+const PinChannel *pin_config_find(const PinConfig *config, int kind, int index) {
+    for (int i = 0; i < config->count; i++) {
+        if (config->channels[i].kind == kind && index-- == 0) {
+            return &config->channels[i];
+        }
+    }
+    return NULL;
+}
+
+// Function to map the GPIO block; NULL on failure
+volatile unsigned int *pin_config_map(const PinConfig *config) {
+    int mem_fd = open(config->device, O_RDWR | O_SYNC);
+    if (mem_fd < 0) {
+        perror("Failed to open GPIO device");
+        return NULL;
+    }
+    void *gpio_map = mmap(NULL, PIN_BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, config->base);
+    close(mem_fd);
+    if (gpio_map == MAP_FAILED) {
+        perror("Failed to map GPIO memory");
+        return NULL;
+    }
+    return (volatile unsigned int *)gpio_map;
+}
+
+void pin_config_unmap(volatile unsigned int *gpio) {
+    munmap((void *)gpio, PIN_BLOCK_SIZE);
+}
+
+// Function to make every mapped pin an input and set the pulls the map asks for
+void pin_config_setup(const PinConfig *config, volatile unsigned int *gpio) {
+    uint32_t pull_pins[3] = {0, 0, 0};  // By PIN_PULL_* value
+
+    for (int i = 0; i < config->count; i++) {
+        const PinChannel *channel = &config->channels[i];
+        int pin = channel->pin;
+        gpio[pin / 10] &= ~(0b111U << ((pin % 10) * 3));  // GPFSELn: 000 = input
+        if (channel->pull != PIN_PULL_KEEP) {
+            pull_pins[channel->pull] |= 1U << pin;
+        }
+    }
+
+    for (int pull = PIN_PULL_OFF; pull <= PIN_PULL_UP; pull++) {
+        uint32_t pins = pull_pins[pull];
+        if (pins == 0) {
+            continue;
+        }
+        if (config->bcm2711_pulls) {
+            // 00 = off, 01 = up, 10 = down
+            unsigned int bits = pull == PIN_PULL_UP ? 1 : pull == PIN_PULL_DOWN ? 2 : 0;
+            for (int pin = 0; pin < 32; pin++) {
+                if (pins & (1U << pin)) {
+                    volatile unsigned int *reg = &gpio[GPIO_PUP_PDN_CNTRL_REG0 / 4 + pin / 16];
+                    *reg = (*reg & ~(3U << ((pin % 16) * 2))) | (bits << ((pin % 16) * 2));
+                }
+            }
+        } else {
+            // Set the control, clock it into the chosen pins, then release both
+            gpio[GPPUD / 4] = (unsigned int)pull;
+            usleep(PUD_SETTLE_US);
+            gpio[GPPUDCLK0 / 4] = pins;
+            usleep(PUD_SETTLE_US);
+            gpio[GPPUD / 4] = 0;
+            gpio[GPPUDCLK0 / 4] = 0;
+        }
+    }
+}
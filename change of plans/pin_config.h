@@ -0,0 +1,91 @@
+#ifndef PIN_CONFIG_H
+#define PIN_CONFIG_H
+
+#include <stdint.h>
+#include "debounce.h"
+#include "morse_timing.h"
+
+// Pin map shared by the programs that touch GPIO, read once at startup
+// from morse_pins.conf (or the file named by MORSE_PINS). With no file,
+// the built-in map below is used: key on GPIO 17 (active high) and power
+// toggle on GPIO 24 (active low). Pull resistors are left alone.
+//
+//   # Where the GPIO block is mapped from, and which pull registers to use
+//   gpio /dev/gpiomem 0x200000
+//   pulls bcm2835
+//   # kind  name   pin  active  pull  debounce       profile
+//   key     key    17   high    -     lockout:10000  -
+//   key     desk2  22   low     up    lockout:10000  1
+//   power   power  24   low     -     -              -
+//   dit     left   5    low     up    -              -
+//   dah     right  6    low     up    -              -
+//   # Input device key code standing in for a pin (evdev_input.h)
+//   evdev   57     17
+//
+// active is the pressed level. pull is up, down, off or - (leave as is).
+// The pull registers are bcm2835 (GPPUD/GPPUDCLK0, Pi 1-3) or bcm2711
+// (Pi 4). debounce is a debounce spec (see debounce.h). profile is a line
+// number in morse_timing.conf (0 = best). A - in either column keeps the
+// program's own setting. Single-key programs use the first key channel.
+// morse_multi uses all of them. dit and dah are the two levers of an
+// iambic paddle (morse_machine -iambic).
+
+#define PIN_CONFIG_FILE "morse_pins.conf"
+#define PIN_CHANNELS_MAX 32
+#define PIN_NAME_SIZE 16
+#define PIN_DEVICE_SIZE 32
+#define PIN_DEFAULT_DEVICE "/dev/gpiomem"
+#define PIN_DEFAULT_BASE 0x200000  // GPIO block offset for /dev/gpiomem
+#define PIN_BLOCK_SIZE (4 * 1024)
+#define PIN_EVDEV_MAX 32
+
+#define PIN_KIND_KEY 0
+#define PIN_KIND_POWER 1
+#define PIN_KIND_DIT 2
+#define PIN_KIND_DAH 3
+
+// Values of the bcm2835 GPPUD register
+#define PIN_PULL_OFF 0
+#define PIN_PULL_DOWN 1
+#define PIN_PULL_UP 2
+#define PIN_PULL_KEEP 3
+
+typedef struct {
+    char name[PIN_NAME_SIZE];
+    uint8_t kind;
+    uint8_t pin;
+    uint8_t active_low;
+    uint8_t pull;
+    int8_t profile;               // morse_timing.conf line, -1 = program default
+    uint8_t has_debounce;
+    MorseTiming timing;           // Loaded profile when profile >= 0
+    DebounceConfig debounce;      // When has_debounce
+} PinChannel;
+
+typedef struct {
+    char device[PIN_DEVICE_SIZE];
+    uint32_t base;
+    int bcm2711_pulls;
+    int count;
+    uint32_t key_mask;            // Pins of all key channels
+    uint32_t invert_mask;         // Active-low pins: levels ^ invert_mask is 1 when pressed
+    PinChannel channels[PIN_CHANNELS_MAX];
+    int evdev_count;
+    uint16_t evdev_codes[PIN_EVDEV_MAX];  // Input device key codes...
+    uint8_t evdev_pins[PIN_EVDEV_MAX];    // ...and the pins they act as
+} PinConfig;
+
+void pin_config_default(PinConfig *config);
+int pin_config_load(const char *path, PinConfig *config);
+int pin_config_init(PinConfig *config);
+const PinChannel *pin_config_find(const PinConfig *config, int kind, int index);
+volatile unsigned int *pin_config_map(const PinConfig *config);
+void pin_config_unmap(volatile unsigned int *gpio);
+void pin_config_setup(const PinConfig *config, volatile unsigned int *gpio);
+
+// Function to tell whether a channel is pressed in a GPLEV0 word
+static inline int pin_active(uint32_t levels, const PinChannel *channel) {
+    return ((levels >> channel->pin) ^ channel->active_low) & 1;
+}
+
+#endif
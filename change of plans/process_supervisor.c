@@ -0,0 +1,293 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "process_supervisor.h"
+
+extern char **environ;
+
+static long elapsed_ms(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) * 1000L + (to->tv_nsec - from->tv_nsec) / 1000000L;
+}
+
+static void add_ms(struct timespec *ts, long ms) {
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static int pidfd_open_compat(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+void supervisor_init(SupervisedProcess *p, const char *name, char *const *argv) {
+    memset(p, 0, sizeof(*p));
+    p->name = name;
+    p->argv = argv;
+    p->pidfd = -1;
+    p->ready_fd = -1;
+    p->ready_ms = -1;
+    p->backoff_ms = SUPERVISOR_BACKOFF_MIN_MS;
+}
+
+// Function to build a copy of the environment with MORSE_READY_FD set
+static char **build_envp(int ready_fd, char *ready_var, size_t ready_len) {
+    size_t count = 0;
+    while (environ[count] != NULL) {
+        count++;
+    }
+
+    char **envp = malloc((count + 2) * sizeof(char *));
+    if (envp == NULL) {
+        return NULL;
+    }
+    size_t n = 0;
+    size_t key_len = strlen(SUPERVISOR_READY_ENV);
+    for (size_t i = 0; i < count; i++) {
+        if (strncmp(environ[i], SUPERVISOR_READY_ENV, key_len) == 0 && environ[i][key_len] == '=') {
+            continue;  // Never pass our own readiness fd down a second level
+        }
+        envp[n++] = environ[i];
+    }
+    snprintf(ready_var, ready_len, "%s=%d", SUPERVISOR_READY_ENV, ready_fd);
+    envp[n++] = ready_var;
+    envp[n] = NULL;
+    return envp;
+}
+
+static void close_fds(SupervisedProcess *p) {
+    if (p->pidfd >= 0) {
+        close(p->pidfd);
+        p->pidfd = -1;
+    }
+    if (p->ready_fd >= 0) {
+        close(p->ready_fd);
+        p->ready_fd = -1;
+    }
+}
+
+// Function to spawn a child directly (no shell, no sudo) with a readiness pipe
+int supervisor_start(SupervisedProcess *p) {
+    int fds[2];
+    char ready_var[64];
+
+    if (p->pid > 0) {
+        return 0;  // Already running
+    }
+    p->wanted = 1;
+
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        perror("Failed to create readiness pipe");
+        return -1;
+    }
+    fcntl(fds[1], F_SETFD, 0);  // Only the write end is inherited by the child
+
+    char **envp = build_envp(fds[1], ready_var, sizeof(ready_var));
+    if (envp == NULL) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    pid_t pid;
+    clock_gettime(CLOCK_MONOTONIC, &p->started);
+    int rc = posix_spawn(&pid, p->argv[0], NULL, NULL, p->argv, envp);
+    close(fds[1]);
+    free(envp);
+
+    if (rc != 0) {
+        fprintf(stderr, "Failed to start %s: %s\n", p->name, strerror(rc));
+        close(fds[0]);
+        p->restart_at = p->started;
+        add_ms(&p->restart_at, p->backoff_ms);
+        return -1;
+    }
+
+    p->pid = pid;
+    p->pidfd = pidfd_open_compat(pid);  // -1 on kernels before 5.3, reaped by polling instead
+    p->ready_fd = fds[0];
+    p->ready_ms = -1;
+    fcntl(p->ready_fd, F_SETFL, O_NONBLOCK);
+    printf("Started %s (pid %d)\n", p->name, (int)pid);
+    return 0;
+}
+
+// Function to record a child's exit and schedule a restart if it is still wanted
+static void handle_exit(SupervisedProcess *p, int status) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long uptime = elapsed_ms(&p->started, &now);
+
+    if (WIFSIGNALED(status)) {
+        printf("%s (pid %d) killed by signal %d after %ld ms\n", p->name, (int)p->pid, WTERMSIG(status), uptime);
+    } else {
+        printf("%s (pid %d) exited with status %d after %ld ms\n", p->name, (int)p->pid, WEXITSTATUS(status), uptime);
+    }
+
+    close_fds(p);
+    p->pid = 0;
+
+    if (p->wanted) {
+        if (uptime >= SUPERVISOR_HEALTHY_MS) {
+            p->backoff_ms = SUPERVISOR_BACKOFF_MIN_MS;
+        }
+        p->restart_at = now;
+        add_ms(&p->restart_at, p->backoff_ms);
+        printf("Restarting %s in %d ms\n", p->name, p->backoff_ms);
+        p->backoff_ms *= 2;
+        if (p->backoff_ms > SUPERVISOR_BACKOFF_MAX_MS) {
+            p->backoff_ms = SUPERVISOR_BACKOFF_MAX_MS;
+        }
+        p->restarts++;
+    }
+    fflush(stdout);
+}
+
+// Function to wait up to timeout_ms for exits or readiness, then reap and restart
+void supervisor_poll(SupervisedProcess *procs, int count, int timeout_ms) {
+    struct pollfd fds[2 * 16];
+    SupervisedProcess *owners[2 * 16];
+    int nfds = 0;
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (int i = 0; i < count && nfds < 2 * 16 - 1; i++) {
+        SupervisedProcess *p = &procs[i];
+        if (p->pid > 0) {
+            if (p->pidfd >= 0) {
+                fds[nfds].fd = p->pidfd;
+                fds[nfds].events = POLLIN;
+                owners[nfds++] = p;
+            }
+            if (p->ready_fd >= 0) {
+                fds[nfds].fd = p->ready_fd;
+                fds[nfds].events = POLLIN;
+                owners[nfds++] = p;
+            }
+        } else if (p->wanted) {
+            long wait = elapsed_ms(&now, &p->restart_at);
+            if (wait < timeout_ms) {
+                timeout_ms = wait > 0 ? (int)wait : 0;  // Wake up in time for the restart
+            }
+        }
+    }
+
+    if (poll(fds, nfds, timeout_ms) < 0 && errno != EINTR) {
+        perror("poll");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    for (int i = 0; i < nfds; i++) {
+        SupervisedProcess *p = owners[i];
+        if (fds[i].fd == p->ready_fd && (fds[i].revents & (POLLIN | POLLHUP))) {
+            char buf[16];
+            ssize_t n = read(p->ready_fd, buf, sizeof(buf));
+            if (n > 0) {
+                p->ready_ms = elapsed_ms(&p->started, &now);
+                printf("%s ready %ld ms after spawn\n", p->name, p->ready_ms);
+                fflush(stdout);
+            }
+            if (n >= 0 || errno != EAGAIN) {
+                close(p->ready_fd);  // Ready, or closed without ever signalling
+                p->ready_fd = -1;
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        SupervisedProcess *p = &procs[i];
+        int status;
+        if (p->pid > 0 && waitpid(p->pid, &status, WNOHANG) == p->pid) {
+            handle_exit(p, status);
+        }
+        if (p->pid == 0 && p->wanted && elapsed_ms(&p->restart_at, &now) >= 0) {
+            supervisor_start(p);
+        }
+    }
+}
+
+// Function to stop a child: SIGTERM, wait up to deadline_ms, then SIGKILL
+int supervisor_stop(SupervisedProcess *p, int deadline_ms) {
+    struct timespec start, now;
+    int status;
+
+    p->wanted = 0;
+    if (p->pid == 0) {
+        return 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    kill(p->pid, SIGTERM);
+
+    int exited = 0;
+    while (!exited) {
+        if (waitpid(p->pid, &status, WNOHANG) == p->pid) {
+            exited = 1;
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long left = deadline_ms - elapsed_ms(&start, &now);
+        if (left <= 0) {
+            break;
+        }
+        if (p->pidfd >= 0) {
+            struct pollfd pfd = {p->pidfd, POLLIN, 0};
+            poll(&pfd, 1, (int)left);
+        } else {
+            usleep(10000);  // No pidfd: poll waitpid every 10 ms
+        }
+    }
+
+    if (!exited) {
+        printf("%s ignored SIGTERM for %d ms, sending SIGKILL\n", p->name, deadline_ms);
+        kill(p->pid, SIGKILL);
+        waitpid(p->pid, &status, 0);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    printf("Stopped %s in %ld ms\n", p->name, elapsed_ms(&start, &now));
+    fflush(stdout);
+    close_fds(p);
+    p->pid = 0;
+    return exited ? 0 : 1;
+}
+
+int supervisor_all_ready(const SupervisedProcess *procs, int count) {
+    for (int i = 0; i < count; i++) {
+        if (procs[i].wanted && (procs[i].pid == 0 || procs[i].ready_ms < 0)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Function for children: tell the supervisor initialization is complete
+void supervisor_notify_ready(void) {
+    const char *value = getenv(SUPERVISOR_READY_ENV);
+    if (value == NULL) {
+        return;  // Started by hand, nobody is listening
+    }
+    int fd = atoi(value);
+    if (write(fd, "READY\n", 6) < 0) {
+        perror("Failed to signal readiness");
+    }
+    close(fd);
+    unsetenv(SUPERVISOR_READY_ENV);
+}
@@ -0,0 +1,41 @@
+#ifndef PROCESS_SUPERVISOR_H
+#define PROCESS_SUPERVISOR_H
+
+#include <sys/types.h>
+#include <time.h>
+
+// Launches child programs with posix_spawn, watches them through pidfds
+// (falling back to waitpid polling on older kernels), restarts crashes with
+// exponential backoff and stops them with SIGTERM followed by SIGKILL after
+// a deadline. Children report readiness by writing to the descriptor named
+// in MORSE_READY_FD (see supervisor_notify_ready).
+
+#define SUPERVISOR_READY_ENV "MORSE_READY_FD"
+#define SUPERVISOR_BACKOFF_MIN_MS 250
+#define SUPERVISOR_BACKOFF_MAX_MS 8000
+#define SUPERVISOR_HEALTHY_MS 10000   // Uptime after which the backoff resets
+
+typedef struct {
+    const char *name;       // Label for log messages
+    char *const *argv;      // argv[0] is the path to execute
+    pid_t pid;              // 0 when not running
+    int pidfd;              // -1 if pidfd_open is unavailable
+    int ready_fd;           // Read end of the readiness pipe, -1 once ready
+    int wanted;             // 1 while the supervisor should keep it running
+    int restarts;
+    int backoff_ms;
+    long ready_ms;          // Spawn-to-ready time of the last start, -1 until ready
+    struct timespec started;
+    struct timespec restart_at;
+} SupervisedProcess;
+
+void supervisor_init(SupervisedProcess *p, const char *name, char *const *argv);
+int supervisor_start(SupervisedProcess *p);
+int supervisor_stop(SupervisedProcess *p, int deadline_ms);
+void supervisor_poll(SupervisedProcess *procs, int count, int timeout_ms);
+int supervisor_all_ready(const SupervisedProcess *procs, int count);
+
+// Called by a child once it is initialized; no-op when not supervised
+void supervisor_notify_ready(void);
+
+#endif
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "rt_profile.h"
+#include "tick_watchdog.h"
+#include "morse_timing.h"
+#include "periodic_sampler.h"
+
+// Jitter report for the real-time profile. Runs the sampling loop's tick
+// (the absolute tick grid delay_ms uses, or -sleep for the old relative
+// nanosleep) for a while as a normal task, then again under the RT profile,
+// optionally with CPU hogs on every core, and prints the tick watchdog's
+// numbers for both side by side. -work adds busy time per tick, like the
+// loop's own work between delay_ms calls; drift shows how far the last
+// tick landed from where a perfect clock would have put it.
+//
+// Usage: rt_jitter [-seconds N] [-tick ms] [-load threads] [-prio P] [-cpu C]
+//                  [-work us] [-sleep]
+//
+// gcc -O2 -o rt_jitter rt_jitter.c rt_profile.c tick_watchdog.c periodic_sampler.c morse_metrics.c
+//     morse_timing.c -lpthread -lrt
+// Run as root (or with CAP_SYS_NICE and CAP_IPC_LOCK) for the RT numbers to mean anything.
+
+#define DEFAULT_SECONDS 20
+#define MAX_LOAD 64
+
+typedef struct {
+    const RtProfile *rt;    // NULL for the default profile
+    int ticks;
+    int tick_ms;
+    int work_us;            // Busy time per tick
+    int relative;           // 1 = nanosleep per tick instead of the absolute grid
+    int applied;
+    int64_t drift_us;       // Last tick's distance from start + ticks * period
+    TickWatchdog wd;
+} TickRun;
+
+static atomic_int load_running;
+
+// Busy work with the odd syscall, like a service sharing the Pi
+static void *load_thread(void *arg) {
+    volatile unsigned long x = 0;
+    (void)arg;
+    while (atomic_load_explicit(&load_running, memory_order_relaxed)) {
+        for (int i = 0; i < 100000; i++) {
+            x += (unsigned long)i;
+        }
+        sched_yield();
+    }
+    return NULL;
+}
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void *tick_thread(void *arg) {
+    TickRun *run = (TickRun *)arg;
+    struct timespec ts = {run->tick_ms / 1000, (run->tick_ms % 1000) * 1000000L};
+    PeriodicSampler sampler;
+    if (run->rt != NULL) {
+        run->applied |= rt_enter_sampling(run->rt, run->applied, RT_LOOP_SLEEPS);
+    }
+    watchdog_init(&run->wd);
+    sampler_init(&sampler);
+    sampler_start(&sampler, (uint64_t)run->tick_ms * 1000);
+    int64_t start = now_us();
+    int64_t woke = start;
+    uint64_t elapsed = 0;  // Ticks of real time covered, overruns included
+    while (elapsed < (uint64_t)run->ticks) {
+        if (run->relative) {
+            nanosleep(&ts, NULL);
+            elapsed++;
+        } else {
+            elapsed += sampler_wait(&sampler);
+        }
+        woke = now_us();
+        watchdog_tick(&run->wd, (uint64_t)run->tick_ms * 1000);
+        for (int64_t until = now_us() + run->work_us; now_us() < until;) {
+            // Stand-in for read_gpio_pin, send_morse_signal and logging
+        }
+    }
+    run->drift_us = woke - start - (int64_t)elapsed * run->tick_ms * 1000;
+    sampler_close(&sampler);
+    return NULL;
+}
+
+// Function to run one profile with `load` hog threads alongside
+static int run_profile(TickRun *run, int load) {
+    pthread_t loaders[MAX_LOAD];
+    pthread_t tid;
+    int started = 0;
+
+    atomic_store(&load_running, 1);
+    for (; started < load; started++) {
+        if (pthread_create(&loaders[started], NULL, load_thread, NULL) != 0) {
+            perror("Failed to start load thread");
+            break;
+        }
+    }
+    int rc = pthread_create(&tid, NULL, tick_thread, run);
+    if (rc == 0) {
+        pthread_join(tid, NULL);
+    } else {
+        perror("Failed to start tick thread");
+    }
+    atomic_store(&load_running, 0);
+    for (int i = 0; i < started; i++) {
+        pthread_join(loaders[i], NULL);
+    }
+    return rc == 0 ? 0 : -1;
+}
+
+static void print_row(const char *name, const TickRun *run) {
+    printf("%-34s %7llu %7llu %8u %8u %9u %8u %9lld\n", name, (unsigned long long)run->wd.ticks,
+           (unsigned long long)run->wd.misses, watchdog_percentile(&run->wd, 0.50),
+           watchdog_percentile(&run->wd, 0.99), watchdog_percentile(&run->wd, 0.999), run->wd.max_jitter_us,
+           (long long)run->drift_us);
+}
+
+int main(int argc, char *argv[]) {
+    int seconds = DEFAULT_SECONDS;
+    int tick_ms = MORSE_TICK_MS;
+    int load = 0;
+    int work_us = 0;
+    int relative = 0;
+    RtProfile rt;
+
+    rt_profile_from_env(&rt);  // Defaults (or MORSE_RT) for priority and CPU
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-sleep") == 0) {
+            relative = 1;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return -1;
+        }
+        if (strcmp(argv[i], "-seconds") == 0) {
+            seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-tick") == 0) {
+            tick_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-load") == 0) {
+            load = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-prio") == 0) {
+            rt.priority = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-cpu") == 0) {
+            rt.cpu = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-work") == 0) {
+            work_us = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (seconds <= 0 || tick_ms <= 0 || load < 0 || load > MAX_LOAD || work_us < 0) {
+        fprintf(stderr, "seconds and tick must be positive, load 0-%d\n", MAX_LOAD);
+        return -1;
+    }
+    rt.enabled = 1;
+
+    TickRun normal = {NULL, seconds * 1000 / tick_ms, tick_ms, work_us, relative, 0, 0, {0}};
+    TickRun realtime = normal;
+    realtime.rt = &rt;
+
+    fprintf(stderr, "Default profile, %d s at %d ms ticks, %d load threads...\n", seconds, tick_ms, load);
+    if (run_profile(&normal, load) != 0) {
+        return -1;
+    }
+    // From here on this thread and the load threads it starts stay off the RT CPU
+    realtime.applied = rt_prepare_process(&rt);
+    fprintf(stderr, "RT profile, SCHED_FIFO %d on CPU %d...\n", rt.priority, rt.cpu);
+    if (run_profile(&realtime, load) != 0) {
+        return -1;
+    }
+
+    char label[64];
+    snprintf(label, sizeof(label), "realtime (%s)", rt_describe(realtime.applied));
+    printf("%-34s %7s %7s %8s %8s %9s %8s %9s\n", "profile", "ticks", "misses", "p50_us", "p99_us", "p99.9_us",
+           "max_us", "drift_us");
+    print_row("default", &normal);
+    print_row(label, &realtime);
+    return 0;
+}
@@ -0,0 +1,137 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "rt_profile.h"
+
+// Function to read MORSE_RT. Returns 1 if the profile is enabled.
+int rt_profile_from_env(RtProfile *rt) {
+    const char *value = getenv(RT_ENV);
+    rt->enabled = 0;
+    rt->priority = RT_DEFAULT_PRIORITY;
+    rt->cpu = RT_DEFAULT_CPU;
+    if (value == NULL || *value == '\0' || strcmp(value, "0") == 0) {
+        return 0;
+    }
+
+    int priority, cpu;
+    int fields = sscanf(value, "%d:%d", &priority, &cpu);
+    if (fields >= 1 && strchr(value, ':') != NULL) {
+        rt->priority = priority;
+    }
+    if (fields == 2) {
+        rt->cpu = cpu;
+    }
+    int min = sched_get_priority_min(SCHED_FIFO);
+    int max = sched_get_priority_max(SCHED_FIFO);
+    if (rt->priority < min || rt->priority > max) {
+        fprintf(stderr, "%s: priority %d out of range %d-%d, using %d\n", RT_ENV, rt->priority, min, max,
+                RT_DEFAULT_PRIORITY);
+        rt->priority = RT_DEFAULT_PRIORITY;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (rt->cpu < 0 || rt->cpu >= cpus) {
+        fprintf(stderr, "%s: CPU %d not online, using CPU %ld\n", RT_ENV, rt->cpu, cpus - 1);
+        rt->cpu = (int)(cpus - 1);
+    }
+    rt->enabled = 1;
+    return 1;
+}
+
+// Function to lock memory and keep the calling thread, and every thread it
+// creates afterwards, off the sampling CPU. Call first thing in main.
+// Returns the RT_APPLIED_* steps that succeeded.
+int rt_prepare_process(const RtProfile *rt) {
+    int applied = 0;
+    if (!rt->enabled) {
+        return 0;
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+        applied |= RT_APPLIED_MLOCK;
+    } else {
+        perror("mlockall (page faults may still stall sampling)");
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 1) {
+        cpu_set_t others;
+        CPU_ZERO(&others);
+        for (int i = 0; i < cpus; i++) {
+            if (i != rt->cpu) {
+                CPU_SET(i, &others);
+            }
+        }
+        if (pthread_setaffinity_np(pthread_self(), sizeof(others), &others) == 0) {
+            applied |= RT_APPLIED_ISOLATED;
+        } else {
+            fprintf(stderr, "Failed to move threads off CPU %d\n", rt->cpu);
+        }
+    }
+    return applied;
+}
+
+// Touch the stack the sampling loop will use, so its pages are resident
+// (and, after mlockall, locked) before the first tick
+static void __attribute__((noinline)) prefault_stack(void) {
+    volatile char stack[RT_PREFAULT_STACK];
+    for (size_t i = 0; i < sizeof(stack); i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+// Function to turn the calling thread into the real-time sampling thread.
+// prepared is what rt_prepare_process returned; loop is RT_LOOP_SLEEPS or
+// RT_LOOP_SPINS. Returns the RT_APPLIED_* steps that succeeded.
+int rt_enter_sampling(const RtProfile *rt, int prepared, int loop) {
+    int applied = 0;
+    if (!rt->enabled) {
+        return 0;
+    }
+
+    prefault_stack();
+
+    cpu_set_t mine;
+    CPU_ZERO(&mine);
+    CPU_SET(rt->cpu, &mine);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(mine), &mine) == 0) {
+        applied |= RT_APPLIED_PINNED;
+    } else {
+        fprintf(stderr, "Failed to pin the sampling thread to CPU %d\n", rt->cpu);
+    }
+
+    if (loop == RT_LOOP_SPINS) {
+        fprintf(stderr, "Sampling loop busy-waits, not using SCHED_FIFO on CPU %d\n", rt->cpu);
+        return applied;
+    }
+    if (!(prepared & RT_APPLIED_ISOLATED)) {
+        fprintf(stderr, "Other threads still share CPU %d, not using SCHED_FIFO\n", rt->cpu);
+        return applied;
+    }
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = rt->priority;
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err == 0) {
+        applied |= RT_APPLIED_FIFO;
+    } else {
+        fprintf(stderr, "SCHED_FIFO %d unavailable (%s), sampling as a normal task\n", rt->priority, strerror(err));
+    }
+    return applied;
+}
+
+// Function to name the applied steps for a log line
+const char *rt_describe(int applied) {
+    static const char *names[] = {
+        "none", "mlock", "isolated", "mlock+isolated",
+        "pinned", "mlock+pinned", "isolated+pinned", "mlock+isolated+pinned",
+        "fifo", "mlock+fifo", "isolated+fifo", "mlock+isolated+fifo",
+        "pinned+fifo", "mlock+pinned+fifo", "isolated+pinned+fifo", "mlock+isolated+pinned+fifo",
+    };
+    return names[applied & 0xF];
+}
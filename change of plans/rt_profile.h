@@ -0,0 +1,45 @@
+#ifndef RT_PROFILE_H
+#define RT_PROFILE_H
+
+// Opt-in real-time profile for the sampling loop. With MORSE_RT set in the
+// environment (the controller passes it on to the interpreter), the process
+// locks its memory, every other thread is kept off the sampling CPU, and the
+// sampling thread runs SCHED_FIFO pinned to that CPU with a prefaulted stack.
+// Each step that lacks the privilege (CAP_SYS_NICE, CAP_IPC_LOCK or
+// RLIMIT_RTPRIO/RLIMIT_MEMLOCK) is skipped with a warning and the program
+// carries on as a normal task.
+//
+//   MORSE_RT=1        defaults below
+//   MORSE_RT=80:3     SCHED_FIFO priority 80 on CPU 3
+//
+// SCHED_FIFO is only given to a loop that sleeps between samples, and only
+// once the other threads are off its CPU. A loop that busy-waits (the edge
+// sampler) would starve everything else on the CPU, so it is pinned but
+// stays a normal task; keep that CPU to itself with isolcpus=3 on the
+// kernel command line.
+
+#define RT_ENV "MORSE_RT"
+#define RT_DEFAULT_PRIORITY 80
+#define RT_DEFAULT_CPU 3                  // Last core of a Pi 3/4
+#define RT_PREFAULT_STACK (256 * 1024)    // Stack touched up front so the loop never page faults
+
+#define RT_APPLIED_MLOCK 0x1
+#define RT_APPLIED_ISOLATED 0x2           // Other threads moved off the sampling CPU
+#define RT_APPLIED_PINNED 0x4
+#define RT_APPLIED_FIFO 0x8
+
+#define RT_LOOP_SLEEPS 0                  // rt_enter_sampling: the loop blocks between samples
+#define RT_LOOP_SPINS 1                   // The loop busy-waits, never SCHED_FIFO
+
+typedef struct {
+    int enabled;
+    int priority;
+    int cpu;
+} RtProfile;
+
+int rt_profile_from_env(RtProfile *rt);
+int rt_prepare_process(const RtProfile *rt);
+int rt_enter_sampling(const RtProfile *rt, int prepared, int loop);
+const char *rt_describe(int applied);
+
+#endif
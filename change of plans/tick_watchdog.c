@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tick_watchdog.h"
+#include "morse_metrics.h"
+#include "morse_timing.h"
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+// Bucket index: values below 8 map 1:1, above that 8 sub-buckets per power of two
+static int bucket_of(uint32_t us) {
+    if (us < 8) {
+        return (int)us;
+    }
+    int msb = 31 - __builtin_clz(us);
+    int index = (msb - 2) * 8 + (int)((us >> (msb - 3)) & 7);
+    return index < WATCHDOG_BUCKETS ? index : WATCHDOG_BUCKETS - 1;
+}
+
+// Upper edge of a bucket
+static uint32_t bucket_value(int index) {
+    if (index < 8) {
+        return (uint32_t)index;
+    }
+    int msb = index / 8 + 2;
+    uint64_t value = ((uint64_t)(8 + index % 8 + 1) << (msb - 3)) - 1;
+    return value > UINT32_MAX ? UINT32_MAX : (uint32_t)value;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Current Morse unit: from the measured sending speed when there is one,
+// otherwise half the dot/dash threshold (a dot is 1 unit, a dash 3)
+static uint32_t unit_us(void) {
+    uint64_t wpm_x100 = morse_stats ? atomic_load_explicit(&morse_stats->wpm_x100, memory_order_relaxed) : 0;
+    if (wpm_x100 > 0) {
+        return (uint32_t)(120000000ULL / wpm_x100);  // 1200 ms / WPM
+    }
+    return (uint32_t)morse_dash_ticks * (uint32_t)morse_tick_ms * 1000U / 2;
+}
+
+void watchdog_init(TickWatchdog *wd) {
+    memset(wd, 0, sizeof(*wd));
+    wd->eval_countdown = WATCHDOG_EVAL_TICKS;
+}
+
+// Function to sort a copy of the window and update the alert state
+static int evaluate(TickWatchdog *wd) {
+    uint32_t sorted[WATCHDOG_WINDOW];
+    memcpy(sorted, wd->window, (size_t)wd->window_fill * sizeof(uint32_t));
+    qsort(sorted, (size_t)wd->window_fill, sizeof(uint32_t), compare_u32);
+    wd->p99_us = sorted[(wd->window_fill * 99) / 100];
+    wd->unit_us = unit_us();
+    METRIC_SET(tick_jitter_p99_us, wd->p99_us);
+
+    uint32_t alert_at = wd->unit_us / WATCHDOG_ALERT_FRACTION;
+    if (!wd->alerting && wd->p99_us > alert_at) {
+        wd->alerting = 1;
+        wd->alerts++;
+        METRIC_INC(jitter_alerts_total);
+        METRIC_SET(jitter_alert, 1);
+        return WATCHDOG_ALERT;
+    }
+    if (wd->alerting && wd->p99_us < alert_at / 2) {
+        wd->alerting = 0;
+        METRIC_SET(jitter_alert, 0);
+        return WATCHDOG_CLEAR;
+    }
+    return WATCHDOG_OK;
+}
+
+// Function to record one tick, called at the top of delay_ms. Returns
+// WATCHDOG_ALERT or WATCHDOG_CLEAR when the alert state changes.
+int watchdog_tick(TickWatchdog *wd, uint64_t intended_us) {
+    uint64_t now = now_us();
+    uint64_t last = wd->last_us;
+    wd->last_us = now;
+    if (last == 0 || intended_us == 0) {
+        return WATCHDOG_OK;
+    }
+
+    uint64_t period = now - last;
+    uint64_t jitter64 = period > intended_us ? period - intended_us : intended_us - period;
+    uint32_t jitter = jitter64 > UINT32_MAX ? UINT32_MAX : (uint32_t)jitter64;
+    wd->ticks++;
+    wd->hist[bucket_of(jitter)]++;
+    if (jitter > wd->max_jitter_us) {
+        wd->max_jitter_us = jitter;
+    }
+    if (period > intended_us) {
+        wd->press_lost_us += period - intended_us;
+    }
+    if (period >= intended_us + intended_us / 2) {
+        wd->misses++;
+        wd->press_missed = 1;
+    }
+
+    wd->window[wd->window_pos] = jitter;
+    wd->window_pos = (wd->window_pos + 1) % WATCHDOG_WINDOW;
+    if (wd->window_fill < WATCHDOG_WINDOW) {
+        wd->window_fill++;
+    }
+    if (--wd->eval_countdown > 0) {
+        return WATCHDOG_OK;
+    }
+    wd->eval_countdown = WATCHDOG_EVAL_TICKS;
+    return evaluate(wd);
+}
+
+// Function to forget the previous tick after the loop was deliberately parked
+void watchdog_resume(TickWatchdog *wd) {
+    wd->last_us = 0;
+}
+
+// Function to start measuring a new press (key went down)
+void watchdog_key_down(TickWatchdog *wd) {
+    wd->press_lost_us = 0;
+    wd->press_missed = 0;
+}
+
+// Function to call when an element is classified. Returns 1 if the press
+// it came from was measured across a stall, and counts it.
+int watchdog_element(TickWatchdog *wd) {
+    int low = wd->press_missed || wd->press_lost_us >= (uint64_t)morse_tick_ms * 1000;
+    wd->press_lost_us = 0;
+    wd->press_missed = 0;
+    if (low) {
+        wd->low_confidence++;
+        METRIC_INC(low_confidence_elements_total);
+    }
+    return low;
+}
+
+// Function to read a lifetime jitter percentile (q in 0..1) in us
+uint32_t watchdog_percentile(const TickWatchdog *wd, double q) {
+    uint64_t target = (uint64_t)(q * (double)wd->ticks);
+    uint64_t seen = 0;
+    for (int i = 0; i < WATCHDOG_BUCKETS; i++) {
+        seen += wd->hist[i];
+        if (seen > target) {
+            uint32_t value = bucket_value(i);
+            return value < wd->max_jitter_us ? value : wd->max_jitter_us;
+        }
+    }
+    return wd->max_jitter_us;
+}
+
+void watchdog_report(const TickWatchdog *wd, FILE *out) {
+    fprintf(out, "Tick watchdog: %llu ticks, %llu deadline misses, %llu low-confidence elements, %llu jitter alerts\n",
+            (unsigned long long)wd->ticks, (unsigned long long)wd->misses,
+            (unsigned long long)wd->low_confidence, (unsigned long long)wd->alerts);
+    fprintf(out, "Tick jitter (us): p50 %u  p99 %u  p99.9 %u  max %u\n", watchdog_percentile(wd, 0.50),
+            watchdog_percentile(wd, 0.99), watchdog_percentile(wd, 0.999), wd->max_jitter_us);
+    fflush(out);
+}
@@ -0,0 +1,54 @@
+#ifndef TICK_WATCHDOG_H
+#define TICK_WATCHDOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Watchdog for the sampling loop's tick regularity. Every delay_ms call
+// measures the real period against the intended one. A tick that wakes
+// half a period late or more is a deadline miss (at least one sample
+// skipped). The press an element was measured from is low confidence when
+// the loop lost a tick's worth of time (or missed a deadline) during it,
+// since its tick count, and so dot vs dash, may be off. An alert is raised
+// while the p99 jitter over the last WATCHDOG_WINDOW ticks exceeds
+// 1/WATCHDOG_ALERT_FRACTION of the current Morse unit.
+
+#define WATCHDOG_WINDOW 256         // Ticks in the rolling jitter window
+#define WATCHDOG_EVAL_TICKS 32      // Re-evaluate the window every this many ticks
+#define WATCHDOG_ALERT_FRACTION 4   // Alert above unit/4, clear below unit/8
+#define WATCHDOG_BUCKETS 256        // Lifetime histogram, 8 sub-buckets per power of two
+
+#define WATCHDOG_OK 0
+#define WATCHDOG_ALERT 1            // Jitter just crossed the alert threshold
+#define WATCHDOG_CLEAR 2            // Jitter just fell back below the clear threshold
+
+typedef struct {
+    uint64_t last_us;               // Previous tick, 0 = none (start or resumed)
+    uint32_t window[WATCHDOG_WINDOW];  // |period - intended| in us
+    int window_pos;
+    int window_fill;
+    int eval_countdown;
+    uint64_t hist[WATCHDOG_BUCKETS];
+
+    uint64_t ticks;
+    uint64_t misses;
+    uint64_t low_confidence;
+    uint64_t alerts;
+    uint32_t max_jitter_us;
+    uint32_t p99_us;                // Over the window, as of the last evaluation
+    uint32_t unit_us;               // Unit used for the last evaluation
+    int alerting;
+
+    uint64_t press_lost_us;         // Time lost to late ticks since the key went down
+    int press_missed;
+} TickWatchdog;
+
+void watchdog_init(TickWatchdog *wd);
+int watchdog_tick(TickWatchdog *wd, uint64_t intended_us);
+void watchdog_resume(TickWatchdog *wd);
+void watchdog_key_down(TickWatchdog *wd);
+int watchdog_element(TickWatchdog *wd);
+uint32_t watchdog_percentile(const TickWatchdog *wd, double q);
+void watchdog_report(const TickWatchdog *wd, FILE *out);
+
+#endif
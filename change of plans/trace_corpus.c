@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <string.h>
+#include "trace_corpus.h"
+
+void corpus_init(TraceCorpus *corpus) {
+    corpus->entries = NULL;
+    corpus->count = 0;
+    corpus->capacity = 0;
+    corpus->checksum = 0;
+}
+
+void corpus_free(TraceCorpus *corpus) {
+    for (size_t i = 0; i < corpus->count; i++) {
+        key_trace_free(&corpus->entries[i].trace);
+    }
+    free(corpus->entries);
+    corpus_init(corpus);
+}
+
+// Function to append an empty entry, returns NULL if out of memory
+LabelledTrace *corpus_add(TraceCorpus *corpus, const char *id, const char *operator_name, const char *text) {
+    if (corpus->count == corpus->capacity) {
+        size_t capacity = corpus->capacity ? corpus->capacity * 2 : 16;
+        LabelledTrace *entries = realloc(corpus->entries, capacity * sizeof(LabelledTrace));
+        if (entries == NULL) {
+            return NULL;
+        }
+        corpus->entries = entries;
+        corpus->capacity = capacity;
+    }
+    LabelledTrace *entry = &corpus->entries[corpus->count++];
+    memset(entry, 0, sizeof(*entry));
+    snprintf(entry->id, sizeof(entry->id), "%s", id);
+    snprintf(entry->operator_name, sizeof(entry->operator_name), "%s", operator_name);
+    snprintf(entry->text, sizeof(entry->text), "%s", text);
+    key_trace_init(&entry->trace);
+    return entry;
+}
+
+static uint32_t fnv1a(uint32_t hash, const char *s) {
+    for (; *s; s++) {
+        hash ^= (uint8_t)*s;
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+// Function to drop the line ending (LF or CRLF)
+static void chomp(char *line) {
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+        line[--len] = '\0';
+    }
+}
+
+// Function to copy a field value, failing rather than truncating it
+static int copy_field(char *dst, size_t size, const char *value) {
+    size_t len = strlen(value);
+    if (len >= size) {
+        return -1;
+    }
+    memcpy(dst, value, len + 1);
+    return 0;
+}
+
+int corpus_load(TraceCorpus *corpus, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Failed to open corpus");
+        return -1;
+    }
+
+    char line[CORPUS_TEXT_MAX + 16];
+    LabelledTrace *entry = NULL;
+    size_t edges_left = 0;
+    int line_number = 0;
+    int status = 0;
+    uint32_t hash = 2166136261U;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        hash = fnv1a(hash, line);
+        chomp(line);
+
+        if (edges_left > 0) {
+            unsigned long long t;
+            int level;
+            if (sscanf(line, "%llu %d", &t, &level) != 2 || key_trace_add(&entry->trace, t, level) != 0) {
+                fprintf(stderr, "%s:%d: bad edge\n", path, line_number);
+                status = -1;
+                break;
+            }
+            edges_left--;
+            continue;
+        }
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+
+        if (strncmp(line, "trace ", 6) == 0) {
+            entry = corpus_add(corpus, line + 6, "", "");
+            if (entry == NULL) {
+                status = -1;
+                break;
+            }
+        } else if (entry == NULL) {
+            fprintf(stderr, "%s:%d: expected 'trace <id>'\n", path, line_number);
+            status = -1;
+            break;
+        } else if (strncmp(line, "operator ", 9) == 0) {
+            if (copy_field(entry->operator_name, sizeof(entry->operator_name), line + 9) != 0) {
+                fprintf(stderr, "%s:%d: operator longer than %d characters\n", path, line_number,
+                        CORPUS_OPERATOR_MAX - 1);
+                status = -1;
+                break;
+            }
+        } else if (strncmp(line, "text ", 5) == 0) {
+            if (copy_field(entry->text, sizeof(entry->text), line + 5) != 0) {
+                fprintf(stderr, "%s:%d: text longer than %d characters\n", path, line_number, CORPUS_TEXT_MAX - 1);
+                status = -1;
+                break;
+            }
+        } else if (strncmp(line, "edges ", 6) == 0) {
+            edges_left = strtoull(line + 6, NULL, 10);
+        } else if (strncmp(line, "end ", 4) == 0) {
+            uint64_t end = strtoull(line + 4, NULL, 10);
+            if (end > entry->trace.end_us) {
+                entry->trace.end_us = end;
+            }
+        } else {
+            fprintf(stderr, "%s:%d: unknown field\n", path, line_number);
+            status = -1;
+            break;
+        }
+    }
+    if (status == 0 && edges_left > 0) {
+        fprintf(stderr, "%s: truncated edge list\n", path);
+        status = -1;
+    }
+
+    fclose(file);
+    corpus->checksum = hash;
+    return status;
+}
+
+int corpus_write_entry(FILE *out, const LabelledTrace *entry) {
+    fprintf(out, "trace %s\noperator %s\ntext %s\nedges %zu\n",
+            entry->id, entry->operator_name, entry->text, entry->trace.count);
+    for (size_t i = 0; i < entry->trace.count; i++) {
+        fprintf(out, "%llu %d\n", (unsigned long long)entry->trace.edges[i].t_us, entry->trace.edges[i].level);
+    }
+    fprintf(out, "end %llu\n\n", (unsigned long long)entry->trace.end_us);
+    return ferror(out) ? -1 : 0;
+}
+
+int corpus_save(const TraceCorpus *corpus, const char *path) {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        perror("Failed to create corpus");
+        return -1;
+    }
+    fprintf(out, "%s\n", CORPUS_HEADER);
+    int status = 0;
+    for (size_t i = 0; i < corpus->count && status == 0; i++) {
+        status = corpus_write_entry(out, &corpus->entries[i]);
+    }
+    if (fclose(out) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        perror("Failed to write corpus");
+    }
+    return status;
+}
@@ -0,0 +1,49 @@
+#ifndef TRACE_CORPUS_H
+#define TRACE_CORPUS_H
+
+#include <stdio.h>
+#include "key_trace.h"
+
+// Labelled key trace corpus: recorded (or synthetic) key traces paired with
+// the text the operator meant to send. Plain text so corpora diff and merge
+// cleanly:
+//
+//   # morse trace corpus v1
+//   trace w1aw-0001
+//   operator W1AW
+//   text CQ CQ DE W1AW
+//   edges 184
+//   0 1                <- microseconds since the start, key level after the edge
+//   212344 0
+//   ...
+//   end 61840000       <- trace length in microseconds
+//
+// Entries follow each other in one file; blank lines and '#' lines are ignored.
+
+#define CORPUS_ID_MAX 64
+#define CORPUS_OPERATOR_MAX 32
+#define CORPUS_TEXT_MAX 1024
+#define CORPUS_HEADER "# morse trace corpus v1"
+
+typedef struct {
+    char id[CORPUS_ID_MAX];
+    char operator_name[CORPUS_OPERATOR_MAX];
+    char text[CORPUS_TEXT_MAX];   // Ground truth, letters, digits and spaces
+    KeyTrace trace;
+} LabelledTrace;
+
+typedef struct {
+    LabelledTrace *entries;
+    size_t count;
+    size_t capacity;
+    uint32_t checksum;            // FNV-1a of the file, to tell corpora apart in results
+} TraceCorpus;
+
+void corpus_init(TraceCorpus *corpus);
+void corpus_free(TraceCorpus *corpus);
+LabelledTrace *corpus_add(TraceCorpus *corpus, const char *id, const char *operator_name, const char *text);
+int corpus_load(TraceCorpus *corpus, const char *path);
+int corpus_write_entry(FILE *out, const LabelledTrace *entry);
+int corpus_save(const TraceCorpus *corpus, const char *path);
+
+#endif
@@ -0,0 +1,214 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "trace_score.h"
+#include "morse_decoder.h"
+
+#define HYP_MAX (CORPUS_TEXT_MAX * 2)
+
+typedef struct {
+    MorseDecoder decoder;
+    char hyp[HYP_MAX];
+    size_t hyp_len;
+    uint64_t last_element_us;   // When the most recent dot/dash was sent
+    uint64_t decided_us;        // When the idle gap after it reached gap_ticks
+    ScoreCounts *counts;
+} Replay;
+
+static int symbol_of(char c) {
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    }
+    if (c >= '0' && c <= '9') {
+        return SCORE_DIGITS + (c - '0');
+    }
+    return c == '?' ? SCORE_UNKNOWN : SCORE_EPSILON;
+}
+
+char score_symbol_char(int symbol) {
+    if (symbol < SCORE_DIGITS) {
+        return (char)('A' + symbol);
+    }
+    if (symbol < SCORE_UNKNOWN) {
+        return (char)('0' + symbol - SCORE_DIGITS);
+    }
+    return symbol == SCORE_UNKNOWN ? '?' : '_';
+}
+
+static void on_signal(int signal, uint64_t t_us, void *ctx) {
+    Replay *r = (Replay *)ctx;
+    char translated;
+
+    if (signal == REPLAY_GAP_DECIDED) {
+        r->decided_us = t_us;
+        return;
+    }
+    if (signal != MORSE_SIGNAL_GAP) {
+        r->last_element_us = t_us;
+    }
+    if (morse_decoder_signal(&r->decoder, signal, &translated) == MORSE_EVENT_CHAR) {
+        if (r->hyp_len < HYP_MAX) {
+            r->hyp[r->hyp_len++] = translated;
+        }
+        // Decision latency: the gap is known here, the assembly only sends it on the next press
+        uint64_t decided = r->decided_us >= r->last_element_us ? r->decided_us : t_us;
+        uint64_t latency = decided - r->last_element_us;
+        r->counts->latency_us_total += latency;
+        r->counts->latency_count++;
+        if (latency > r->counts->latency_us_max) {
+            r->counts->latency_us_max = latency;
+        }
+    }
+}
+
+// Function to align decoded text with the reference and count the edits
+static int align(const char *ref, const int *ref_word, size_t n, const char *hyp, size_t m, ScoreCounts *counts) {
+    uint16_t *d = malloc((n + 1) * (m + 1) * sizeof(uint16_t));
+    if (d == NULL) {
+        return -1;
+    }
+#define D(i, j) d[(i) * (m + 1) + (j)]
+    for (size_t i = 0; i <= n; i++) {
+        D(i, 0) = (uint16_t)i;
+    }
+    for (size_t j = 0; j <= m; j++) {
+        D(0, j) = (uint16_t)j;
+    }
+    for (size_t i = 1; i <= n; i++) {
+        for (size_t j = 1; j <= m; j++) {
+            uint16_t best = D(i - 1, j - 1) + (ref[i - 1] != hyp[j - 1]);
+            if (D(i - 1, j) + 1 < best) {
+                best = D(i - 1, j) + 1;
+            }
+            if (D(i, j - 1) + 1 < best) {
+                best = D(i, j - 1) + 1;
+            }
+            D(i, j) = best;
+        }
+    }
+
+    // Walk back, preferring matches and substitutions, marking damaged words
+    int words = n > 0 ? ref_word[n - 1] + 1 : 0;
+    char *word_bad = calloc(words + 1, 1);
+    if (word_bad == NULL) {
+        free(d);
+        return -1;
+    }
+    size_t i = n;
+    size_t j = m;
+    while (i > 0 || j > 0) {
+        if (i > 0 && j > 0 && D(i, j) == D(i - 1, j - 1) + (ref[i - 1] != hyp[j - 1])) {
+            counts->confusion[symbol_of(ref[i - 1])][symbol_of(hyp[j - 1])]++;
+            if (ref[i - 1] != hyp[j - 1]) {
+                counts->substitutions++;
+                word_bad[ref_word[i - 1]] = 1;
+            }
+            i--;
+            j--;
+        } else if (i > 0 && D(i, j) == D(i - 1, j) + 1) {
+            counts->confusion[symbol_of(ref[i - 1])][SCORE_EPSILON]++;
+            counts->deletions++;
+            word_bad[ref_word[i - 1]] = 1;
+            i--;
+        } else {
+            counts->confusion[SCORE_EPSILON][symbol_of(hyp[j - 1])]++;
+            counts->insertions++;
+            // Blame the word the insertion lands in (or the one before it)
+            if (words > 0) {
+                word_bad[i > 0 ? ref_word[i - 1] : 0] = 1;
+            }
+            j--;
+        }
+    }
+#undef D
+    for (int w = 0; w < words; w++) {
+        counts->word_errors += word_bad[w];
+    }
+    counts->ref_words += words;
+    free(word_bad);
+    free(d);
+    return 0;
+}
+
+// Function to decode one trace and score it against its ground truth.
+// Characters still buffered when the trace ends are flushed, as the next
+// press would do on the device. The decoded text goes to decoded if given.
+int score_trace(const LabelledTrace *entry, const MorseTiming *timing, ScoreCounts *counts, char *decoded, size_t decoded_len) {
+    Replay *r = calloc(1, sizeof(Replay));
+    char ref[CORPUS_TEXT_MAX];
+    int ref_word[CORPUS_TEXT_MAX];
+    size_t n = 0;
+    int word = 0;
+    int in_word = 0;
+
+    if (r == NULL) {
+        return -1;
+    }
+    memset(counts, 0, sizeof(*counts));
+    r->counts = counts;
+    morse_decoder_init(&r->decoder);
+
+    key_trace_replay(&entry->trace, timing, on_signal, r);
+    if (r->decoder.buffer_index > 0) {
+        on_signal(MORSE_SIGNAL_GAP, r->last_element_us, r);
+    }
+
+    // Reference: letters and digits only, words split on spaces
+    for (const char *s = entry->text; *s && n < CORPUS_TEXT_MAX; s++) {
+        char c = (char)toupper((unsigned char)*s);
+        if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+            ref[n] = c;
+            ref_word[n++] = word;
+            in_word = 1;
+        } else if (c == ' ' && in_word) {
+            word++;
+            in_word = 0;
+        }
+    }
+
+    counts->ref_chars = n;
+    counts->hyp_chars = r->hyp_len;
+    int status = align(ref, ref_word, n, r->hyp, r->hyp_len, counts);
+    if (decoded != NULL && decoded_len > 0) {
+        size_t len = r->hyp_len < decoded_len - 1 ? r->hyp_len : decoded_len - 1;
+        memcpy(decoded, r->hyp, len);
+        decoded[len] = '\0';
+    }
+    free(r);
+    return status;
+}
+
+void score_add(ScoreCounts *into, const ScoreCounts *from) {
+    into->ref_chars += from->ref_chars;
+    into->hyp_chars += from->hyp_chars;
+    into->substitutions += from->substitutions;
+    into->insertions += from->insertions;
+    into->deletions += from->deletions;
+    into->ref_words += from->ref_words;
+    into->word_errors += from->word_errors;
+    into->latency_us_total += from->latency_us_total;
+    into->latency_count += from->latency_count;
+    if (from->latency_us_max > into->latency_us_max) {
+        into->latency_us_max = from->latency_us_max;
+    }
+    for (int i = 0; i < SCORE_SYMBOLS; i++) {
+        for (int j = 0; j < SCORE_SYMBOLS; j++) {
+            into->confusion[i][j] += from->confusion[i][j];
+        }
+    }
+}
+
+double score_cer(const ScoreCounts *counts) {
+    uint64_t edits = counts->substitutions + counts->insertions + counts->deletions;
+    if (counts->ref_chars == 0) {
+        return edits ? 1.0 : 0.0;
+    }
+    return (double)edits / (double)counts->ref_chars;
+}
+
+double score_wer(const ScoreCounts *counts) {
+    if (counts->ref_words == 0) {
+        return 0.0;
+    }
+    return (double)counts->word_errors / (double)counts->ref_words;
+}
@@ -0,0 +1,39 @@
+#ifndef TRACE_SCORE_H
+#define TRACE_SCORE_H
+
+#include <stdint.h>
+#include "key_trace.h"
+#include "trace_corpus.h"
+
+// Accuracy of the decoder on one labelled trace. The trace is replayed
+// through the sampling-loop model and morse_decoder, and the decoded
+// characters are aligned with the ground truth (Levenshtein). Spaces in the
+// ground truth only mark word boundaries, since the decoder has no word gap:
+// a word is wrong if any of its letters, or anything inserted inside it, is.
+
+#define SCORE_SYMBOLS 38        // A-Z, 0-9, '?', and SCORE_EPSILON
+#define SCORE_DIGITS 26         // '0' is symbol 26
+#define SCORE_UNKNOWN 36        // '?' from the decoder
+#define SCORE_EPSILON 37        // Nothing: insertion (row) or deletion (column)
+
+typedef struct {
+    uint64_t ref_chars;
+    uint64_t hyp_chars;
+    uint64_t substitutions;
+    uint64_t insertions;
+    uint64_t deletions;
+    uint64_t ref_words;
+    uint64_t word_errors;
+    uint64_t latency_us_total;  // Last element released -> character decided (gap_ticks idle)
+    uint64_t latency_us_max;
+    uint64_t latency_count;
+    uint32_t confusion[SCORE_SYMBOLS][SCORE_SYMBOLS];  // [reference][decoded]
+} ScoreCounts;
+
+int score_trace(const LabelledTrace *entry, const MorseTiming *timing, ScoreCounts *counts, char *decoded, size_t decoded_len);
+void score_add(ScoreCounts *into, const ScoreCounts *from);
+double score_cer(const ScoreCounts *counts);
+double score_wer(const ScoreCounts *counts);
+char score_symbol_char(int symbol);
+
+#endif
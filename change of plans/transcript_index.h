@@ -0,0 +1,78 @@
+#ifndef TRANSCRIPT_INDEX_H
+#define TRANSCRIPT_INDEX_H
+
+#include <stdint.h>
+
+// On-disk inverted index over sealed transcript segments, written by
+// transcript_indexer and mmapped by transcript_query. Layout:
+//
+//   IndexHeader
+//   uint32_t    segments[segment_count]   sequence numbers already indexed
+//   IndexTerm   terms[term_count]         sorted by term text
+//   IndexPosting postings[posting_count]  grouped by term, sorted by (seq, offset, position)
+//   char        strings[strings_bytes]    term text, not NUL terminated
+//
+// The decoder keys no word spaces, so a line is one run of letters and a
+// word can't be a term. Terms are the character trigrams of each line
+// instead: its term characters, upper-cased, with a gram of up to
+// TRANSCRIPT_GRAM characters starting at every position (the last two are
+// shorter). A query matches a line where its own grams sit at consecutive
+// positions, i.e. anywhere in the line.
+
+#define TRANSCRIPT_INDEX_MAGIC 0x5849544DU  // "MTIX"
+#define TRANSCRIPT_INDEX_VERSION 2
+#define TRANSCRIPT_GRAM 3
+#define TRANSCRIPT_QUERY_MAX 256        // Term characters in a query
+
+// Terms are made of these, upper-cased; the indexer and queries filter text the same way
+static inline int transcript_is_term_char(char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '/';
+}
+
+static inline char transcript_term_upper(char c) {
+    return (c >= 'a' && c <= 'z') ? c - 32 : c;  // Decoder output is upper case
+}
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t segment_count;
+    uint32_t term_count;
+    uint64_t posting_count;
+    uint64_t strings_bytes;
+} IndexHeader;
+
+typedef struct {
+    uint64_t string_offset;  // Offset into the strings blob
+    uint64_t first_posting;  // Index of the first posting for this term
+    uint32_t posting_count;
+    uint32_t length;         // Term length in bytes
+} IndexTerm;
+
+typedef struct {
+    int64_t timestamp;       // Unix time of the transcript line
+    uint32_t seq;            // Segment sequence number
+    uint32_t offset;         // Byte offset of the line within the uncompressed segment
+    uint32_t position;       // Gram position among the line's term characters
+    uint32_t reserved;
+} IndexPosting;
+
+// Function to check that the tables the header describes fit in size bytes
+static inline int transcript_index_fits(const IndexHeader *h, uint64_t size) {
+    uint64_t end = sizeof(IndexHeader) + ((uint64_t)h->segment_count + (h->segment_count & 1)) * sizeof(uint32_t) +
+                   (uint64_t)h->term_count * sizeof(IndexTerm);
+    if (end > size || h->posting_count > (size - end) / sizeof(IndexPosting)) {
+        return 0;
+    }
+    end += h->posting_count * sizeof(IndexPosting);
+    return h->strings_bytes <= size - end;
+}
+
+// Function to check that a term's text and postings lie inside their tables
+static inline int transcript_index_term_fits(const IndexHeader *h, const IndexTerm *t) {
+    return t->length <= TRANSCRIPT_GRAM && t->length <= h->strings_bytes &&
+           t->string_offset <= h->strings_bytes - t->length &&
+           t->first_posting <= h->posting_count && t->posting_count <= h->posting_count - t->first_posting;
+}
+
+#endif
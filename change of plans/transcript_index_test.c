@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "morse_decoder.h"
+#include "transcript_log.h"
+
+// Checks the transcript index against real decoder output: keys a few
+// lines through the decoder, seals them into a transcript in a temporary
+// directory, runs ./transcript_indexer on it and asks ./transcript_query
+// for text that is and is not there. Run from the directory holding both
+// tools. Exits non-zero on the first failed check.
+//
+// gcc -o transcript_index_test transcript_index_test.c morse_decoder.c transcript_log.c lz4_lite.c -lpthread
+
+static const char *lines[] = {"CQ DE W1AW", "QST 73 DE K2ABC", NULL};
+
+static int failures = 0;
+
+// Function to key one line of text through the decoder, ending it with the
+// ten-dot endline signal, and return the decoded text
+static const char *key_line(MorseDecoder *decoder, const char *text) {
+    for (const char *s = text; *s; s++) {
+        const char *code = translate_english_to_morse(*s);
+        if (!code) {
+            continue;   // Word spaces are not keyed, as on the real key
+        }
+        for (const char *e = code; *e; e++) {
+            morse_decoder_signal(decoder, *e == '.' ? MORSE_SIGNAL_DOT : MORSE_SIGNAL_DASH, NULL);
+        }
+        morse_decoder_signal(decoder, MORSE_SIGNAL_GAP, NULL);
+    }
+    for (int i = 0; i < MORSE_ENDLINE_DOTS; i++) {
+        if (morse_decoder_signal(decoder, MORSE_SIGNAL_DOT, NULL) == MORSE_EVENT_LINE) {
+            return decoder->text_buffer;
+        }
+    }
+    return "";
+}
+
+// Function to run transcript_query and compare its exit status
+static void expect_query(const char *dir, const char *query, int hits) {
+    char command[512];
+    snprintf(command, sizeof(command), "./transcript_query -t %s/morse_output.txt %s > /dev/null", dir, query);
+    int status = system(command);
+    int found = status == 0;
+    if (found != hits) {
+        fprintf(stderr, "FAIL: query \"%s\" %s\n", query, hits ? "found nothing" : "matched");
+        failures++;
+    } else {
+        printf("ok: query \"%s\" %s\n", query, hits ? "matches" : "misses");
+    }
+}
+
+int main(void) {
+    char dir[] = "/tmp/transcript_index_testXXXXXX";
+    char path[TRANSCRIPT_PATH_MAX];
+    char command[512];
+    MorseDecoder decoder;
+
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/morse_output.txt", dir);
+    if (transcript_open(path, TRANSCRIPT_DEFAULT_MAX_BYTES, TRANSCRIPT_DEFAULT_MAX_AGE) != 0) {
+        return 1;
+    }
+    morse_decoder_init(&decoder);
+    for (int i = 0; lines[i]; i++) {
+        const char *text = key_line(&decoder, lines[i]);
+        printf("keyed \"%s\", decoded \"%s\"\n", lines[i], text);
+        transcript_append(text);
+    }
+    transcript_rotate();
+    transcript_close();
+
+    snprintf(command, sizeof(command), "./transcript_indexer %s > /dev/null", path);
+    if (system(command) != 0) {
+        fprintf(stderr, "FAIL: transcript_indexer\n");
+        return 1;
+    }
+
+    expect_query(dir, "W1AW", 1);
+    expect_query(dir, "CQ DE W1AW", 1);
+    expect_query(dir, "73", 1);
+    expect_query(dir, "K2", 1);
+    expect_query(dir, "QST 73 DE K2ABC", 1);
+    expect_query(dir, "W1AX", 0);
+    expect_query(dir, "W1AWQ", 0);
+
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    system(command);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,470 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "transcript_log.h"
+#include "transcript_index.h"
+#include "lz4_lite.h"
+
+// Builds or incrementally updates morse_output.index from the sealed
+// segments listed in morse_output.manifest. Segments are split into
+// trigrams (see transcript_index.h) in parallel, one worker per core, each
+// into its own term table.
+//
+// Usage: transcript_indexer [active_transcript_path] [-j threads]
+
+#define MAX_THREADS 64
+
+typedef struct {
+    char term[TRANSCRIPT_GRAM + 1];
+    uint32_t length;
+    IndexPosting *postings;
+    size_t count;
+    size_t capacity;
+} TermEntry;
+
+typedef struct {
+    TermEntry **slots;
+    size_t capacity;
+    size_t used;
+} TermMap;
+
+typedef struct {
+    const char *active_path;
+    TranscriptSegment *todo;
+    int todo_count;
+    atomic_int next;
+    TermMap maps[MAX_THREADS];
+    atomic_int failures;
+} IndexJob;
+
+typedef struct {
+    IndexJob *job;
+    int worker;
+} WorkerArg;
+
+static uint32_t hash_term(const char *term, size_t len) {
+    uint32_t h = 2166136261U;  // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)term[i]) * 16777619U;
+    }
+    return h;
+}
+
+static void termmap_init(TermMap *map) {
+    map->capacity = 1024;
+    map->used = 0;
+    map->slots = calloc(map->capacity, sizeof(TermEntry *));
+}
+
+// Function to find a term, inserting an empty entry if it is new
+static TermEntry *termmap_get(TermMap *map, const char *term, size_t len) {
+    if ((map->used + 1) * 10 >= map->capacity * 7) {
+        // Grow at 70% load and rehash
+        size_t new_capacity = map->capacity * 2;
+        TermEntry **slots = calloc(new_capacity, sizeof(TermEntry *));
+        for (size_t i = 0; i < map->capacity; i++) {
+            TermEntry *e = map->slots[i];
+            if (e == NULL) {
+                continue;
+            }
+            size_t j = hash_term(e->term, e->length) & (new_capacity - 1);
+            while (slots[j] != NULL) {
+                j = (j + 1) & (new_capacity - 1);
+            }
+            slots[j] = e;
+        }
+        free(map->slots);
+        map->slots = slots;
+        map->capacity = new_capacity;
+    }
+
+    size_t i = hash_term(term, len) & (map->capacity - 1);
+    while (map->slots[i] != NULL) {
+        TermEntry *e = map->slots[i];
+        if (e->length == len && memcmp(e->term, term, len) == 0) {
+            return e;
+        }
+        i = (i + 1) & (map->capacity - 1);
+    }
+
+    TermEntry *e = calloc(1, sizeof(TermEntry));
+    memcpy(e->term, term, len);
+    e->length = (uint32_t)len;
+    map->slots[i] = e;
+    map->used++;
+    return e;
+}
+
+static void add_posting(TermEntry *e, const IndexPosting *p) {
+    if (e->count == e->capacity) {
+        e->capacity = e->capacity ? e->capacity * 2 : 4;
+        e->postings = realloc(e->postings, e->capacity * sizeof(IndexPosting));
+    }
+    e->postings[e->count++] = *p;
+}
+
+// Function to load a segment (decompressing .lz4) into memory
+static char *load_segment(const char *path, int compressed, size_t *len) {
+    char *data = NULL;
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        return NULL;
+    }
+
+    FILE *out = open_memstream(&data, len);
+    if (out == NULL) {
+        fclose(in);
+        return NULL;
+    }
+
+    int status;
+    if (compressed) {
+        status = lz4_lite_decompress_stream(in, out);
+    } else {
+        char buf[16 * 1024];
+        size_t n;
+        status = 0;
+        while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+            fwrite(buf, 1, n, out);
+        }
+    }
+    fclose(in);
+    fclose(out);
+
+    if (status != 0) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+// Function to add one segment's grams to the worker's term table
+static int index_segment(const char *active_path, const TranscriptSegment *seg, TermMap *map) {
+    char path[TRANSCRIPT_PATH_MAX];
+    size_t len = 0;
+
+    if (transcript_segment_path(active_path, seg, path, sizeof(path)) != 0) {
+        return -1;
+    }
+    char *data = load_segment(path, seg->compressed, &len);
+    if (data == NULL) {
+        fprintf(stderr, "Failed to read segment %s\n", path);
+        return -1;
+    }
+    char *chars = malloc(len + 1);  // A line's term characters
+    if (chars == NULL) {
+        free(data);
+        return -1;
+    }
+
+    size_t pos = 0;
+    while (pos < len) {
+        size_t line_start = pos;
+        size_t line_end = pos;
+        while (line_end < len && data[line_end] != '\n') {
+            line_end++;
+        }
+        pos = line_end + 1;
+
+        // Lines are "<unix seconds> <text>"; the timestamp is not a term
+        time_t timestamp = 0;
+        if (line_end < len) {
+            data[line_end] = '\0';  // open_memstream already terminates the last line
+        }
+        const char *text = transcript_strip_timestamp(data + line_start, &timestamp);
+        const char *end = data + line_end;
+
+        IndexPosting posting;
+        posting.timestamp = timestamp;
+        posting.seq = seg->seq;
+        posting.offset = (uint32_t)line_start;
+        posting.reserved = 0;
+
+        size_t count = 0;
+        for (const char *p = text; p < end; p++) {
+            if (transcript_is_term_char(*p)) {
+                chars[count++] = transcript_term_upper(*p);
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            size_t gram = count - i < TRANSCRIPT_GRAM ? count - i : TRANSCRIPT_GRAM;
+            posting.position = (uint32_t)i;
+            add_posting(termmap_get(map, &chars[i], gram), &posting);
+        }
+    }
+
+    free(chars);
+    free(data);
+    return 0;
+}
+
+static void *index_worker(void *arg) {
+    WorkerArg *wa = (WorkerArg *)arg;
+    IndexJob *job = wa->job;
+    int i;
+
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->todo_count) {
+        if (index_segment(job->active_path, &job->todo[i], &job->maps[wa->worker]) != 0) {
+            atomic_fetch_add(&job->failures, 1);
+            job->todo[i].seq = 0;  // Do not record it as indexed, retry next run
+        }
+    }
+    return NULL;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const TermEntry *ea = *(const TermEntry *const *)a;
+    const TermEntry *eb = *(const TermEntry *const *)b;
+    uint32_t n = ea->length < eb->length ? ea->length : eb->length;
+    int c = memcmp(ea->term, eb->term, n);
+    if (c != 0) {
+        return c;
+    }
+    return (int)ea->length - (int)eb->length;
+}
+
+static int compare_postings(const void *a, const void *b) {
+    const IndexPosting *pa = (const IndexPosting *)a;
+    const IndexPosting *pb = (const IndexPosting *)b;
+    if (pa->seq != pb->seq) {
+        return pa->seq < pb->seq ? -1 : 1;
+    }
+    if (pa->offset != pb->offset) {
+        return pa->offset < pb->offset ? -1 : 1;
+    }
+    return (pa->position > pb->position) - (pa->position < pb->position);
+}
+
+static int seq_indexed(const uint32_t *seqs, uint32_t count, uint32_t seq) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (seqs[i] == seq) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to write the merged table to <index>.tmp and rename it into place
+static int write_index(const char *index_path, TermMap *map, const uint32_t *seqs, uint32_t seq_count) {
+    char tmp_path[TRANSCRIPT_PATH_MAX + 8];
+    TermEntry **entries = malloc((map->used + 1) * sizeof(TermEntry *));
+    size_t n = 0;
+    uint64_t posting_count = 0;
+    uint64_t strings_bytes = 0;
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        TermEntry *e = map->slots[i];
+        if (e != NULL) {
+            qsort(e->postings, e->count, sizeof(IndexPosting), compare_postings);
+            entries[n++] = e;
+            posting_count += e->count;
+            strings_bytes += e->length;
+        }
+    }
+    qsort(entries, n, sizeof(TermEntry *), compare_entries);
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", index_path);
+    FILE *out = fopen(tmp_path, "wb");
+    if (out == NULL) {
+        perror("Failed to create index");
+        free(entries);
+        return -1;
+    }
+
+    IndexHeader header = {TRANSCRIPT_INDEX_MAGIC, TRANSCRIPT_INDEX_VERSION, seq_count, (uint32_t)n,
+                          posting_count, strings_bytes};
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(seqs, sizeof(uint32_t), seq_count, out);
+    if (seq_count & 1) {
+        uint32_t pad = 0;
+        fwrite(&pad, sizeof(pad), 1, out);  // Keep the term table 8-byte aligned
+    }
+
+    uint64_t first = 0;
+    uint64_t str_off = 0;
+    for (size_t i = 0; i < n; i++) {
+        IndexTerm term = {str_off, first, (uint32_t)entries[i]->count, entries[i]->length};
+        fwrite(&term, sizeof(term), 1, out);
+        first += entries[i]->count;
+        str_off += entries[i]->length;
+    }
+    for (size_t i = 0; i < n; i++) {
+        fwrite(entries[i]->postings, sizeof(IndexPosting), entries[i]->count, out);
+    }
+    for (size_t i = 0; i < n; i++) {
+        fwrite(entries[i]->term, 1, entries[i]->length, out);
+    }
+    free(entries);
+
+    int failed = ferror(out);
+    fflush(out);
+    fsync(fileno(out));
+    fclose(out);
+    if (failed || rename(tmp_path, index_path) != 0) {
+        perror("Failed to write index");
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// Function to merge the existing index into the global table, returns indexed segment list
+static uint32_t *load_existing_index(const char *index_path, TermMap *map, uint32_t *seq_count) {
+    *seq_count = 0;
+    int fd = open(index_path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;  // First run
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IndexHeader)) {
+        close(fd);
+        return NULL;
+    }
+    const uint8_t *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+
+    const IndexHeader *header = (const IndexHeader *)base;
+    if (header->magic != TRANSCRIPT_INDEX_MAGIC || header->version != TRANSCRIPT_INDEX_VERSION) {
+        fprintf(stderr, "Ignoring incompatible index %s, rebuilding\n", index_path);
+        munmap((void *)base, st.st_size);
+        return NULL;
+    }
+    if (!transcript_index_fits(header, (uint64_t)st.st_size)) {
+        fprintf(stderr, "Ignoring truncated index %s, rebuilding\n", index_path);
+        munmap((void *)base, st.st_size);
+        return NULL;
+    }
+
+    const uint32_t *seqs = (const uint32_t *)(base + sizeof(IndexHeader));
+    const IndexTerm *terms = (const IndexTerm *)(seqs + header->segment_count + (header->segment_count & 1));
+    const IndexPosting *postings = (const IndexPosting *)(terms + header->term_count);
+    const char *strings = (const char *)(postings + header->posting_count);
+
+    for (uint32_t i = 0; i < header->term_count; i++) {
+        if (!transcript_index_term_fits(header, &terms[i])) {
+            fprintf(stderr, "Ignoring corrupt index %s, rebuilding\n", index_path);
+            munmap((void *)base, st.st_size);
+            return NULL;
+        }
+    }
+
+    uint32_t *copy = malloc(((size_t)header->segment_count + 1) * sizeof(uint32_t));
+    memcpy(copy, seqs, header->segment_count * sizeof(uint32_t));
+    *seq_count = header->segment_count;
+
+    for (uint32_t i = 0; i < header->term_count; i++) {
+        TermEntry *e = termmap_get(map, strings + terms[i].string_offset, terms[i].length);
+        for (uint32_t j = 0; j < terms[i].posting_count; j++) {
+            add_posting(e, &postings[terms[i].first_posting + j]);
+        }
+    }
+
+    munmap((void *)base, st.st_size);
+    return copy;
+}
+
+int main(int argc, char *argv[]) {
+    const char *active_path = "morse_output.txt";
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    char index_path[TRANSCRIPT_PATH_MAX];
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else {
+            active_path = argv[i];
+        }
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+
+    if (transcript_index_path(active_path, index_path, sizeof(index_path)) != 0) {
+        return -1;
+    }
+
+    static TranscriptSegment segs[TRANSCRIPT_MAX_SEGMENTS];
+    int seg_count = transcript_load_manifest(active_path, segs, TRANSCRIPT_MAX_SEGMENTS);
+
+    TermMap global;
+    termmap_init(&global);
+    uint32_t old_count;
+    uint32_t *old_seqs = load_existing_index(index_path, &global, &old_count);
+
+    // Only sealed segments that are not in the index yet
+    static IndexJob job;
+    job.active_path = active_path;
+    job.todo = malloc((seg_count + 1) * sizeof(TranscriptSegment));
+    job.todo_count = 0;
+    for (int i = 0; i < seg_count; i++) {
+        if (!seq_indexed(old_seqs, old_count, segs[i].seq)) {
+            job.todo[job.todo_count++] = segs[i];
+        }
+    }
+    if (job.todo_count == 0) {
+        printf("Index is up to date (%u segments)\n", old_count);
+        return 0;
+    }
+    if (threads > job.todo_count) {
+        threads = job.todo_count;
+    }
+
+    printf("Indexing %d new segments on %d threads...\n", job.todo_count, threads);
+    pthread_t tids[MAX_THREADS];
+    WorkerArg args[MAX_THREADS];
+    for (int t = 0; t < threads; t++) {
+        termmap_init(&job.maps[t]);
+        args[t].job = &job;
+        args[t].worker = t;
+        pthread_create(&tids[t], NULL, index_worker, &args[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+
+    // Merge the per-worker tables into the global one
+    for (int t = 0; t < threads; t++) {
+        TermMap *m = &job.maps[t];
+        for (size_t i = 0; i < m->capacity; i++) {
+            TermEntry *e = m->slots[i];
+            if (e == NULL) {
+                continue;
+            }
+            TermEntry *g = termmap_get(&global, e->term, e->length);
+            for (size_t j = 0; j < e->count; j++) {
+                add_posting(g, &e->postings[j]);
+            }
+        }
+    }
+
+    uint32_t *seqs = malloc((old_count + job.todo_count) * sizeof(uint32_t));
+    uint32_t seq_count = 0;
+    for (uint32_t i = 0; i < old_count; i++) {
+        seqs[seq_count++] = old_seqs[i];
+    }
+    for (int i = 0; i < job.todo_count; i++) {
+        if (job.todo[i].seq != 0) {
+            seqs[seq_count++] = job.todo[i].seq;
+        }
+    }
+
+    if (write_index(index_path, &global, seqs, seq_count) != 0) {
+        return -1;
+    }
+    printf("Wrote %s: %u segments, %zu terms\n", index_path, seq_count, global.used);
+    return atomic_load(&job.failures) ? 1 : 0;
+}
@@ -0,0 +1,428 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "transcript_log.h"
+#include "lz4_lite.h"
+
+static struct {
+    char active_path[TRANSCRIPT_PATH_MAX];
+    size_t max_bytes;
+    time_t max_age;
+
+    int fd;                 // Active segment, kept open to avoid open/close per line
+    size_t size;            // Bytes in the active segment
+    time_t start_time;      // Timestamp of the first line in the active segment
+    unsigned int next_seq;
+
+    TranscriptSegment segs[TRANSCRIPT_MAX_SEGMENTS];
+    int seg_count;
+
+    unsigned int queue[TRANSCRIPT_MAX_SEGMENTS];  // Sealed segments waiting for compression
+    int queue_head;
+    int queue_tail;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t compressor;
+    int running;
+} tlog = { .fd = -1, .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+// Function to split "dir/name.ext" into "dir/name" and ".ext"
+static void split_path(const char *path, char *base, size_t base_len, const char **ext) {
+    const char *slash = strrchr(path, '/');
+    const char *dot = strrchr(path, '.');
+    if (dot == NULL || (slash != NULL && dot < slash)) {
+        dot = path + strlen(path);
+    }
+    size_t n = (size_t)(dot - path);
+    if (n >= base_len) {
+        n = base_len - 1;
+    }
+    memcpy(base, path, n);
+    base[n] = '\0';
+    *ext = dot;
+}
+
+// Function to report a derived path that didn't fit, returns -1
+static int path_too_long(const char *active_path) {
+    fprintf(stderr, "Transcript path too long: %s\n", active_path);
+    return -1;
+}
+
+// The path functions return -1 if the path doesn't fit in out
+int transcript_manifest_path(const char *active_path, char *out, size_t out_len) {
+    char base[TRANSCRIPT_PATH_MAX];
+    const char *ext;
+    split_path(active_path, base, sizeof(base), &ext);
+    if (snprintf(out, out_len, "%s.manifest", base) >= (int)out_len) {
+        return path_too_long(active_path);
+    }
+    return 0;
+}
+
+int transcript_index_path(const char *active_path, char *out, size_t out_len) {
+    char base[TRANSCRIPT_PATH_MAX];
+    const char *ext;
+    split_path(active_path, base, sizeof(base), &ext);
+    if (snprintf(out, out_len, "%s.index", base) >= (int)out_len) {
+        return path_too_long(active_path);
+    }
+    return 0;
+}
+
+int transcript_segment_path(const char *active_path, const TranscriptSegment *seg, char *out, size_t out_len) {
+    char base[TRANSCRIPT_PATH_MAX];
+    const char *ext;
+    split_path(active_path, base, sizeof(base), &ext);
+    if (snprintf(out, out_len, "%s.%06u%s%s", base, seg->seq, ext, seg->compressed ? ".lz4" : "") >= (int)out_len) {
+        return path_too_long(active_path);
+    }
+    return 0;
+}
+
+// Function to read the manifest, returns the number of segments listed
+int transcript_load_manifest(const char *active_path, TranscriptSegment *segs, int max_segs) {
+    char path[TRANSCRIPT_PATH_MAX];
+    char line[256];
+    int count = 0;
+
+    if (transcript_manifest_path(active_path, path, sizeof(path)) != 0) {
+        return 0;
+    }
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return 0;  // No manifest yet
+    }
+
+    while (count < max_segs && fgets(line, sizeof(line), file)) {
+        long start, end;
+        unsigned long bytes;
+        unsigned int seq;
+        int compressed;
+        if (line[0] == '#') {
+            continue;
+        }
+        if (sscanf(line, "%u %ld %ld %lu %d", &seq, &start, &end, &bytes, &compressed) == 5) {
+            segs[count].seq = seq;
+            segs[count].start_time = (time_t)start;
+            segs[count].end_time = (time_t)end;
+            segs[count].raw_bytes = bytes;
+            segs[count].compressed = compressed;
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+// Function to atomically rewrite the manifest (write temp file, fsync, rename)
+static int write_manifest_locked(void) {
+    char path[TRANSCRIPT_PATH_MAX];
+    char tmp_path[TRANSCRIPT_PATH_MAX + 8];
+
+    if (transcript_manifest_path(tlog.active_path, path, sizeof(path)) != 0) {
+        return -1;
+    }
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *file = fopen(tmp_path, "w");
+    if (file == NULL) {
+        perror("Failed to write transcript manifest");
+        return -1;
+    }
+    fprintf(file, "# seq start_time end_time raw_bytes compressed\n");
+    for (int i = 0; i < tlog.seg_count; i++) {
+        TranscriptSegment *seg = &tlog.segs[i];
+        fprintf(file, "%u %ld %ld %lu %d\n", seg->seq, (long)seg->start_time, (long)seg->end_time,
+                (unsigned long)seg->raw_bytes, seg->compressed);
+    }
+    fflush(file);
+    fsync(fileno(file));
+    fclose(file);
+
+    if (rename(tmp_path, path) != 0) {
+        perror("Failed to replace transcript manifest");
+        return -1;
+    }
+    return 0;
+}
+
+static TranscriptSegment *find_segment_locked(unsigned int seq) {
+    for (int i = 0; i < tlog.seg_count; i++) {
+        if (tlog.segs[i].seq == seq) {
+            return &tlog.segs[i];
+        }
+    }
+    return NULL;
+}
+
+static void queue_compression_locked(unsigned int seq) {
+    int next = (tlog.queue_tail + 1) % TRANSCRIPT_MAX_SEGMENTS;
+    if (next == tlog.queue_head) {
+        return;  // Queue full, the segment stays uncompressed until next start
+    }
+    tlog.queue[tlog.queue_tail] = seq;
+    tlog.queue_tail = next;
+    pthread_cond_signal(&tlog.cond);
+}
+
+// Function to compress one sealed segment into <segment>.lz4
+static int compress_segment(const char *txt_path, const char *lz4_path) {
+    char tmp_path[TRANSCRIPT_PATH_MAX + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", lz4_path);
+
+    FILE *in = fopen(txt_path, "rb");
+    if (in == NULL) {
+        perror("Failed to open sealed transcript segment");
+        return -1;
+    }
+    FILE *out = fopen(tmp_path, "wb");
+    if (out == NULL) {
+        perror("Failed to create compressed transcript segment");
+        fclose(in);
+        return -1;
+    }
+
+    int status = lz4_lite_compress_stream(in, out);
+    fclose(in);
+    fflush(out);
+    fsync(fileno(out));
+    fclose(out);
+
+    if (status != 0 || rename(tmp_path, lz4_path) != 0) {
+        fprintf(stderr, "Failed to compress transcript segment %s\n", txt_path);
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// Background thread that compresses sealed segments off the decode path
+static void *compressor_thread(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&tlog.lock);
+    while (1) {
+        while (tlog.running && tlog.queue_head == tlog.queue_tail) {
+            pthread_cond_wait(&tlog.cond, &tlog.lock);
+        }
+        if (tlog.queue_head == tlog.queue_tail) {
+            break;  // Stopping and nothing left to do
+        }
+
+        unsigned int seq = tlog.queue[tlog.queue_head];
+        tlog.queue_head = (tlog.queue_head + 1) % TRANSCRIPT_MAX_SEGMENTS;
+        TranscriptSegment *seg = find_segment_locked(seq);
+        if (seg == NULL || seg->compressed) {
+            continue;
+        }
+
+        TranscriptSegment copy = *seg;
+        char txt_path[TRANSCRIPT_PATH_MAX];
+        char lz4_path[TRANSCRIPT_PATH_MAX];
+        if (transcript_segment_path(tlog.active_path, &copy, txt_path, sizeof(txt_path)) != 0) {
+            continue;
+        }
+        copy.compressed = 1;
+        if (transcript_segment_path(tlog.active_path, &copy, lz4_path, sizeof(lz4_path)) != 0) {
+            continue;  // Left uncompressed
+        }
+
+        pthread_mutex_unlock(&tlog.lock);
+        int status = compress_segment(txt_path, lz4_path);
+        pthread_mutex_lock(&tlog.lock);
+
+        if (status == 0) {
+            seg = find_segment_locked(seq);
+            if (seg != NULL) {
+                seg->compressed = 1;
+                write_manifest_locked();
+            }
+            unlink(txt_path);  // Only after the manifest points at the .lz4 file
+        }
+    }
+    pthread_mutex_unlock(&tlog.lock);
+    return NULL;
+}
+
+static int open_active_locked(void) {
+    tlog.fd = open(tlog.active_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (tlog.fd < 0) {
+        perror("Failed to open transcript file");
+        return -1;
+    }
+
+    struct stat st;
+    tlog.size = (fstat(tlog.fd, &st) == 0) ? (size_t)st.st_size : 0;
+    tlog.start_time = time(NULL);
+
+    if (tlog.size > 0) {
+        // Recover the age of an existing segment from its first line
+        FILE *file = fopen(tlog.active_path, "r");
+        long first = 0;
+        if (file != NULL) {
+            if (fscanf(file, "%ld", &first) == 1 && first > 0) {
+                tlog.start_time = (time_t)first;
+            }
+            fclose(file);
+        }
+    }
+    return 0;
+}
+
+// Function to seal the active segment and start a new one (lock held)
+static int rotate_locked(time_t now) {
+    if (tlog.size == 0) {
+        return 0;  // Nothing to seal
+    }
+
+    TranscriptSegment seg;
+    seg.seq = tlog.next_seq++;
+    seg.start_time = tlog.start_time;
+    seg.end_time = now;
+    seg.raw_bytes = tlog.size;
+    seg.compressed = 0;
+
+    char sealed_path[TRANSCRIPT_PATH_MAX];
+    if (transcript_segment_path(tlog.active_path, &seg, sealed_path, sizeof(sealed_path)) != 0) {
+        tlog.next_seq--;
+        return -1;  // Keep writing to the active file
+    }
+
+    fsync(tlog.fd);
+    close(tlog.fd);
+    tlog.fd = -1;
+
+    if (rename(tlog.active_path, sealed_path) != 0) {
+        perror("Failed to seal transcript segment");
+        return open_active_locked();
+    }
+
+    if (tlog.seg_count == TRANSCRIPT_MAX_SEGMENTS) {
+        // Manifest is full: forget the oldest entry, its file stays on disk
+        memmove(&tlog.segs[0], &tlog.segs[1], sizeof(TranscriptSegment) * (TRANSCRIPT_MAX_SEGMENTS - 1));
+        tlog.seg_count--;
+    }
+    tlog.segs[tlog.seg_count++] = seg;
+    write_manifest_locked();
+    queue_compression_locked(seg.seq);
+
+    printf("Sealed transcript segment: %s\n", sealed_path);
+    return open_active_locked();
+}
+
+// Function to open the active transcript and start the compressor thread
+int transcript_open(const char *active_path, size_t max_bytes, time_t max_age) {
+    pthread_mutex_lock(&tlog.lock);
+
+    snprintf(tlog.active_path, sizeof(tlog.active_path), "%s", active_path);
+    tlog.max_bytes = max_bytes;
+    tlog.max_age = max_age;
+    tlog.seg_count = transcript_load_manifest(active_path, tlog.segs, TRANSCRIPT_MAX_SEGMENTS);
+    tlog.queue_head = tlog.queue_tail = 0;
+    tlog.next_seq = 1;
+
+    for (int i = 0; i < tlog.seg_count; i++) {
+        if (tlog.segs[i].seq >= tlog.next_seq) {
+            tlog.next_seq = tlog.segs[i].seq + 1;
+        }
+        if (!tlog.segs[i].compressed) {
+            queue_compression_locked(tlog.segs[i].seq);  // Interrupted before compression
+        }
+    }
+
+    if (open_active_locked() != 0) {
+        pthread_mutex_unlock(&tlog.lock);
+        return -1;
+    }
+
+    tlog.running = 1;
+    if (pthread_create(&tlog.compressor, NULL, compressor_thread, NULL) != 0) {
+        fprintf(stderr, "Failed to start transcript compressor, segments stay uncompressed\n");
+        tlog.running = 0;
+    }
+
+    pthread_mutex_unlock(&tlog.lock);
+    return 0;
+}
+
+// Function to append one line, rotating first if the segment is too big or too old
+int transcript_append(const char *text) {
+    char line[512];
+    time_t now = time(NULL);
+    int len = snprintf(line, sizeof(line), "%ld %s\n", (long)now, text);
+    if (len >= (int)sizeof(line)) {
+        len = sizeof(line) - 1;
+        line[len - 1] = '\n';
+    }
+
+    pthread_mutex_lock(&tlog.lock);
+
+    if (tlog.size > 0 && (tlog.size + len > tlog.max_bytes || now - tlog.start_time >= tlog.max_age)) {
+        rotate_locked(now);
+    }
+    if (tlog.fd < 0) {
+        pthread_mutex_unlock(&tlog.lock);
+        return -1;
+    }
+    if (tlog.size == 0) {
+        tlog.start_time = now;
+    }
+
+    ssize_t written = write(tlog.fd, line, len);  // Single write keeps lines whole for readers
+    if (written > 0) {
+        tlog.size += written;
+    }
+
+    pthread_mutex_unlock(&tlog.lock);
+    return written == len ? 0 : -1;
+}
+
+int transcript_rotate(void) {
+    pthread_mutex_lock(&tlog.lock);
+    int status = rotate_locked(time(NULL));
+    pthread_mutex_unlock(&tlog.lock);
+    return status;
+}
+
+// Function to stop the compressor (after draining its queue) and close the file
+void transcript_close(void) {
+    pthread_mutex_lock(&tlog.lock);
+    int was_running = tlog.running;
+    tlog.running = 0;
+    pthread_cond_signal(&tlog.cond);
+    pthread_mutex_unlock(&tlog.lock);
+
+    if (was_running) {
+        pthread_join(tlog.compressor, NULL);
+    }
+    if (tlog.fd >= 0) {
+        close(tlog.fd);
+        tlog.fd = -1;
+    }
+}
+
+// Function to split "<unix seconds> <text>" lines, older lines pass through unchanged
+const char *transcript_strip_timestamp(const char *line, time_t *timestamp) {
+    const char *p = line;
+    long value = 0;
+
+    while (*p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    if (p == line || *p != ' ') {
+        if (timestamp) {
+            *timestamp = 0;
+        }
+        return line;
+    }
+    if (timestamp) {
+        *timestamp = (time_t)value;
+    }
+    return p + 1;
+}
@@ -0,0 +1,38 @@
+#ifndef TRANSCRIPT_LOG_H
+#define TRANSCRIPT_LOG_H
+
+#include <stddef.h>
+#include <time.h>
+
+// Rotating transcript writer. Lines are appended to the active file
+// (e.g. morse_output.txt) as "<unix seconds> <text>". When the active file
+// grows past max_bytes or is older than max_age seconds it is sealed as
+// morse_output.NNNNNN.txt, listed in morse_output.manifest, and compressed to
+// morse_output.NNNNNN.txt.lz4 by a background thread.
+
+#define TRANSCRIPT_DEFAULT_MAX_BYTES (256 * 1024)       // Rotate after 256 KB
+#define TRANSCRIPT_DEFAULT_MAX_AGE (24 * 60 * 60)       // Rotate after one day
+#define TRANSCRIPT_MAX_SEGMENTS 4096
+#define TRANSCRIPT_PATH_MAX 256
+
+typedef struct {
+    unsigned int seq;       // Segment sequence number
+    time_t start_time;      // Timestamp of the first line
+    time_t end_time;        // Timestamp when the segment was sealed
+    size_t raw_bytes;       // Uncompressed size
+    int compressed;         // 1 once the .lz4 file has replaced the .txt file
+} TranscriptSegment;
+
+int transcript_open(const char *active_path, size_t max_bytes, time_t max_age);
+int transcript_append(const char *text);
+int transcript_rotate(void);
+void transcript_close(void);
+
+// Helpers shared with readers of the archive
+int transcript_manifest_path(const char *active_path, char *out, size_t out_len);
+int transcript_index_path(const char *active_path, char *out, size_t out_len);
+int transcript_segment_path(const char *active_path, const TranscriptSegment *seg, char *out, size_t out_len);
+int transcript_load_manifest(const char *active_path, TranscriptSegment *segs, int max_segs);
+const char *transcript_strip_timestamp(const char *line, time_t *timestamp);
+
+#endif
@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "transcript_log.h"
+#include "transcript_index.h"
+
+// Answers queries from the mmapped transcript index.
+//
+// Usage: transcript_query [-t active_transcript_path] QUERY...
+//   W1AW          lines containing W1AW
+//   CQ DE W1AW    lines containing CQDEW1AW
+//
+// Decoded lines have no word spaces, so a query matches anywhere in a
+// line: its arguments are filtered as the indexer filters transcript lines
+// (term characters only, upper-cased) and joined. A trailing '*' is
+// accepted and changes nothing. Each matching line is printed once.
+
+typedef struct {
+    const IndexHeader *header;
+    const IndexTerm *terms;
+    const IndexPosting *postings;
+    const char *strings;
+} Index;
+
+// Function to compare an index term with a query string (ordering matches the indexer)
+static int compare_term(const Index *ix, const IndexTerm *t, const char *q, size_t qlen) {
+    size_t n = t->length < qlen ? t->length : qlen;
+    int c = memcmp(ix->strings + t->string_offset, q, n);
+    if (c != 0) {
+        return c;
+    }
+    return (t->length > qlen) - (t->length < qlen);
+}
+
+// Function to find the first term >= query
+static uint32_t lower_bound(const Index *ix, const char *q, size_t qlen) {
+    uint32_t lo = 0;
+    uint32_t hi = ix->header->term_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (compare_term(ix, &ix->terms[mid], q, qlen) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static const IndexTerm *find_term(const Index *ix, const char *q) {
+    size_t qlen = strlen(q);
+    uint32_t i = lower_bound(ix, q, qlen);
+    if (i < ix->header->term_count && compare_term(ix, &ix->terms[i], q, qlen) == 0) {
+        return &ix->terms[i];
+    }
+    return NULL;
+}
+
+// Function to check a posting list for (seq, offset, position) by binary search
+static int has_posting(const Index *ix, const IndexTerm *t, uint32_t seq, uint32_t offset, uint32_t position) {
+    const IndexPosting *p = ix->postings + t->first_posting;
+    uint32_t lo = 0;
+    uint32_t hi = t->posting_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const IndexPosting *m = &p[mid];
+        int before = m->seq != seq ? m->seq < seq : m->offset != offset ? m->offset < offset : m->position < position;
+        if (before) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < t->posting_count && p[lo].seq == seq && p[lo].offset == offset && p[lo].position == position;
+}
+
+static int compare_lines(const void *a, const void *b) {
+    const IndexPosting *pa = *(const IndexPosting *const *)a;
+    const IndexPosting *pb = *(const IndexPosting *const *)b;
+    if (pa->seq != pb->seq) {
+        return pa->seq < pb->seq ? -1 : 1;
+    }
+    return (pa->offset > pb->offset) - (pa->offset < pb->offset);
+}
+
+// Function to append a matching posting to the hit list
+static int add_hit(const IndexPosting ***hits, size_t *count, size_t *capacity, const IndexPosting *p) {
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 64;
+        const IndexPosting **grown = realloc(*hits, new_capacity * sizeof(*grown));
+        if (grown == NULL) {
+            perror("Failed to allocate hits");
+            return -1;
+        }
+        *hits = grown;
+        *capacity = new_capacity;
+    }
+    (*hits)[(*count)++] = p;
+    return 0;
+}
+
+static void print_hit(const IndexPosting *p) {
+    char when[32];
+    time_t ts = (time_t)p->timestamp;
+    struct tm tm;
+    localtime_r(&ts, &tm);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+    printf("segment %06u  offset %-8u  %s\n", p->seq, p->offset, when);
+}
+
+// Function to add an argument's term characters to the query the way the
+// indexer filters lines (upper-cased, everything else dropped). Returns
+// the new length, or -1 if the query gets too long.
+static int add_chars(const char *arg, char *query, int len) {
+    for (const char *p = arg; *p; p++) {
+        if (!transcript_is_term_char(*p)) {
+            continue;
+        }
+        if (len == TRANSCRIPT_QUERY_MAX) {
+            return -1;
+        }
+        query[len++] = transcript_term_upper(*p);
+    }
+    query[len] = '\0';
+    return len;
+}
+
+int main(int argc, char *argv[]) {
+    const char *active_path = "morse_output.txt";
+    char index_path[TRANSCRIPT_PATH_MAX];
+    char query[TRANSCRIPT_QUERY_MAX + 1] = "";
+    int len = 0;
+
+    for (int i = 1; i < argc && len >= 0; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            active_path = argv[++i];
+        } else {
+            len = add_chars(argv[i], query, len);
+        }
+    }
+    if (len < 0) {
+        fprintf(stderr, "Query longer than %d characters\n", TRANSCRIPT_QUERY_MAX);
+        return -1;
+    }
+    if (len == 0) {
+        fprintf(stderr, "Usage: %s [-t transcript] TEXT...\n", argv[0]);
+        return -1;
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    if (transcript_index_path(active_path, index_path, sizeof(index_path)) != 0) {
+        return -1;
+    }
+    int fd = open(index_path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open index (run transcript_indexer first)");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IndexHeader)) {
+        fprintf(stderr, "Index %s is truncated\n", index_path);
+        close(fd);
+        return -1;
+    }
+    const uint8_t *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map index");
+        return -1;
+    }
+
+    Index ix;
+    ix.header = (const IndexHeader *)base;
+    if (ix.header->magic != TRANSCRIPT_INDEX_MAGIC || ix.header->version != TRANSCRIPT_INDEX_VERSION) {
+        fprintf(stderr, "Index %s has an unknown format (run transcript_indexer)\n", index_path);
+        return -1;
+    }
+    if (!transcript_index_fits(ix.header, (uint64_t)st.st_size)) {
+        fprintf(stderr, "Index %s is truncated\n", index_path);
+        return -1;
+    }
+    const uint32_t *seqs = (const uint32_t *)(base + sizeof(IndexHeader));
+    ix.terms = (const IndexTerm *)(seqs + ix.header->segment_count + (ix.header->segment_count & 1));
+    ix.postings = (const IndexPosting *)(ix.terms + ix.header->term_count);
+    ix.strings = (const char *)(ix.postings + ix.header->posting_count);
+    for (uint32_t i = 0; i < ix.header->term_count; i++) {
+        if (!transcript_index_term_fits(ix.header, &ix.terms[i])) {
+            fprintf(stderr, "Index %s is corrupt\n", index_path);
+            return -1;
+        }
+    }
+
+    const IndexPosting **hits = NULL;
+    size_t hit_count = 0, hit_capacity = 0;
+    int failed = 0;
+
+    if (len < TRANSCRIPT_GRAM) {
+        // Shorter than a gram: every gram starting with the query is an occurrence
+        for (uint32_t i = lower_bound(&ix, query, (size_t)len); i < ix.header->term_count && !failed; i++) {
+            const IndexTerm *t = &ix.terms[i];
+            if (t->length < (uint32_t)len || memcmp(ix.strings + t->string_offset, query, (size_t)len) != 0) {
+                break;
+            }
+            for (uint32_t j = 0; j < t->posting_count && !failed; j++) {
+                failed = add_hit(&hits, &hit_count, &hit_capacity, &ix.postings[t->first_posting + j]) != 0;
+            }
+        }
+    } else {
+        // Anchor on the first gram, probe the query's other grams at the following positions
+        static const IndexTerm *grams[TRANSCRIPT_QUERY_MAX];
+        int gram_count = len - TRANSCRIPT_GRAM + 1;
+        char gram[TRANSCRIPT_GRAM + 1];
+        for (int k = 0; k < gram_count; k++) {
+            memcpy(gram, query + k, TRANSCRIPT_GRAM);
+            gram[TRANSCRIPT_GRAM] = '\0';
+            grams[k] = find_term(&ix, gram);
+            if (grams[k] == NULL) {
+                gram_count = 0;  // A missing gram means no line can match
+                break;
+            }
+        }
+        for (uint32_t j = 0; gram_count > 0 && j < grams[0]->posting_count && !failed; j++) {
+            const IndexPosting *p = &ix.postings[grams[0]->first_posting + j];
+            int match = 1;
+            for (int k = 1; k < gram_count && match; k++) {
+                match = has_posting(&ix, grams[k], p->seq, p->offset, p->position + (uint32_t)k);
+            }
+            if (match) {
+                failed = add_hit(&hits, &hit_count, &hit_capacity, p) != 0;
+            }
+        }
+    }
+
+    // One line per match, in transcript order
+    qsort(hits, hit_count, sizeof(*hits), compare_lines);
+    uint64_t lines = 0;
+    for (size_t i = 0; i < hit_count; i++) {
+        if (i == 0 || compare_lines(&hits[i - 1], &hits[i]) != 0) {
+            print_hit(hits[i]);
+            lines++;
+        }
+    }
+    free(hits);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    long us = (t1.tv_sec - t0.tv_sec) * 1000000L + (t1.tv_nsec - t0.tv_nsec) / 1000;
+    fprintf(stderr, "%llu lines in %ld us (%u segments indexed)\n", (unsigned long long)lines, us,
+            ix.header->segment_count);
+
+    munmap((void *)base, st.st_size);
+    if (failed) {
+        return -1;
+    }
+    return lines > 0 ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "work_pool.h"
+
+typedef struct {
+    WorkFn fn;
+    void *arg;
+} WorkItem;
+
+// Tasks in items[head, tail); the owner works at the tail, thieves at the head
+typedef struct {
+    pthread_mutex_t lock;
+    WorkItem *items;
+    size_t head;
+    size_t tail;
+    size_t capacity;
+} WorkDeque;
+
+struct WorkPool {
+    int threads;
+    pthread_t *tids;
+    WorkDeque *deques;
+    atomic_size_t queued;        // Tasks sitting in deques
+    atomic_size_t pending;       // Tasks submitted and not yet finished
+    atomic_size_t steals;
+    atomic_uint next_deque;      // Round robin for submits from outside the pool
+    pthread_mutex_t idle_lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t all_done;
+    int stopping;
+};
+
+typedef struct {
+    WorkPool *pool;
+    int index;
+} WorkerStart;
+
+static _Thread_local WorkPool *current_pool;
+static _Thread_local int current_index;
+
+static int deque_push(WorkDeque *d, WorkItem item) {
+    pthread_mutex_lock(&d->lock);
+    if (d->tail == d->capacity) {
+        // Slide live items to the front, grow if that isn't enough
+        size_t live = d->tail - d->head;
+        if (d->head > 0) {
+            memmove(d->items, d->items + d->head, live * sizeof(WorkItem));
+            d->head = 0;
+            d->tail = live;
+        }
+        if (d->tail == d->capacity) {
+            size_t capacity = d->capacity ? d->capacity * 2 : 64;
+            WorkItem *items = realloc(d->items, capacity * sizeof(WorkItem));
+            if (items == NULL) {
+                pthread_mutex_unlock(&d->lock);
+                return -1;
+            }
+            d->items = items;
+            d->capacity = capacity;
+        }
+    }
+    d->items[d->tail++] = item;
+    pthread_mutex_unlock(&d->lock);
+    return 0;
+}
+
+// Function for the owner: newest task first (still warm in cache)
+static int deque_pop(WorkDeque *d, WorkItem *item) {
+    int found = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->tail > d->head) {
+        *item = d->items[--d->tail];
+        found = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+// Function for thieves: oldest task, usually the biggest remaining chunk
+static int deque_steal(WorkDeque *d, WorkItem *item) {
+    int found = 0;
+    if (pthread_mutex_trylock(&d->lock) != 0) {
+        return 0;  // Busy, try the next victim
+    }
+    if (d->tail > d->head) {
+        *item = d->items[d->head++];
+        found = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+static int find_work(WorkPool *pool, int self, unsigned int *seed, WorkItem *item) {
+    if (deque_pop(&pool->deques[self], item)) {
+        return 1;
+    }
+    *seed = *seed * 1103515245U + 12345U;
+    int start = (int)((*seed >> 16) % (unsigned int)pool->threads);
+    for (int i = 0; i < pool->threads; i++) {
+        int victim = (start + i) % pool->threads;
+        if (victim != self && deque_steal(&pool->deques[victim], item)) {
+            atomic_fetch_add_explicit(&pool->steals, 1, memory_order_relaxed);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *worker_thread(void *arg) {
+    WorkerStart *start = (WorkerStart *)arg;
+    WorkPool *pool = start->pool;
+    int self = start->index;
+    unsigned int seed = (unsigned int)self * 2654435761U + 1;
+    WorkItem item;
+    free(start);
+
+    current_pool = pool;
+    current_index = self;
+    while (1) {
+        if (find_work(pool, self, &seed, &item)) {
+            atomic_fetch_sub(&pool->queued, 1);
+            item.fn(item.arg);
+            if (atomic_fetch_sub(&pool->pending, 1) == 1) {
+                pthread_mutex_lock(&pool->idle_lock);
+                pthread_cond_broadcast(&pool->all_done);
+                pthread_mutex_unlock(&pool->idle_lock);
+            }
+            continue;
+        }
+
+        // Nothing to run or steal: sleep until a submit (or shutdown)
+        pthread_mutex_lock(&pool->idle_lock);
+        while (!pool->stopping && atomic_load(&pool->queued) == 0) {
+            pthread_cond_wait(&pool->work_ready, &pool->idle_lock);
+        }
+        int done = pool->stopping && atomic_load(&pool->queued) == 0;
+        pthread_mutex_unlock(&pool->idle_lock);
+        if (done) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+WorkPool *work_pool_create(int threads) {
+    WorkPool *pool = calloc(1, sizeof(WorkPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->threads = threads > 0 ? threads : 1;
+    pool->tids = calloc(pool->threads, sizeof(pthread_t));
+    pool->deques = calloc(pool->threads, sizeof(WorkDeque));
+    if (pool->tids == NULL || pool->deques == NULL) {
+        free(pool->tids);
+        free(pool->deques);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+    for (int i = 0; i < pool->threads; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+
+    for (int i = 0; i < pool->threads; i++) {
+        WorkerStart *start = malloc(sizeof(WorkerStart));
+        start->pool = pool;
+        start->index = i;
+        if (pthread_create(&pool->tids[i], NULL, worker_thread, start) != 0) {
+            perror("Failed to start pool worker");
+            free(start);
+            pool->threads = i;  // Run with the workers we have
+            break;
+        }
+    }
+    if (pool->threads == 0) {
+        work_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+int work_pool_submit(WorkPool *pool, WorkFn fn, void *arg) {
+    WorkItem item = {fn, arg};
+    int target;
+    if (current_pool == pool) {
+        target = current_index;  // Spawned by a task: keep it local
+    } else {
+        target = (int)(atomic_fetch_add(&pool->next_deque, 1) % (unsigned int)pool->threads);
+    }
+
+    atomic_fetch_add(&pool->pending, 1);
+    if (deque_push(&pool->deques[target], item) != 0) {
+        atomic_fetch_sub(&pool->pending, 1);
+        return -1;
+    }
+    atomic_fetch_add(&pool->queued, 1);
+
+    pthread_mutex_lock(&pool->idle_lock);
+    pthread_cond_signal(&pool->work_ready);
+    pthread_mutex_unlock(&pool->idle_lock);
+    return 0;
+}
+
+// Function to block until every submitted task (and the tasks they submitted) has run
+void work_pool_wait(WorkPool *pool) {
+    pthread_mutex_lock(&pool->idle_lock);
+    while (atomic_load(&pool->pending) > 0) {
+        pthread_cond_wait(&pool->all_done, &pool->idle_lock);
+    }
+    pthread_mutex_unlock(&pool->idle_lock);
+}
+
+void work_pool_destroy(WorkPool *pool) {
+    work_pool_wait(pool);
+    pthread_mutex_lock(&pool->idle_lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->idle_lock);
+    for (int i = 0; i < pool->threads; i++) {
+        pthread_join(pool->tids[i], NULL);
+    }
+    for (int i = 0; i < pool->threads; i++) {
+        free(pool->deques[i].items);
+    }
+    free(pool->tids);
+    free(pool->deques);
+    free(pool);
+}
+
+size_t work_pool_steals(const WorkPool *pool) {
+    return atomic_load(&((WorkPool *)pool)->steals);
+}
@@ -0,0 +1,22 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stddef.h>
+
+// Work-stealing thread pool for the offline tools. Every worker owns a
+// deque: it runs its own tasks newest first, and when it runs out it
+// steals the oldest task from another worker. Uneven tasks (long and short
+// traces) therefore balance themselves across cores. Tasks may submit more
+// tasks; those go to the submitting worker's own deque.
+
+typedef void (*WorkFn)(void *arg);
+
+typedef struct WorkPool WorkPool;
+
+WorkPool *work_pool_create(int threads);
+int work_pool_submit(WorkPool *pool, WorkFn fn, void *arg);
+void work_pool_wait(WorkPool *pool);
+void work_pool_destroy(WorkPool *pool);
+size_t work_pool_steals(const WorkPool *pool);
+
+#endif